@@ -0,0 +1,736 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+// Headless benchmark of the point and the radius path pipelines.
+//
+// Loads the demo meshes, builds tiled navmeshes with the face data enabled and replays
+// a seeded random set of start/goal/radius queries through:
+//   point:  findPath -> findStraightPath
+//   radius: findPathByRadius -> funnel::straightPathByRadius -> dtRadiusModifier::applyModify
+// The searches are also run with DT_FINDPATH_BIDIRECTIONAL and with a landmark table for comparison.
+// The latency, the number of search nodes and the number of Detour allocations of every
+// stage are reported as percentiles.
+//
+// Usage: Benchmark_Radius [-n queries] [-s seed] [-d meshdir] [mesh.obj ...]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+
+#include "Recast.h"
+#include "DetourAlloc.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshBuilder.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourNode.h"
+#include "DetourLandmarks.h"
+#include "ChunkyTriMesh.h"
+#include "MeshLoaderObj.h"
+
+static const int MAX_POLYS = 256;
+static const int MAX_NODES = 2048;
+static const float MIN_RADIUS = 0.2f;
+static const float MAX_RADIUS = 2.0f;
+static const int LANDMARK_COUNT = 8;
+
+// Same defaults as the demo tile mesh sample.
+struct BuildSettings
+{
+	float cellSize;
+	float cellHeight;
+	float agentHeight;
+	float agentRadius;
+	float agentMaxClimb;
+	float agentMaxSlope;
+	float regionMinSize;
+	float regionMergeSize;
+	float edgeMaxLen;
+	float edgeMaxError;
+	float vertsPerPoly;
+	float detailSampleDist;
+	float detailSampleMaxError;
+	int tileSize;
+};
+
+static void initBuildSettings(BuildSettings& s)
+{
+	s.cellSize = 0.3f;
+	s.cellHeight = 0.2f;
+	s.agentHeight = 2.0f;
+	s.agentRadius = 0.6f;
+	s.agentMaxClimb = 0.9f;
+	s.agentMaxSlope = 45.0f;
+	s.regionMinSize = 8;
+	s.regionMergeSize = 20;
+	s.edgeMaxLen = 12.0f;
+	s.edgeMaxError = 1.3f;
+	s.vertsPerPoly = 6.0f;
+	s.detailSampleDist = 6.0f;
+	s.detailSampleMaxError = 1.0f;
+	s.tileSize = 32;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Seeded random numbers, findRandomPoint() only takes a function pointer.
+
+static unsigned int s_seed = 1;
+
+static float frand()
+{
+	s_seed = s_seed*1103515245u + 12345u;
+	return (float)((s_seed >> 8) & 0xffffff) / (float)0x1000000;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Counts the Detour allocations.
+
+static int s_allocCount = 0;
+
+static void* countingAlloc(size_t size, dtAllocHint /*hint*/)
+{
+	s_allocCount++;
+	return malloc(size);
+}
+
+static void countingFree(void* ptr)
+{
+	free(ptr);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+class Timer
+{
+	std::chrono::high_resolution_clock::time_point m_start;
+public:
+	Timer() : m_start(std::chrono::high_resolution_clock::now()) {}
+	float usec() const
+	{
+		const std::chrono::duration<float, std::micro> d = std::chrono::high_resolution_clock::now() - m_start;
+		return d.count();
+	}
+};
+
+// The samples of one stage.
+struct Stage
+{
+	const char* name;
+	std::vector<float> usec;
+	std::vector<float> nodes;
+	std::vector<float> allocs;
+	int succeeded;
+	bool hasNodes;
+
+	Stage(const char* n, bool searches) : name(n), succeeded(0), hasNodes(searches) {}
+};
+
+static float percentile(std::vector<float>& values, const float p)
+{
+	if (values.empty())
+		return 0.0f;
+	std::sort(values.begin(), values.end());
+	const int idx = dtMin((int)(p * values.size()), (int)values.size()-1);
+	return values[idx];
+}
+
+static void printStage(Stage& s)
+{
+	char nodes[64] = "-";
+	if (s.hasNodes)
+	{
+		snprintf(nodes, sizeof(nodes), "%6.0f %6.0f %6.0f",
+			percentile(s.nodes, 0.5f), percentile(s.nodes, 0.9f), percentile(s.nodes, 0.99f));
+	}
+	printf("  %-24s %6d  %8.1f %8.1f %8.1f  %-20s  %4.0f %4.0f %4.0f\n",
+		s.name, s.succeeded,
+		percentile(s.usec, 0.5f), percentile(s.usec, 0.9f), percentile(s.usec, 0.99f),
+		nodes,
+		percentile(s.allocs, 0.5f), percentile(s.allocs, 0.9f), percentile(s.allocs, 0.99f));
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Navmesh build, a condensed Sample_TileMesh::buildTileMesh().
+
+static unsigned char* buildTileMesh(rcContext* ctx, const BuildSettings& s,
+	const rcMeshLoaderObj& mesh, const rcChunkyTriMesh& chunkyMesh,
+	const int tx, const int ty, const float* bmin, const float* bmax, int& dataSize)
+{
+	rcConfig cfg;
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.cs = s.cellSize;
+	cfg.ch = s.cellHeight;
+	cfg.walkableSlopeAngle = s.agentMaxSlope;
+	cfg.walkableHeight = (int)ceilf(s.agentHeight / cfg.ch);
+	cfg.walkableClimb = (int)floorf(s.agentMaxClimb / cfg.ch);
+	cfg.walkableRadius = (int)ceilf(s.agentRadius / cfg.cs);
+	cfg.maxEdgeLen = (int)(s.edgeMaxLen / s.cellSize);
+	cfg.maxSimplificationError = s.edgeMaxError;
+	cfg.minRegionArea = (int)rcSqr(s.regionMinSize);
+	cfg.mergeRegionArea = (int)rcSqr(s.regionMergeSize);
+	cfg.maxVertsPerPoly = (int)s.vertsPerPoly;
+	cfg.tileSize = s.tileSize;
+	cfg.borderSize = cfg.walkableRadius + 3;
+	cfg.width = cfg.tileSize + cfg.borderSize*2;
+	cfg.height = cfg.tileSize + cfg.borderSize*2;
+	cfg.detailSampleDist = s.cellSize * s.detailSampleDist;
+	cfg.detailSampleMaxError = s.cellHeight * s.detailSampleMaxError;
+
+	rcVcopy(cfg.bmin, bmin);
+	rcVcopy(cfg.bmax, bmax);
+	cfg.bmin[0] -= cfg.borderSize*cfg.cs;
+	cfg.bmin[2] -= cfg.borderSize*cfg.cs;
+	cfg.bmax[0] += cfg.borderSize*cfg.cs;
+	cfg.bmax[2] += cfg.borderSize*cfg.cs;
+
+	dataSize = 0;
+	unsigned char* navData = 0;
+
+	rcHeightfield* solid = rcAllocHeightfield();
+	rcCompactHeightfield* chf = rcAllocCompactHeightfield();
+	rcContourSet* cset = rcAllocContourSet();
+	rcPolyMesh* pmesh = rcAllocPolyMesh();
+	rcPolyMeshDetail* dmesh = rcAllocPolyMeshDetail();
+	unsigned char* triareas = new unsigned char[chunkyMesh.maxTrisPerChunk];
+
+	bool ok = solid && chf && cset && pmesh && dmesh &&
+		rcCreateHeightfield(ctx, *solid, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs, cfg.ch);
+
+	float tbmin[2] = { cfg.bmin[0], cfg.bmin[2] };
+	float tbmax[2] = { cfg.bmax[0], cfg.bmax[2] };
+	int cid[512];
+	const int ncid = ok ? rcGetChunksOverlappingRect(&chunkyMesh, tbmin, tbmax, cid, 512) : 0;
+	ok = ok && ncid > 0;
+
+	for (int i = 0; ok && i < ncid; ++i)
+	{
+		const rcChunkyTriMeshNode& node = chunkyMesh.nodes[cid[i]];
+		const int* ctris = &chunkyMesh.tris[node.i*3];
+		const int nctris = node.n;
+		memset(triareas, 0, nctris*sizeof(unsigned char));
+		rcMarkWalkableTriangles(ctx, cfg.walkableSlopeAngle,
+			mesh.getVerts(), mesh.getVertCount(), ctris, nctris, triareas);
+		ok = rcRasterizeTriangles(ctx, mesh.getVerts(), mesh.getVertCount(), ctris, triareas, nctris, *solid, cfg.walkableClimb);
+	}
+
+	if (ok)
+	{
+		rcFilterLowHangingWalkableObstacles(ctx, cfg.walkableClimb, *solid);
+		rcFilterLedgeSpans(ctx, cfg.walkableHeight, cfg.walkableClimb, *solid);
+		rcFilterWalkableLowHeightSpans(ctx, cfg.walkableHeight, *solid);
+	}
+
+	ok = ok && rcBuildCompactHeightfield(ctx, cfg.walkableHeight, cfg.walkableClimb, *solid, *chf);
+	ok = ok && rcErodeWalkableArea(ctx, cfg.walkableRadius, *chf);
+	ok = ok && rcBuildDistanceField(ctx, *chf);
+	ok = ok && rcBuildRegions(ctx, *chf, cfg.borderSize, cfg.minRegionArea, cfg.mergeRegionArea);
+	ok = ok && rcBuildContours(ctx, *chf, cfg.maxSimplificationError, cfg.maxEdgeLen, *cset);
+	ok = ok && cset->nconts > 0;
+	ok = ok && rcBuildPolyMesh(ctx, *cset, cfg.maxVertsPerPoly, *pmesh);
+	ok = ok && rcBuildPolyMeshDetail(ctx, *pmesh, *chf, cfg.detailSampleDist, cfg.detailSampleMaxError, *dmesh);
+	ok = ok && pmesh->nverts < 0xffff && cfg.maxVertsPerPoly <= DT_VERTS_PER_POLYGON;
+
+	if (ok)
+	{
+		for (int i = 0; i < pmesh->npolys; ++i)
+			pmesh->flags[i] = pmesh->areas[i] == RC_WALKABLE_AREA ? 1 : 0;
+
+		dtNavMeshCreateParams params;
+		memset(&params, 0, sizeof(params));
+		params.verts = pmesh->verts;
+		params.vertCount = pmesh->nverts;
+		params.polys = pmesh->polys;
+		params.polyAreas = pmesh->areas;
+		params.polyFlags = pmesh->flags;
+		params.polyCount = pmesh->npolys;
+		params.nvp = pmesh->nvp;
+		params.detailMeshes = dmesh->meshes;
+		params.detailVerts = dmesh->verts;
+		params.detailVertsCount = dmesh->nverts;
+		params.detailTris = dmesh->tris;
+		params.detailTriCount = dmesh->ntris;
+		params.walkableHeight = s.agentHeight;
+		params.walkableRadius = s.agentRadius;
+		params.walkableClimb = s.agentMaxClimb;
+		params.tileX = tx;
+		params.tileY = ty;
+		params.tileLayer = 0;
+		rcVcopy(params.bmin, pmesh->bmin);
+		rcVcopy(params.bmax, pmesh->bmax);
+		params.cs = cfg.cs;
+		params.ch = cfg.ch;
+		params.buildBvTree = true;
+		params.buildFaceClearance = true;
+		params.buildFaceBvTree = true;
+		params.buildFaceAbstraction = true;
+		params.buildPolyTriangulation = true;
+		params.buildWideBvTree = true;
+
+		if (!dtCreateNavMeshData(&params, &navData, &dataSize))
+		{
+			navData = 0;
+			dataSize = 0;
+		}
+	}
+
+	delete [] triareas;
+	rcFreeHeightField(solid);
+	rcFreeCompactHeightfield(chf);
+	rcFreeContourSet(cset);
+	rcFreePolyMesh(pmesh);
+	rcFreePolyMeshDetail(dmesh);
+
+	return navData;
+}
+
+static dtNavMesh* buildNavMesh(rcContext* ctx, const BuildSettings& s, const rcMeshLoaderObj& mesh, int* tileCount)
+{
+	*tileCount = 0;
+
+	rcChunkyTriMesh chunkyMesh;
+	if (!rcCreateChunkyTriMesh(mesh.getVerts(), mesh.getTris(), mesh.getTriCount(), 256, &chunkyMesh))
+		return 0;
+
+	float bmin[3], bmax[3];
+	rcCalcBounds(mesh.getVerts(), mesh.getVertCount(), bmin, bmax);
+
+	int gw = 0, gh = 0;
+	rcCalcGridSize(bmin, bmax, s.cellSize, &gw, &gh);
+	const int ts = s.tileSize;
+	const int tw = (gw + ts-1) / ts;
+	const int th = (gh + ts-1) / ts;
+	const float tcs = s.tileSize*s.cellSize;
+
+	// There are 22 bits available for identifying a tile and a polygon.
+	int tileBits = 0;
+	while ((1 << tileBits) < tw*th)
+		tileBits++;
+	tileBits = rcMin(tileBits, 14);
+	const int polyBits = 22 - tileBits;
+
+	dtNavMeshParams params;
+	rcVcopy(params.orig, bmin);
+	params.tileWidth = tcs;
+	params.tileHeight = tcs;
+	params.maxTiles = 1 << tileBits;
+	params.maxPolys = 1 << polyBits;
+
+	dtNavMesh* nav = dtAllocNavMesh();
+	if (!nav || dtStatusFailed(nav->init(&params)))
+	{
+		dtFreeNavMesh(nav);
+		return 0;
+	}
+
+	for (int y = 0; y < th; ++y)
+	{
+		for (int x = 0; x < tw; ++x)
+		{
+			float tbmin[3], tbmax[3];
+			tbmin[0] = bmin[0] + x*tcs;
+			tbmin[1] = bmin[1];
+			tbmin[2] = bmin[2] + y*tcs;
+			tbmax[0] = bmin[0] + (x+1)*tcs;
+			tbmax[1] = bmax[1];
+			tbmax[2] = bmin[2] + (y+1)*tcs;
+
+			int dataSize = 0;
+			unsigned char* data = buildTileMesh(ctx, s, mesh, chunkyMesh, x, y, tbmin, tbmax, dataSize);
+			if (!data)
+				continue;
+			if (dtStatusFailed(nav->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, 0)))
+				dtFree(data);
+			else
+				(*tileCount)++;
+		}
+	}
+
+	return nav;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+struct Query
+{
+	dtPolyRef startRef, endRef;
+	float spos[3], epos[3];
+	float radius;
+};
+
+static void runQueries(const char* name, const dtNavMesh* nav, const int tileCount, const int queryCount, const unsigned int seed)
+{
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	funnel::dtRadiusPathScratch* scratch = new funnel::dtRadiusPathScratch;
+	if (!query || dtStatusFailed(query->init(nav, MAX_NODES)) || !scratch->init(MAX_POLYS + 3))
+	{
+		printf("%s: could not init the query.\n", name);
+		dtFreeNavMeshQuery(query);
+		delete scratch;
+		return;
+	}
+
+	dtQueryFilter filter;
+	const float halfExtents[3] = { 2, 4, 2 };
+
+	Timer landmarkTimer;
+	dtLandmarkTable landmarks;
+	const dtStatus landmarkStatus = landmarks.build(nav, LANDMARK_COUNT);
+	const float landmarkTime = landmarkTimer.usec();
+
+	// The queries are generated first so that both pipelines replay the same set.
+	s_seed = seed;
+	std::vector<Query> queries;
+	for (int i = 0; i < queryCount; ++i)
+	{
+		Query q;
+		if (dtStatusFailed(query->findRandomPoint(&filter, frand, &q.startRef, q.spos)) ||
+			dtStatusFailed(query->findRandomPoint(&filter, frand, &q.endRef, q.epos)))
+		{
+			continue;
+		}
+		q.radius = MIN_RADIUS + frand()*(MAX_RADIUS - MIN_RADIUS);
+		queries.push_back(q);
+	}
+
+	Stage findPath("findPath", true);
+	Stage findStraightPath("findStraightPath", false);
+	Stage pointTotal("point total", true);
+	Stage findPathBidir("findPath bidir", true);
+	Stage findPathAlt("findPath alt", true);
+	Stage findPathByRadius("findPathByRadius", true);
+	Stage findPathByRadiusBidir("findPathByRadius bidir", true);
+	Stage findPathByRadiusAlt("findPathByRadius alt", true);
+	Stage straightPathByRadius("straightPathByRadius", false);
+	Stage applyModify("applyModify", false);
+	Stage radiusTotal("radius total", true);
+
+	dtPolyRef polys[MAX_POLYS];
+	dtPolyFace faces[MAX_POLYS];
+	dtPolyEdge edges[MAX_POLYS];
+	float straightPath[MAX_POLYS*3];
+	float modifiedPath[MAX_POLYS*2*3];
+
+	dtAllocSetCustom(countingAlloc, countingFree);
+
+	for (size_t i = 0; i < queries.size(); ++i)
+	{
+		const Query& q = queries[i];
+
+		// Point pipeline.
+		{
+			int npolys = 0;
+			int nstraight = 0;
+
+			s_allocCount = 0;
+			Timer t0;
+			const dtStatus status = query->findPath(q.startRef, q.endRef, q.spos, q.epos, &filter, polys, &npolys, MAX_POLYS);
+			const float searchTime = t0.usec();
+			const float searchAllocs = (float)s_allocCount;
+			const float nodes = (float)query->getNodePool()->getNodeCount();
+
+			s_allocCount = 0;
+			Timer t1;
+			const dtStatus straightStatus = npolys ?
+				query->findStraightPath(q.spos, q.epos, polys, npolys, straightPath, 0, 0, &nstraight, MAX_POLYS) : DT_FAILURE;
+			const float straightTime = t1.usec();
+			const float straightAllocs = (float)s_allocCount;
+
+			findPath.usec.push_back(searchTime);
+			findPath.nodes.push_back(nodes);
+			findPath.allocs.push_back(searchAllocs);
+			findStraightPath.usec.push_back(straightTime);
+			findStraightPath.allocs.push_back(straightAllocs);
+			pointTotal.usec.push_back(searchTime + straightTime);
+			pointTotal.nodes.push_back(nodes);
+			pointTotal.allocs.push_back(searchAllocs + straightAllocs);
+
+			if (dtStatusSucceed(status) && !dtStatusDetail(status, DT_PARTIAL_RESULT))
+			{
+				findPath.succeeded++;
+				pointTotal.succeeded++;
+			}
+			if (dtStatusSucceed(straightStatus))
+				findStraightPath.succeeded++;
+
+			s_allocCount = 0;
+			Timer t2;
+			const dtStatus bidirStatus = query->findPath(q.startRef, q.endRef, q.spos, q.epos, &filter, polys, &npolys, MAX_POLYS,
+				DT_FINDPATH_BIDIRECTIONAL);
+			findPathBidir.usec.push_back(t2.usec());
+			findPathBidir.nodes.push_back((float)query->getNodePool()->getNodeCount());
+			findPathBidir.allocs.push_back((float)s_allocCount);
+			if (dtStatusSucceed(bidirStatus) && !dtStatusDetail(bidirStatus, DT_PARTIAL_RESULT))
+				findPathBidir.succeeded++;
+
+			query->setLandmarkTable(&landmarks);
+			s_allocCount = 0;
+			Timer t3;
+			const dtStatus altStatus = query->findPath(q.startRef, q.endRef, q.spos, q.epos, &filter, polys, &npolys, MAX_POLYS);
+			findPathAlt.usec.push_back(t3.usec());
+			findPathAlt.nodes.push_back((float)query->getNodePool()->getNodeCount());
+			findPathAlt.allocs.push_back((float)s_allocCount);
+			if (dtStatusSucceed(altStatus) && !dtStatusDetail(altStatus, DT_PARTIAL_RESULT))
+				findPathAlt.succeeded++;
+			query->setLandmarkTable(0);
+		}
+
+		// Radius pipeline. The start and end faces are looked up outside of the timed stages,
+		// like the polygons of the point pipeline.
+		{
+			dtPolyFace startFace, endFace;
+			float snearest[3], enearest[3];
+			query->findNearestFace(q.spos, halfExtents, &filter, &startFace, snearest);
+			query->findNearestFace(q.epos, halfExtents, &filter, &endFace, enearest);
+			if (!startFace.isValid() || !endFace.isValid())
+				continue;
+
+			int nfaces = 0;
+			int nedges = 0;
+			int nstraight = 0;
+			int nmodified = 0;
+
+			s_allocCount = 0;
+			Timer t0;
+			const dtStatus status = query->findPathByRadius(startFace, endFace, snearest, enearest, &filter,
+				faces, &nfaces, MAX_POLYS, edges, &nedges, MAX_POLYS, q.radius
+				);
+			const float searchTime = t0.usec();
+			const float searchAllocs = (float)s_allocCount;
+			const float nodes = (float)query->getNodePool()->getNodeCount();
+
+			s_allocCount = 0;
+			Timer t1;
+			const dtStatus straightStatus = nfaces ?
+				funnel::straightPathByRadius(snearest, enearest, faces, nfaces, edges, nedges,
+					straightPath, 0, 0, &nstraight, MAX_POLYS, q.radius, scratch
+					) : DT_FAILURE;
+			const float straightTime = t1.usec();
+			const float straightAllocs = (float)s_allocCount;
+
+			s_allocCount = 0;
+			Timer t2;
+			funnel::dtRadiusModifier modifier(q.radius, 10.0f);
+			const dtStatus modifyStatus = nstraight ?
+				modifier.applyModify(straightPath, nstraight, modifiedPath, &nmodified, MAX_POLYS*2, scratch
+					) : DT_FAILURE;
+			const float modifyTime = t2.usec();
+			const float modifyAllocs = (float)s_allocCount;
+
+			findPathByRadius.usec.push_back(searchTime);
+			findPathByRadius.nodes.push_back(nodes);
+			findPathByRadius.allocs.push_back(searchAllocs);
+			straightPathByRadius.usec.push_back(straightTime);
+			straightPathByRadius.allocs.push_back(straightAllocs);
+			applyModify.usec.push_back(modifyTime);
+			applyModify.allocs.push_back(modifyAllocs);
+			radiusTotal.usec.push_back(searchTime + straightTime + modifyTime);
+			radiusTotal.nodes.push_back(nodes);
+			radiusTotal.allocs.push_back(searchAllocs + straightAllocs + modifyAllocs);
+
+			if (dtStatusSucceed(status) && !dtStatusDetail(status, DT_PARTIAL_RESULT))
+			{
+				findPathByRadius.succeeded++;
+				radiusTotal.succeeded++;
+			}
+			if (dtStatusSucceed(straightStatus))
+				straightPathByRadius.succeeded++;
+			if (dtStatusSucceed(modifyStatus))
+				applyModify.succeeded++;
+
+			s_allocCount = 0;
+			Timer t3;
+			const dtStatus bidirStatus = query->findPathByRadius(startFace, endFace, snearest, enearest, &filter,
+				faces, &nfaces, MAX_POLYS, edges, &nedges, MAX_POLYS, q.radius, DT_FINDPATH_BIDIRECTIONAL);
+			findPathByRadiusBidir.usec.push_back(t3.usec());
+			findPathByRadiusBidir.nodes.push_back((float)query->getNodePool()->getNodeCount());
+			findPathByRadiusBidir.allocs.push_back((float)s_allocCount);
+			if (dtStatusSucceed(bidirStatus) && !dtStatusDetail(bidirStatus, DT_PARTIAL_RESULT))
+				findPathByRadiusBidir.succeeded++;
+
+			query->setLandmarkTable(&landmarks);
+			s_allocCount = 0;
+			Timer t4;
+			const dtStatus altStatus = query->findPathByRadius(startFace, endFace, snearest, enearest, &filter,
+				faces, &nfaces, MAX_POLYS, edges, &nedges, MAX_POLYS, q.radius);
+			findPathByRadiusAlt.usec.push_back(t4.usec());
+			findPathByRadiusAlt.nodes.push_back((float)query->getNodePool()->getNodeCount());
+			findPathByRadiusAlt.allocs.push_back((float)s_allocCount);
+			if (dtStatusSucceed(altStatus) && !dtStatusDetail(altStatus, DT_PARTIAL_RESULT))
+				findPathByRadiusAlt.succeeded++;
+			query->setLandmarkTable(0);
+		}
+	}
+
+	dtAllocSetCustom(0, 0);
+
+	// Snapping all the query end points, one by one and in one batch.
+	std::vector<float> centers;
+	for (size_t i = 0; i < queries.size(); ++i)
+	{
+		centers.insert(centers.end(), queries[i].spos, queries[i].spos + 3);
+		centers.insert(centers.end(), queries[i].epos, queries[i].epos + 3);
+	}
+	const int pointCount = (int)centers.size() / 3;
+	std::vector<dtPolyRef> nearestRefs(pointCount);
+	std::vector<float> nearestX(pointCount), nearestY(pointCount), nearestZ(pointCount);
+	Timer nearestTimer;
+	for (int i = 0; i < pointCount; ++i)
+	{
+		float pt[3];
+		query->findNearestPoly(&centers[i*3], halfExtents, &filter, &nearestRefs[i], pt);
+	}
+	const float nearestTime = nearestTimer.usec();
+	Timer nearestBatchTimer;
+	query->findNearestPolys(centers.data(), pointCount, halfExtents, &filter,
+		nearestRefs.data(), nearestX.data(), nearestY.data(), nearestZ.data());
+	const float nearestBatchTime = nearestBatchTimer.usec();
+
+	// Polygons around the query end points, through the wide BV trees of the tiles.
+	const float queryExtents[3] = { 8, 4, 8 };
+	dtPolyRef queryPolys[MAX_POLYS];
+	int queryPolyCount = 0;
+	long long queryPolyTotal = 0;
+	Timer queryTimer;
+	for (int i = 0; i < pointCount; ++i)
+	{
+		query->queryPolygons(&centers[i*3], queryExtents, &filter, queryPolys, &queryPolyCount, MAX_POLYS);
+		queryPolyTotal += queryPolyCount;
+	}
+	const float queryTime = queryTimer.usec();
+
+	// Line of sight rays around each query start point, one by one and in one batch.
+	static const int RAYS_PER_POINT = 16;
+	static const float RAY_LENGTH = 10.0f;
+	const int rayCount = (int)queries.size() * RAYS_PER_POINT;
+	std::vector<dtPolyRef> rayRefs(rayCount);
+	std::vector<float> rayStarts(rayCount*3), rayEnds(rayCount*3);
+	for (int i = 0; i < rayCount; ++i)
+	{
+		const Query& q = queries[i / RAYS_PER_POINT];
+		const float angle = (float)(i % RAYS_PER_POINT) * (2.0f * RC_PI / RAYS_PER_POINT);
+		rayRefs[i] = q.startRef;
+		rcVcopy(&rayStarts[i*3], q.spos);
+		rayEnds[i*3+0] = q.spos[0] + cosf(angle) * RAY_LENGTH;
+		rayEnds[i*3+1] = q.spos[1];
+		rayEnds[i*3+2] = q.spos[2] + sinf(angle) * RAY_LENGTH;
+	}
+	std::vector<dtRaycastHit> rayHits(rayCount);
+	std::vector<dtPolyRef> rayPaths(rayCount * MAX_POLYS);
+	for (int i = 0; i < rayCount; ++i)
+	{
+		rayHits[i].path = &rayPaths[i * MAX_POLYS];
+		rayHits[i].maxPath = MAX_POLYS;
+	}
+	Timer rayTimer;
+	for (int i = 0; i < rayCount; ++i)
+		query->raycast(rayRefs[i], &rayStarts[i*3], &rayEnds[i*3], &filter, 0, &rayHits[i]);
+	const float rayTime = rayTimer.usec();
+	Timer rayBatchTimer;
+	query->raycasts(rayRefs.data(), rayStarts.data(), rayEnds.data(), rayCount, &filter, 0, rayHits.data());
+	const float rayBatchTime = rayBatchTimer.usec();
+
+	printf("%s: %d tiles, %d queries, seed %u, radius %.1f..%.1f\n",
+		name, tileCount, (int)queries.size(), seed, MIN_RADIUS, MAX_RADIUS);
+	printf("  landmark table: %d landmarks, %s in %.1f ms\n",
+		LANDMARK_COUNT, dtStatusSucceed(landmarkStatus) ? "built" : "failed", landmarkTime / 1000.0f);
+	printf("  nearest polys: %d points, findNearestPoly %.1f us, findNearestPolys %.1f us\n",
+		pointCount, nearestTime, nearestBatchTime);
+	printf("  query polygons: %d boxes, %lld polys, %.1f us\n", pointCount, queryPolyTotal, queryTime);
+	printf("  raycasts: %d rays, raycast %.1f us, raycasts %.1f us\n", rayCount, rayTime, rayBatchTime);
+	printf("  %-24s %6s  %8s %8s %8s  %-20s  %-14s\n",
+		"stage", "ok", "p50 us", "p90 us", "p99 us", "nodes p50/p90/p99", "allocs p50/p90/p99");
+	printStage(findPath);
+	printStage(findStraightPath);
+	printStage(pointTotal);
+	printStage(findPathBidir);
+	printStage(findPathAlt);
+	printStage(findPathByRadius);
+	printStage(straightPathByRadius);
+	printStage(applyModify);
+	printStage(radiusTotal);
+	printStage(findPathByRadiusBidir);
+	printStage(findPathByRadiusAlt);
+	printf("\n");
+
+	dtFreeNavMeshQuery(query);
+	delete scratch;
+}
+
+int main(int argc, char** argv)
+{
+	int queryCount = 1000;
+	unsigned int seed = 1;
+	std::string meshDir = "Meshes";
+	std::vector<std::string> meshes;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-n") == 0 && i+1 < argc)
+			queryCount = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-s") == 0 && i+1 < argc)
+			seed = (unsigned int)strtoul(argv[++i], 0, 10);
+		else if (strcmp(argv[i], "-d") == 0 && i+1 < argc)
+			meshDir = argv[++i];
+		else if (argv[i][0] == '-')
+		{
+			printf("Usage: %s [-n queries] [-s seed] [-d meshdir] [mesh.obj ...]\n", argv[0]);
+			return 1;
+		}
+		else
+			meshes.push_back(argv[i]);
+	}
+	if (meshes.empty())
+	{
+		meshes.push_back("dungeon.obj");
+		meshes.push_back("nav_test.obj");
+	}
+
+	BuildSettings settings;
+	initBuildSettings(settings);
+	rcContext ctx(false);
+
+	for (size_t i = 0; i < meshes.size(); ++i)
+	{
+		rcMeshLoaderObj mesh;
+		const std::string path = meshDir + "/" + meshes[i];
+		if (!mesh.load(path))
+		{
+			printf("%s: could not load the mesh.\n", path.c_str());
+			continue;
+		}
+
+		int tileCount = 0;
+		dtNavMesh* nav = buildNavMesh(&ctx, settings, mesh, &tileCount);
+		if (!nav || !tileCount)
+		{
+			printf("%s: could not build the navmesh.\n", path.c_str());
+			dtFreeNavMesh(nav);
+			continue;
+		}
+
+		runQueries(meshes[i].c_str(), nav, tileCount, queryCount, seed);
+
+		dtFreeNavMesh(nav);
+	}
+
+	return 0;
+}
@@ -22,6 +22,12 @@
 #include "DetourMath.h"
 #include <stddef.h>
 
+// SSE2 is part of every x86-64 target. Define DT_NO_SIMD in the build config to use the scalar code.
+#if !defined(DT_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define DT_SSE2 1
+#include <emmintrin.h>
+#endif
+
 /**
 @defgroup detour Detour
 
@@ -362,6 +368,41 @@ inline bool dtOverlapQuantBounds(const unsigned short amin[3], const unsigned sh
 	return overlap;
 }
 
+/// Determines which of eight axis-aligned bounding boxes overlap a box, all eight at once.
+///  @param[in]		amin	Minimum bounds of box A. [(x, y, z)]
+///  @param[in]		amax	Maximum bounds of box A. [(x, y, z)]
+///  @param[in]		bmin	Minimum bounds of the boxes B, stored by axis. [(x * 8, y * 8, z * 8)]
+///  @param[in]		bmax	Maximum bounds of the boxes B, stored by axis. [(x * 8, y * 8, z * 8)]
+/// @return The boxes B overlapping box A, bit i is set for box i.
+/// @see dtOverlapQuantBounds
+inline unsigned int dtOverlapQuantBounds8(const unsigned short amin[3], const unsigned short amax[3],
+										  const unsigned short* bmin, const unsigned short* bmax)
+{
+#ifdef DT_SSE2
+	// a <= b for unsigned shorts when the saturated a - b is zero.
+	__m128i sep = _mm_setzero_si128();
+	for (int i = 0; i < 3; ++i)
+	{
+		const __m128i lo = _mm_loadu_si128((const __m128i*)(bmin + i*8));
+		const __m128i hi = _mm_loadu_si128((const __m128i*)(bmax + i*8));
+		sep = _mm_or_si128(sep, _mm_subs_epu16(_mm_set1_epi16((short)amin[i]), hi));
+		sep = _mm_or_si128(sep, _mm_subs_epu16(lo, _mm_set1_epi16((short)amax[i])));
+	}
+	const __m128i overlap = _mm_cmpeq_epi16(sep, _mm_setzero_si128());
+	return (unsigned int)_mm_movemask_epi8(_mm_packs_epi16(overlap, _mm_setzero_si128()));
+#else
+	unsigned int mask = 0;
+	for (int j = 0; j < 8; ++j)
+	{
+		bool overlap = true;
+		for (int i = 0; i < 3; ++i)
+			overlap = (amin[i] > bmax[i*8+j] || amax[i] < bmin[i*8+j]) ? false : overlap;
+		mask |= overlap ? (1u << j) : 0;
+	}
+	return mask;
+#endif
+}
+
 /// Determines if two axis-aligned bounding boxes overlap.
 ///  @param[in]		amin	Minimum bounds of box A. [(x, y, z)]
 ///  @param[in]		amax	Maximum bounds of box A. [(x, y, z)]
@@ -401,6 +442,25 @@ bool dtIntersectSegmentPoly2D(const float* p0, const float* p1,
 							  float& tmin, float& tmax,
 							  int& segMin, int& segMax);
 
+/// Intersects four segments with the same convex polygon on the xz-plane, see dtIntersectSegmentPoly2D.
+/// The segments are stored by coordinate and the results match dtIntersectSegmentPoly2D for each segment.
+///  @param[in]		p0x		The x of the segment starts. [4]
+///  @param[in]		p0z		The z of the segment starts. [4]
+///  @param[in]		p1x		The x of the segment ends. [4]
+///  @param[in]		p1z		The z of the segment ends. [4]
+///  @param[in]		verts	The polygon vertices. [(x, y, z) * @p nverts]
+///  @param[in]		nverts	The number of vertices.
+///  @param[out]	tmin	The parameters where the segments enter the polygon. [4]
+///  @param[out]	tmax	The parameters where the segments leave the polygon. [4]
+///  @param[out]	segMin	The edges the segments enter through, -1 if none. [4]
+///  @param[out]	segMax	The edges the segments leave through, -1 if none. [4]
+/// @return The segments intersecting the polygon, bit i is set for segment i.
+unsigned int dtIntersectSegmentsPoly2D4(const float* p0x, const float* p0z,
+										const float* p1x, const float* p1z,
+										const float* verts, int nverts,
+										float* tmin, float* tmax,
+										int* segMin, int* segMax);
+
 bool dtIntersectSegSeg2D(const float* ap, const float* aq,
 						 const float* bp, const float* bq,
 						 float& s, float& t);
@@ -0,0 +1,119 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef DETOURLANDMARKS_H
+#define DETOURLANDMARKS_H
+
+#include "DetourNavMesh.h"
+#include "DetourStatus.h"
+
+/// The maximum number of landmarks of a landmark table.
+static const int DT_MAX_LANDMARKS = 16;
+
+/// The landmark distances of the end point of a path search, see dtLandmarkTable::initGoal.
+/// @ingroup detour
+struct dtLandmarkGoal
+{
+	dtPolyRef ref;						///< The polygon of the end point, 0 if not set.
+	float lo[DT_MAX_LANDMARKS];			///< Lower bounds of the landmark distances of the end point.
+	float hi[DT_MAX_LANDMARKS];			///< Upper bounds of the landmark distances of the end point.
+	float costScale;					///< Scale of the lower bounds, the smallest area cost of the path costs.
+};
+
+/// Precomputed landmark distances for the ALT heuristic of the path queries.
+///
+/// The table stores the shortest distance from every landmark to every polygon portal, measured
+/// like the path searches do, from portal middle to portal middle. By the triangle inequality the
+/// difference of the landmark distances of two points is a lower bound of the distance between them,
+/// which follows walls and detours unlike the straight-line distance.
+/// @ingroup detour
+class dtLandmarkTable
+{
+public:
+	dtLandmarkTable();
+	~dtLandmarkTable();
+
+	/// Builds the table for the current tiles of the navigation mesh.
+	///  @param[in]	nav				The navigation mesh. Must stay alive while the table is used.
+	///  @param[in]	landmarkCount	The number of landmarks. [Limits: 0 < value <= #DT_MAX_LANDMARKS]
+	/// @returns The status flags for the operation.
+	dtStatus build(const dtNavMesh* nav, const int landmarkCount);
+
+	/// Rebuilds the table with the same navigation mesh and landmark count,
+	/// after tiles were added or removed.
+	/// @returns The status flags for the operation.
+	dtStatus refresh();
+
+	/// Releases the table.
+	void clear();
+
+	/// Checks that the table was built for the navigation mesh and no tile has been added or removed since.
+	///  @param[in]	nav		The navigation mesh.
+	/// @returns True if the table can be used with the navigation mesh.
+	bool isValid(const dtNavMesh* nav) const
+	{
+		return m_distances && nav == m_nav && nav->getTileGeneration() == m_tileGeneration;
+	}
+
+	/// Returns a lower bound of the path cost between two points, with the area costs of 1.
+	/// The bound holds for the searches stepping from portal middle to portal middle, the any-angle
+	/// searches and the radius searches can find slightly shorter paths.
+	///  @param[in]	from		The reference of the polygon of the first point. Must be a valid reference.
+	///  @param[in]	fromPos		A position within the first polygon. [(x, y, z)]
+	///  @param[in]	to			The reference of the polygon of the second point. Must be a valid reference.
+	///  @param[in]	toPos		A position within the second polygon. [(x, y, z)]
+	/// @returns The lower bound, 0 if nothing is known or the points are in the same polygon.
+	float getLowerBound(dtPolyRef from, const float* fromPos, dtPolyRef to, const float* toPos) const;
+
+	/// Computes the landmark distances of the end point of a path search once for all its nodes.
+	/// The cost scale of the goal is 1, the search sets it to the smallest area cost of its filter.
+	///  @param[in]	ref		The reference of the polygon of the end point. Must be a valid reference.
+	///  @param[in]	pos		A position within the polygon. [(x, y, z)]
+	///  @param[out]	goal	The landmark distances of the end point.
+	void initGoal(dtPolyRef ref, const float* pos, dtLandmarkGoal* goal) const;
+
+	/// Returns a lower bound of the path cost to the end point of a path search, see #getLowerBound.
+	/// The bound is scaled by dtLandmarkGoal::costScale.
+	///  @param[in]	from		The reference of the polygon of the point. Must be a valid reference.
+	///  @param[in]	fromPos		A position within the polygon. [(x, y, z)]
+	///  @param[in]	goal		The end point, initialized by #initGoal.
+	/// @returns The lower bound, 0 if nothing is known or the point is in the end polygon.
+	float getLowerBound(dtPolyRef from, const float* fromPos, const dtLandmarkGoal& goal) const;
+
+	/// @returns The number of landmarks of the table.
+	int getLandmarkCount() const { return m_landmarkCount; }
+
+	/// @returns The polygon of the landmark.
+	dtPolyRef getLandmark(int i) const { return m_landmarks[i]; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtLandmarkTable(const dtLandmarkTable&);
+	dtLandmarkTable& operator=(const dtLandmarkTable&);
+
+	const dtNavMesh* m_nav;						///< The navigation mesh of the table.
+	unsigned int m_tileGeneration;				///< The tile generation of the navigation mesh when built.
+	int m_landmarkCount;						///< Number of landmarks.
+	dtPolyRef m_landmarks[DT_MAX_LANDMARKS];	///< The landmark polygons.
+	int m_maxTiles;								///< Size of the link offsets.
+	int* m_linkOffsets;							///< Index of the first link of each tile, -1 for the empty tiles.
+	float* m_distances;							///< Landmark distances of the polygon links. [landmarkCount * links]
+	float* m_positions;							///< Portal middles of the polygon links. [3 * links]
+};
+
+#endif // DETOURLANDMARKS_H
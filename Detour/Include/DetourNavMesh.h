@@ -60,6 +60,15 @@ typedef unsigned int dtTileRef;
 /// @ingroup detour
 static const int DT_VERTS_PER_POLYGON = 6;
 
+/// The maximum number of fan triangles a polygon can be split into.
+/// @ingroup detour
+static const int DT_FACES_PER_POLYGON = DT_VERTS_PER_POLYGON - 2;
+
+/// Index of a vertex, edge or fan triangle inside a navigation polygon.
+/// @ingroup detour
+typedef unsigned short dtPrimIndex;
+static const dtPrimIndex DT_INVALID_PRIM_INDEX = ~0;
+
 /// @{
 /// @name Tile Serialization Constants
 /// These constants are used to detect whether a navigation tile's data
@@ -70,7 +79,7 @@ static const int DT_VERTS_PER_POLYGON = 6;
 static const int DT_NAVMESH_MAGIC = 'D'<<24 | 'N'<<16 | 'A'<<8 | 'V';
 
 /// A version number used to detect compatibility of navigation tile data.
-static const int DT_NAVMESH_VERSION = 7;
+static const int DT_NAVMESH_VERSION = 12;
 
 /// A magic number used to detect the compatibility of navigation tile states.
 static const int DT_NAVMESH_STATE_MAGIC = 'D'<<24 | 'N'<<16 | 'M'<<8 | 'S';
@@ -118,10 +127,11 @@ enum dtStraightPathOptions
 };
 
 
-/// Options for dtNavMeshQuery::initSlicedFindPath and updateSlicedFindPath
+/// Options for dtNavMeshQuery::findPath, findPathByRadius, initSlicedFindPath and updateSlicedFindPath
 enum dtFindPathOptions
 {
 	DT_FINDPATH_ANY_ANGLE	= 0x02,		///< use raycasts during pathfind to "shortcut" (raycast still consider costs)
+	DT_FINDPATH_BIDIRECTIONAL = 0x04,	///< search from both ends and meet in the middle (findPath and findPathByRadius only)
 };
 
 /// Options for dtNavMeshQuery::raycast
@@ -219,6 +229,92 @@ struct dtBVNode
 	int i;							///< The node's index. (Negative for escape sequence.)
 };
 
+/// The number of children of a wide bounding volume node.
+/// @ingroup detour
+static const int DT_WIDE_BV_WIDTH = 8;
+
+/// The traversal stack size of the wide trees. The median split trees are at most 32 levels deep.
+/// @ingroup detour
+static const int DT_WIDE_BV_STACK_SIZE = 32*(DT_WIDE_BV_WIDTH-1) + 1;
+
+/// Bounding volume node with up to #DT_WIDE_BV_WIDTH children, the child boxes
+/// are stored by axis so they can be tested together. (See: #dtOverlapQuantBounds8)
+/// @note This structure is rarely if ever used by the end user.
+/// @see dtMeshTile
+struct dtWideBVNode
+{
+	unsigned short bmin[3][DT_WIDE_BV_WIDTH];	///< Minimum bounds of the child AABBs. [(x, y, z)][child]
+	unsigned short bmax[3][DT_WIDE_BV_WIDTH];	///< Maximum bounds of the child AABBs. [(x, y, z)][child]
+	/// The children. The index of the child node if positive, ~polyIndex for a polygon, zero for an unused child.
+	int child[DT_WIDE_BV_WIDTH];
+};
+
+/// Flags describing the entries of a dtFaceClearance.
+enum dtFaceClearanceFlags
+{
+	/// The width around the vertex is only an upper bound. The clearance search reached
+	/// a tile border, so the width must be verified at runtime if it is wide enough.
+	/// Shift by the vertex index to get the flag for that vertex.
+	DT_FACE_CLEARANCE_PARTIAL = 0x01,
+};
+
+/// Corridor clearance of a polygon fan triangle.
+/// @note This structure is rarely if ever used by the end user.
+/// @see dtMeshTile
+struct dtFaceClearance
+{
+	/// The corridor width when passing the triangle between the two edges sharing each vertex. [(v0, v1, v2)] [Unit: wu]
+	float width[3];
+	/// Per vertex flags. (See: #dtFaceClearanceFlags)
+	unsigned char flags;
+};
+
+/// The role of a polygon fan triangle in the abstract face graph.
+/// @see dtFaceAbstraction
+enum dtFaceAbstractionType
+{
+	/// The face is a decision node: it has three traversable neighbours or touches a tile border.
+	DT_FACE_DECISION = 0,
+	/// The face has exactly two traversable neighbours inside the tile, searches pass it without branching.
+	DT_FACE_CORRIDOR = 1,
+	/// The face belongs to a tree hanging off the rest of the tile, searches only enter it when the goal is inside.
+	DT_FACE_DEAD_END = 2,
+};
+
+/// Position of a polygon fan triangle in the abstract face graph of its tile.
+/// Chains of corridor faces are collapsed and dead-end trees are pruned by the radius searches.
+/// @note This structure is rarely if ever used by the end user.
+/// @see dtMeshTile
+struct dtFaceAbstraction
+{
+	/// The smallest width of the corridor chain the face belongs to. [Unit: wu]
+	/// (Zero if the face is not a corridor or the width must be verified at runtime.)
+	float corridorWidth;
+	/// The dead-end tree the face belongs to. (Zero if the face is not a dead end.)
+	unsigned short region;
+	/// The role of the face. (See: #dtFaceAbstractionType)
+	unsigned char type;
+	unsigned char pad;
+};
+
+/// The triangulation of a polygon used by the face queries, in place of the fan from vertex 0.
+/// The polygon edges keep their index [0 .. vertCount-1]. The diagonal d is split into the inner edge
+/// (#DT_VERTS_PER_POLYGON + d*2) from diagVerts[d][0] to diagVerts[d][1] and the inner edge
+/// (#DT_VERTS_PER_POLYGON + d*2 + 1) going back. The local edge k of a face goes from its
+/// local vertex k to k+1, the faces keep the winding of the polygon.
+/// @note This structure is rarely if ever used by the end user.
+/// @see dtMeshTile
+struct dtPolyTriangulation
+{
+	/// The edge indices of the local edges of each face. [(edge, edge, edge) * (vertCount - 2)]
+	unsigned char faceEdges[DT_FACES_PER_POLYGON][3];
+	/// The face on the left of each edge and the local index of the edge in it, packed as (face << 2) | k.
+	unsigned char edgeFaces[DT_VERTS_PER_POLYGON*2];
+	/// The polygon vertex indices of the diagonals. [(from, to) * (vertCount - 3)]
+	unsigned char diagVerts[DT_VERTS_PER_POLYGON-3][2];
+	unsigned char pad[2];
+};
+
 /// Defines an navigation mesh off-mesh connection within a dtMeshTile object.
 /// An off-mesh connection is a user defined traversable connection made up to two vertices.
 struct dtOffMeshConnection
@@ -266,6 +362,11 @@ struct dtMeshHeader
 	int bvNodeCount;			///< The number of bounding volume nodes. (Zero if bounding volumes are disabled.)
 	int offMeshConCount;		///< The number of off-mesh connections.
 	int offMeshBase;			///< The index of the first polygon which is an off-mesh connection.
+	int faceClearanceCount;		///< The number of face clearances. (Zero if face clearances are disabled.)
+	int faceBvNodeCount;		///< The number of face bounding volume nodes. (Zero if the face tree is disabled.)
+	int faceAbstractionCount;	///< The number of face abstractions. (Zero if the face abstraction is disabled.)
+	int polyTriangulationCount;	///< The number of polygon triangulations. (Zero if the polygons use the fan.)
+	int wideBvNodeCount;		///< The number of wide bounding volume nodes. (Zero if the wide tree is disabled.)
 	float walkableHeight;		///< The height of the agents using the tile.
 	float walkableRadius;		///< The radius of the agents using the tile.
 	float walkableClimb;		///< The maximum climb height of the agents using the tile.
@@ -301,6 +402,30 @@ struct dtMeshTile
 	dtBVNode* bvTree;
 
 	dtOffMeshConnection* offMeshCons;		///< The tile off-mesh connections. [Size: dtMeshHeader::offMeshConCount]
+
+	/// The corridor clearances of the polygon fan triangles. [Size: dtMeshHeader::faceClearanceCount]
+	/// (Will be null if face clearances are disabled.)
+	/// Indexed by (polyIndex * #DT_FACES_PER_POLYGON + faceIndex).
+	dtFaceClearance* faceClearances;
+
+	/// The bounding volume nodes of the polygon fan triangles. [Size: dtMeshHeader::faceBvNodeCount]
+	/// (Will be null if the face tree is disabled.)
+	/// The leaf index is (polyIndex * #DT_FACES_PER_POLYGON + faceIndex).
+	dtBVNode* faceBvTree;
+
+	/// The abstract graph roles of the polygon fan triangles. [Size: dtMeshHeader::faceAbstractionCount]
+	/// (Will be null if the face abstraction is disabled.)
+	/// Indexed by (polyIndex * #DT_FACES_PER_POLYGON + faceIndex).
+	dtFaceAbstraction* faceAbstractions;
+
+	/// The triangulations of the polygons into faces. [Size: dtMeshHeader::polyTriangulationCount]
+	/// (Will be null if the faces are the fan from vertex 0.)
+	dtPolyTriangulation* polyTriangulations;
+
+	/// The wide bounding volume nodes of the polygons, built from the same tree as #bvTree. [Size: dtMeshHeader::wideBvNodeCount]
+	/// (Will be null if the wide tree is disabled.)
+	/// The root is node 0, the polygon queries walk this tree instead of #bvTree when present.
+	dtWideBVNode* wideBvTree;
 		
 	unsigned char* data;					///< The tile data. (Not directly accessed under normal situations.)
 	int dataSize;							///< Size of the tile data.
@@ -424,6 +549,10 @@ public:
 	/// The maximum number of tiles supported by the navigation mesh.
 	/// @return The maximum number of tiles supported by the navigation mesh.
 	int getMaxTiles() const;
+
+	/// A counter incremented by every #addTile and #removeTile, used to detect stale data derived from the tiles.
+	/// @return The tile generation of the navigation mesh.
+	unsigned int getTileGeneration() const { return m_tileGeneration; }
 	
 	/// Gets the tile at the specified index.
 	///  @param[in]	i		The tile index. [Limit: 0 >= index < #getMaxTiles()]
@@ -666,6 +795,7 @@ private:
 	dtMeshTile** m_posLookup;			///< Tile hash lookup.
 	dtMeshTile* m_nextFree;				///< Freelist of tiles.
 	dtMeshTile* m_tiles;				///< List of tiles.
+	unsigned int m_tileGeneration;		///< Incremented when a tile is added or removed.
 		
 #ifndef DT_POLYREF64
 	unsigned int m_saltBits;			///< Number of salt bits in the tile ID.
@@ -101,6 +101,28 @@ struct dtNavMeshCreateParams
 	/// @note The BVTree is not normally needed for layered navigation meshes.
 	bool buildBvTree;
 
+	/// True if the corridor clearances of the polygon fan triangles should be built for the tile.
+	/// @note The clearances are only used by the radius based queries. (E.g. dtNavMeshQuery::findPathByRadius)
+	bool buildFaceClearance;
+
+	/// True if a bounding volume tree of the polygon fan triangles should be built for the tile.
+	/// @note The tree is only used by the face queries. (E.g. dtNavMeshQuery::findNearestFace)
+	bool buildFaceBvTree;
+
+	/// True if the abstract face graph (corridor chains and dead-end trees) should be built for the tile.
+	/// @note The abstraction is only used by the radius based searches. (E.g. dtNavMeshQuery::findPathByRadius)
+	bool buildFaceAbstraction;
+
+	/// True if the polygons should be split into Delaunay triangles instead of the fan from vertex 0.
+	/// The faces avoid the slivers of the fan, which narrow the corridors of the radius queries.
+	/// @note The face clearances, face tree and abstraction are built from the same triangles.
+	bool buildPolyTriangulation;
+
+	/// True if the bounding volume tree should also be stored as a tree of #DT_WIDE_BV_WIDTH wide nodes.
+	/// The polygon queries test the children of a wide node together. (E.g. dtNavMeshQuery::queryPolygons)
+	/// @note Ignored if #buildBvTree is false.
+	bool buildWideBvTree;
+
 	/// @}
 };
 
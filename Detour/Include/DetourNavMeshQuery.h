@@ -21,16 +21,22 @@
 
 #include "DetourNavMesh.h"
 #include "DetourStatus.h"
+#include "DetourCommon.h"
+#include "DetourLandmarks.h"
 #include "DetourNavMeshQuery_Nonpoint.h"
 
 
 // Define DT_VIRTUAL_QUERYFILTER if you wish to derive a custom filter from dtQueryFilter.
 // On certain platforms indirect or virtual function call is expensive. The default
 // setting is to use non-virtual functions, the actual implementations of the functions
-// are declared as inline for maximum speed. 
+// are declared as inline for maximum speed. They are defined in this header so that the
+// queries outside DetourNavMeshQuery.cpp link in optimized builds.
 
 //#define DT_VIRTUAL_QUERYFILTER 1
 
+/// Search heuristic scale of the path queries.
+static const float DT_HEURISTIC_SCALE = 0.999f;
+
 /// Defines polygon filtering and traversal costs for navigation mesh query operations.
 /// @ingroup detour
 class dtQueryFilter
@@ -120,6 +126,23 @@ public:
 
 };
 
+#ifndef DT_VIRTUAL_QUERYFILTER
+inline bool dtQueryFilter::passFilter(const dtPolyRef /*ref*/,
+									  const dtMeshTile* /*tile*/,
+									  const dtPoly* poly) const
+{
+	return (poly->flags & m_includeFlags) != 0 && (poly->flags & m_excludeFlags) == 0;
+}
+
+inline float dtQueryFilter::getCost(const float* pa, const float* pb,
+									const dtPolyRef /*prevRef*/, const dtMeshTile* /*prevTile*/, const dtPoly* /*prevPoly*/,
+									const dtPolyRef /*curRef*/, const dtMeshTile* /*curTile*/, const dtPoly* curPoly,
+									const dtPolyRef /*nextRef*/, const dtMeshTile* /*nextTile*/, const dtPoly* /*nextPoly*/) const
+{
+	return dtVdist(pa, pb) * m_areaCost[curPoly->getArea()];
+}
+#endif
+
 /// Provides information about raycast hit
 /// filled by dtNavMeshQuery::raycast
 /// @ingroup detour
@@ -171,7 +194,7 @@ public:
 	
 	/// Initializes the query object.
 	///  @param[in]		nav			Pointer to the dtNavMesh object to use for all queries.
-	///  @param[in]		maxNodes	Maximum number of search nodes. [Limits: 0 < value <= 65535]
+	///  @param[in]		maxNodes	Maximum number of search nodes. [Limits: 0 < value <= #DT_MAX_NODES]
 	/// @returns The status flags for the query.
 	dtStatus init(const dtNavMesh* nav, const int maxNodes);
 	
@@ -188,10 +211,42 @@ public:
 	///  							[(polyRef) * @p pathCount]
 	///  @param[out]	pathCount	The number of polygons returned in the @p path array.
 	///  @param[in]		maxPath		The maximum number of polygons the @p path array can hold. [Limit: >= 1]
+	///  @param[in]		options		Query options, only #DT_FINDPATH_BIDIRECTIONAL is used. (see: #dtFindPathOptions)
 	dtStatus findPath(dtPolyRef startRef, dtPolyRef endRef,
 					  const float* startPos, const float* endPos,
 					  const dtQueryFilter* filter,
-					  dtPolyRef* path, int* pathCount, const int maxPath) const;
+					  dtPolyRef* path, int* pathCount, const int maxPath,
+					  const unsigned int options = 0) const;
+
+	/// Finds a path like #findPath, with the filter type known at compile time.
+	/// The A* expansion calls TFilter::passFilter and TFilter::getCost directly (see dtFilterCalls),
+	/// so a custom filter derived from dtQueryFilter is inlined instead of called virtually.
+	/// The bidirectional search (#DT_FINDPATH_BIDIRECTIONAL) calls the filter the same way.
+	/// Defined in DetourNavMeshQueryTemplates.h.
+	template <class TFilter>
+	dtStatus findPathWithFilter(dtPolyRef startRef, dtPolyRef endRef,
+								const float* startPos, const float* endPos,
+								const TFilter* filter,
+								dtPolyRef* path, int* pathCount, const int maxPath,
+								const unsigned int options = 0) const;
+
+	/// Finds a path from the start polygon to the end polygon through the tile portal graph,
+	/// for the paths crossing many tiles.
+	///  @param[in]		graph		The tile portal graph of the navigation mesh.
+	///  @param[in]		startRef	The refrence id of the start polygon.
+	///  @param[in]		endRef		The reference id of the end polygon.
+	///  @param[in]		startPos	A position within the start polygon. [(x, y, z)]
+	///  @param[in]		endPos		A position within the end polygon. [(x, y, z)]
+	///  @param[in]		filter		The polygon filter to apply to the query.
+	///  @param[out]	path		An ordered list of polygon references representing the path. (Start to end.) 
+	///  							[(polyRef) * @p pathCount]
+	///  @param[out]	pathCount	The number of polygons returned in the @p path array.
+	///  @param[in]		maxPath		The maximum number of polygons the @p path array can hold. [Limit: >= 1]
+	dtStatus findPathHierarchical(const class dtTilePortalGraph* graph,
+								  dtPolyRef startRef, dtPolyRef endRef,
+								  const float* startPos, const float* endPos,
+								  const dtQueryFilter* filter,
+								  dtPolyRef* path, int* pathCount, const int maxPath) const;
 
 	/// Finds the straight path from the start to the end position within the polygon corridor.
 	///  @param[in]		startPos			Path start position. [(x, y, z)]
@@ -236,6 +291,15 @@ public:
 	/// @returns The status flags for the query.
 	dtStatus updateSlicedFindPath(const int maxIter, int* doneIters);
 
+	/// Updates an in-progress sliced path query like #updateSlicedFindPath, with the filter type known
+	/// at compile time, see #findPathWithFilter. Defined in DetourNavMeshQueryTemplates.h.
+	///  @param[in]		filter		The filter passed to #initSlicedFindPath.
+	///  @param[in]		maxIter		The maximum number of iterations to perform.
+	///  @param[out]	doneIters	The actual number of iterations completed. [opt]
+	/// @returns The status flags for the query.
+	template <class TFilter>
+	dtStatus updateSlicedFindPathWithFilter(const TFilter* filter, const int maxIter, int* doneIters);
+
 	/// Finalizes and returns the results of a sliced path query.
 	///  @param[out]	path		An ordered list of polygon references representing the path. (Start to end.) 
 	///  							[(polyRef) * @p pathCount]
@@ -339,6 +403,24 @@ public:
 	dtStatus findNearestPoly(const float* center, const float* halfExtents,
 							 const dtQueryFilter* filter,
 							 dtPolyRef* nearestRef, float* nearestPt, bool* isOverPoly) const;
+
+	/// Finds the polygon nearest to each point of a batch, like #findNearestPoly.
+	/// The points are grouped by tile and each tile's BV tree is walked once per group.
+	/// The results are written per coordinate, the points with no polygon get a zero reference and their center.
+	///  @param[in]		centers		The centers of the search boxes. [(x, y, z) * @p count]
+	///  @param[in]		count		The number of points. [Limit: >= 0]
+	///  @param[in]		halfExtents	The search distance along each axis, the same for all the points. [(x, y, z)]
+	///  @param[in]		filter		The polygon filter to apply to the query.
+	///  @param[out]	nearestRefs	The reference ids of the nearest polygons. [(polyRef) * @p count]
+	///  @param[out]	nearestX	The x coordinates of the nearest points. [opt] [(x) * @p count]
+	///  @param[out]	nearestY	The y coordinates of the nearest points. [opt] [(y) * @p count]
+	///  @param[out]	nearestZ	The z coordinates of the nearest points. [opt] [(z) * @p count]
+	///  @param[out]	isOverPoly	1 if the point's X/Z coordinate lies inside its polygon, 0 otherwise. [opt] [(flag) * @p count]
+	/// @returns The status flags for the query.
+	dtStatus findNearestPolys(const float* centers, const int count, const float* halfExtents,
+							  const dtQueryFilter* filter,
+							  dtPolyRef* nearestRefs, float* nearestX, float* nearestY, float* nearestZ,
+							  unsigned char* isOverPoly = 0) const;
 	
 	/// Finds polygons that overlap the search box.
 	///  @param[in]		center		The center of the search box. [(x, y, z)]
@@ -423,6 +505,22 @@ public:
 					 const dtQueryFilter* filter, const unsigned int options,
 					 dtRaycastHit* hit, dtPolyRef prevRef = 0) const;
 
+	/// Casts a batch of 'walkability' rays, like #raycast for each ray.
+	/// The rays in the same polygon are intersected with it together.
+	///  @param[in]		startRefs	The reference ids of the start polygons. [(polyRef) * @p count]
+	///  @param[in]		startPos	Positions within the start polygons representing
+	///  							the starts of the rays. [(x, y, z) * @p count]
+	///  @param[in]		endPos		The positions to cast the rays toward. [(x, y, z) * @p count]
+	///  @param[in]		count		The number of rays. [Limit: >= 0]
+	///  @param[in]		filter		The polygon filter to apply to the query.
+	///  @param[in]		options		govern how the raycasts behave. See dtRaycastOptions
+	///  @param[in,out]	hits		The hits of the rays, their path and maxPath are set by the caller. [(hit) * @p count]
+	///  @param[in]		prevRefs	The parents of the start refs, zero for none. Used during for cost calculation [opt] [(polyRef) * @p count]
+	/// @returns The status flags for the query, with the detail flags of all the rays.
+	dtStatus raycasts(const dtPolyRef* startRefs, const float* startPos, const float* endPos, const int count,
+					  const dtQueryFilter* filter, const unsigned int options,
+					  dtRaycastHit* hits, const dtPolyRef* prevRefs = 0) const;
+
 
 	/// Finds the distance from the specified position to the nearest polygon wall.
 	///  @param[in]		startRef		The reference id of the polygon containing @p centerPos.
@@ -520,25 +618,174 @@ public:
 	/// @return The navigation mesh the query object is using.
 	const dtNavMesh* getAttachedNavMesh() const { return m_nav; }
 
+	/// Sets the landmark table used to tighten the heuristic of #findPath and the sliced path queries.
+	/// The table is owned by the caller, pass null to disable it.
+	/// The any-angle queries (#DT_FINDPATH_ANY_ANGLE), the bidirectional queries and the radius queries
+	/// do not use it, their paths can be shorter than the landmark bound.
+	/// A table that is not valid for the navigation mesh is ignored, see dtLandmarkTable::isValid.
+	///  @param[in]		landmarks	The landmark table. [opt]
+	void setLandmarkTable(const dtLandmarkTable* landmarks) { m_landmarks = landmarks; }
+
+	/// Gets the landmark table of the query.
+	/// @return The landmark table, or null if none is set.
+	const dtLandmarkTable* getLandmarkTable() const { return m_landmarks; }
+
 	/// Non-point
 	dtStatus findNearestFace(const float* center, const float* halfExtents,
 		const dtQueryFilter* filter,
 		dtPolyFace* nearestFace, float* nearestPt) const;
 	
+	/// Finds a face path from the start face to the end face that fits a unit of the specified radius.
+	/// @p options only takes #DT_FINDPATH_BIDIRECTIONAL.
+	/// The expanded faces are recorded in the trace buffer of the query, see #setTraceBuffer.
 	dtStatus findPathByRadius(const dtPolyFace& startRef, const dtPolyFace& endRef,
 		const float* startPos, const float* endPos,
 		const dtQueryFilter* filter,
 		dtPolyFace* path, int* pathCount, const int maxPath,
 		dtPolyEdge* portalEdges, int* portalEdgeCount, const int maxPortalEdge,
-		const float radius
-	#if DT_DEBUG_ASTAR
-		,
-		int maxIters,
-		astar::dtAstarNodeDebug* visitNodes, int& nVisitNodes, const int maxVisitNode
-	#endif
-		) const;
-
-	dtStatus dtNavMeshQuery::getPathToNode(
+		const float radius, const unsigned int options = 0) const;
+
+	/// Finds a face path like #findPathByRadius, with the filter type known at compile time,
+	/// see #findPathWithFilter. Defined in DetourNavMeshQueryTemplates.h.
+	template <class TFilter>
+	dtStatus findPathByRadiusWithFilter(const dtPolyFace& startRef, const dtPolyFace& endRef,
+		const float* startPos, const float* endPos,
+		const TFilter* filter,
+		dtPolyFace* path, int* pathCount, const int maxPath,
+		dtPolyEdge* portalEdges, int* portalEdgeCount, const int maxPortalEdge,
+		const float radius, const unsigned int options = 0) const;
+
+	/// Finds a path from the start face to the end face for each unit radius of a sorted list, in one search.
+	/// The expansions are shared by the radii that fit through the same faces.
+	///  @param[in]		startRef			The start face.
+	///  @param[in]		endRef				The end face.
+	///  @param[in]		startPos			A position within the start face. [(x, y, z)]
+	///  @param[in]		endPos				A position within the end face. [(x, y, z)]
+	///  @param[in]		filter				The polygon filter to apply to the query.
+	///  @param[in]		radii				The unit radii, sorted from the narrowest. [(radius) * @p radiusCount]
+	///  @param[in]		radiusCount			The number of radii. [Limit: 1 <= value <= #DT_MAX_STATES_PER_NODE]
+	///  @param[out]	paths				The path of each radius, from start to end. [(face) * @p maxPath * @p radiusCount]
+	///  @param[out]	pathCounts			The number of faces in each path. [(count) * @p radiusCount]
+	///  @param[in]		maxPath				The max number of faces of each path. [Limit: >= 1]
+	///  @param[out]	portalEdges			The edges crossed by each path. [(edge) * @p maxPortalEdge * @p radiusCount]
+	///  @param[out]	portalEdgeCounts	The number of edges of each path. [(count) * @p radiusCount]
+	///  @param[in]		maxPortalEdge		The max number of edges of each path. [Limit: >= 1]
+	///  @param[out]	pathStatuses		The status of each path, e.g. #DT_PARTIAL_RESULT. [(status) * @p radiusCount] [opt]
+	/// @returns The status flags for the query, the detail flags of all the paths combined.
+	dtStatus findPathByRadii(const dtPolyFace& startRef, const dtPolyFace& endRef,
+		const float* startPos, const float* endPos,
+		const dtQueryFilter* filter, const float* radii, const int radiusCount,
+		dtPolyFace* paths, int* pathCounts, const int maxPath,
+		dtPolyEdge* portalEdges, int* portalEdgeCounts, const int maxPortalEdge,
+		dtStatus* pathStatuses = 0) const;
+
+	/// Casts a disc of the given radius along the surface from the start position toward the end position.
+	/// The disc is stopped by the walls and by the faces that do not pass the filter.
+	///  @param[in]		startRef	The face containing the start position.
+	///  @param[in]		startPos	A position within the start face representing
+	///  							the start of the ray. [(x, y, z)]
+	///  @param[in]		endPos		The position to cast the ray toward. [(x, y, z)]
+	///  @param[in]		filter		The polygon filter to apply to the query.
+	///  @param[in]		radius		The radius of the unit. [Limit: > 0]
+	///  @param[out]	t			The hit parameter. (FLT_MAX if no wall hit.)
+	///  @param[out]	hitNormal	The normal of the nearest wall hit. [(x, y, z)] [opt]
+	///  @param[out]	path		The faces the center of the disc visited. [opt]
+	///  @param[out]	pathCount	The number of visited faces. [opt]
+	///  @param[in]		maxPath		The maximum number of faces the @p path array can hold.
+	/// @returns The status flags for the query.
+	dtStatus raycastByRadius(const dtPolyFace& startRef, const float* startPos, const float* endPos,
+		const dtQueryFilter* filter, const float radius,
+		float* t, float* hitNormal, dtPolyFace* path, int* pathCount, const int maxPath) const;
+
+	/// Moves a unit of the given radius from the start to the end position constrained to the navigation mesh.
+	/// The unit only crosses the faces it fits through and its center keeps at least @p radius from the walls.
+	/// Uses the small fixed size node pool, the search is bounded and does not allocate. Without a baked
+	/// clearance the walkability of a face is searched on fixed size stacks too, see astar::isWalkableByRadius.
+	///  @param[in]		startRef		The face containing the start position.
+	///  @param[in]		startPos		A position of the mover within the start face. [(x, y, z)]
+	///  @param[in]		endPos			The desired end position of the mover. [(x, y, z)]
+	///  @param[in]		filter			The polygon filter to apply to the query.
+	///  @param[in]		radius			The radius of the unit. [Limit: >= 0]
+	///  @param[out]	resultPos		The result position of the mover. [(x, y, z)]
+	///  @param[out]	visited			The faces visited during the move.
+	///  @param[out]	visitedCount	The number of faces visited during the move.
+	///  @param[in]		maxVisitedSize	The maximum number of faces the @p visited array can hold.
+	/// @returns The status flags for the query.
+	dtStatus moveAlongSurfaceByRadius(const dtPolyFace& startRef, const float* startPos, const float* endPos,
+		const dtQueryFilter* filter, const float radius,
+		float* resultPos, dtPolyFace* visited, int* visitedCount, const int maxVisitedSize) const;
+
+	/// @name Sliced Radius Pathfinding Functions
+	/// Same usage as the sliced polygon path query, the face-level search of 
+	/// findPathByRadius() is run in steps of @p maxIter expanded faces.
+	/// The sliced polygon and radius queries share their state, only one of
+	/// them can be in progress at a time.
+	///@{
+
+	/// Intializes a sliced radius path query.
+	///  @param[in]		startRef	The start face.
+	///  @param[in]		endRef		The end face.
+	///  @param[in]		startPos	A position within the start face. [(x, y, z)]
+	///  @param[in]		endPos		A position within the end face. [(x, y, z)]
+	///  @param[in]		filter		The polygon filter to apply to the query.
+	///  @param[in]		radius		The radius of the unit.
+	/// @returns The status flags for the query.
+	dtStatus initSlicedFindPathByRadius(const dtPolyFace& startRef, const dtPolyFace& endRef,
+		const float* startPos, const float* endPos,
+		const dtQueryFilter* filter, const float radius);
+
+	/// Updates an in-progress sliced radius path query.
+	///  @param[in]		maxIter		The maximum number of iterations to perform.
+	///  @param[out]	doneIters	The actual number of iterations completed. [opt]
+	/// @returns The status flags for the query.
+	dtStatus updateSlicedFindPathByRadius(const int maxIter, int* doneIters);
+
+	/// Updates an in-progress sliced radius path query like #updateSlicedFindPathByRadius, with the filter
+	/// type known at compile time, see #findPathWithFilter. Defined in DetourNavMeshQueryTemplates.h.
+	///  @param[in]		filter		The filter passed to #initSlicedFindPathByRadius.
+	///  @param[in]		maxIter		The maximum number of iterations to perform.
+	///  @param[out]	doneIters	The actual number of iterations completed. [opt]
+	/// @returns The status flags for the query.
+	template <class TFilter>
+	dtStatus updateSlicedFindPathByRadiusWithFilter(const TFilter* filter, const int maxIter, int* doneIters);
+
+	/// Finalizes and returns the results of a sliced radius path query.
+	///  @param[out]	path			An ordered list of faces representing the path. (Start to end.)
+	///  @param[out]	pathCount		The number of faces returned in the @p path array.
+	///  @param[in]		maxPath			The max number of faces the path array can hold. [Limit: >= 1]
+	///  @param[out]	portalEdges		The edges crossed between consecutive faces of the path.
+	///  @param[out]	portalEdgeCount	The number of edges returned in the @p portalEdges array.
+	///  @param[in]		maxPortalEdge	The max number of edges the @p portalEdges array can hold. [Limit: >= 1]
+	/// @returns The status flags for the query.
+	dtStatus finalizeSlicedFindPathByRadius(dtPolyFace* path, int* pathCount, const int maxPath,
+		dtPolyEdge* portalEdges, int* portalEdgeCount, const int maxPortalEdge);
+
+	/// Finalizes and returns the results of an incomplete sliced radius path query, returning the path
+	/// to the furthest face on the existing path that was visited during the search.
+	///  @param[in]		existing		An array of faces for the existing path.
+	///  @param[in]		existingSize	The number of faces in the @p existing array.
+	///  @param[out]	path			An ordered list of faces representing the path. (Start to end.)
+	///  @param[out]	pathCount		The number of faces returned in the @p path array.
+	///  @param[in]		maxPath			The max number of faces the path array can hold. [Limit: >= 1]
+	///  @param[out]	portalEdges		The edges crossed between consecutive faces of the path.
+	///  @param[out]	portalEdgeCount	The number of edges returned in the @p portalEdges array.
+	///  @param[in]		maxPortalEdge	The max number of edges the @p portalEdges array can hold. [Limit: >= 1]
+	/// @returns The status flags for the query.
+	dtStatus finalizeSlicedFindPathByRadiusPartial(const dtPolyFace* existing, const int existingSize,
+		dtPolyFace* path, int* pathCount, const int maxPath,
+		dtPolyEdge* portalEdges, int* portalEdgeCount, const int maxPortalEdge);
+	///@}
+
+	/// Sets the trace buffer the radius queries record their search events to.
+	/// The buffer is owned by the caller, pass null to disable tracing.
+	///  @param[in]		trace		The trace buffer. [opt]
+	void setTraceBuffer(debug::dtTraceBuffer* trace) { m_trace = trace; }
+
+	/// Gets the trace buffer of the radius queries.
+	/// @returns The trace buffer, or null if tracing is disabled.
+	debug::dtTraceBuffer* getTraceBuffer() const { return m_trace; }
+
+	dtStatus getPathToNode(
 		struct dtNode* endNode, 
 		dtPolyFace* path, int* pathCount, int maxPath,
 		dtPolyEdge* portalEdges, int* portalEdgeCount, const int maxPortalEdge) const;
@@ -560,6 +807,13 @@ private:
 							 dtPolyRef to, const dtPoly* toPoly, const dtMeshTile* toTile,
 							 float* left, float* right) const;
 	
+	// Prepares the landmark bound of the end of a path search, disabled if no valid table is set.
+	// The bound is scaled by the smallest area cost of the filter.
+	void initLandmarkGoal(dtPolyRef endRef, const float* endPos, const dtQueryFilter* filter, dtLandmarkGoal* goal) const;
+
+	// The heuristic of a node in the polygon, raised to the landmark bound when the goal is prepared.
+	float estimateCostToEnd(dtPolyRef ref, const float* pos, const dtLandmarkGoal& goal, const float heuristic) const;
+
 	/// Returns edge mid point between two polygons.
 	dtStatus getEdgeMidPoint(dtPolyRef from, dtPolyRef to, float* mid) const;
 	dtStatus getEdgeMidPoint(dtPolyRef from, const dtPoly* fromPoly, const dtMeshTile* fromTile,
@@ -578,6 +832,57 @@ private:
 
 	// Gets the path leading to the specified end node.
 	dtStatus getPathToNode(struct dtNode* endNode, dtPolyRef* path, int* pathCount, int maxPath) const;
+
+	// findPath() searching from both ends, the input has been validated.
+	template <class TFilter>
+	dtStatus findPathBidirectional(dtPolyRef startRef, dtPolyRef endRef,
+								   const float* startPos, const float* endPos,
+								   const TFilter* filter,
+								   dtPolyRef* path, int* pathCount, const int maxPath) const;
+
+	// Keeps the cheapest meeting of the two searches of findPathBidirectional() in the polygon of the node.
+	template <class TFilter>
+	void updatePolyMeeting(const TFilter* filter, struct dtNode* node, struct dtNode** meetNodes, float* meetCost) const;
+
+	// True when the search in the other direction has closed a node in the polygon of the node.
+	bool isPolyClosedByOtherSearch(const struct dtNode* node) const;
+
+	// findPathByRadius() searching from both ends, the input has been validated.
+	template <class TFilter>
+	dtStatus findPathByRadiusBidirectional(const dtPolyFace& startRef, const dtPolyFace& endRef,
+		const float* startPos, const float* endPos,
+		const TFilter* filter,
+		dtPolyFace* path, int* pathCount, const int maxPath,
+		dtPolyEdge* portalEdges, int* portalEdgeCount, const int maxPortalEdge,
+		const float radius) const;
+
+	// Expands one face node of the bidirectional radius search and updates the best meeting of the two searches.
+	template <class TFilter>
+	dtStatus expandFaceNodeBidirectional(struct dtNode* bestNode, const bool backward,
+		const dtResolvedPolyFace& startRef, const dtResolvedPolyFace& endRef,
+		const float* startPos, const float* endPos,
+		const TFilter* filter, const float radius,
+		struct dtNode** meetNodes, float* meetCost,
+		struct dtNode** lastBestNode, float* lastBestNodeCost) const;
+
+	// Keeps the cheapest meeting of the two searches of findPathByRadiusBidirectional() in the face of the node.
+	template <class TFilter>
+	void updateFaceMeeting(const TFilter* filter,
+		const dtResolvedPolyFace& startRef, const dtResolvedPolyFace& endRef, const float radius,
+		struct dtNode* node, struct dtNode** meetNodes, float* meetCost) const;
+
+	// Expands one face node of the radius search, returns DT_OUT_OF_NODES when the pool runs out.
+	template <class TFilter>
+	dtStatus expandFaceNodeByRadius(struct dtNode* bestNode,
+		const dtPolyFace& startRef, const dtResolvedPolyFace& endRef, const float* endPos,
+		const TFilter* filter, const float radius,
+		struct dtNode** lastBestNode, float* lastBestNodeCost) const;
+
+	// Expands one face node of the multi radius search, the node state is its radius class.
+	dtStatus expandFaceNodeByRadii(struct dtNode* bestNode,
+		const dtPolyFace& startRef, const dtResolvedPolyFace& endRef, const float* endPos,
+		const dtQueryFilter* filter, const float* radii, const int radiusCount,
+		struct dtNode** lastBestNodes, float* lastBestNodeCosts) const;
 	
 	const dtNavMesh* m_nav;				///< Pointer to navmesh data.
 
@@ -591,12 +896,19 @@ private:
 		const dtQueryFilter* filter;
 		unsigned int options;
 		float raycastLimitSqr;
+		dtPrimIndex startPrim, endPrim;		///< Start and end faces of a radius query.
+		float radius;						///< Unit radius of a radius query.
+		dtLandmarkGoal landmarkGoal;		///< Landmark bound of the end of the query.
 	};
 	dtQueryData m_query;				///< Sliced query state.
 
 	class dtNodePool* m_tinyNodePool;	///< Pointer to small node pool.
 	class dtNodePool* m_nodePool;		///< Pointer to node pool.
 	class dtNodeQueue* m_openList;		///< Pointer to open list queue.
+	class dtNodeQueue* m_backOpenList;	///< Pointer to the open list of the backward search of the bidirectional queries.
+
+	debug::dtTraceBuffer* m_trace;		///< Trace buffer of the radius queries. (Not owned.)
+	const dtLandmarkTable* m_landmarks;	///< Landmark heuristic of the path queries. (Not owned.)
 };
 
 /// Allocates a query object using the Detour allocator.
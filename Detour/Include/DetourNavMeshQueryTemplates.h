@@ -0,0 +1,1504 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef DETOURNAVMESHQUERYTEMPLATES_H
+#define DETOURNAVMESHQUERYTEMPLATES_H
+
+// Definitions of the dtNavMeshQuery path searches taking the filter type as a template parameter.
+// Include this header in the files calling dtNavMeshQuery::findPathWithFilter,
+// dtNavMeshQuery::updateSlicedFindPathWithFilter, dtNavMeshQuery::findPathByRadiusWithFilter
+// or dtNavMeshQuery::updateSlicedFindPathByRadiusWithFilter with a custom filter type.
+
+#include "DetourNavMeshQuery.h"
+#include "DetourNode.h"
+#include "DetourCommon.h"
+#include "DetourAssert.h"
+#include <float.h>
+
+/// Calls the filter of the templated path searches.
+/// A filter type derived from dtQueryFilter is called through its own functions, TFilter::passFilter and
+/// TFilter::getCost, so that the calls are not dispatched virtually even with #DT_VIRTUAL_QUERYFILTER and
+/// the functions defined in TFilter can be inlined.
+/// dtQueryFilter itself is called as before, the non-template queries keep the virtual dispatch.
+/// @ingroup detour
+template <class TFilter>
+struct dtFilterCalls
+{
+	static inline bool passFilter(const TFilter* filter, const dtPolyRef ref, const dtMeshTile* tile, const dtPoly* poly)
+	{
+		return filter->TFilter::passFilter(ref, tile, poly);
+	}
+
+	static inline float getCost(const TFilter* filter, const float* pa, const float* pb,
+								const dtPolyRef prevRef, const dtMeshTile* prevTile, const dtPoly* prevPoly,
+								const dtPolyRef curRef, const dtMeshTile* curTile, const dtPoly* curPoly,
+								const dtPolyRef nextRef, const dtMeshTile* nextTile, const dtPoly* nextPoly)
+	{
+		return filter->TFilter::getCost(pa, pb, prevRef, prevTile, prevPoly, curRef, curTile, curPoly,
+										nextRef, nextTile, nextPoly);
+	}
+};
+
+template <>
+struct dtFilterCalls<dtQueryFilter>
+{
+	static inline bool passFilter(const dtQueryFilter* filter, const dtPolyRef ref, const dtMeshTile* tile, const dtPoly* poly)
+	{
+		return filter->passFilter(ref, tile, poly);
+	}
+
+	static inline float getCost(const dtQueryFilter* filter, const float* pa, const float* pb,
+								const dtPolyRef prevRef, const dtMeshTile* prevTile, const dtPoly* prevPoly,
+								const dtPolyRef curRef, const dtMeshTile* curTile, const dtPoly* curPoly,
+								const dtPolyRef nextRef, const dtMeshTile* nextTile, const dtPoly* nextPoly)
+	{
+		return filter->getCost(pa, pb, prevRef, prevTile, prevPoly, curRef, curTile, curPoly,
+							   nextRef, nextTile, nextPoly);
+	}
+};
+
+template <class TFilter>
+dtStatus dtNavMeshQuery::findPathWithFilter(dtPolyRef startRef, dtPolyRef endRef,
+											const float* startPos, const float* endPos,
+											const TFilter* filter,
+											dtPolyRef* path, int* pathCount, const int maxPath,
+											const unsigned int options) const
+{
+	dtAssert(m_nav);
+	dtAssert(m_nodePool);
+	dtAssert(m_openList);
+
+	if (!pathCount)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	*pathCount = 0;
+	
+	// Validate input
+	if (!m_nav->isValidPolyRef(startRef) || !m_nav->isValidPolyRef(endRef) ||
+		!startPos || !dtVisfinite(startPos) ||
+		!endPos || !dtVisfinite(endPos) ||
+		!filter || !path || maxPath <= 0)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	if (startRef == endRef)
+	{
+		path[0] = startRef;
+		*pathCount = 1;
+		return DT_SUCCESS;
+	}
+
+	if (options & DT_FINDPATH_BIDIRECTIONAL)
+		return findPathBidirectional(startRef, endRef, startPos, endPos, filter, path, pathCount, maxPath);
+	
+	m_nodePool->clear();
+	m_openList->clear();
+	dtLandmarkGoal landmarkGoal;
+	initLandmarkGoal(endRef, endPos, filter, &landmarkGoal);
+	
+	dtNode* startNode = m_nodePool->getNode(startRef);
+	dtVcopy(startNode->pos, startPos);
+	startNode->pidx = 0;
+	startNode->cost = 0;
+	startNode->total = dtVdist(startPos, endPos) * DT_HEURISTIC_SCALE;
+	startNode->id = startRef;
+	startNode->flags = DT_NODE_OPEN;
+	m_openList->push(startNode);
+	
+	dtNode* lastBestNode = startNode;
+	float lastBestNodeCost = startNode->total;
+	
+	bool outOfNodes = false;
+	
+	while (!m_openList->empty())
+	{
+		// Remove node from open list and put it in closed list.
+		dtNode* bestNode = m_openList->pop();
+		bestNode->flags &= ~DT_NODE_OPEN;
+		bestNode->flags |= DT_NODE_CLOSED;
+		
+		// Reached the goal, stop searching.
+		if (bestNode->id == endRef)
+		{
+			lastBestNode = bestNode;
+			break;
+		}
+		
+		// Get current poly and tile.
+		// The API input has been cheked already, skip checking internal data.
+		const dtPolyRef bestRef = bestNode->id;
+		const dtMeshTile* bestTile = 0;
+		const dtPoly* bestPoly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(bestRef, &bestTile, &bestPoly);
+		
+		// Get parent poly and tile.
+		dtPolyRef parentRef = 0;
+		const dtMeshTile* parentTile = 0;
+		const dtPoly* parentPoly = 0;
+		if (bestNode->pidx)
+			parentRef = m_nodePool->getNodeAtIdx(bestNode->pidx)->id;
+		if (parentRef)
+			m_nav->getTileAndPolyByRefUnsafe(parentRef, &parentTile, &parentPoly);
+		
+		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
+		{
+			dtPolyRef neighbourRef = bestTile->links[i].ref;
+			
+			// Skip invalid ids and do not expand back to where we came from.
+			if (!neighbourRef || neighbourRef == parentRef)
+				continue;
+			
+			// Get neighbour poly and tile.
+			// The API input has been cheked already, skip checking internal data.
+			const dtMeshTile* neighbourTile = 0;
+			const dtPoly* neighbourPoly = 0;
+			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);			
+			
+			if (!dtFilterCalls<TFilter>::passFilter(filter, neighbourRef, neighbourTile, neighbourPoly))
+				continue;
+
+			// deal explicitly with crossing tile boundaries
+			unsigned char crossSide = 0;
+			if (bestTile->links[i].side != 0xff)
+				crossSide = bestTile->links[i].side >> 1;
+
+			// get the node
+			dtNode* neighbourNode = m_nodePool->getNode(neighbourRef, crossSide);
+			if (!neighbourNode)
+			{
+				outOfNodes = true;
+				continue;
+			}
+			
+			// If the node is visited the first time, calculate node position.
+			if (neighbourNode->flags == 0)
+			{
+				getEdgeMidPoint(bestRef, bestPoly, bestTile,
+								neighbourRef, neighbourPoly, neighbourTile,
+								neighbourNode->pos);
+			}
+
+			// Calculate cost and heuristic.
+			float cost = 0;
+			float heuristic = 0;
+			
+			// Special case for last node.
+			if (neighbourRef == endRef)
+			{
+				// Cost
+				const float curCost = dtFilterCalls<TFilter>::getCost(filter, bestNode->pos, neighbourNode->pos,
+													  parentRef, parentTile, parentPoly,
+													  bestRef, bestTile, bestPoly,
+													  neighbourRef, neighbourTile, neighbourPoly);
+				const float endCost = dtFilterCalls<TFilter>::getCost(filter, neighbourNode->pos, endPos,
+													  bestRef, bestTile, bestPoly,
+													  neighbourRef, neighbourTile, neighbourPoly,
+													  0, 0, 0);
+				
+				cost = bestNode->cost + curCost + endCost;
+				heuristic = 0;
+			}
+			else
+			{
+				// Cost
+				const float curCost = dtFilterCalls<TFilter>::getCost(filter, bestNode->pos, neighbourNode->pos,
+													  parentRef, parentTile, parentPoly,
+													  bestRef, bestTile, bestPoly,
+													  neighbourRef, neighbourTile, neighbourPoly);
+				cost = bestNode->cost + curCost;
+				heuristic = dtVdist(neighbourNode->pos, endPos)*DT_HEURISTIC_SCALE;
+			}
+
+			const float total = cost + estimateCostToEnd(neighbourRef, neighbourNode->pos, landmarkGoal, heuristic);
+			
+			// The node is already in open list and the new result is worse, skip.
+			if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
+				continue;
+			// The node is already visited and process, and the new result is worse, skip.
+			if ((neighbourNode->flags & DT_NODE_CLOSED) && total >= neighbourNode->total)
+				continue;
+			
+			// Add or update the node.
+			neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
+			neighbourNode->id = neighbourRef;
+			neighbourNode->flags = (neighbourNode->flags & ~DT_NODE_CLOSED);
+			neighbourNode->cost = cost;
+			neighbourNode->total = total;
+			
+			if (neighbourNode->flags & DT_NODE_OPEN)
+			{
+				// Already in open, update node location.
+				m_openList->modify(neighbourNode);
+			}
+			else
+			{
+				// Put the node in open list.
+				neighbourNode->flags |= DT_NODE_OPEN;
+				m_openList->push(neighbourNode);
+			}
+			
+			// Update nearest node to target so far.
+			if (heuristic < lastBestNodeCost)
+			{
+				lastBestNodeCost = heuristic;
+				lastBestNode = neighbourNode;
+			}
+		}
+	}
+
+	dtStatus status = getPathToNode(lastBestNode, path, pathCount, maxPath);
+
+	if (lastBestNode->id != endRef)
+		status |= DT_PARTIAL_RESULT;
+
+	if (outOfNodes)
+		status |= DT_OUT_OF_NODES;
+	
+	return status;
+}
+
+template <class TFilter>
+dtStatus dtNavMeshQuery::updateSlicedFindPathWithFilter(const TFilter* filter, const int maxIter, int* doneIters)
+{
+	if (!dtStatusInProgress(m_query.status))
+		return m_query.status;
+
+	// The filter of the query, only its static type is new.
+	if (filter != m_query.filter)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	// Make sure the request is still valid.
+	if (!m_nav->isValidPolyRef(m_query.startRef) || !m_nav->isValidPolyRef(m_query.endRef))
+	{
+		m_query.status = DT_FAILURE;
+		return DT_FAILURE;
+	}
+
+	dtRaycastHit rayHit;
+	rayHit.maxPath = 0;
+		
+	int iter = 0;
+	while (iter < maxIter && !m_openList->empty())
+	{
+		iter++;
+		
+		// Remove node from open list and put it in closed list.
+		dtNode* bestNode = m_openList->pop();
+		bestNode->flags &= ~DT_NODE_OPEN;
+		bestNode->flags |= DT_NODE_CLOSED;
+		
+		// Reached the goal, stop searching.
+		if (bestNode->id == m_query.endRef)
+		{
+			m_query.lastBestNode = bestNode;
+			const dtStatus details = m_query.status & DT_STATUS_DETAIL_MASK;
+			m_query.status = DT_SUCCESS | details;
+			if (doneIters)
+				*doneIters = iter;
+			return m_query.status;
+		}
+		
+		// Get current poly and tile.
+		// The API input has been cheked already, skip checking internal data.
+		const dtPolyRef bestRef = bestNode->id;
+		const dtMeshTile* bestTile = 0;
+		const dtPoly* bestPoly = 0;
+		if (dtStatusFailed(m_nav->getTileAndPolyByRef(bestRef, &bestTile, &bestPoly)))
+		{
+			// The polygon has disappeared during the sliced query, fail.
+			m_query.status = DT_FAILURE;
+			if (doneIters)
+				*doneIters = iter;
+			return m_query.status;
+		}
+		
+		// Get parent and grand parent poly and tile.
+		dtPolyRef parentRef = 0, grandpaRef = 0;
+		const dtMeshTile* parentTile = 0;
+		const dtPoly* parentPoly = 0;
+		dtNode* parentNode = 0;
+		if (bestNode->pidx)
+		{
+			parentNode = m_nodePool->getNodeAtIdx(bestNode->pidx);
+			parentRef = parentNode->id;
+			if (parentNode->pidx)
+				grandpaRef = m_nodePool->getNodeAtIdx(parentNode->pidx)->id;
+		}
+		if (parentRef)
+		{
+			bool invalidParent = dtStatusFailed(m_nav->getTileAndPolyByRef(parentRef, &parentTile, &parentPoly));
+			if (invalidParent || (grandpaRef && !m_nav->isValidPolyRef(grandpaRef)) )
+			{
+				// The polygon has disappeared during the sliced query, fail.
+				m_query.status = DT_FAILURE;
+				if (doneIters)
+					*doneIters = iter;
+				return m_query.status;
+			}
+		}
+
+		// decide whether to test raycast to previous nodes
+		bool tryLOS = false;
+		if (m_query.options & DT_FINDPATH_ANY_ANGLE)
+		{
+			if ((parentRef != 0) && (dtVdistSqr(parentNode->pos, bestNode->pos) < m_query.raycastLimitSqr))
+				tryLOS = true;
+		}
+		
+		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
+		{
+			dtPolyRef neighbourRef = bestTile->links[i].ref;
+			
+			// Skip invalid ids and do not expand back to where we came from.
+			if (!neighbourRef || neighbourRef == parentRef)
+				continue;
+			
+			// Get neighbour poly and tile.
+			// The API input has been cheked already, skip checking internal data.
+			const dtMeshTile* neighbourTile = 0;
+			const dtPoly* neighbourPoly = 0;
+			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);			
+			
+			if (!dtFilterCalls<TFilter>::passFilter(filter, neighbourRef, neighbourTile, neighbourPoly))
+				continue;
+			
+			// get the neighbor node
+			dtNode* neighbourNode = m_nodePool->getNode(neighbourRef, 0);
+			if (!neighbourNode)
+			{
+				m_query.status |= DT_OUT_OF_NODES;
+				continue;
+			}
+			
+			// do not expand to nodes that were already visited from the same parent
+			if (neighbourNode->pidx != 0 && neighbourNode->pidx == bestNode->pidx)
+				continue;
+
+			// If the node is visited the first time, calculate node position.
+			if (neighbourNode->flags == 0)
+			{
+				getEdgeMidPoint(bestRef, bestPoly, bestTile,
+								neighbourRef, neighbourPoly, neighbourTile,
+								neighbourNode->pos);
+			}
+			
+			// Calculate cost and heuristic.
+			float cost = 0;
+			float heuristic = 0;
+			
+			// raycast parent
+			bool foundShortCut = false;
+			rayHit.pathCost = rayHit.t = 0;
+			if (tryLOS)
+			{
+				raycast(parentRef, parentNode->pos, neighbourNode->pos, m_query.filter, DT_RAYCAST_USE_COSTS, &rayHit, grandpaRef);
+				foundShortCut = rayHit.t >= 1.0f;
+			}
+
+			// update move cost
+			if (foundShortCut)
+			{
+				// shortcut found using raycast. Using shorter cost instead
+				cost = parentNode->cost + rayHit.pathCost;
+			}
+			else
+			{
+				// No shortcut found.
+				const float curCost = dtFilterCalls<TFilter>::getCost(filter, bestNode->pos, neighbourNode->pos,
+															  parentRef, parentTile, parentPoly,
+															bestRef, bestTile, bestPoly,
+															neighbourRef, neighbourTile, neighbourPoly);
+				cost = bestNode->cost + curCost;
+			}
+
+			// Special case for last node.
+			if (neighbourRef == m_query.endRef)
+			{
+				const float endCost = dtFilterCalls<TFilter>::getCost(filter, neighbourNode->pos, m_query.endPos,
+															  bestRef, bestTile, bestPoly,
+															  neighbourRef, neighbourTile, neighbourPoly,
+															  0, 0, 0);
+				
+				cost = cost + endCost;
+				heuristic = 0;
+			}
+			else
+			{
+				heuristic = dtVdist(neighbourNode->pos, m_query.endPos)*DT_HEURISTIC_SCALE;
+			}
+			
+			const float total = cost + estimateCostToEnd(neighbourRef, neighbourNode->pos, m_query.landmarkGoal, heuristic);
+			
+			// The node is already in open list and the new result is worse, skip.
+			if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
+				continue;
+			// The node is already visited and process, and the new result is worse, skip.
+			if ((neighbourNode->flags & DT_NODE_CLOSED) && total >= neighbourNode->total)
+				continue;
+			
+			// Add or update the node.
+			neighbourNode->pidx = foundShortCut ? bestNode->pidx : m_nodePool->getNodeIdx(bestNode);
+			neighbourNode->id = neighbourRef;
+			neighbourNode->flags = (neighbourNode->flags & ~(DT_NODE_CLOSED | DT_NODE_PARENT_DETACHED));
+			neighbourNode->cost = cost;
+			neighbourNode->total = total;
+			if (foundShortCut)
+				neighbourNode->flags = (neighbourNode->flags | DT_NODE_PARENT_DETACHED);
+			
+			if (neighbourNode->flags & DT_NODE_OPEN)
+			{
+				// Already in open, update node location.
+				m_openList->modify(neighbourNode);
+			}
+			else
+			{
+				// Put the node in open list.
+				neighbourNode->flags |= DT_NODE_OPEN;
+				m_openList->push(neighbourNode);
+			}
+			
+			// Update nearest node to target so far.
+			if (heuristic < m_query.lastBestNodeCost)
+			{
+				m_query.lastBestNodeCost = heuristic;
+				m_query.lastBestNode = neighbourNode;
+			}
+		}
+	}
+	
+	// Exhausted all nodes, but could not find path.
+	if (m_openList->empty())
+	{
+		const dtStatus details = m_query.status & DT_STATUS_DETAIL_MASK;
+		m_query.status = DT_SUCCESS | details;
+	}
+
+	if (doneIters)
+		*doneIters = iter;
+
+	return m_query.status;
+}
+
+// Keeps the cheapest meeting of the two searches of findPathBidirectional() in the polygon of 'node'.
+// The forward node is at the entry of the polygon and the backward node at its exit,
+// the cost of the step in between is evaluated in the direction of travel.
+template <class TFilter>
+void dtNavMeshQuery::updatePolyMeeting(const TFilter* filter, dtNode* node, dtNode** meetNodes, float* meetCost) const
+{
+	const bool backward = node->state >= DT_NODE_BACKWARD_STATE;
+
+	dtNode* others[DT_MAX_STATES_PER_NODE];
+	const int n = m_nodePool->findNodes(node->id, others, DT_MAX_STATES_PER_NODE);
+	for (int i = 0; i < n; ++i)
+	{
+		dtNode* other = others[i];
+		if ((other->state >= DT_NODE_BACKWARD_STATE) == backward || !(other->flags & (DT_NODE_OPEN | DT_NODE_CLOSED)))
+			continue;
+
+		dtNode* fwd = backward ? other : node;
+		dtNode* bwd = backward ? node : other;
+		const dtNode* fwdParent = m_nodePool->getNodeAtIdx(fwd->pidx);
+		const dtNode* bwdParent = m_nodePool->getNodeAtIdx(bwd->pidx);
+
+		// Entering and leaving through the same neighbour is never the shortest path.
+		if (fwdParent && bwdParent && fwdParent->id == bwdParent->id)
+			continue;
+
+		const dtMeshTile* tile = 0;
+		const dtPoly* poly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(node->id, &tile, &poly);
+		const dtPolyRef prevRef = fwdParent ? fwdParent->id : 0;
+		const dtPolyRef nextRef = bwdParent ? bwdParent->id : 0;
+		const dtMeshTile* prevTile = 0;
+		const dtPoly* prevPoly = 0;
+		const dtMeshTile* nextTile = 0;
+		const dtPoly* nextPoly = 0;
+		if (prevRef)
+			m_nav->getTileAndPolyByRefUnsafe(prevRef, &prevTile, &prevPoly);
+		if (nextRef)
+			m_nav->getTileAndPolyByRefUnsafe(nextRef, &nextTile, &nextPoly);
+
+		const float cost = fwd->cost + bwd->cost +
+			dtFilterCalls<TFilter>::getCost(filter, fwd->pos, bwd->pos,
+											prevRef, prevTile, prevPoly,
+											node->id, tile, poly,
+											nextRef, nextTile, nextPoly);
+		if (cost < *meetCost)
+		{
+			*meetCost = cost;
+			meetNodes[0] = fwd;
+			meetNodes[1] = bwd;
+		}
+	}
+}
+
+/// @par
+///
+/// The bidirectional search runs one A* from the start and one from the end in the same node pool,
+/// always expanding the smaller of the two open lists. The backward search evaluates
+/// dtQueryFilter::getCost() in the direction of travel, so asymmetric costs give the same path costs
+/// as the forward search. The search stops when no open node of either side can improve the cheapest
+/// meeting found so far.
+template <class TFilter>
+dtStatus dtNavMeshQuery::findPathBidirectional(dtPolyRef startRef, dtPolyRef endRef,
+											   const float* startPos, const float* endPos,
+											   const TFilter* filter,
+											   dtPolyRef* path, int* pathCount, const int maxPath) const
+{
+	dtAssert(m_backOpenList);
+
+	m_nodePool->clear();
+	m_openList->clear();
+	m_backOpenList->clear();
+
+	dtNode* startNode = m_nodePool->getNode(startRef);
+	dtVcopy(startNode->pos, startPos);
+	startNode->pidx = 0;
+	startNode->cost = 0;
+	startNode->total = dtVdist(startPos, endPos) * DT_HEURISTIC_SCALE;
+	startNode->id = startRef;
+	startNode->flags = DT_NODE_OPEN;
+	m_openList->push(startNode);
+
+	dtNode* endNode = m_nodePool->getNode(endRef, DT_NODE_BACKWARD_STATE);
+	dtVcopy(endNode->pos, endPos);
+	endNode->pidx = 0;
+	endNode->cost = 0;
+	endNode->total = dtVdist(startPos, endPos) * DT_HEURISTIC_SCALE;
+	endNode->id = endRef;
+	endNode->flags = DT_NODE_OPEN;
+	m_backOpenList->push(endNode);
+
+	dtNode* lastBestNode = startNode;
+	float lastBestNodeCost = startNode->total;
+
+	// The forward and the backward node of the cheapest meeting.
+	dtNode* meetNodes[2] = { 0, 0 };
+	float meetCost = FLT_MAX;
+
+	bool outOfNodes = false;
+
+	while (!m_openList->empty())
+	{
+		// No path through the open nodes can be cheaper than the meeting.
+		// Without a meeting the forward search goes on alone to find the partial path.
+		const float backTotal = m_backOpenList->empty() ? FLT_MAX : m_backOpenList->top()->total;
+		if (meetNodes[0] && dtMax(m_openList->top()->total, backTotal) >= meetCost)
+			break;
+
+		// Expand the smaller frontier.
+		const bool backward = !m_backOpenList->empty() && m_backOpenList->size() < m_openList->size();
+		dtNodeQueue* openList = backward ? m_backOpenList : m_openList;
+		const float* targetPos = backward ? startPos : endPos;
+
+		dtNode* bestNode = openList->pop();
+		bestNode->flags &= ~DT_NODE_OPEN;
+		bestNode->flags |= DT_NODE_CLOSED;
+
+		// Get current poly and tile.
+		// The API input has been cheked already, skip checking internal data.
+		const dtPolyRef bestRef = bestNode->id;
+		const dtMeshTile* bestTile = 0;
+		const dtPoly* bestPoly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(bestRef, &bestTile, &bestPoly);
+
+		// The goal of each direction is not crossed.
+		if (bestRef == (backward ? startRef : endRef))
+			continue;
+
+		// The other search has expanded the polygon already, the paths through it meet there.
+		if (isPolyClosedByOtherSearch(bestNode))
+			continue;
+
+		// Get parent poly and tile, the next polygon toward the end for the backward search.
+		dtPolyRef parentRef = 0;
+		const dtMeshTile* parentTile = 0;
+		const dtPoly* parentPoly = 0;
+		if (bestNode->pidx)
+			parentRef = m_nodePool->getNodeAtIdx(bestNode->pidx)->id;
+		if (parentRef)
+			m_nav->getTileAndPolyByRefUnsafe(parentRef, &parentTile, &parentPoly);
+
+		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
+		{
+			dtPolyRef neighbourRef = bestTile->links[i].ref;
+
+			// Skip invalid ids and do not expand back to where we came from.
+			if (!neighbourRef || neighbourRef == parentRef)
+				continue;
+
+			// Get neighbour poly and tile.
+			// The API input has been cheked already, skip checking internal data.
+			const dtMeshTile* neighbourTile = 0;
+			const dtPoly* neighbourPoly = 0;
+			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);
+
+			if (!dtFilterCalls<TFilter>::passFilter(filter, neighbourRef, neighbourTile, neighbourPoly))
+				continue;
+
+			// deal explicitly with crossing tile boundaries
+			unsigned char crossSide = 0;
+			if (bestTile->links[i].side != 0xff)
+				crossSide = bestTile->links[i].side >> 1;
+
+			// get the node
+			dtNode* neighbourNode = m_nodePool->getNode(neighbourRef,
+				(unsigned char)(backward ? DT_NODE_BACKWARD_STATE + crossSide : crossSide));
+			if (!neighbourNode)
+			{
+				outOfNodes = true;
+				continue;
+			}
+
+			// If the node is visited the first time, calculate node position.
+			if (neighbourNode->flags == 0)
+			{
+				getEdgeMidPoint(bestRef, bestPoly, bestTile,
+								neighbourRef, neighbourPoly, neighbourTile,
+								neighbourNode->pos);
+			}
+
+			// Cost, the backward search walks from the neighbour through the current polygon.
+			float curCost;
+			if (backward)
+			{
+				curCost = dtFilterCalls<TFilter>::getCost(filter, neighbourNode->pos, bestNode->pos,
+														  neighbourRef, neighbourTile, neighbourPoly,
+														  bestRef, bestTile, bestPoly,
+														  parentRef, parentTile, parentPoly);
+			}
+			else
+			{
+				curCost = dtFilterCalls<TFilter>::getCost(filter, bestNode->pos, neighbourNode->pos,
+														  parentRef, parentTile, parentPoly,
+														  bestRef, bestTile, bestPoly,
+														  neighbourRef, neighbourTile, neighbourPoly);
+			}
+
+			const float cost = bestNode->cost + curCost;
+			const float heuristic = dtVdist(neighbourNode->pos, targetPos)*DT_HEURISTIC_SCALE;
+			const float total = cost + heuristic;
+
+			// The node is already in open list and the new result is worse, skip.
+			if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
+				continue;
+			// The node is already visited and process, and the new result is worse, skip.
+			if ((neighbourNode->flags & DT_NODE_CLOSED) && total >= neighbourNode->total)
+				continue;
+
+			// Add or update the node.
+			neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
+			neighbourNode->id = neighbourRef;
+			neighbourNode->flags = (neighbourNode->flags & ~DT_NODE_CLOSED);
+			neighbourNode->cost = cost;
+			neighbourNode->total = total;
+
+			if (neighbourNode->flags & DT_NODE_OPEN)
+			{
+				// Already in open, update node location.
+				openList->modify(neighbourNode);
+			}
+			else
+			{
+				// Put the node in open list.
+				neighbourNode->flags |= DT_NODE_OPEN;
+				openList->push(neighbourNode);
+			}
+
+			// Update nearest node to target so far.
+			if (!backward && heuristic < lastBestNodeCost)
+			{
+				lastBestNodeCost = heuristic;
+				lastBestNode = neighbourNode;
+			}
+
+			updatePolyMeeting(filter, neighbourNode, meetNodes, &meetCost);
+		}
+	}
+
+	dtStatus status;
+	if (meetNodes[0])
+	{
+		// The forward half ends in the meeting polygon, the parents of the backward node lead to the end.
+		status = getPathToNode(meetNodes[0], path, pathCount, maxPath);
+		int n = *pathCount;
+		dtNode* node = m_nodePool->getNodeAtIdx(meetNodes[1]->pidx);
+		for (; node && n < maxPath; node = m_nodePool->getNodeAtIdx(node->pidx))
+			path[n++] = node->id;
+		if (node)
+			status |= DT_BUFFER_TOO_SMALL;
+		*pathCount = n;
+	}
+	else
+	{
+		status = getPathToNode(lastBestNode, path, pathCount, maxPath);
+		status |= DT_PARTIAL_RESULT;
+	}
+
+	if (outOfNodes)
+		status |= DT_OUT_OF_NODES;
+
+	return status;
+}
+
+/// @par
+///
+/// When the tiles have an abstract face graph (dtNavMeshCreateParams::buildFaceAbstraction),
+/// the expansion skips the dead-end trees that do not contain the goal and walks the corridor
+/// chains to their far end in one step. Only the chain end is added to the open list, it is
+/// flagged #DT_NODE_PARENT_DETACHED and getPathToNode() refines the chain back into faces.
+/// Both only drop faces that cannot be on a better path, the result is unchanged.
+template <class TFilter>
+dtStatus dtNavMeshQuery::expandFaceNodeByRadius(dtNode* bestNode,
+	const dtPolyFace& startRef, const dtResolvedPolyFace& endRef, const float* endPos,
+	const TFilter* filter, const float radius,
+	dtNode** lastBestNode, float* lastBestNodeCost) const
+{
+	dtStatus status = 0;
+
+	// The face refs have been validated already, skip checking internal data.
+	const dtMeshTile* bestTile = 0;
+	const dtPoly* bestPoly = 0;
+	m_nav->getTileAndPolyByRefUnsafe(bestNode->id, &bestTile, &bestPoly);
+	dtResolvedPolyFace bestFace(m_nav, bestNode->id, bestNode->primIdx, bestTile, bestPoly);
+
+	if (m_trace)
+		m_trace->record(debug::DT_TRACE_FACE_EXPANDED, bestFace.polyId, bestFace.innerIdx,
+			m_nodePool->getEntryEdge(bestNode), bestNode->cost, bestNode->total, 0);
+
+	// Get parent face, the entry edge belongs to the parent face.
+	dtResolvedPolyFace parentFace;
+	dtResolvedPolyEdge entryEdge;
+	if (bestNode->flags & DT_NODE_PARENT_DETACHED)
+	{
+		// Entered through a corridor chain, the parent is the last face of the chain.
+		const dtResolvedPolyEdge ownEdge = bestFace.sibling(m_nodePool->getEntryEdge(bestNode));
+		entryEdge = queriers::edgeOppositeEdge(ownEdge);
+		parentFace = queriers::edgeLeftFace(entryEdge);
+	}
+	else if (bestNode->pidx)
+	{
+		auto parentNode = m_nodePool->getNodeAtIdx(bestNode->pidx);
+		const dtMeshTile* parentTile = 0;
+		const dtPoly* parentPoly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(parentNode->id, &parentTile, &parentPoly);
+		parentFace = dtResolvedPolyFace(m_nav, parentNode->id, parentNode->primIdx, parentTile, parentPoly);
+		entryEdge = parentFace.sibling(m_nodePool->getEntryEdge(bestNode));
+	}
+
+	// The dead-end tree containing the goal, if any.
+	const dtFaceAbstraction* bestAbstraction = queriers::faceAbstraction(bestFace);
+	const dtFaceAbstraction* endAbstraction = queriers::faceAbstraction(endRef);
+	const unsigned short endRegion = (endAbstraction && endAbstraction->type == DT_FACE_DEAD_END) ? endAbstraction->region : 0;
+	const bool bestDeadEnd = bestAbstraction && bestAbstraction->type == DT_FACE_DEAD_END;
+
+	iterations::fromFaceToInnerEdges iterInnerEdges(bestFace);
+
+	do
+	{
+		auto innerEdge = iterInnerEdges.next();
+		if (!innerEdge.isValid())
+			break;
+
+		auto neighbourFace = queriers::edgeRightFace(innerEdge);
+
+		// Skip invalid ids and do not expand back to where we came from.
+		if (!neighbourFace.isValid()
+			|| neighbourFace == bestFace
+			|| neighbourFace == parentFace)
+		{
+			continue;
+		}
+
+		if (!dtFilterCalls<TFilter>::passFilter(filter, neighbourFace.polyId, neighbourFace.tile, neighbourFace.poly))
+			continue;
+
+		// 只进入包含终点的死胡同，从死胡同内部出发时可以在同一区域内移动
+		const dtFaceAbstraction* neighbourAbstraction = queriers::faceAbstraction(neighbourFace);
+		if (neighbourAbstraction && neighbourAbstraction->type == DT_FACE_DEAD_END && !bestDeadEnd &&
+			(neighbourFace.tile != endRef.tile || neighbourAbstraction->region != endRegion))
+		{
+			continue;
+		}
+
+		// check radius
+		if (bestFace != startRef
+			&& radius > 0.0f
+			&& !astar::isWalkableByRadius(radius, entryEdge, bestFace, innerEdge))
+		{
+			if (m_trace)
+				m_trace->record(debug::DT_TRACE_RADIUS_REJECTED, bestFace.polyId, bestFace.innerIdx,
+					(unsigned short)innerEdge.innerIdx, radius, 0, 0);
+			continue;
+		}
+
+		// Walk the corridor chain. The faces in between are not added to the node pool,
+		// 'fromFace' is the last face walked and 'crossEdge' the edge leading out of it.
+		// The walk stops on the face the plain search could not expand, that face is added as usual.
+		// A dead-end face sees both directions of the chain, the chains are only entered from the graph.
+		dtResolvedPolyFace fromParent = parentFace;
+		dtResolvedPolyFace fromFace = bestFace;
+		dtResolvedPolyEdge crossEdge = innerEdge;
+		float fromPos[3];
+		dtVcopy(fromPos, bestNode->pos);
+		float fromCost = bestNode->cost;
+		int chainLength = 0;
+
+		while (!bestDeadEnd && neighbourAbstraction && neighbourAbstraction->type == DT_FACE_CORRIDOR &&
+			neighbourFace != endRef && neighbourFace != startRef && chainLength < astar::MAX_CORRIDOR_CHAIN &&
+			!(endRegion && astar::touchesDeadEnd(neighbourFace, endRef.tile, endRegion)))
+		{
+			dtResolvedPolyEdge exitEdge;
+			const dtResolvedPolyFace nextFace = astar::corridorNextFace(neighbourFace, fromFace, &exitEdge);
+			if (!nextFace.isValid() || nextFace == bestFace ||
+				!dtFilterCalls<TFilter>::passFilter(filter, nextFace.polyId, nextFace.tile, nextFace.poly))
+			{
+				break;
+			}
+
+			// The chain width is baked, only narrower chains check every face.
+			if (radius > 0.0f && neighbourAbstraction->corridorWidth < radius * 2 &&
+				!astar::isWalkableByRadius(radius, crossEdge, neighbourFace, exitEdge))
+			{
+				break;
+			}
+
+			float entryPos[3];
+			if (!geom::closestPointToEdge(fromPos, crossEdge, entryPos))
+				break;
+			fromCost += dtFilterCalls<TFilter>::getCost(filter, fromPos, entryPos,
+				fromParent.polyId, fromParent.tile, fromParent.poly,
+				fromFace.polyId, fromFace.tile, fromFace.poly,
+				neighbourFace.polyId, neighbourFace.tile, neighbourFace.poly);
+			dtVcopy(fromPos, entryPos);
+
+			fromParent = fromFace;
+			fromFace = neighbourFace;
+			crossEdge = exitEdge;
+			neighbourFace = nextFace;
+			neighbourAbstraction = queriers::faceAbstraction(neighbourFace);
+			chainLength++;
+		}
+
+		// Get neighbor node
+		dtNode* neighbourNode = m_nodePool->getNode(neighbourFace.polyId, 0, neighbourFace.innerIdx);
+		if (!neighbourNode)
+		{
+			status |= DT_OUT_OF_NODES;
+			continue;
+		}
+
+		// If the node is visited the first time, calculate node position.
+		if (neighbourNode->flags == 0)
+		{
+			if (!geom::closestPointToEdge(fromPos, crossEdge, neighbourNode->pos))
+			{
+				break;
+			}
+		}
+
+		// Calculate cost and heuristic.
+		float cost = 0;
+		float heuristic = 0;
+
+		// Special case for last node.
+		if (neighbourFace == endRef)
+		{
+			// Cost
+			const float curCost = dtFilterCalls<TFilter>::getCost(filter, fromPos, neighbourNode->pos,
+				fromParent.polyId, fromParent.tile, fromParent.poly,
+				fromFace.polyId, fromFace.tile, fromFace.poly,
+				neighbourFace.polyId, neighbourFace.tile, neighbourFace.poly);
+			const float endCost = dtFilterCalls<TFilter>::getCost(filter, neighbourNode->pos, endPos,
+				fromFace.polyId, fromFace.tile, fromFace.poly,
+				neighbourFace.polyId, neighbourFace.tile, neighbourFace.poly,
+				0, 0, 0);
+
+			cost = fromCost + curCost + endCost;
+			heuristic = 0;
+		}
+		else
+		{
+			// Cost
+			const float curCost = dtFilterCalls<TFilter>::getCost(filter, fromPos, neighbourNode->pos,
+				fromParent.polyId, fromParent.tile, fromParent.poly,
+				fromFace.polyId, fromFace.tile, fromFace.poly,
+				neighbourFace.polyId, neighbourFace.tile, neighbourFace.poly);
+			cost = fromCost + curCost;
+			heuristic = dtVdist(neighbourNode->pos, endPos) * DT_HEURISTIC_SCALE;
+		}
+
+		const float total = cost + heuristic;
+
+		// The node is already in open list and the new result is worse, skip.
+		if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
+			continue;
+		// The node is already visited and process, and the new result is worse, skip.
+		if ((neighbourNode->flags & DT_NODE_CLOSED) && total >= neighbourNode->total)
+			continue;
+
+		// Add or update the node.
+		neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
+		neighbourNode->id = neighbourFace.polyId;
+		neighbourNode->primIdx = neighbourFace.innerIdx;
+		neighbourNode->flags = (neighbourNode->flags & ~(DT_NODE_CLOSED | DT_NODE_PARENT_DETACHED));
+		if (chainLength > 0)
+		{
+			// The entry edge of a chain end belongs to the node itself, see getPathToNode().
+			m_nodePool->setEntryEdge(neighbourNode, (unsigned char)queriers::edgeOppositeEdge(crossEdge).innerIdx);
+			neighbourNode->flags |= DT_NODE_PARENT_DETACHED;
+		}
+		else
+		{
+			m_nodePool->setEntryEdge(neighbourNode, (unsigned char)innerEdge.innerIdx);
+		}
+		neighbourNode->cost = cost;
+		neighbourNode->total = total;
+
+		if (neighbourNode->flags & DT_NODE_OPEN)
+		{
+			// Already in open, update node location.
+			m_openList->modify(neighbourNode);
+		}
+		else
+		{
+			// Put the node in open list.
+			neighbourNode->flags |= DT_NODE_OPEN;
+			m_openList->push(neighbourNode);
+		}
+
+		// Update nearest node to target so far.
+		if (heuristic < *lastBestNodeCost)
+		{
+			*lastBestNodeCost = heuristic;
+			*lastBestNode = neighbourNode;
+		}
+	} while(true);
+
+	return status;
+}
+
+template <class TFilter>
+dtStatus dtNavMeshQuery::findPathByRadiusWithFilter(const dtPolyFace& startRef, const dtPolyFace& endRef,
+	const float* startPos, const float* endPos,
+	const TFilter* filter,
+	dtPolyFace* path, int* pathCount, const int maxPath,
+	dtPolyEdge* portalEdges, int* portalEdgeCount, const int maxPortalEdge,
+	const float radius, const unsigned int options) const
+{
+	if (dtAbs(radius) < 0.01f)
+	{
+		return DT_FAILURE;
+	}
+
+	dtAssert(m_nav);
+	dtAssert(m_nodePool);
+	dtAssert(m_openList);
+
+	if (!pathCount || !portalEdgeCount)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	*pathCount = 0;
+
+	// Validate input
+	if (!startRef.isValid() || !endRef.isValid() ||
+		startRef.navmesh != m_nav || endRef.navmesh != m_nav ||
+		!startPos || !dtVisfinite(startPos) ||
+		!endPos || !dtVisfinite(endPos) ||
+		!filter || !path || maxPath <= 0 || !portalEdges || maxPortalEdge <= 0)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	if (startRef == endRef)
+	{
+		path[0] = startRef;
+		*pathCount = 1;
+		*portalEdgeCount = 0;
+		return DT_SUCCESS;
+	}
+
+	if (options & DT_FINDPATH_BIDIRECTIONAL)
+	{
+		return findPathByRadiusBidirectional(startRef, endRef, startPos, endPos, filter,
+			path, pathCount, maxPath, portalEdges, portalEdgeCount, maxPortalEdge, radius);
+	}
+
+	m_nodePool->clear();
+	m_openList->clear();
+
+	dtNode* startNode = m_nodePool->getNode(startRef.polyId, 0, startRef.innerIdx);
+	dtVcopy(startNode->pos, startPos);
+	startNode->pidx = 0;
+	startNode->cost = 0;
+	startNode->total = dtVdist(startPos, endPos) * DT_HEURISTIC_SCALE;
+	startNode->id = startRef.polyId;
+	startNode->primIdx = startRef.innerIdx;
+	m_nodePool->setEntryEdge(startNode, DT_NODE_NULL_EDGE);
+	startNode->flags = DT_NODE_OPEN;
+	m_openList->push(startNode);
+
+	if (m_trace)
+		m_trace->record(debug::DT_TRACE_SEARCH_BEGIN, startRef.polyId, startRef.innerIdx, 0, startPos[0], startPos[1], startPos[2]);
+
+	dtNode* lastBestNode = startNode;
+	float lastBestNodeCost = startNode->total;
+	const dtResolvedPolyFace resolvedEndRef(endRef);
+
+	dtStatus status = 0;
+
+	while (!m_openList->empty())
+	{
+		// Remove node from open list and put it in closed list.
+		dtNode* bestNode = m_openList->pop();
+		bestNode->flags &= ~DT_NODE_OPEN;
+		bestNode->flags |= DT_NODE_CLOSED;
+
+		// Reached the goal, stop searching.
+		if (bestNode->id == endRef.polyId && bestNode->primIdx == endRef.innerIdx)
+		{
+			lastBestNode = bestNode;
+			break;
+		}
+
+		status |= expandFaceNodeByRadius(bestNode, startRef, resolvedEndRef, endPos, filter, radius,
+			&lastBestNode, &lastBestNodeCost);
+	}
+
+	status |= getPathToNode(lastBestNode, path, pathCount, maxPath, portalEdges, portalEdgeCount, maxPortalEdge);
+
+	if (lastBestNode->id != endRef.polyId ||
+		lastBestNode->primIdx != endRef.innerIdx)
+		status |= DT_PARTIAL_RESULT;
+
+	if (m_trace)
+		m_trace->record(debug::DT_TRACE_SEARCH_END, lastBestNode->id, lastBestNode->primIdx,
+			(unsigned short)(status & DT_STATUS_DETAIL_MASK), lastBestNode->cost, 0, 0);
+
+	return status;
+}
+
+template <class TFilter>
+dtStatus dtNavMeshQuery::updateSlicedFindPathByRadiusWithFilter(const TFilter* filter, const int maxIter, int* doneIters)
+{
+	if (!dtStatusInProgress(m_query.status))
+		return m_query.status;
+
+	// The filter of the query, only its static type is new.
+	if (filter != m_query.filter)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	// Make sure the request is still valid.
+	if (!m_nav->isValidPolyRef(m_query.startRef) || !m_nav->isValidPolyRef(m_query.endRef))
+	{
+		m_query.status = DT_FAILURE;
+		return DT_FAILURE;
+	}
+
+	const dtPolyFace startRef(m_nav, m_query.startRef, m_query.startPrim);
+	const dtResolvedPolyFace endRef(dtPolyFace(m_nav, m_query.endRef, m_query.endPrim));
+
+	int iter = 0;
+	while (iter < maxIter && !m_openList->empty())
+	{
+		iter++;
+
+		// Remove node from open list and put it in closed list.
+		dtNode* bestNode = m_openList->pop();
+		bestNode->flags &= ~DT_NODE_OPEN;
+		bestNode->flags |= DT_NODE_CLOSED;
+
+		// Reached the goal, stop searching.
+		if (bestNode->id == m_query.endRef && bestNode->primIdx == m_query.endPrim)
+		{
+			m_query.lastBestNode = bestNode;
+			const dtStatus details = m_query.status & DT_STATUS_DETAIL_MASK;
+			m_query.status = DT_SUCCESS | details;
+			if (doneIters)
+				*doneIters = iter;
+			return m_query.status;
+		}
+
+		// The polygons may have disappeared during the sliced query, fail.
+		const dtNode* parentNode = m_nodePool->getNodeAtIdx(bestNode->pidx);
+		if (!m_nav->isValidPolyRef(bestNode->id) || (parentNode && !m_nav->isValidPolyRef(parentNode->id)))
+		{
+			m_query.status = DT_FAILURE;
+			if (doneIters)
+				*doneIters = iter;
+			return m_query.status;
+		}
+
+		m_query.status |= expandFaceNodeByRadius(bestNode, startRef, endRef, m_query.endPos,
+			filter, m_query.radius, &m_query.lastBestNode, &m_query.lastBestNodeCost);
+	}
+
+	// Exhausted all nodes, but could not find path.
+	if (m_openList->empty())
+	{
+		const dtStatus details = m_query.status & DT_STATUS_DETAIL_MASK;
+		m_query.status = DT_SUCCESS | details;
+	}
+
+	if (doneIters)
+		*doneIters = iter;
+
+	return m_query.status;
+}
+
+// 双向搜索：node所在face上另一个方向的节点与node相遇，保留代价最小的相遇。
+// 前向节点在face的入口边上，后向节点在出口边上，中间这一步按行走方向计算代价，并检查半径能否穿过face
+template <class TFilter>
+void dtNavMeshQuery::updateFaceMeeting(const TFilter* filter,
+	const dtResolvedPolyFace& startRef, const dtResolvedPolyFace& endRef, const float radius,
+	dtNode* node, dtNode** meetNodes, float* meetCost) const
+{
+	const bool backward = node->state == DT_NODE_BACKWARD_STATE;
+	dtNode* other = m_nodePool->findNode(node->id, backward ? 0 : DT_NODE_BACKWARD_STATE, node->primIdx);
+	if (!other || !(other->flags & (DT_NODE_OPEN | DT_NODE_CLOSED)))
+		return;
+
+	dtNode* fwd = backward ? other : node;
+	dtNode* bwd = backward ? node : other;
+	const dtNode* fwdParent = m_nodePool->getNodeAtIdx(fwd->pidx);
+	const dtNode* bwdParent = m_nodePool->getNodeAtIdx(bwd->pidx);
+
+	// Entering and leaving through the same neighbour is never the shortest path.
+	if (fwdParent && bwdParent && fwdParent->id == bwdParent->id && fwdParent->primIdx == bwdParent->primIdx)
+		return;
+
+	const dtResolvedPolyFace face(dtPolyFace(m_nav, node->id, node->primIdx));
+	const dtResolvedPolyFace prevFace = fwdParent ? dtResolvedPolyFace(dtPolyFace(m_nav, fwdParent->id, fwdParent->primIdx)) : dtResolvedPolyFace();
+	const dtResolvedPolyFace nextFace = bwdParent ? dtResolvedPolyFace(dtPolyFace(m_nav, bwdParent->id, bwdParent->primIdx)) : dtResolvedPolyFace();
+
+	// The start and the end face are not crossed, see expandFaceNodeByRadius().
+	if (prevFace.isValid() && nextFace.isValid() && face != startRef && face != endRef)
+	{
+		const dtResolvedPolyEdge entryEdge = prevFace.sibling(m_nodePool->getEntryEdge(fwd));
+		const dtResolvedPolyEdge exitEdge = queriers::edgeOppositeEdge(nextFace.sibling(m_nodePool->getEntryEdge(bwd)));
+		if (!astar::isWalkableByRadius(radius, entryEdge, face, exitEdge))
+			return;
+	}
+
+	const float cost = fwd->cost + bwd->cost +
+		dtFilterCalls<TFilter>::getCost(filter, fwd->pos, bwd->pos,
+			prevFace.polyId, prevFace.tile, prevFace.poly,
+			face.polyId, face.tile, face.poly,
+			nextFace.polyId, nextFace.tile, nextFace.poly);
+	if (cost < *meetCost)
+	{
+		*meetCost = cost;
+		meetNodes[0] = fwd;
+		meetNodes[1] = bwd;
+	}
+}
+
+/// @par
+///
+/// The backward nodes are the #DT_NODE_BACKWARD_STATE nodes of the faces, their parent is the
+/// next face toward the end and their entry edge belongs to that parent, like the forward nodes.
+/// The walkability of a face is checked from the edge toward the start to the edge toward the end
+/// in both directions, and the costs are evaluated in the direction of travel.
+/// The corridor chains of the face abstraction are not collapsed, the dead-end trees are pruned
+/// with the start as the goal of the backward search.
+template <class TFilter>
+dtStatus dtNavMeshQuery::expandFaceNodeBidirectional(dtNode* bestNode, const bool backward,
+	const dtResolvedPolyFace& startRef, const dtResolvedPolyFace& endRef,
+	const float* startPos, const float* endPos,
+	const TFilter* filter, const float radius,
+	dtNode** meetNodes, float* meetCost,
+	dtNode** lastBestNode, float* lastBestNodeCost) const
+{
+	dtStatus status = 0;
+
+	dtNodeQueue* openList = backward ? m_backOpenList : m_openList;
+	const dtResolvedPolyFace& targetRef = backward ? startRef : endRef;
+	const float* targetPos = backward ? startPos : endPos;
+
+	// The face refs have been validated already, skip checking internal data.
+	const dtMeshTile* bestTile = 0;
+	const dtPoly* bestPoly = 0;
+	m_nav->getTileAndPolyByRefUnsafe(bestNode->id, &bestTile, &bestPoly);
+	dtResolvedPolyFace bestFace(m_nav, bestNode->id, bestNode->primIdx, bestTile, bestPoly);
+
+	if (m_trace)
+		m_trace->record(debug::DT_TRACE_FACE_EXPANDED, bestFace.polyId, bestFace.innerIdx,
+			m_nodePool->getEntryEdge(bestNode), bestNode->cost, bestNode->total, 0);
+
+	// Get parent face, the next face toward the end for the backward search.
+	// The entry edge belongs to the parent face.
+	dtResolvedPolyFace parentFace;
+	dtResolvedPolyEdge parentEdge;
+	if (bestNode->pidx)
+	{
+		auto parentNode = m_nodePool->getNodeAtIdx(bestNode->pidx);
+		const dtMeshTile* parentTile = 0;
+		const dtPoly* parentPoly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(parentNode->id, &parentTile, &parentPoly);
+		parentFace = dtResolvedPolyFace(m_nav, parentNode->id, parentNode->primIdx, parentTile, parentPoly);
+		parentEdge = parentFace.sibling(m_nodePool->getEntryEdge(bestNode));
+	}
+
+	// The dead-end tree containing the goal of this direction, if any.
+	const dtFaceAbstraction* bestAbstraction = queriers::faceAbstraction(bestFace);
+	const dtFaceAbstraction* targetAbstraction = queriers::faceAbstraction(targetRef);
+	const unsigned short targetRegion = (targetAbstraction && targetAbstraction->type == DT_FACE_DEAD_END) ? targetAbstraction->region : 0;
+	const bool bestDeadEnd = bestAbstraction && bestAbstraction->type == DT_FACE_DEAD_END;
+
+	iterations::fromFaceToInnerEdges iterInnerEdges(bestFace);
+
+	do
+	{
+		auto innerEdge = iterInnerEdges.next();
+		if (!innerEdge.isValid())
+			break;
+
+		auto neighbourFace = queriers::edgeRightFace(innerEdge);
+
+		// Skip invalid ids and do not expand back to where we came from.
+		if (!neighbourFace.isValid()
+			|| neighbourFace == bestFace
+			|| neighbourFace == parentFace)
+		{
+			continue;
+		}
+
+		if (!dtFilterCalls<TFilter>::passFilter(filter, neighbourFace.polyId, neighbourFace.tile, neighbourFace.poly))
+			continue;
+
+		const dtFaceAbstraction* neighbourAbstraction = queriers::faceAbstraction(neighbourFace);
+		if (neighbourAbstraction && neighbourAbstraction->type == DT_FACE_DEAD_END && !bestDeadEnd &&
+			(neighbourFace.tile != targetRef.tile || neighbourAbstraction->region != targetRegion))
+		{
+			continue;
+		}
+
+		// check radius, the unit crosses the best face from the start side to the end side
+		if (parentFace.isValid() && radius > 0.0f)
+		{
+			const bool walkable = backward
+				? astar::isWalkableByRadius(radius, queriers::edgeOppositeEdge(innerEdge), bestFace, queriers::edgeOppositeEdge(parentEdge))
+				: astar::isWalkableByRadius(radius, parentEdge, bestFace, innerEdge);
+			if (!walkable)
+			{
+				if (m_trace)
+					m_trace->record(debug::DT_TRACE_RADIUS_REJECTED, bestFace.polyId, bestFace.innerIdx,
+						(unsigned short)innerEdge.innerIdx, radius, 0, 0);
+				continue;
+			}
+		}
+
+		// Get neighbor node
+		dtNode* neighbourNode = m_nodePool->getNode(neighbourFace.polyId,
+			backward ? DT_NODE_BACKWARD_STATE : 0, neighbourFace.innerIdx);
+		if (!neighbourNode)
+		{
+			status |= DT_OUT_OF_NODES;
+			continue;
+		}
+
+		// If the node is visited the first time, calculate node position.
+		if (neighbourNode->flags == 0)
+		{
+			if (!geom::closestPointToEdge(bestNode->pos, innerEdge, neighbourNode->pos))
+			{
+				break;
+			}
+		}
+
+		// Cost, the backward search walks from the neighbour through the best face.
+		float curCost;
+		if (backward)
+		{
+			curCost = dtFilterCalls<TFilter>::getCost(filter, neighbourNode->pos, bestNode->pos,
+				neighbourFace.polyId, neighbourFace.tile, neighbourFace.poly,
+				bestFace.polyId, bestFace.tile, bestFace.poly,
+				parentFace.polyId, parentFace.tile, parentFace.poly);
+		}
+		else
+		{
+			curCost = dtFilterCalls<TFilter>::getCost(filter, bestNode->pos, neighbourNode->pos,
+				parentFace.polyId, parentFace.tile, parentFace.poly,
+				bestFace.polyId, bestFace.tile, bestFace.poly,
+				neighbourFace.polyId, neighbourFace.tile, neighbourFace.poly);
+		}
+
+		const float cost = bestNode->cost + curCost;
+		const float heuristic = dtVdist(neighbourNode->pos, targetPos) * DT_HEURISTIC_SCALE;
+		const float total = cost + heuristic;
+
+		// The node is already in open list and the new result is worse, skip.
+		if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
+			continue;
+		// The node is already visited and process, and the new result is worse, skip.
+		if ((neighbourNode->flags & DT_NODE_CLOSED) && total >= neighbourNode->total)
+			continue;
+
+		// Add or update the node.
+		neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
+		neighbourNode->id = neighbourFace.polyId;
+		neighbourNode->primIdx = neighbourFace.innerIdx;
+		neighbourNode->flags = (neighbourNode->flags & ~DT_NODE_CLOSED);
+		m_nodePool->setEntryEdge(neighbourNode, (unsigned char)innerEdge.innerIdx);
+		neighbourNode->cost = cost;
+		neighbourNode->total = total;
+
+		if (neighbourNode->flags & DT_NODE_OPEN)
+		{
+			// Already in open, update node location.
+			openList->modify(neighbourNode);
+		}
+		else
+		{
+			// Put the node in open list.
+			neighbourNode->flags |= DT_NODE_OPEN;
+			openList->push(neighbourNode);
+		}
+
+		// Update nearest node to target so far.
+		if (!backward && heuristic < *lastBestNodeCost)
+		{
+			*lastBestNodeCost = heuristic;
+			*lastBestNode = neighbourNode;
+		}
+
+		updateFaceMeeting(filter, startRef, endRef, radius, neighbourNode, meetNodes, meetCost);
+	} while(true);
+
+	return status;
+}
+
+/// @par
+///
+/// Same search as findPathBidirectional() over the faces, see expandFaceNodeBidirectional().
+template <class TFilter>
+dtStatus dtNavMeshQuery::findPathByRadiusBidirectional(const dtPolyFace& startRef, const dtPolyFace& endRef,
+	const float* startPos, const float* endPos,
+	const TFilter* filter,
+	dtPolyFace* path, int* pathCount, const int maxPath,
+	dtPolyEdge* portalEdges, int* portalEdgeCount, const int maxPortalEdge,
+	const float radius) const
+{
+	dtAssert(m_backOpenList);
+
+	m_nodePool->clear();
+	m_openList->clear();
+	m_backOpenList->clear();
+
+	dtNode* startNode = m_nodePool->getNode(startRef.polyId, 0, startRef.innerIdx);
+	dtVcopy(startNode->pos, startPos);
+	startNode->pidx = 0;
+	startNode->cost = 0;
+	startNode->total = dtVdist(startPos, endPos) * DT_HEURISTIC_SCALE;
+	startNode->id = startRef.polyId;
+	startNode->primIdx = startRef.innerIdx;
+	m_nodePool->setEntryEdge(startNode, DT_NODE_NULL_EDGE);
+	startNode->flags = DT_NODE_OPEN;
+	m_openList->push(startNode);
+
+	dtNode* endNode = m_nodePool->getNode(endRef.polyId, DT_NODE_BACKWARD_STATE, endRef.innerIdx);
+	dtVcopy(endNode->pos, endPos);
+	endNode->pidx = 0;
+	endNode->cost = 0;
+	endNode->total = dtVdist(startPos, endPos) * DT_HEURISTIC_SCALE;
+	endNode->id = endRef.polyId;
+	endNode->primIdx = endRef.innerIdx;
+	m_nodePool->setEntryEdge(endNode, DT_NODE_NULL_EDGE);
+	endNode->flags = DT_NODE_OPEN;
+	m_backOpenList->push(endNode);
+
+	if (m_trace)
+		m_trace->record(debug::DT_TRACE_SEARCH_BEGIN, startRef.polyId, startRef.innerIdx, 0, startPos[0], startPos[1], startPos[2]);
+
+	dtNode* lastBestNode = startNode;
+	float lastBestNodeCost = startNode->total;
+	const dtResolvedPolyFace resolvedStartRef(startRef);
+	const dtResolvedPolyFace resolvedEndRef(endRef);
+
+	// The forward and the backward node of the cheapest meeting.
+	dtNode* meetNodes[2] = { 0, 0 };
+	float meetCost = FLT_MAX;
+
+	dtStatus status = 0;
+
+	while (!m_openList->empty())
+	{
+		// No path through the open nodes can be cheaper than the meeting.
+		// Without a meeting the forward search goes on alone to find the partial path.
+		const float backTotal = m_backOpenList->empty() ? FLT_MAX : m_backOpenList->top()->total;
+		if (meetNodes[0] && dtMax(m_openList->top()->total, backTotal) >= meetCost)
+			break;
+
+		// Expand the smaller frontier.
+		const bool backward = !m_backOpenList->empty() && m_backOpenList->size() < m_openList->size();
+		dtNode* bestNode = (backward ? m_backOpenList : m_openList)->pop();
+		bestNode->flags &= ~DT_NODE_OPEN;
+		bestNode->flags |= DT_NODE_CLOSED;
+
+		// The goal of each direction is not crossed.
+		const dtPolyFace& goalRef = backward ? startRef : endRef;
+		if (bestNode->id == goalRef.polyId && bestNode->primIdx == goalRef.innerIdx)
+			continue;
+
+		// The other search has expanded the face already, the paths through it meet there.
+		const dtNode* otherNode = m_nodePool->findNode(bestNode->id, backward ? 0 : DT_NODE_BACKWARD_STATE, bestNode->primIdx);
+		if (otherNode && (otherNode->flags & DT_NODE_CLOSED))
+			continue;
+
+		status |= expandFaceNodeBidirectional(bestNode, backward, resolvedStartRef, resolvedEndRef, startPos, endPos,
+			filter, radius, meetNodes, &meetCost, &lastBestNode, &lastBestNodeCost);
+	}
+
+	if (meetNodes[0])
+	{
+		// The forward half ends in the meeting face, the parents of the backward node lead to the end.
+		status |= getPathToNode(meetNodes[0], path, pathCount, maxPath, portalEdges, portalEdgeCount, maxPortalEdge);
+		int n = *pathCount;
+		int nportals = *portalEdgeCount;
+		dtNode* prevNode = meetNodes[1];
+		dtNode* node = m_nodePool->getNodeAtIdx(prevNode->pidx);
+		for (; node && n < maxPath; node = m_nodePool->getNodeAtIdx(node->pidx))
+		{
+			// The entry edge of the backward node belongs to its parent, the portal is its twin.
+			const dtResolvedPolyFace face(dtPolyFace(m_nav, node->id, node->primIdx));
+			if (nportals < maxPortalEdge)
+				portalEdges[nportals++] = queriers::edgeOppositeEdge(face.sibling(m_nodePool->getEntryEdge(prevNode)));
+			path[n++] = face;
+			prevNode = node;
+		}
+		if (node)
+			status |= DT_BUFFER_TOO_SMALL;
+		*pathCount = n;
+		*portalEdgeCount = nportals;
+		lastBestNode = meetNodes[0];
+	}
+	else
+	{
+		status |= getPathToNode(lastBestNode, path, pathCount, maxPath, portalEdges, portalEdgeCount, maxPortalEdge);
+		status |= DT_PARTIAL_RESULT;
+	}
+
+	if (m_trace)
+		m_trace->record(debug::DT_TRACE_SEARCH_END, lastBestNode->id, lastBestNode->primIdx,
+			(unsigned short)(status & DT_STATUS_DETAIL_MASK), meetNodes[0] ? meetCost : lastBestNode->cost, 0, 0);
+
+	return status;
+}
+
+#endif // DETOURNAVMESHQUERYTEMPLATES_H
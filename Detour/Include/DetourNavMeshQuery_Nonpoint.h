@@ -6,20 +6,14 @@
 #include "DetourCommon.h"
 #include "DetourNavMesh.h"
 
-#include <fstream>
 #include <sstream>
-#include <chrono>
-
-#define DT_DEBUG_ASTAR 0
 
 // 处理带有半径的单位寻路
-typedef unsigned short dtPrimIndex;
-static const dtPrimIndex DT_INVALID_PRIM_INDEX = ~0;
-
+// 这一层没有全局或静态的可变状态，primitive只是值类型，查询的状态都在dtNavMeshQuery、
+// dtRadiusPathScratch和dtTraceBuffer中。每个线程使用自己的这些对象时可以并发查询同一个dtNavMesh，
+// 前提是查询期间没有线程修改navmesh（addTile/removeTile等）
 struct dtPolyPrimitive
 {
-	static dtPolyPrimitive INVALID;
-
 	dtPolyPrimitive()
 		: navmesh(nullptr), polyId(0), innerIdx(DT_INVALID_PRIM_INDEX)
 	{
@@ -101,6 +95,160 @@ typedef dtPolyPrimitive dtPolyVertex;
 typedef dtPolyPrimitive dtPolyEdge;
 typedef dtPolyPrimitive dtPolyFace;
 
+// 已经解析过的primitive，缓存验证过的tile和poly
+// 查询时不再需要通过getTileAndPolyByRef解码polyRef，只在tile没有被移除或替换前有效
+struct dtResolvedPolyPrimitive : public dtPolyPrimitive
+{
+	dtResolvedPolyPrimitive()
+		: dtPolyPrimitive(), tile(nullptr), poly(nullptr)
+	{
+	}
+
+	dtResolvedPolyPrimitive(const dtNavMesh* inNavmesh, const dtPolyRef& inPolyId, const dtPrimIndex& inInnerIdx,
+		const dtMeshTile* inTile, const dtPoly* inPoly)
+		: dtPolyPrimitive(inNavmesh, inPolyId, inInnerIdx), tile(inTile), poly(inPoly)
+	{
+	}
+
+	explicit dtResolvedPolyPrimitive(const dtPolyPrimitive& inPrim)
+		: dtPolyPrimitive(), tile(nullptr), poly(nullptr)
+	{
+		if (inPrim.getTileAndPoly(&tile, &poly))
+		{
+			dtPolyPrimitive::operator=(inPrim);
+		}
+		else
+		{
+			tile = nullptr;
+			poly = nullptr;
+		}
+	}
+
+	// 同一个poly内的另一个primitive，不需要重新解析
+	dtResolvedPolyPrimitive sibling(int inInnerIdx) const
+	{
+		return dtResolvedPolyPrimitive(navmesh, polyId, (dtPrimIndex)inInnerIdx, tile, poly);
+	}
+
+	void reset()
+	{
+		dtPolyPrimitive::reset();
+		tile = nullptr;
+		poly = nullptr;
+	}
+
+	const dtMeshTile*	tile;
+	const dtPoly*		poly;
+};
+
+typedef dtResolvedPolyPrimitive dtResolvedPolyVertex;
+typedef dtResolvedPolyPrimitive dtResolvedPolyEdge;
+typedef dtResolvedPolyPrimitive dtResolvedPolyFace;
+
+// 寻路追踪：每个查询对象持有一个环形缓冲区，记录固定大小的二进制事件，离线解码
+// 没有设置缓冲区时只有一次指针判断，可以在发布版本中保持开启
+namespace debug
+{
+	enum dtTraceEventType
+	{
+		DT_TRACE_NONE = 0,
+		DT_TRACE_SEARCH_BEGIN,		///< ref/prim: 起点face, data: 起点坐标, arg: 0
+		DT_TRACE_FACE_EXPANDED,		///< ref/prim: 展开的face, data: [cost, total, 多半径搜索时节点类别的半径], arg: 进入边的innerIdx
+		DT_TRACE_RADIUS_REJECTED,	///< ref/prim: 穿过的face, data: [radius, 0, 0], arg: 离开边的innerIdx
+		DT_TRACE_SEARCH_END,		///< ref/prim: 最后展开的face, data: [cost, 多半径搜索时该路径的半径, 0], arg: dtStatus的detail位
+		DT_TRACE_FUNNEL_STEP,		///< data: 漏斗点坐标, arg: 漏斗点序号, side: 0左侧 1右侧
+		DT_TRACE_EVENT_TYPE_COUNT
+	};
+
+	/// 固定大小的追踪事件，POD类型，可以直接按字节写入文件
+	struct dtTraceEvent
+	{
+		unsigned int seq;		///< 事件序号，单调递增，用于发现被覆盖的事件
+		unsigned char type;		///< dtTraceEventType
+		unsigned char prim;		///< face的innerIdx (DT_INVALID_PRIM_INDEX表示无效)
+		unsigned char side;		///< 仅DT_TRACE_FUNNEL_STEP使用
+		unsigned char pad;
+		unsigned short arg;		///< 含义由type决定
+		unsigned short pad2;
+		dtPolyRef ref;
+		float data[3];			///< 含义由type决定
+	};
+
+	class dtTraceBuffer
+	{
+	public:
+		dtTraceBuffer();
+		~dtTraceBuffer();
+
+		/// 容量向上取到2的幂
+		bool init(const int capacity);
+
+		/// 清空事件，不释放内存
+		inline void clear() { m_next = 0; }
+
+		inline void record(const unsigned char type, const dtPolyRef ref, const dtPrimIndex prim,
+			const unsigned short arg, const float d0, const float d1, const float d2, const unsigned char side = 0)
+		{
+			if (!m_events)
+				return;
+			dtTraceEvent& ev = m_events[m_next & m_mask];
+			ev.seq = m_next++;
+			ev.type = type;
+			ev.prim = (unsigned char)prim;
+			ev.side = side;
+			ev.pad = 0;
+			ev.arg = arg;
+			ev.pad2 = 0;
+			ev.ref = ref;
+			ev.data[0] = d0;
+			ev.data[1] = d1;
+			ev.data[2] = d2;
+		}
+
+		inline int getCapacity() const { return m_events ? (int)(m_mask + 1) : 0; }
+
+		/// 缓冲区中保留的事件数
+		inline int getEventCount() const
+		{
+			const unsigned int cap = m_events ? m_mask + 1 : 0;
+			return (int)(m_next < cap ? m_next : cap);
+		}
+
+		/// 因为环绕被覆盖的事件数
+		inline unsigned int getDroppedCount() const
+		{
+			return m_next - (unsigned int)getEventCount();
+		}
+
+		/// 按时间顺序返回第i个保留的事件，0是最旧的
+		inline const dtTraceEvent* getEvent(const int i) const
+		{
+			if (i < 0 || i >= getEventCount())
+				return 0;
+			const unsigned int first = m_next - (unsigned int)getEventCount();
+			return &m_events[(first + (unsigned int)i) & m_mask];
+		}
+
+		/// 按时间顺序拷贝事件，用于保存后离线解码，返回拷贝的数量
+		int copyEvents(dtTraceEvent* events, const int maxEvents) const;
+
+	private:
+		// Explicitly disabled copy constructor and copy assignment operator.
+		dtTraceBuffer(const dtTraceBuffer&);
+		dtTraceBuffer& operator=(const dtTraceBuffer&);
+
+		dtTraceEvent* m_events;
+		unsigned int m_mask;
+		unsigned int m_next;
+	};
+
+	/// 事件类型的名字
+	const char* traceEventName(const unsigned char type);
+
+	/// 把一个事件解码为文本，返回写入的字符数（不含结尾的0）
+	int formatTraceEvent(const dtTraceEvent& ev, char* buf, const int bufSize);
+}
+
 
 namespace queriers
 {
@@ -134,99 +282,190 @@ namespace queriers
 				\ |  \   /     内部面：[0]: 0-1-2, [1]: 0-2-3, [2]: 0-3-4, [3]: 0-4-5
 				 \|____\/      面的边：[0]: 0-1-6, [1]: 7-2-8, [2]：9-3-10, [3]: 10-4-5
 				 4       3
+
+		tile保存了dtPolyTriangulation时（dtNavMeshCreateParams::buildPolyTriangulation），
+		face和内部边按照保存的三角化编号，边的编号规则不变：原始边[0..N-1]，对角线d为[6+d*2]和[6+d*2+1]
+
+		每个查询都有两个版本：
+		- dtResolvedPolyPrimitive版本直接使用缓存的tile和poly，返回的primitive同样是已解析的
+		- dtPolyPrimitive版本先解析一次，再调用dtResolvedPolyPrimitive版本
 	*/
 
-	// Vertex
-	inline static bool vertexPosition(const dtPolyVertex& vertex, float* pos) 
+	// 构建时保存的polygon三角化，没有时使用扇形三角化
+	inline static const dtPolyTriangulation* polyTriangulation(const dtMeshTile* tile, const dtPoly* poly)
 	{
-		const dtMeshTile* tile = 0;
-		const dtPoly* poly = 0;
-		if (vertex.getTileAndPoly(&tile, &poly))
+		if (tile->polyTriangulations)
 		{
-			dtAssert(vertex.innerIdx < poly->vertCount);
-			auto vi = poly->verts[vertex.innerIdx];
-			auto v = &tile->verts[vi*3];
-			dtVcopy(pos, v);
-			return true;
+			const int ip = (int)(poly - tile->polys);
+			if (ip < tile->header->polyTriangulationCount)
+				return &tile->polyTriangulations[ip];
 		}
-		return false;
+		return 0;
 	}
 
-	// Edge
-	inline static dtPolyVertex edgeOriginVertex(const dtPolyEdge& edge)
+	// face的三条边在poly内的索引，按局部边顺序排列
+	inline static void faceEdgeIndices(const dtMeshTile* tile, const dtPoly* poly, int face, int edges[3])
 	{
-		const dtMeshTile* tile = 0;
-		const dtPoly* poly = 0;
-		if (edge.getTileAndPoly(&tile, &poly))
+		if (const dtPolyTriangulation* tri = polyTriangulation(tile, poly))
 		{
-			if (edge.innerIdx < DT_VERTS_PER_POLYGON)
-			{
-				// 原始边
-				return dtPolyVertex(edge.navmesh, edge.polyId, edge.innerIdx);
-			}
-			else
-			{
-				// 新增内部边(起点)
-				auto idx = edge.innerIdx - DT_VERTS_PER_POLYGON;
-				return (idx & 0x1) == 1 ? dtPolyVertex(edge.navmesh, edge.polyId, 0) : dtPolyVertex(edge.navmesh, edge.polyId, idx/2 + 2);
-			}
+			edges[0] = tri->faceEdges[face][0];
+			edges[1] = tri->faceEdges[face][1];
+			edges[2] = tri->faceEdges[face][2];
+			return;
+		}
+
+		// N = poly->vertCount, 表示总边数
+		// i == 0				=> [0, 1, 6]
+		// i > 0 && i < N-3		=> [7 + (i-1)*2, i+1, 8 + (i-1)*2]
+		// i == N-3				=> [7 + (i-1)*2, i+1, i+2]
+		if (poly->vertCount == 3)
+		{
+			edges[0] = 0; edges[1] = 1; edges[2] = 2;
+		}
+		else if (face == 0)
+		{
+			edges[0] = 0; edges[1] = 1; edges[2] = 6;
+		}
+		else if (face == poly->vertCount - 3)
+		{
+			edges[0] = 7 + (face - 1) * 2; edges[1] = face + 1; edges[2] = face + 2;
+		}
+		else
+		{
+			edges[0] = 7 + (face - 1) * 2; edges[1] = face + 1; edges[2] = 8 + (face - 1) * 2;
 		}
-		return dtPolyVertex::INVALID;
 	}
 
-	inline static dtPolyVertex edgeDestinationVertex(const dtPolyEdge& edge)
+	// 边左侧face的索引
+	inline static int edgeLeftFaceIndex(const dtMeshTile* tile, const dtPoly* poly, int edgeIdx)
 	{
-		const dtMeshTile* tile = 0;
-		const dtPoly* poly = 0;
-		if (edge.getTileAndPoly(&tile, &poly))
+		if (const dtPolyTriangulation* tri = polyTriangulation(tile, poly))
+			return tri->edgeFaces[edgeIdx] >> 2;
+
+		if (edgeIdx < DT_VERTS_PER_POLYGON)
 		{
-			if (edge.innerIdx < DT_VERTS_PER_POLYGON)
-			{
-				// 原始边
-				return dtPolyVertex(edge.navmesh, edge.polyId, (edge.innerIdx + 1) % poly->vertCount);
-			}
+			// 原始边
+			if (edgeIdx < 2)
+				return 0;
+			else if (edgeIdx > poly->vertCount - 3)
+				return poly->vertCount - 3;
 			else
+				return edgeIdx - 1;
+		}
+		else
+		{
+			// 新增内部边
+			auto idx = edgeIdx - DT_VERTS_PER_POLYGON;
+			return (idx & 0x1) == 0 ? idx / 2 : idx / 2 + 1;
+		}
+	}
+
+	// 边在其左侧face内的局部索引[0..2]
+	inline static int edgeLocalIndex(const dtMeshTile* tile, const dtPoly* poly, int edgeIdx)
+	{
+		if (const dtPolyTriangulation* tri = polyTriangulation(tile, poly))
+			return tri->edgeFaces[edgeIdx] & 3;
+
+		if (edgeIdx < DT_VERTS_PER_POLYGON)
+		{
+			// 原始边
+			if (edgeIdx == 0)
+				return 0;
+			if (edgeIdx == poly->vertCount - 1)
+				return 2;
+			return 1;
+		}
+		else
+		{
+			// 新增内部边
+			auto idx = edgeIdx - DT_VERTS_PER_POLYGON;
+			return (idx & 0x1) == 1 ? 0 : 2;
+		}
+	}
+
+	// face的三个顶点在poly内的索引，局部顶点k是局部边k的起点
+	inline static void faceVertexIndices(const dtMeshTile* tile, const dtPoly* poly, int face, int verts[3])
+	{
+		if (const dtPolyTriangulation* tri = polyTriangulation(tile, poly))
+		{
+			for (int k = 0; k < 3; ++k)
 			{
-				// 新增内部边(终点)
-				auto idx = edge.innerIdx - DT_VERTS_PER_POLYGON;
-				return (idx & 0x1) == 0 ? dtPolyVertex(edge.navmesh, edge.polyId, 0) : dtPolyVertex(edge.navmesh, edge.polyId, idx/2 + 2);
+				const int edge = tri->faceEdges[face][k];
+				if (edge < DT_VERTS_PER_POLYGON)
+				{
+					verts[k] = edge;
+				}
+				else
+				{
+					const int idx = edge - DT_VERTS_PER_POLYGON;
+					verts[k] = tri->diagVerts[idx / 2][(idx & 0x1) == 0 ? 0 : 1];
+				}
 			}
+			return;
 		}
-		return dtPolyVertex::INVALID;
+		verts[0] = 0;
+		verts[1] = face + 1;
+		verts[2] = face + 2;
 	}
 
-	inline static bool edgeOriginAndDestinationVertex(const dtPolyEdge& edge, dtPolyVertex* origin, dtPolyVertex* destination)
+	// Vertex
+	inline static bool vertexPosition(const dtResolvedPolyVertex& vertex, float* pos)
+	{
+		if (vertex.isValid())
+		{
+			dtAssert(vertex.innerIdx < vertex.poly->vertCount);
+			auto vi = vertex.poly->verts[vertex.innerIdx];
+			auto v = &vertex.tile->verts[vi*3];
+			dtVcopy(pos, v);
+			return true;
+		}
+		return false;
+	}
+
+	inline static bool vertexPosition(const dtPolyVertex& vertex, float* pos)
+	{
+		return vertexPosition(dtResolvedPolyVertex(vertex), pos);
+	}
+
+	// Edge
+	inline static bool edgeOriginAndDestinationVertex(const dtResolvedPolyEdge& edge, dtResolvedPolyVertex* origin, dtResolvedPolyVertex* destination)
 	{
-		const dtMeshTile* tile = 0;
-		const dtPoly* poly = 0;
-		if (edge.getTileAndPoly(&tile, &poly))
+		if (edge.isValid())
 		{
 			if (edge.innerIdx < DT_VERTS_PER_POLYGON)
 			{
 				// 原始边
 				if (origin)
-					*origin = dtPolyVertex(edge.navmesh, edge.polyId, edge.innerIdx);
+					*origin = edge.sibling(edge.innerIdx);
 				if (destination)
-					*destination = dtPolyVertex(edge.navmesh, edge.polyId, (edge.innerIdx + 1) % poly->vertCount);
+					*destination = edge.sibling((edge.innerIdx + 1) % edge.poly->vertCount);
 				return true;
 			}
 			else
 			{
 				// 新增内部边(起点)
 				auto idx = edge.innerIdx - DT_VERTS_PER_POLYGON;
-				if ((idx & 0x1) == 1)
+				if (const dtPolyTriangulation* tri = polyTriangulation(edge.tile, edge.poly))
 				{
+					const unsigned char* diag = tri->diagVerts[idx / 2];
 					if (origin)
-						*origin = dtPolyVertex(edge.navmesh, edge.polyId, 0);
+						*origin = edge.sibling((idx & 0x1) == 0 ? diag[0] : diag[1]);
 					if (destination)
-						*destination = dtPolyVertex(edge.navmesh, edge.polyId, idx / 2 + 2);
-				} 
+						*destination = edge.sibling((idx & 0x1) == 0 ? diag[1] : diag[0]);
+				}
+				else if ((idx & 0x1) == 1)
+				{
+					if (origin)
+						*origin = edge.sibling(0);
+					if (destination)
+						*destination = edge.sibling(idx / 2 + 2);
+				}
 				else
 				{
 					if (origin)
-						*origin = dtPolyVertex(edge.navmesh, edge.polyId, idx / 2 + 2);
+						*origin = edge.sibling(idx / 2 + 2);
 					if (destination)
-						*destination = dtPolyVertex(edge.navmesh, edge.polyId, 0);
+						*destination = edge.sibling(0);
 				}
 				return true;
 			}
@@ -234,44 +473,73 @@ namespace queriers
 		return false;
 	}
 
-	inline static dtPolyFace edgeLeftFace(const dtPolyEdge& edge)
+	inline static bool edgeOriginAndDestinationVertex(const dtPolyEdge& edge, dtPolyVertex* origin, dtPolyVertex* destination)
 	{
-		const dtMeshTile* tile = 0;
-		const dtPoly* poly = 0;
-		if (edge.getTileAndPoly(&tile, &poly))
+		dtResolvedPolyVertex resolvedOrigin, resolvedDestination;
+		if (edgeOriginAndDestinationVertex(dtResolvedPolyEdge(edge), &resolvedOrigin, &resolvedDestination))
 		{
-			if (edge.innerIdx < DT_VERTS_PER_POLYGON)
-			{
-				// 原始边
-				if (edge.innerIdx < 2)
-				{
-					return dtPolyFace(edge.navmesh, edge.polyId, 0);
-				}
-				else if (edge.innerIdx > poly->vertCount - 3)
-				{
-					return dtPolyFace(edge.navmesh, edge.polyId, poly->vertCount - 3);
-				}
-				else
-				{
-					return dtPolyFace(edge.navmesh, edge.polyId, edge.innerIdx - 1);
-				}
-			}
-			else
-			{
-				// 新增内部边
-				auto idx = edge.innerIdx - DT_VERTS_PER_POLYGON;
-				return (idx & 0x1) == 0 ? dtPolyFace(edge.navmesh, edge.polyId, idx / 2) : dtPolyFace(edge.navmesh, edge.polyId, idx / 2 + 1);
-			}
+			if (origin)
+				*origin = resolvedOrigin;
+			if (destination)
+				*destination = resolvedDestination;
+			return true;
 		}
-		return dtPolyFace::INVALID;
+		return false;
 	}
 
-	inline static int sharedEdgeIndex(const dtNavMesh* nav, const dtPolyRef from, const dtPolyRef to)
+	inline static dtResolvedPolyVertex edgeOriginVertex(const dtResolvedPolyEdge& edge)
 	{
-		const dtMeshTile* fromTile = 0;
-		const dtPoly* fromPoly = 0;
-		nav->getTileAndPolyByRefUnsafe(from, &fromTile, &fromPoly);
+		dtResolvedPolyVertex origin;
+		edgeOriginAndDestinationVertex(edge, &origin, 0);
+		return origin;
+	}
+
+	inline static dtPolyVertex edgeOriginVertex(const dtPolyEdge& edge)
+	{
+		return edgeOriginVertex(dtResolvedPolyEdge(edge));
+	}
 
+	inline static dtResolvedPolyVertex edgeDestinationVertex(const dtResolvedPolyEdge& edge)
+	{
+		dtResolvedPolyVertex destination;
+		edgeOriginAndDestinationVertex(edge, 0, &destination);
+		return destination;
+	}
+
+	inline static dtPolyVertex edgeDestinationVertex(const dtPolyEdge& edge)
+	{
+		return edgeDestinationVertex(dtResolvedPolyEdge(edge));
+	}
+
+	// 边的起点和终点坐标
+	inline static bool edgeOriginAndDestinationPosition(const dtResolvedPolyEdge& edge, float* origin, float* destination)
+	{
+		dtResolvedPolyVertex v0, v1;
+		if (edgeOriginAndDestinationVertex(edge, &v0, &v1))
+		{
+			vertexPosition(v0, origin);
+			vertexPosition(v1, destination);
+			return true;
+		}
+		return false;
+	}
+
+	inline static dtResolvedPolyFace edgeLeftFace(const dtResolvedPolyEdge& edge)
+	{
+		if (edge.isValid())
+		{
+			return edge.sibling(edgeLeftFaceIndex(edge.tile, edge.poly, edge.innerIdx));
+		}
+		return dtResolvedPolyFace();
+	}
+
+	inline static dtPolyFace edgeLeftFace(const dtPolyEdge& edge)
+	{
+		return edgeLeftFace(dtResolvedPolyEdge(edge));
+	}
+
+	inline static int sharedEdgeIndex(const dtMeshTile* fromTile, const dtPoly* fromPoly, const dtPolyRef to)
+	{
 		for (unsigned int k = fromPoly->firstLink; k != DT_NULL_LINK; k = fromTile->links[k].next)
 		{
 			const dtLink* link = &fromTile->links[k];
@@ -283,31 +551,41 @@ namespace queriers
 		return -1;
 	}
 
-	inline static dtPolyEdge edgeOppositeEdge(const dtPolyEdge& edge)
+	inline static int sharedEdgeIndex(const dtNavMesh* nav, const dtPolyRef from, const dtPolyRef to)
 	{
-		const dtMeshTile* tile = 0;
-		const dtPoly* poly = 0;
-		if (edge.getTileAndPoly(&tile, &poly))
+		const dtMeshTile* fromTile = 0;
+		const dtPoly* fromPoly = 0;
+		nav->getTileAndPolyByRefUnsafe(from, &fromTile, &fromPoly);
+		return sharedEdgeIndex(fromTile, fromPoly, to);
+	}
+
+	inline static dtResolvedPolyEdge edgeOppositeEdge(const dtResolvedPolyEdge& edge)
+	{
+		if (edge.isValid())
 		{
 			if (edge.innerIdx < DT_VERTS_PER_POLYGON)
 			{
 				// 原始边
+				const dtMeshTile* tile = edge.tile;
+				const dtPoly* poly = edge.poly;
 				unsigned short edgeIdx = (unsigned short)edge.innerIdx;
 				unsigned short nei = poly->neis[edgeIdx];
 
+				dtPolyRef neiRef = 0;
+				const dtMeshTile* neiTile = 0;
+				const dtPoly* neiPoly = 0;
 				if (nei & DT_EXT_LINK)
 				{
 					// Tile border.
 					for (unsigned int k = poly->firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
 					{
 						const dtLink* link = &tile->links[k];
-						if (link->edge == edgeIdx)
+						if (link->edge == edgeIdx && link->ref != 0)
 						{
-							if (link->ref != 0)
-							{
-								int neiEdgeIdx = sharedEdgeIndex(edge.navmesh, link->ref, edge.polyId);
-								return dtPolyEdge(edge.navmesh, link->ref, neiEdgeIdx);
-							}
+							// links are kept up to date by the navmesh, the ref is always valid
+							neiRef = link->ref;
+							edge.navmesh->getTileAndPolyByRefUnsafe(neiRef, &neiTile, &neiPoly);
+							break;
 						}
 					}
 				}
@@ -315,68 +593,50 @@ namespace queriers
 				{
 					// Portal edge
 					const unsigned int idx = (unsigned int)(nei - 1);
-					const dtPolyRef ref = edge.navmesh->getPolyRefBase(tile) | idx;
+					neiRef = edge.navmesh->getPolyRefBase(tile) | idx;
+					neiTile = tile;
+					neiPoly = &tile->polys[idx];
+				}
 
-					int neiEdgeIdx = sharedEdgeIndex(edge.navmesh, ref, edge.polyId);
-					return dtPolyEdge(edge.navmesh, ref, neiEdgeIdx);
+				if (neiPoly)
+				{
+					int neiEdgeIdx = sharedEdgeIndex(neiTile, neiPoly, edge.polyId);
+					if (neiEdgeIdx >= 0)
+						return dtResolvedPolyEdge(edge.navmesh, neiRef, (dtPrimIndex)neiEdgeIdx, neiTile, neiPoly);
 				}
 			}
 			else
 			{
 				// 新增内部边
 				auto idx = edge.innerIdx;
-				return (idx & 0x1) == 0 ? dtPolyEdge(edge.navmesh, edge.polyId, idx + 1) : dtPolyVertex(edge.navmesh, edge.polyId, idx - 1);
+				return (idx & 0x1) == 0 ? edge.sibling(idx + 1) : edge.sibling(idx - 1);
 			}
 		}
-		return dtPolyEdge::INVALID;
+		return dtResolvedPolyEdge();
 	}
 
-	inline static dtPolyEdge edgeNextLeftEdge(const dtPolyEdge& edge)
+	inline static dtPolyEdge edgeOppositeEdge(const dtPolyEdge& edge)
+	{
+		return edgeOppositeEdge(dtResolvedPolyEdge(edge));
+	}
+
+	inline static dtResolvedPolyEdge edgeNextLeftEdge(const dtResolvedPolyEdge& edge)
 	{
-		const dtMeshTile* tile = 0;
-		const dtPoly* poly = 0;
-		if (edge.getTileAndPoly(&tile, &poly))
+		if (edge.isValid())
 		{
 			int edges[3];
-			if (poly->vertCount == 3)
-			{
-				edges[0] = 0; edges[1] = 1; edges[2] = 2;
-			}
-			else
-			{
-				auto face = edgeLeftFace(edge);
-				auto i = face.innerIdx;
-				// N = poly->vertCount, 表示总边数
-				// i == 0				=> [0, 1, 6]
-				// i > 0 && i < N-3		=> [7 + (i-1)*2, i+1, 8 + (i-1)*2]
-				// i == N-3				=> [7 + (i-1)*2, i+1, i+2]
-
-				if (i == 0)
-				{
-					edges[0] = 0; edges[1] = 1; edges[2] = 6;
-				}
-				else if (i == poly->vertCount - 3)
-				{
-					edges[0] = 7 + (i - 1) * 2; edges[1] = i + 1; edges[2] = i + 2;
-				}
-				else
-				{
-					edges[0] = 7 + (i - 1) * 2; edges[1] = i + 1; edges[2] = 8 + (i - 1) * 2;
-				}
-			}
-
-			for (int k = 0; k < 3; ++k)
-			{
-				if (edges[k] == edge.innerIdx)
-				{
-					return dtPolyEdge(edge.navmesh, edge.polyId, edges[(k + 1) % 3]);
-				}
-			}
+			faceEdgeIndices(edge.tile, edge.poly, edgeLeftFaceIndex(edge.tile, edge.poly, edge.innerIdx), edges);
+			return edge.sibling(edges[(edgeLocalIndex(edge.tile, edge.poly, edge.innerIdx) + 1) % 3]);
 		}
-		return dtPolyEdge::INVALID;
+		return dtResolvedPolyEdge();
 	}
 
-	inline static dtPolyEdge edgePrevLeftEdge(const dtPolyEdge& edge)
+	inline static dtPolyEdge edgeNextLeftEdge(const dtPolyEdge& edge)
+	{
+		return edgeNextLeftEdge(dtResolvedPolyEdge(edge));
+	}
+
+	inline static dtResolvedPolyEdge edgePrevLeftEdge(const dtResolvedPolyEdge& edge)
 	{
 		do
 		{
@@ -384,10 +644,15 @@ namespace queriers
 			if (!currEdge.isValid()) break;
 			return edgeNextLeftEdge(currEdge);
 		} while (false);
-		return dtPolyEdge::INVALID;
+		return dtResolvedPolyEdge();
 	}
 
-	inline static dtPolyEdge edgeNextRightEdge(const dtPolyEdge& edge)
+	inline static dtPolyEdge edgePrevLeftEdge(const dtPolyEdge& edge)
+	{
+		return edgePrevLeftEdge(dtResolvedPolyEdge(edge));
+	}
+
+	inline static dtResolvedPolyEdge edgeNextRightEdge(const dtResolvedPolyEdge& edge)
 	{
 		do
 		{
@@ -399,10 +664,15 @@ namespace queriers
 			if (!currEdge.isValid()) break;
 			return edgeOppositeEdge(currEdge);
 		} while (false);
-		return dtPolyEdge::INVALID;
+		return dtResolvedPolyEdge();
 	}
 
-	inline static dtPolyEdge edgePrevRightEdge(const dtPolyEdge& edge)
+	inline static dtPolyEdge edgeNextRightEdge(const dtPolyEdge& edge)
+	{
+		return edgeNextRightEdge(dtResolvedPolyEdge(edge));
+	}
+
+	inline static dtResolvedPolyEdge edgePrevRightEdge(const dtResolvedPolyEdge& edge)
 	{
 		do
 		{
@@ -411,10 +681,15 @@ namespace queriers
 			currEdge = edgeNextLeftEdge(currEdge);
 			return edgeOppositeEdge(currEdge);
 		} while (false);
-		return dtPolyEdge::INVALID;
+		return dtResolvedPolyEdge();
 	}
 
-	inline static dtPolyFace edgeRightFace(const dtPolyEdge& edge)
+	inline static dtPolyEdge edgePrevRightEdge(const dtPolyEdge& edge)
+	{
+		return edgePrevRightEdge(dtResolvedPolyEdge(edge));
+	}
+
+	inline static dtResolvedPolyFace edgeRightFace(const dtResolvedPolyEdge& edge)
 	{
 		do
 		{
@@ -422,20 +697,38 @@ namespace queriers
 			if (!currEdge.isValid()) break;
 			return edgeLeftFace(currEdge);
 		} while (false);
-		return dtPolyFace::INVALID;
+		return dtResolvedPolyFace();
 	}
 
-	inline static bool edgeIsBoundary(const dtPolyEdge& edge)
+	inline static dtPolyFace edgeRightFace(const dtPolyEdge& edge)
+	{
+		return edgeRightFace(dtResolvedPolyEdge(edge));
+	}
+
+	// 边在其左侧face内的局部索引[0..2]，局部边k从face的局部顶点k指向k+1
+	inline static int edgeFaceIndex(const dtResolvedPolyEdge& edge)
+	{
+		if (edge.isValid())
+		{
+			return edgeLocalIndex(edge.tile, edge.poly, edge.innerIdx);
+		}
+		return -1;
+	}
+
+	inline static int edgeFaceIndex(const dtPolyEdge& edge)
+	{
+		return edgeFaceIndex(dtResolvedPolyEdge(edge));
+	}
+
+	inline static bool edgeIsBoundary(const dtResolvedPolyEdge& edge)
 	{
-		const dtMeshTile* tile = 0;
-		const dtPoly* poly = 0;
-		if (edge.getTileAndPoly(&tile, &poly))
+		if (edge.isValid())
 		{
 			if (edge.innerIdx < DT_VERTS_PER_POLYGON)
 			{
 				// 原始边
 				unsigned short edgeIdx = (unsigned short)edge.innerIdx;
-				unsigned short nei = poly->neis[edgeIdx];
+				unsigned short nei = edge.poly->neis[edgeIdx];
 				return nei == 0;
 			}
 			else
@@ -447,76 +740,103 @@ namespace queriers
 		return false;
 	}
 
+	inline static bool edgeIsBoundary(const dtPolyEdge& edge)
+	{
+		return edgeIsBoundary(dtResolvedPolyEdge(edge));
+	}
+
 	// Face
+	inline static dtResolvedPolyEdge faceEdge(const dtResolvedPolyFace& face)
+	{
+		if (face.isValid())
+		{
+			int edges[3];
+			faceEdgeIndices(face.tile, face.poly, face.innerIdx, edges);
+			return face.sibling(edges[0]);
+		}
+		return dtResolvedPolyEdge();
+	}
+
 	inline static dtPolyEdge faceEdge(const dtPolyFace& face)
 	{
-		const dtMeshTile* tile = 0;
-		const dtPoly* poly = 0;
-		if (face.getTileAndPoly(&tile, &poly))
+		return faceEdge(dtResolvedPolyFace(face));
+	}
+
+	// face的第k条局部边
+	inline static dtResolvedPolyEdge faceLocalEdge(const dtResolvedPolyFace& face, int k)
+	{
+		if (face.isValid() && k >= 0 && k < 3)
 		{
-			auto edgeIndex = -1;
-			if (poly->vertCount == 3)
+			int edges[3];
+			faceEdgeIndices(face.tile, face.poly, face.innerIdx, edges);
+			return face.sibling(edges[k]);
+		}
+		return dtResolvedPolyEdge();
+	}
+
+	inline static dtPolyEdge faceLocalEdge(const dtPolyFace& face, int k)
+	{
+		return faceLocalEdge(dtResolvedPolyFace(face), k);
+	}
+
+	// 构建tile时预计算的face通行宽度，没有时返回null
+	inline static const dtFaceClearance* faceClearance(const dtResolvedPolyFace& face)
+	{
+		if (face.isValid() && face.tile->faceClearances)
+		{
+			const int ip = (int)(face.poly - face.tile->polys);
+			if (ip < face.tile->header->faceClearanceCount / DT_FACES_PER_POLYGON &&
+				face.innerIdx < face.poly->vertCount - 2)
 			{
-				edgeIndex = 0;
+				return &face.tile->faceClearances[ip * DT_FACES_PER_POLYGON + face.innerIdx];
 			}
-			else
-			{
-				auto i = face.innerIdx;
-				// N = poly->vertCount, 表示总边数
-				// i == 0				=> [0, 1, 6]
-				// i > 0 && i < N-3		=> [7 + (i-1)*2, i, 8 + (i-1)*2]
-				// i == N-3				=> [7 + (i-1)*2, i+1, i+2]
+		}
+		return 0;
+	}
 
-				if (i == 0)
-				{
-					edgeIndex = 0;
-				}
-				else
-				{
-					edgeIndex = 7 + (i - 1) * 2;
-				}
+	inline static const dtFaceClearance* faceClearance(const dtPolyFace& face)
+	{
+		return faceClearance(dtResolvedPolyFace(face));
+	}
+
+	// 构建tile时预计算的抽象图信息（走廊链、死胡同），没有时返回null
+	inline static const dtFaceAbstraction* faceAbstraction(const dtResolvedPolyFace& face)
+	{
+		if (face.isValid() && face.tile->faceAbstractions)
+		{
+			const int ip = (int)(face.poly - face.tile->polys);
+			if (ip < face.tile->header->faceAbstractionCount / DT_FACES_PER_POLYGON &&
+				face.innerIdx < face.poly->vertCount - 2)
+			{
+				return &face.tile->faceAbstractions[ip * DT_FACES_PER_POLYGON + face.innerIdx];
 			}
-			return dtPolyEdge(face.navmesh, face.polyId, edgeIndex);
 		}
-		return dtPolyEdge::INVALID;
+		return 0;
 	}
 
-	inline static void faceAllEdges(const dtPolyFace& face, dtPolyEdge outEdges[3])
+	inline static void faceAllEdges(const dtResolvedPolyFace& face, dtResolvedPolyEdge outEdges[3])
 	{
-		const dtMeshTile* tile = 0;
-		const dtPoly* poly = 0;
-		if (face.getTileAndPoly(&tile, &poly))
+		if (face.isValid())
 		{
 			int edges[3];
-			if (poly->vertCount == 3)
+			faceEdgeIndices(face.tile, face.poly, face.innerIdx, edges);
+			for (int k = 0; k < 3; ++k)
 			{
-				edges[0] = 0; edges[1] = 1; edges[2] = 2;
-			}
-			else
-			{
-				auto i = face.innerIdx;
-				// N = poly->vertCount, 表示总边数
-				// i == 0				=> [0, 1, 6]
-				// i > 0 && i < N-3		=> [7 + (i-1)*2, i+1, 8 + (i-1)*2]
-				// i == N-3				=> [7 + (i-1)*2, i+1, i+2]
-
-				if (i == 0)
-				{
-					edges[0] = 0; edges[1] = 1; edges[2] = 6;
-				}
-				else if (i == poly->vertCount - 3)
-				{
-					edges[0] = 7 + (i - 1) * 2; edges[1] = i + 1; edges[2] = i + 2;
-				}
-				else
-				{
-					edges[0] = 7 + (i - 1) * 2; edges[1] = i + 1; edges[2] = 8 + (i - 1) * 2;
-				}
+				outEdges[k] = face.sibling(edges[(k + 1) % 3]);
 			}
+		}
+	}
 
+	inline static void faceAllEdges(const dtPolyFace& face, dtPolyEdge outEdges[3])
+	{
+		dtResolvedPolyFace resolvedFace(face);
+		if (resolvedFace.isValid())
+		{
+			dtResolvedPolyEdge resolvedEdges[3];
+			faceAllEdges(resolvedFace, resolvedEdges);
 			for (int k = 0; k < 3; ++k)
 			{
-				outEdges[k] = dtPolyEdge(face.navmesh, face.polyId, edges[(k + 1) % 3]);
+				outEdges[k] = resolvedEdges[k];
 			}
 		}
 	}
@@ -524,16 +844,22 @@ namespace queriers
 
 namespace iterations
 {
+	// 迭代器内部只解析一次起始face，之后的遍历都使用已解析的primitive
 	struct fromFaceToInnerEdges
 	{
-		fromFaceToInnerEdges(const dtPolyFace& fromFace)
+		fromFaceToInnerEdges(const dtResolvedPolyFace& fromFace)
 			: _fromFace(fromFace)
 		{
 			_fromFaceEdge = queriers::faceEdge(fromFace);
 			_nextEdge = _fromFaceEdge;
 		}
 
-		dtPolyEdge next()
+		fromFaceToInnerEdges(const dtPolyFace& fromFace)
+			: fromFaceToInnerEdges(dtResolvedPolyFace(fromFace))
+		{
+		}
+
+		dtResolvedPolyEdge next()
 		{
 			if (_nextEdge.isValid())
 			{
@@ -541,33 +867,38 @@ namespace iterations
 				_nextEdge = queriers::edgeNextLeftEdge(_nextEdge);
 				if (_nextEdge == _fromFaceEdge)
 				{
-					_nextEdge = dtPolyEdge::INVALID;
+					_nextEdge.reset();
 				}
 			}
 			else 
 			{
-				_resultEdge = dtPolyEdge::INVALID;
+				_resultEdge.reset();
 			}
 
 			return _resultEdge;
 		}
 
-		dtPolyFace _fromFace;
-		dtPolyEdge _fromFaceEdge;
-		dtPolyEdge _nextEdge;
-		dtPolyFace _resultEdge;
+		dtResolvedPolyFace _fromFace;
+		dtResolvedPolyEdge _fromFaceEdge;
+		dtResolvedPolyEdge _nextEdge;
+		dtResolvedPolyEdge _resultEdge;
 	};
 
 	struct fromFaceToVertices
 	{
-		fromFaceToVertices(const dtPolyFace& fromFace)
+		fromFaceToVertices(const dtResolvedPolyFace& fromFace)
 			: _fromFace(fromFace)
 		{
 			_fromFaceEdge = queriers::faceEdge(fromFace);
 			_nextEdge = _fromFaceEdge;
 		}
 
-		dtPolyVertex next()
+		fromFaceToVertices(const dtPolyFace& fromFace)
+			: fromFaceToVertices(dtResolvedPolyFace(fromFace))
+		{
+		}
+
+		dtResolvedPolyVertex next()
 		{
 			if (_nextEdge.isValid())
 			{
@@ -575,16 +906,34 @@ namespace iterations
 				_nextEdge = queriers::edgeNextLeftEdge(_nextEdge);
 				if (_nextEdge == _fromFaceEdge)
 				{
-					_nextEdge = dtPolyEdge::INVALID;
+					_nextEdge.reset();
 				}
 			}
 			else 
 			{
-				_resultVertex = dtPolyVertex::INVALID;
+				_resultVertex.reset();
 			}
 			return _resultVertex;
 		}
 
+		int allVertices(dtResolvedPolyVertex *outVerts, int maxVertNum)
+		{
+			int vi = 0;
+			do 
+			{
+				if (vi >= maxVertNum)
+					break;
+
+				auto v = next();
+				if (!v.isValid()) 
+					break;
+
+				outVerts[vi] = v;
+				++vi;
+			} while (true);
+			return vi;
+		}
+
 		int allVertices(dtPolyVertex *outVerts, int maxVertNum)
 		{
 			int vi = 0;
@@ -603,22 +952,27 @@ namespace iterations
 			return vi;
 		}
 
-		dtPolyFace _fromFace;
-		dtPolyEdge _fromFaceEdge;
-		dtPolyEdge _nextEdge;
-		dtPolyVertex _resultVertex;
+		dtResolvedPolyFace _fromFace;
+		dtResolvedPolyEdge _fromFaceEdge;
+		dtResolvedPolyEdge _nextEdge;
+		dtResolvedPolyVertex _resultVertex;
 	};
 
 	struct fromFaceToNeighborFace
 	{
-		fromFaceToNeighborFace(const dtPolyFace& fromFace)
+		fromFaceToNeighborFace(const dtResolvedPolyFace& fromFace)
 			: _fromFace(fromFace)
 		{
 			_fromFaceEdge = queriers::faceEdge(fromFace);
 			_nextEdge = _fromFaceEdge;
 		}
 
-		dtPolyFace next()
+		fromFaceToNeighborFace(const dtPolyFace& fromFace)
+			: fromFaceToNeighborFace(dtResolvedPolyFace(fromFace))
+		{
+		}
+
+		dtResolvedPolyFace next()
 		{
 			if (_nextEdge.isValid()) 
 			{
@@ -628,7 +982,7 @@ namespace iterations
 					_nextEdge = queriers::edgeNextLeftEdge(_nextEdge);
 					if (_nextEdge == _fromFaceEdge)
 					{
-						_nextEdge = dtPolyEdge::INVALID;
+						_nextEdge.reset();
 						break;
 					}
 					if (_resultFace.isValid())
@@ -639,12 +993,30 @@ namespace iterations
 			}
 			else
 			{
-				_resultFace = dtPolyFace::INVALID;
+				_resultFace.reset();
 			}
 
 			return _resultFace;
 		}
 
+		int allFaces(dtResolvedPolyFace* outFaces, int maxFaceNum)
+		{
+			int fi = 0;
+			do
+			{
+				if (fi >= maxFaceNum)
+					break;
+
+				auto f = next();
+				if (!f.isValid())
+					break;
+				
+				outFaces[fi] = f;
+				++fi;
+			} while (true);
+			return fi;
+		}
+
 		int allFaces(dtPolyFace* outFaces, int maxFaceNum)
 		{
 			int fi = 0;
@@ -663,16 +1035,16 @@ namespace iterations
 			return fi;
 		}
 
-		dtPolyFace _fromFace;
-		dtPolyEdge _fromFaceEdge;
-		dtPolyEdge _nextEdge;
-		dtPolyFace _resultFace;
+		dtResolvedPolyFace _fromFace;
+		dtResolvedPolyEdge _fromFaceEdge;
+		dtResolvedPolyEdge _nextEdge;
+		dtResolvedPolyFace _resultFace;
 	};
 
 	struct fromPolyToInternalFaces
 	{
 		fromPolyToInternalFaces(const dtNavMesh* nav, const dtPolyRef& ref)
-			: _nav(nav), _ref(ref), _poly(0), _faceIdx(0), _resultFace()
+			: _nav(nav), _ref(ref), _tile(0), _poly(0), _faceIdx(0), _resultFace()
 		{
 			if (_nav && _ref)
 			{
@@ -680,17 +1052,19 @@ namespace iterations
 				const dtPoly* poly = 0;
 				if (dtStatusSucceed(_nav->getTileAndPolyByRef(_ref, &tile, &poly)))
 				{
+					_tile = tile;
 					_poly = poly;
 					_faceIdx = 0;
 				}
 			}
 		}
 
-		dtPolyFace next()
+		dtResolvedPolyFace next()
 		{
-			if (_poly && _faceIdx < _poly->vertCount)
+			// 扇形三角化后，N边形共有N-2个face
+			if (_poly && _faceIdx < _poly->vertCount - 2)
 			{
-				_resultFace = dtPolyFace(_nav, _ref, _faceIdx);
+				_resultFace = dtResolvedPolyFace(_nav, _ref, (dtPrimIndex)_faceIdx, _tile, _poly);
 				++_faceIdx;
 			}
 			else
@@ -702,23 +1076,20 @@ namespace iterations
 
 		const dtNavMesh*	_nav;
 		dtPolyRef			_ref;
+		const dtMeshTile*	_tile;
 		const dtPoly*		_poly;	
 		int					_faceIdx;
-		dtPolyFace		_resultFace;
+		dtResolvedPolyFace	_resultFace;
 	};
 }
 
 namespace geom
 {
-	inline static bool projectPointOnEdge(const float* p, const dtPolyEdge& edge, float* proj)
+	inline static bool projectPointOnEdge(const float* p, const dtResolvedPolyEdge& edge, float* proj)
 	{
-		dtPolyVertex v0, v1;
-		if (queriers::edgeOriginAndDestinationVertex(edge, &v0, &v1))
+		float p0[3], p1[3];
+		if (queriers::edgeOriginAndDestinationPosition(edge, p0, p1))
 		{
-			float p0[3], p1[3];
-			queriers::vertexPosition(v0, p0);
-			queriers::vertexPosition(v1, p1);
-
 			float p0p[3], n_p0p1[3];
 			dtVsub(p0p, p, p0);
 			dtVsub(n_p0p1, p1, p0);
@@ -730,15 +1101,16 @@ namespace geom
 		return false;
 	}
 
-	inline static float distanceSquaredPointToEdge(const float* p, const dtPolyEdge& edge)
+	inline static bool projectPointOnEdge(const float* p, const dtPolyEdge& edge, float* proj)
 	{
-		dtPolyVertex v0, v1;
-		if (queriers::edgeOriginAndDestinationVertex(edge, &v0, &v1))
-		{
-			float a[3], b[3];
-			queriers::vertexPosition(v0, a);
-			queriers::vertexPosition(v1, b);
+		return projectPointOnEdge(p, dtResolvedPolyEdge(edge), proj);
+	}
 
+	inline static float distanceSquaredPointToEdge(const float* p, const dtResolvedPolyEdge& edge)
+	{
+		float a[3], b[3];
+		if (queriers::edgeOriginAndDestinationPosition(edge, a, b))
+		{
 			float ab[3], ap[3];
 			dtVsub(ab, b, a);
 			float abSqr = dtVlenSqr(ab);
@@ -762,7 +1134,7 @@ namespace geom
 				else
 				{
 					float bp[3];
-					dtVsub(bp, p, a);
+					dtVsub(bp, p, b);
 					return dtVlenSqr(bp);
 				}
 			}
@@ -771,7 +1143,12 @@ namespace geom
 		return 0.0f;
 	}
 
-	inline static float distanceSquaredVertexToEdge(const dtPolyVertex& vertex, const dtPolyEdge& edge)
+	inline static float distanceSquaredPointToEdge(const float* p, const dtPolyEdge& edge)
+	{
+		return distanceSquaredPointToEdge(p, dtResolvedPolyEdge(edge));
+	}
+
+	inline static float distanceSquaredVertexToEdge(const dtResolvedPolyVertex& vertex, const dtResolvedPolyEdge& edge)
 	{
 		float p[3];
 		if (queriers::vertexPosition(vertex, p))
@@ -781,15 +1158,16 @@ namespace geom
 		return 0.0f;
 	}
 
-	inline static bool closestPointToEdge(const float* p, const dtPolyEdge& edge, float* closest)
+	inline static float distanceSquaredVertexToEdge(const dtPolyVertex& vertex, const dtPolyEdge& edge)
 	{
-		dtPolyVertex v0, v1;
-		if (queriers::edgeOriginAndDestinationVertex(edge, &v0, &v1))
-		{
-			float a[3], b[3];
-			queriers::vertexPosition(v0, a);
-			queriers::vertexPosition(v1, b);
+		return distanceSquaredVertexToEdge(dtResolvedPolyVertex(vertex), dtResolvedPolyEdge(edge));
+	}
 
+	inline static bool closestPointToEdge(const float* p, const dtResolvedPolyEdge& edge, float* closest)
+	{
+		float a[3], b[3];
+		if (queriers::edgeOriginAndDestinationPosition(edge, a, b))
+		{
 			float ab[3], ap[3];
 			dtVsub(ab, b, a);
 			dtVsub(ap, p, a);
@@ -822,6 +1200,11 @@ namespace geom
 		return false;
 	}
 
+	inline static bool closestPointToEdge(const float* p, const dtPolyEdge& edge, float* closest)
+	{
+		return closestPointToEdge(p, dtResolvedPolyEdge(edge), closest);
+	}
+
 	// 0 if the p on edge
 	// 1 if the p goes to the left
 	// -1 if the p goes to the right
@@ -840,76 +1223,119 @@ namespace geom
 			return REL_SIDE_ON;
 	}
 
-	inline static bool relativeSideToEdge(const float* p, const dtPolyEdge& edge, int* side)
+	inline static bool relativeSideToEdge(const float* p, const dtResolvedPolyEdge& edge, int* side)
 	{
-		dtPolyVertex v0, v1;
-		if (queriers::edgeOriginAndDestinationVertex(edge, &v0, &v1))
+		float a[3], b[3];
+		if (queriers::edgeOriginAndDestinationPosition(edge, a, b))
 		{
-			float a[3], b[3];
-			queriers::vertexPosition(v0, a);
-			queriers::vertexPosition(v1, b);
-
 			*side = relativeSide(p, a, b);
 			return true;
 		}
 		return false;
 	}
 
+	inline static bool relativeSideToEdge(const float* p, const dtPolyEdge& edge, int* side)
+	{
+		return relativeSideToEdge(p, dtResolvedPolyEdge(edge), side);
+	}
+
 	/** Returns if \a p lies on the left side of the line \a a - \a b. Uses XZ space. Also returns true if the points are colinear */
 	inline static bool left(const float* a, const float* b, const float* p) 
 	{
 		return (b[0] - a[0]) * (p[2] - a[2]) - (p[0] - a[0]) * (b[2] - a[2]) <= 0;
 	}
+
+	// 线段pq与线段ab在xz平面上最近距离的平方
+	inline static float distanceSquaredSegmentToSegment2D(const float* p, const float* q, const float* a, const float* b)
+	{
+		float s, t;
+		if (dtIntersectSegSeg2D(p, q, a, b, s, t) && s >= 0.0f && s <= 1.0f && t >= 0.0f && t <= 1.0f)
+			return 0.0f;
+		float u;
+		return dtMin(dtMin(dtDistancePtSegSqr2D(p, a, b, u), dtDistancePtSegSqr2D(q, a, b, u)),
+					 dtMin(dtDistancePtSegSqr2D(a, p, q, u), dtDistancePtSegSqr2D(b, p, q, u)));
+	}
+
+	// 半径为radius的圆沿pq移动，返回圆第一次与线段ab重叠时圆心的参数t [0..1]，不重叠时返回false (xz平面)
+	bool sweptCircleHitSegment2D(const float* p, const float* q, const float radius, const float* a, const float* b, float* t);
 }
 
 namespace astar
 {
-	struct dtAstarNodeDebug
-	{
-		dtPolyFace	face;
-		float		entry_pos[3];
-	};
-
 	// 检查通过throughFace从fromEdge到toEdge，半径为radius的单位是否能够通过
+	// fromEdge为上一个face的边，toEdge为throughFace的边
+	// tile带有dtFaceClearance时直接查表，否则在运行时用固定大小的栈搜索附近的边界，不分配内存，
+	// 栈放不下的face不再搜索，这么大的搜索范围是开阔区域，没有搜到的边界按不在半径内处理
 	bool isWalkableByRadius(float radius, const dtPolyEdge& fromEdge, const dtPolyFace& throughFace, const dtPolyEdge& toEdge);
+	bool isWalkableByRadius(float radius, const dtResolvedPolyEdge& fromEdge, const dtResolvedPolyFace& throughFace, const dtResolvedPolyEdge& toEdge);
+
+	// 一次展开最多走过的走廊face数
+	static const int MAX_CORRIDOR_CHAIN = 1024;
+
+	// 抽象图：走廊face离开的那条边，返回下一个face，没有时返回无效face
+	dtResolvedPolyFace corridorNextFace(const dtResolvedPolyFace& face, const dtPolyFace& fromFace, dtResolvedPolyEdge* exitEdge);
+
+	// face是否挨着tile内的某个死胡同区域
+	bool touchesDeadEnd(const dtResolvedPolyFace& face, const dtMeshTile* tile, const unsigned short region);
 }
 
 namespace funnel
 {
-	struct dtFunnelDebug
+	// straightPathByRadius和dtRadiusModifier使用的临时内存
+	// 初始化一次后可以重复使用，拉直路径时不再分配内存，同一时间只能被一个查询使用
+	class dtRadiusPathScratch
 	{
-		dtPolyEdge portalEdge;
-		dtPolyVertex portalLeft;
-		dtPolyVertex portalRight;
-	};
+	public:
+		dtRadiusPathScratch();
+		~dtRadiusPathScratch();
 
-	struct dtFunnelStep
-	{
-		float	apexPos[3];
-		float	leftPos[3];
-		float	rightPos[3];
-		float	currPos[3];
-		int		currSide;
+		// maxPoints: straightPathByRadius需要portalEdgeCount+3个点，applyModify需要straightPathCount个点
+		bool init(const int maxPoints);
+
+		inline int getMaxPoints() const { return m_maxPoints; }
+
+		inline int getMemUsed() const
+		{
+			return sizeof(*this) +
+				(sizeof(float)*3 + sizeof(int) + sizeof(float)*3 + sizeof(unsigned char)) * m_maxPoints;
+		}
+
+		inline float* getPoints() { return m_points; }
+		inline int* getPointSides() { return m_pointSides; }
+		inline float* getRadii() { return m_radii; }
+		inline float* getStartAngles() { return m_startAngles; }
+		inline float* getEndAngles() { return m_endAngles; }
+		inline unsigned char* getDirs() { return m_dirs; }
+
+		/// 设置后straightPathByRadius会记录DT_TRACE_FUNNEL_STEP事件，缓冲区由调用者持有
+		inline void setTraceBuffer(debug::dtTraceBuffer* trace) { m_trace = trace; }
+		inline debug::dtTraceBuffer* getTraceBuffer() const { return m_trace; }
+
+	private:
+		// Explicitly disabled copy constructor and copy assignment operator.
+		dtRadiusPathScratch(const dtRadiusPathScratch&);
+		dtRadiusPathScratch& operator=(const dtRadiusPathScratch&);
+
+		void purge();
+
+		float* m_points;			// 漏斗算法的点 [(x, y, z) * m_maxPoints]
+		int* m_pointSides;			// 点在路径的哪一侧 [m_maxPoints]
+		float* m_radii;				// 每个拐点的圆半径 [m_maxPoints]
+		float* m_startAngles;		// 拐点圆弧的起始角度 [m_maxPoints]
+		float* m_endAngles;			// 拐点圆弧的结束角度 [m_maxPoints]
+		unsigned char* m_dirs;		// 圆弧方向 [m_maxPoints]
+		int m_maxPoints;
+		debug::dtTraceBuffer* m_trace;
 	};
 
+	// scratch至少需要portalEdgeCount+3个点，否则返回DT_FAILURE | DT_BUFFER_TOO_SMALL
 	dtStatus straightPathByRadius(const float* startPos, const float* endPos,
 		const dtPolyFace* path, const int pathSize,
 		const dtPolyEdge* portalEdges, const int portalEdgeCount,
 		float* straightPath, unsigned char* straightPathFlags, dtPolyFace* straightPathRefs, 
 		int* straightPathCount, const int maxStraightPath, 
-		const float radius
-	#if DT_DEBUG_ASTAR
-		,
-		dtFunnelDebug* portalDebugs, int* portalDebugCount, const int maxPortalDebug,
-		dtFunnelStep* funnelSteps, int* funnelStepCount, const int maxFunnelStep
-	#endif
-		);
+		const float radius, dtRadiusPathScratch* scratch);
 	
-	struct dtRadiusModifierDebug
-	{
-		float pos[3];
-		float radius;
-	};
 	class dtRadiusModifier
 	{
 	public:
@@ -918,14 +1344,11 @@ namespace funnel
 		{
 		}
 
-		void applyModify(
+		// scratch至少需要straightPathCount个点，否则返回DT_FAILURE | DT_BUFFER_TOO_SMALL
+		dtStatus applyModify(
 			const float* straightPath, const int straightPathCount,
-			float* mdifiedStraightPath, int* mdifiedStraightPathCount, const int maxMdifiedStraightPath
-		#if DT_DEBUG_ASTAR
-			,
-			dtRadiusModifierDebug* modifierDebug, int* modifierDebugCount, const int maxModifierDebug
-		#endif
-			);
+			float* mdifiedStraightPath, int* mdifiedStraightPathCount, const int maxMdifiedStraightPath,
+			dtRadiusPathScratch* scratch);
 
 	private:
 		/** Calculates inner tangents for a pair of circles.
@@ -1019,111 +1442,4 @@ namespace funnel
 	};
 }
 
-namespace debug
-{
-	enum class LogLevel 
-	{
-		INFO,
-		WARNING,
-		CRITICAL
-	};
-
-	class dtLogger
-	{
-	public:
-		static void Init(
-			LogLevel level = LogLevel::INFO,
-			const std::string& baseName = "app",
-			const std::string& logDir = "./logs"
-		) {
-			auto& instance = GetInstance();
-
-			instance.minLevel = level;
-			instance.logBaseName = baseName;
-			instance.logDirectory = logDir;
-
-			// 确保日志目录存在
-			/*if (!fs::exists(instance.logDirectory)) {
-				fs::create_directories(instance.logDirectory);
-			}*/
-
-			// 打开初始日志文件
-			OpenCurrentLogFile();
-		}
-
-		template <typename... Args>
-		static void Log(LogLevel level, const char* file, int line, const char* format, Args&&... args) 
-		{
-			auto& instance = GetInstance();
-			if (level < instance.minLevel) return;
-
-			// 获取当前时间
-			auto now = std::time(nullptr);
-			char timeStr[20];
-			std::strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
-
-			char message[1024];
-			sprintf_s(message, 1024, format, args...);
-
-			if (instance.fileStream.is_open()) {
-				instance.fileStream << timeStr << " " << message << "\n";
-				instance.fileStream.flush();
-			}
-		}
-
-	private:
-		// 单例模式
-		static dtLogger& GetInstance() 
-		{
-			static dtLogger instance;
-			return instance;
-		}
-
-		// 构造函数私有
-		dtLogger() : minLevel(LogLevel::INFO) {}
-
-		// 禁止复制
-		dtLogger(const dtLogger&) = delete;
-		dtLogger& operator=(const dtLogger&) = delete;
-
-		// 打开带时间戳的日志文件
-		static void OpenCurrentLogFile() {
-			auto& instance = GetInstance();
-
-			// 获取当前日期用于文件名
-			auto now = std::chrono::system_clock::now();
-			auto now_c = std::chrono::system_clock::to_time_t(now);
-			std::tm tm = {};
-#ifdef _WIN32
-			localtime_s(&tm, &now_c);
-#else
-			localtime_r(&now_c, &tm);
-#endif
-
-			char dateStr[20];
-			std::strftime(dateStr, sizeof(dateStr), "%Y.%m.%d-%H.%M.%S", &tm);
-
-			// 构造带时间戳的文件名
-			std::ostringstream filename;
-			filename << instance.logBaseName << "_" << dateStr << ".log";
-			std::string filePath = instance.logDirectory + "/" + filename.str();
-
-			// 打开文件
-			instance.fileStream.open(filePath, std::ios::app);
-			if (!instance.fileStream.is_open())
-			{
-				int i = 0;
-			}
-		}
-
-		LogLevel		minLevel;
-		std::string		logBaseName;
-		std::string		logDirectory;
-		std::ofstream	fileStream;
-	};
-}
-
-#define LOG_INFO(format, ...)     debug::dtLogger::Log(debug::LogLevel::INFO,     __FILE__, __LINE__, format, ##__VA_ARGS__)
-#define LOG_WARNING(format, ...)  debug::dtLogger::Log(debug::LogLevel::WARNING,  __FILE__, __LINE__, format, ##__VA_ARGS__)
-#define LOG_CRITICAL(format, ...) debug::dtLogger::Log(debug::LogLevel::CRITICAL, __FILE__, __LINE__, format, ##__VA_ARGS__)
 #endif // DETOURNAVMESHQUERY_NONPOINT_H
\ No newline at end of file
@@ -20,7 +20,7 @@
 #define DETOURNODE_H
 
 #include "DetourNavMesh.h"
-#include "DetourNavMeshQuery_Nonpoint.h"
+#include "DetourAssert.h"
 
 enum dtNodeFlags
 {
@@ -29,11 +29,31 @@ enum dtNodeFlags
 	DT_NODE_PARENT_DETACHED = 0x04, // parent of the node is not adjacent. Found using raycast.
 };
 
+// Define (or define in a build config) the following line to use 32bit node indices.
+// The node pools are then limited by dtNode::pidx instead of 65535 nodes, useful for long
+// searches over fan triangle nodes. The hash chains of the pools take twice the memory.
+//#define DT_NODE_INDEX32 1
+
+#ifdef DT_NODE_INDEX32
+typedef unsigned int dtNodeIndex;
+#else
 typedef unsigned short dtNodeIndex;
+#endif
 static const dtNodeIndex DT_NULL_IDX = (dtNodeIndex)~0;
 
-static const int DT_NODE_PARENT_BITS = 24;
-static const int DT_NODE_STATE_BITS = 2;
+static const int DT_NODE_PARENT_BITS = 23;
+
+// Maximum number of nodes of a dtNodePool: the node indices must fit dtNodeIndex without DT_NULL_IDX,
+// and dtNode::pidx, where 0 means "none".
+#ifdef DT_NODE_INDEX32
+static const int DT_MAX_NODES = (1 << DT_NODE_PARENT_BITS) - 1;
+#else
+static const int DT_MAX_NODES = DT_NULL_IDX;
+#endif
+static const int DT_NODE_STATE_BITS = 3;
+static const int DT_NODE_PRIM_BITS = 3;
+static const unsigned int DT_NODE_NULL_PRIM = (1 << DT_NODE_PRIM_BITS) - 1;	// primIdx of nodes covering a whole polygon.
+static const unsigned char DT_NODE_NULL_EDGE = 0xff;
 struct dtNode
 {
 	float pos[3];								///< Position of the node.
@@ -42,14 +62,12 @@ struct dtNode
 	unsigned int pidx : DT_NODE_PARENT_BITS;	///< Index to parent node.
 	unsigned int state : DT_NODE_STATE_BITS;	///< extra state information. A polyRef can have multiple nodes with different extra info. see DT_MAX_STATES_PER_NODE
 	unsigned int flags : 3;						///< Node flags. A combination of dtNodeFlags.
+	unsigned int primIdx : DT_NODE_PRIM_BITS;	///< Fan triangle of the polygon for triangle-based pathfinding, DT_NODE_NULL_PRIM otherwise.
 	dtPolyRef id;								///< Polygon ref the node corresponds to.
-
-	//
-	dtPrimIndex primIdx;						///< Triangle-based Pathfinding Index
-	dtPolyEdge entryEdge;
 };
 
 static const int DT_MAX_STATES_PER_NODE = 1 << DT_NODE_STATE_BITS;	// number of extra states per node. See dtNode::state
+static const unsigned char DT_NODE_BACKWARD_STATE = DT_MAX_STATES_PER_NODE / 2;	// first state of the backward nodes of a bidirectional search.
 
 class dtNodePool
 {
@@ -82,18 +100,44 @@ public:
 		return &m_nodes[idx - 1];
 	}
 	
+	// Edge of the parent triangle through which a triangle node was entered.
+	// Stored next to the nodes so that polygon searches keep the compact dtNode.
+	inline unsigned char getEntryEdge(const dtNode* node) const
+	{
+		return m_entryEdges[node - m_nodes];
+	}
+
+	inline void setEntryEdge(const dtNode* node, unsigned char edge)
+	{
+		m_entryEdges[node - m_nodes] = edge;
+	}
+
+	// Position of an open node in the heap of its dtNodeQueue, kept by the queue.
+	inline dtNodeIndex getHeapIndex(const dtNode* node) const
+	{
+		return m_heapIndices[node - m_nodes];
+	}
+
+	inline void setHeapIndex(const dtNode* node, dtNodeIndex i)
+	{
+		m_heapIndices[node - m_nodes] = i;
+	}
+	
 	inline int getMemUsed() const
 	{
 		return sizeof(*this) +
 			sizeof(dtNode)*m_maxNodes +
+			sizeof(unsigned char)*m_maxNodes +
 			sizeof(dtNodeIndex)*m_maxNodes +
-			sizeof(dtNodeIndex)*m_hashSize;
+			sizeof(dtNodeIndex)*m_maxNodes +
+			sizeof(dtNodeIndex)*m_hashSize +
+			sizeof(unsigned int)*m_hashSize;
 	}
 	
 	inline int getMaxNodes() const { return m_maxNodes; }
 	
 	inline int getHashSize() const { return m_hashSize; }
-	inline dtNodeIndex getFirst(int bucket) const { return m_first[bucket]; }
+	inline dtNodeIndex getFirst(int bucket) const { return m_bucketGens[bucket] == m_generation ? m_first[bucket] : DT_NULL_IDX; }
 	inline dtNodeIndex getNext(int i) const { return m_next[i]; }
 	inline int getNodeCount() const { return m_nodeCount; }
 	
@@ -103,17 +147,32 @@ private:
 	dtNodePool& operator=(const dtNodePool&);
 	
 	dtNode* m_nodes;
+	unsigned char* m_entryEdges;
+	dtNodeIndex* m_heapIndices;
 	dtNodeIndex* m_first;
 	dtNodeIndex* m_next;
+	unsigned int* m_bucketGens;		// The generation in which each bucket was last written, older buckets are empty.
+	unsigned int m_generation;		// Bumped by clear().
 	const int m_maxNodes;
 	const int m_hashSize;
 	int m_nodeCount;
 };
 
+// Number of children per node of the dtNodeQueue heap.
+// A 4-ary heap is shallower and compares the siblings within a cache line, define 2 for a binary heap.
+#ifndef DT_NODE_QUEUE_ARITY
+#define DT_NODE_QUEUE_ARITY 4
+#endif
+
+// Open list of a search, a min-heap on dtNode::total.
+// The heap positions of the nodes are kept in the node pool, so that modify() does not search the heap.
+// All the queued nodes must come from that pool.
+// A queue created without a pool keeps the old behavior: the nodes may come from anywhere and modify() searches the heap.
 class dtNodeQueue
 {
 public:
 	dtNodeQueue(int n);
+	dtNodeQueue(int n, dtNodePool* nodePool);
 	~dtNodeQueue();
 	
 	inline void clear() { m_size = 0; }
@@ -124,7 +183,8 @@ public:
 	{
 		dtNode* result = m_heap[0];
 		m_size--;
-		trickleDown(0, m_heap[m_size]);
+		if (m_size > 0)
+			trickleDown(0, m_heap[m_size]);
 		return result;
 	}
 	
@@ -134,19 +194,29 @@ public:
 		bubbleUp(m_size-1, node);
 	}
 	
+	// Moves the node up after its total was lowered. The node must be in the queue.
 	inline void modify(dtNode* node)
 	{
-		for (int i = 0; i < m_size; ++i)
+		if (!m_nodePool)
 		{
-			if (m_heap[i] == node)
+			for (int i = 0; i < m_size; ++i)
 			{
-				bubbleUp(i, node);
-				return;
+				if (m_heap[i] == node)
+				{
+					bubbleUp(i, node);
+					return;
+				}
 			}
+			return;
 		}
+		const int i = (int)m_nodePool->getHeapIndex(node);
+		dtAssert(i < m_size && m_heap[i] == node);
+		bubbleUp(i, node);
 	}
 	
 	inline bool empty() const { return m_size == 0; }
+
+	inline int size() const { return m_size; }
 	
 	inline int getMemUsed() const
 	{
@@ -155,6 +225,9 @@ public:
 	}
 	
 	inline int getCapacity() const { return m_capacity; }
+
+	// The pool that keeps the heap positions, or null for a queue created without one.
+	inline const dtNodePool* getNodePool() const { return m_nodePool; }
 	
 private:
 	// Explicitly disabled copy constructor and copy assignment operator.
@@ -164,6 +237,7 @@ private:
 	void bubbleUp(int i, dtNode* node);
 	void trickleDown(int i, dtNode* node);
 	
+	dtNodePool* m_nodePool;
 	dtNode** m_heap;
 	const int m_capacity;
 	int m_size;
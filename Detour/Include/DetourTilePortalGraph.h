@@ -0,0 +1,138 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef DETOURTILEPORTALGRAPH_H
+#define DETOURTILEPORTALGRAPH_H
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourStatus.h"
+
+class dtNodePool;
+class dtNodeQueue;
+
+/// The number of bits of the portal index in the node ids of the portal searches.
+static const int DT_TILE_PORTAL_BITS = 10;
+
+/// The maximum number of portals of a tile, the links past it are left out of the graph.
+static const int DT_MAX_TILE_PORTALS = 1 << DT_TILE_PORTAL_BITS;
+
+/// A link from a polygon of a tile to a polygon of another tile.
+/// @ingroup detour
+struct dtTilePortal
+{
+	dtPolyRef poly;			///< The polygon of the tile.
+	dtPolyRef neighbour;	///< The polygon of the other tile.
+	float pos[3];			///< The middle of the portal. [(x, y, z)]
+	int twin;				///< Index of the portal back from the neighbour in its tile, -1 if none.
+};
+
+/// Abstract graph of the tile portals for the long range path queries, see dtNavMeshQuery::findPathHierarchical.
+///
+/// The nodes are the links between the tiles (#DT_EXT_LINK edges and the off-mesh connections
+/// crossing tiles). The portals of a tile are connected by the cost of the shortest path between
+/// them that stays in the tile, and each portal is connected to its twin in the neighbour tile.
+/// The costs are measured with the default filter, all the polygons pass and the area costs are 1.
+/// @ingroup detour
+class dtTilePortalGraph
+{
+public:
+	dtTilePortalGraph();
+	~dtTilePortalGraph();
+
+	/// Builds the graph for the current tiles of the navigation mesh.
+	///  @param[in]	nav			The navigation mesh. Must stay alive while the graph is used.
+	///  @param[in]	maxNodes	Maximum number of search nodes of the intra-tile searches. [Limits: 0 < value <= #DT_MAX_NODES]
+	/// @returns The status flags for the operation.
+	dtStatus init(const dtNavMesh* nav, const int maxNodes);
+
+	/// Updates the tiles added or removed since the last update and their neighbours.
+	/// @returns The status flags for the operation.
+	dtStatus update();
+
+	/// Releases the graph.
+	void clear();
+
+	/// Checks that the graph is up to date with the tiles of the navigation mesh.
+	///  @param[in]	nav		The navigation mesh.
+	/// @returns True if the graph can be used with the navigation mesh.
+	bool isValid(const dtNavMesh* nav) const
+	{
+		return m_tiles && nav == m_nav && nav->getTileGeneration() == m_tileGeneration;
+	}
+
+	/// Gets the portals of a tile.
+	///  @param[in]		tileIndex		The index of the tile, see dtNavMesh::decodePolyIdTile.
+	///  @param[out]	portalCount		The number of portals of the tile.
+	/// @returns The portals of the tile.
+	const dtTilePortal* getPortals(const int tileIndex, int* portalCount) const;
+
+	/// Gets the costs between the portals of a tile, FLT_MAX if a portal cannot be reached from the other in the tile.
+	///  @param[in]	tileIndex	The index of the tile, see dtNavMesh::decodePolyIdTile.
+	/// @returns The costs from portal i to portal j at [i * portalCount + j].
+	const float* getCosts(const int tileIndex) const;
+
+	/// @returns The number of tiles rebuilt by the last #init or #update.
+	int getUpdatedTileCount() const { return m_updatedTileCount; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtTilePortalGraph(const dtTilePortalGraph&);
+	dtTilePortalGraph& operator=(const dtTilePortalGraph&);
+
+	struct TileGraph
+	{
+		dtTileRef ref;			///< The tile the graph was built for, 0 if none.
+		int x, y;				///< The location of the tile.
+		int portalCount;		///< Number of portals.
+		dtTilePortal* portals;	///< The portals. [portalCount]
+		float* costs;			///< The costs between the portals. [portalCount * portalCount]
+	};
+
+	void markTileAndNeighbours(const int x, const int y, unsigned char flag);
+	dtStatus buildTile(const int tileIndex);
+	void linkTwins(const int tileIndex);
+
+	const dtNavMesh* m_nav;				///< The navigation mesh of the graph.
+	unsigned int m_tileGeneration;		///< The tile generation of the navigation mesh when updated.
+	int m_maxTiles;						///< Number of tile graphs.
+	TileGraph* m_tiles;					///< The graphs of the tiles. [m_maxTiles]
+	unsigned char* m_marks;				///< Update marks of the tiles. [m_maxTiles]
+	int m_updatedTileCount;				///< Number of tiles rebuilt by the last update.
+	dtNodePool* m_nodePool;				///< Nodes of the intra-tile searches.
+	dtNodeQueue* m_openList;			///< Open list of the intra-tile searches.
+	dtQueryFilter m_filter;				///< The filter of the intra-tile costs.
+};
+
+/// Searches the polygons of a tile from a point, without leaving the tile.
+/// The nodes are keyed by polygon and @p state, their position is the middle of the portal they were first
+/// entered through, and their cost is the cost from the start point. The node pool is not cleared.
+///  @param[in]		nav			The navigation mesh.
+///  @param[in]		filter		The polygon filter to apply to the search.
+///  @param[in]		nodePool	The node pool of the search.
+///  @param[in]		openList	The open list of the search, cleared on start.
+///  @param[in]		startRef	The reference of the start polygon.
+///  @param[in]		startPos	A position within the start polygon. [(x, y, z)]
+///  @param[in]		state		The state of the search nodes.
+/// @returns The status flags for the operation.
+/// @ingroup detour
+dtStatus dtSearchTilePolys(const dtNavMesh* nav, const dtQueryFilter* filter,
+						   dtNodePool* nodePool, dtNodeQueue* openList,
+						   dtPolyRef startRef, const float* startPos, const unsigned char state);
+
+#endif // DETOURTILEPORTALGRAPH_H
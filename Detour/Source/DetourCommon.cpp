@@ -370,6 +370,84 @@ void dtRandomPointInConvexPoly(const float* pts, const int npts, float* areas,
 
 inline float vperpXZ(const float* a, const float* b) { return a[0]*b[2] - a[2]*b[0]; }
 
+unsigned int dtIntersectSegmentsPoly2D4(const float* p0x, const float* p0z,
+										const float* p1x, const float* p1z,
+										const float* verts, int nverts,
+										float* tmin, float* tmax,
+										int* segMin, int* segMax)
+{
+#ifdef DT_SSE2
+	// The same steps as dtIntersectSegmentPoly2D, one segment per lane. A lane that
+	// would return false is marked as out and keeps its values for the remaining edges.
+	static const float EPS = 0.00000001f;
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 eps = _mm_set1_ps(EPS);
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	const __m128 x0 = _mm_loadu_ps(p0x);
+	const __m128 z0 = _mm_loadu_ps(p0z);
+	const __m128 dirx = _mm_sub_ps(_mm_loadu_ps(p1x), x0);
+	const __m128 dirz = _mm_sub_ps(_mm_loadu_ps(p1z), z0);
+
+	__m128 vtmin = zero;
+	__m128 vtmax = _mm_set1_ps(1.0f);
+	__m128i vsegMin = _mm_set1_epi32(-1);
+	__m128i vsegMax = _mm_set1_epi32(-1);
+	__m128 out = zero;
+
+	for (int i = 0, j = nverts-1; i < nverts; j=i++)
+	{
+		const float* vi = &verts[i*3];
+		const float* vj = &verts[j*3];
+		const __m128 edgex = _mm_set1_ps(vi[0] - vj[0]);
+		const __m128 edgez = _mm_set1_ps(vi[2] - vj[2]);
+		const __m128 diffx = _mm_sub_ps(x0, _mm_set1_ps(vj[0]));
+		const __m128 diffz = _mm_sub_ps(z0, _mm_set1_ps(vj[2]));
+		const __m128 n = _mm_sub_ps(_mm_mul_ps(edgez, diffx), _mm_mul_ps(edgex, diffz));
+		const __m128 d = _mm_sub_ps(_mm_mul_ps(dirz, edgex), _mm_mul_ps(dirx, edgez));
+		const __m128i seg = _mm_set1_epi32(j);
+
+		// S is nearly parallel to this edge
+		const __m128 parallel = _mm_cmplt_ps(_mm_and_ps(d, absMask), eps);
+		out = _mm_or_ps(out, _mm_and_ps(parallel, _mm_cmplt_ps(n, zero)));
+		const __m128 live = _mm_andnot_ps(_mm_or_ps(out, parallel), _mm_castsi128_ps(_mm_set1_epi32(-1)));
+
+		const __m128 t = _mm_div_ps(n, d);
+		const __m128 entering = _mm_cmplt_ps(d, zero);
+
+		// segment S is entering across this edge
+		const __m128 enter = _mm_and_ps(_mm_and_ps(live, entering), _mm_cmpgt_ps(t, vtmin));
+		vtmin = _mm_or_ps(_mm_and_ps(enter, t), _mm_andnot_ps(enter, vtmin));
+		vsegMin = _mm_or_si128(_mm_and_si128(_mm_castps_si128(enter), seg), _mm_andnot_si128(_mm_castps_si128(enter), vsegMin));
+		// S enters after leaving polygon
+		out = _mm_or_ps(out, _mm_and_ps(enter, _mm_cmpgt_ps(vtmin, vtmax)));
+
+		// segment S is leaving across this edge
+		const __m128 leave = _mm_and_ps(_mm_andnot_ps(entering, live), _mm_cmplt_ps(t, vtmax));
+		vtmax = _mm_or_ps(_mm_and_ps(leave, t), _mm_andnot_ps(leave, vtmax));
+		vsegMax = _mm_or_si128(_mm_and_si128(_mm_castps_si128(leave), seg), _mm_andnot_si128(_mm_castps_si128(leave), vsegMax));
+		// S leaves before entering polygon
+		out = _mm_or_ps(out, _mm_and_ps(leave, _mm_cmplt_ps(vtmax, vtmin)));
+	}
+
+	_mm_storeu_ps(tmin, vtmin);
+	_mm_storeu_ps(tmax, vtmax);
+	_mm_storeu_si128((__m128i*)segMin, vsegMin);
+	_mm_storeu_si128((__m128i*)segMax, vsegMax);
+	return ~(unsigned int)_mm_movemask_ps(out) & 0xf;
+#else
+	unsigned int mask = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		const float p0[3] = { p0x[i], 0, p0z[i] };
+		const float p1[3] = { p1x[i], 0, p1z[i] };
+		if (dtIntersectSegmentPoly2D(p0, p1, verts, nverts, tmin[i], tmax[i], segMin[i], segMax[i]))
+			mask |= 1u << i;
+	}
+	return mask;
+#endif
+}
+
 bool dtIntersectSegSeg2D(const float* ap, const float* aq,
 						 const float* bp, const float* bq,
 						 float& s, float& t)
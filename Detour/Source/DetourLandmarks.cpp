@@ -0,0 +1,527 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include <float.h>
+#include <string.h>
+#include "DetourLandmarks.h"
+#include "DetourCommon.h"
+#include "DetourMath.h"
+#include "DetourAlloc.h"
+#include "DetourAssert.h"
+
+// The table models the graph the path searches run on: a search node is a polygon entered at the
+// middle of a portal, and the cost to the next node is the distance to the middle of the next portal.
+// The graph nodes ("slots") are the links of the polygons, slot = link offset of the tile + link index,
+// located at the middle of the portal of the link. A slot is connected to the other links of its
+// polygon and to the links of the polygon it leads to, so it can be walked in both directions
+// and the distances from a landmark are symmetric.
+//
+// Off-mesh connections are portals of a single point, the connection end point in the ground polygon.
+
+namespace
+{
+	struct LandmarkGraph
+	{
+		const dtNavMesh* nav;
+		const int* linkOffsets;
+		const dtPolyRef* slotPolys;
+		const float* slotPos;
+		float* dist;
+		int* heap;
+		int* heapPos;
+		int heapSize;
+	};
+}
+
+// The middle of the portal of the link, the position of the search nodes entering link.ref from ref.
+static void getLinkPortalMid(const dtNavMesh* nav, const dtMeshTile* tile, const dtPoly* poly,
+							 dtPolyRef ref, const dtLink& link, float* mid)
+{
+	if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+	{
+		dtVcopy(mid, &tile->verts[poly->verts[link.edge]*3]);
+		return;
+	}
+
+	const dtMeshTile* toTile = 0;
+	const dtPoly* toPoly = 0;
+	nav->getTileAndPolyByRefUnsafe(link.ref, &toTile, &toPoly);
+	if (toPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+	{
+		for (unsigned int i = toPoly->firstLink; i != DT_NULL_LINK; i = toTile->links[i].next)
+		{
+			if (toTile->links[i].ref == ref)
+			{
+				dtVcopy(mid, &toTile->verts[toPoly->verts[toTile->links[i].edge]*3]);
+				return;
+			}
+		}
+		dtVcopy(mid, &tile->verts[poly->verts[0]*3]);
+		return;
+	}
+
+	const float* v0 = &tile->verts[poly->verts[link.edge]*3];
+	const float* v1 = &tile->verts[poly->verts[(link.edge+1) % (int)poly->vertCount]*3];
+	float tmin = 0.0f, tmax = 1.0f;
+	if (link.side != 0xff && (link.bmin != 0 || link.bmax != 255))
+	{
+		const float s = 1.0f/255.0f;
+		tmin = link.bmin*s;
+		tmax = link.bmax*s;
+	}
+	dtVlerp(mid, v0, v1, (tmin + tmax)*0.5f);
+}
+
+static int linkSlot(const LandmarkGraph& g, dtPolyRef ref, unsigned int link)
+{
+	return g.linkOffsets[g.nav->decodePolyIdTile(ref)] + (int)link;
+}
+
+static void heapUp(LandmarkGraph& g, int i)
+{
+	const int slot = g.heap[i];
+	while (i > 0)
+	{
+		const int parent = (i-1)/2;
+		if (g.dist[g.heap[parent]] <= g.dist[slot])
+			break;
+		g.heap[i] = g.heap[parent];
+		g.heapPos[g.heap[i]] = i;
+		i = parent;
+	}
+	g.heap[i] = slot;
+	g.heapPos[slot] = i;
+}
+
+static int heapPop(LandmarkGraph& g)
+{
+	const int result = g.heap[0];
+	g.heapPos[result] = -1;
+	g.heapSize--;
+	if (g.heapSize == 0)
+		return result;
+
+	const int slot = g.heap[g.heapSize];
+	int i = 0;
+	for (;;)
+	{
+		int child = i*2+1;
+		if (child >= g.heapSize)
+			break;
+		if (child+1 < g.heapSize && g.dist[g.heap[child+1]] < g.dist[g.heap[child]])
+			child++;
+		if (g.dist[slot] <= g.dist[g.heap[child]])
+			break;
+		g.heap[i] = g.heap[child];
+		g.heapPos[g.heap[i]] = i;
+		i = child;
+	}
+	g.heap[i] = slot;
+	g.heapPos[slot] = i;
+	return result;
+}
+
+static void relax(LandmarkGraph& g, int slot, float d)
+{
+	if (d >= g.dist[slot])
+		return;
+	g.dist[slot] = d;
+	if (g.heapPos[slot] < 0)
+	{
+		g.heap[g.heapSize] = slot;
+		g.heapPos[slot] = g.heapSize++;
+	}
+	heapUp(g, g.heapPos[slot]);
+}
+
+// The representative of the connected part of the slot.
+static int findPart(int* parts, int slot)
+{
+	while (parts[slot] != slot)
+	{
+		parts[slot] = parts[parts[slot]];
+		slot = parts[slot];
+	}
+	return slot;
+}
+
+// Relaxes the links of the polygon from a slot at distance d.
+static void relaxPolyLinks(LandmarkGraph& g, dtPolyRef ref, const float* pos, const float d)
+{
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	g.nav->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
+	for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+	{
+		const int slot = linkSlot(g, ref, i);
+		relax(g, slot, d + dtVdist(pos, &g.slotPos[slot*3]));
+	}
+}
+
+// Shortest slot distances from the links of the source polygon.
+static void computeDistances(LandmarkGraph& g, const int slotCount, dtPolyRef source)
+{
+	for (int i = 0; i < slotCount; ++i)
+	{
+		g.dist[i] = FLT_MAX;
+		g.heapPos[i] = -1;
+	}
+	g.heapSize = 0;
+
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	g.nav->getTileAndPolyByRefUnsafe(source, &tile, &poly);
+	for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+		relax(g, linkSlot(g, source, i), 0.0f);
+
+	while (g.heapSize > 0)
+	{
+		const int slot = heapPop(g);
+		const float d = g.dist[slot];
+		const dtPolyRef ref = g.slotPolys[slot];
+		g.nav->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
+		const dtLink& link = tile->links[slot - g.linkOffsets[g.nav->decodePolyIdTile(ref)]];
+
+		// Along the polygon, or into the polygon the link leads to.
+		relaxPolyLinks(g, ref, &g.slotPos[slot*3], d);
+		relaxPolyLinks(g, link.ref, &g.slotPos[slot*3], d);
+	}
+}
+
+// Lower and upper bounds of the landmark distances of a point: the search leaves the polygon
+// through one of its links, and the slot distances differ by at most the distance to the point.
+static void getPointDistanceRange(const dtNavMesh* nav, const int* linkOffsets, const float* distances,
+								  const float* positions, const int landmarkCount,
+								  dtPolyRef ref, const float* pos, float* lo, float* hi)
+{
+	for (int i = 0; i < landmarkCount; ++i)
+	{
+		lo[i] = FLT_MAX;
+		hi[i] = -FLT_MAX;
+	}
+
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	nav->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
+	const int offset = linkOffsets[nav->decodePolyIdTile(ref)];
+	for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+	{
+		const int slot = offset + (int)i;
+		const float d = dtVdist(pos, &positions[slot*3]);
+		const float* slotDistances = &distances[slot*landmarkCount];
+		for (int j = 0; j < landmarkCount; ++j)
+		{
+			// Unreachable from the landmark.
+			if (slotDistances[j] == FLT_MAX)
+				continue;
+			lo[j] = dtMin(lo[j], slotDistances[j] + d);
+			hi[j] = dtMax(hi[j], slotDistances[j] - d);
+		}
+	}
+}
+
+dtLandmarkTable::dtLandmarkTable() :
+	m_nav(0),
+	m_tileGeneration(0),
+	m_landmarkCount(0),
+	m_maxTiles(0),
+	m_linkOffsets(0),
+	m_distances(0),
+	m_positions(0)
+{
+	memset(m_landmarks, 0, sizeof(m_landmarks));
+}
+
+dtLandmarkTable::~dtLandmarkTable()
+{
+	clear();
+}
+
+void dtLandmarkTable::clear()
+{
+	dtFree(m_linkOffsets);
+	dtFree(m_distances);
+	dtFree(m_positions);
+	m_linkOffsets = 0;
+	m_distances = 0;
+	m_positions = 0;
+	m_maxTiles = 0;
+	m_landmarkCount = 0;
+	memset(m_landmarks, 0, sizeof(m_landmarks));
+}
+
+/// @par
+///
+/// The landmarks are picked by farthest point selection: each landmark is the polygon farthest
+/// from the landmarks picked so far, the first one is the polygon farthest from the first polygon
+/// of the largest connected part of the mesh.
+/// Landmarks behind the goal or the start give the tightest bounds, so spreading them to the
+/// extremities of the mesh works well. The landmarks are placed in the largest connected part of
+/// the mesh, the smaller islands keep the straight-line heuristic.
+///
+/// The build runs one Dijkstra search over all polygon links per landmark. Its cost is
+/// about landmarkCount times a full mesh search, so it is meant to run offline or after the tiles
+/// are loaded, not per query.
+///
+/// The table is not updated by dtNavMesh::addTile() or dtNavMesh::removeTile(), a new tile can
+/// create shorter routes. The queries check #isValid and use the straight-line distance alone
+/// until #refresh is called.
+dtStatus dtLandmarkTable::build(const dtNavMesh* nav, const int landmarkCount)
+{
+	clear();
+
+	if (!nav || landmarkCount <= 0 || landmarkCount > DT_MAX_LANDMARKS)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	m_nav = nav;
+	m_tileGeneration = nav->getTileGeneration();
+	m_maxTiles = nav->getMaxTiles();
+
+	m_linkOffsets = (int*)dtAlloc(sizeof(int)*m_maxTiles, DT_ALLOC_PERM);
+	if (!m_linkOffsets)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+
+	int slotCount = 0;
+	int polyCount = 0;
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const dtMeshTile* tile = nav->getTile(i);
+		if (!tile || !tile->header)
+		{
+			m_linkOffsets[i] = -1;
+			continue;
+		}
+		m_linkOffsets[i] = slotCount;
+		slotCount += tile->header->maxLinkCount;
+		polyCount += tile->header->polyCount;
+	}
+
+	dtPolyRef* slotPolys = (dtPolyRef*)dtAlloc(sizeof(dtPolyRef)*dtMax(slotCount, 1), DT_ALLOC_TEMP);
+	float* dist = (float*)dtAlloc(sizeof(float)*dtMax(slotCount, 1), DT_ALLOC_TEMP);
+	int* heap = (int*)dtAlloc(sizeof(int)*dtMax(slotCount, 1), DT_ALLOC_TEMP);
+	int* heapPos = (int*)dtAlloc(sizeof(int)*dtMax(slotCount, 1), DT_ALLOC_TEMP);
+	dtPolyRef* polyRefs = (dtPolyRef*)dtAlloc(sizeof(dtPolyRef)*dtMax(polyCount, 1), DT_ALLOC_TEMP);
+	float* nearest = (float*)dtAlloc(sizeof(float)*dtMax(polyCount, 1), DT_ALLOC_TEMP);
+	int* parts = (int*)dtAlloc(sizeof(int)*dtMax(slotCount, 1), DT_ALLOC_TEMP);
+	m_distances = (float*)dtAlloc(sizeof(float)*landmarkCount*dtMax(slotCount, 1), DT_ALLOC_PERM);
+	m_positions = (float*)dtAlloc(sizeof(float)*3*dtMax(slotCount, 1), DT_ALLOC_PERM);
+	if (!slotPolys || !dist || !heap || !heapPos || !polyRefs || !nearest || !parts || !m_distances || !m_positions)
+	{
+		dtFree(slotPolys);
+		dtFree(dist);
+		dtFree(heap);
+		dtFree(heapPos);
+		dtFree(polyRefs);
+		dtFree(nearest);
+		dtFree(parts);
+		clear();
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+
+	// The unused links of the tiles stay unreachable.
+	for (int i = 0; i < slotCount; ++i)
+		slotPolys[i] = 0;
+
+	// The polygons without links cannot be reached nor be landmarks.
+	int linkedCount = 0;
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		if (m_linkOffsets[i] < 0)
+			continue;
+		const dtMeshTile* tile = nav->getTile(i);
+		const dtPolyRef base = nav->getPolyRefBase(tile);
+		for (int j = 0; j < tile->header->polyCount; ++j)
+		{
+			const dtPoly* poly = &tile->polys[j];
+			const dtPolyRef ref = base | (dtPolyRef)j;
+			if (poly->firstLink == DT_NULL_LINK)
+				continue;
+			polyRefs[linkedCount] = ref;
+			nearest[linkedCount] = FLT_MAX;
+			linkedCount++;
+			for (unsigned int k = poly->firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
+			{
+				const int slot = m_linkOffsets[i] + (int)k;
+				slotPolys[slot] = ref;
+				getLinkPortalMid(nav, tile, poly, ref, tile->links[k], &m_positions[slot*3]);
+			}
+		}
+	}
+
+	for (int i = 0; i < landmarkCount*slotCount; ++i)
+		m_distances[i] = FLT_MAX;
+	m_landmarkCount = landmarkCount;
+
+	LandmarkGraph g;
+	g.nav = nav;
+	g.linkOffsets = m_linkOffsets;
+	g.slotPolys = slotPolys;
+	g.slotPos = m_positions;
+	g.dist = dist;
+	g.heap = heap;
+	g.heapPos = heapPos;
+	g.heapSize = 0;
+
+	// Connected parts of the mesh, the first link of each polygon stands for the polygon.
+	// The links of a part are merged into the part of the first polygon found.
+	for (int i = 0; i < slotCount; ++i)
+		parts[i] = i;
+	for (int i = 0; i < linkedCount; ++i)
+	{
+		const dtMeshTile* tile = 0;
+		const dtPoly* poly = 0;
+		nav->getTileAndPolyByRefUnsafe(polyRefs[i], &tile, &poly);
+		const int first = findPart(parts, linkSlot(g, polyRefs[i], poly->firstLink));
+		for (unsigned int k = poly->firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
+		{
+			const dtMeshTile* nextTile = 0;
+			const dtPoly* nextPoly = 0;
+			nav->getTileAndPolyByRefUnsafe(tile->links[k].ref, &nextTile, &nextPoly);
+			if (nextPoly->firstLink == DT_NULL_LINK)
+				continue;
+			parts[findPart(parts, linkSlot(g, tile->links[k].ref, nextPoly->firstLink))] = first;
+		}
+	}
+
+	// The first search starts in the largest part and only finds the first landmark.
+	for (int i = 0; i < slotCount; ++i)
+		dist[i] = 0.0f;
+	dtPolyRef source = 0;
+	float largest = 0.0f;
+	for (int i = 0; i < linkedCount; ++i)
+	{
+		const dtMeshTile* tile = 0;
+		const dtPoly* poly = 0;
+		nav->getTileAndPolyByRefUnsafe(polyRefs[i], &tile, &poly);
+		const int part = findPart(parts, linkSlot(g, polyRefs[i], poly->firstLink));
+		dist[part] += 1.0f;
+		if (dist[part] > largest)
+		{
+			largest = dist[part];
+			source = polyRefs[i];
+		}
+	}
+	for (int l = -1; l < landmarkCount && source; ++l)
+	{
+		computeDistances(g, slotCount, source);
+		if (l >= 0)
+		{
+			m_landmarks[l] = source;
+			for (int i = 0; i < slotCount; ++i)
+				m_distances[i*landmarkCount + l] = dist[i];
+		}
+
+		float farthest = 0.0f;
+		dtPolyRef next = 0;
+		for (int i = 0; i < linkedCount; ++i)
+		{
+			const dtMeshTile* tile = 0;
+			const dtPoly* poly = 0;
+			nav->getTileAndPolyByRefUnsafe(polyRefs[i], &tile, &poly);
+			const int offset = m_linkOffsets[nav->decodePolyIdTile(polyRefs[i])];
+			float dmin = FLT_MAX;
+			for (unsigned int k = poly->firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
+				dmin = dtMin(dmin, dist[offset + (int)k]);
+
+			// Outside the part of the landmarks.
+			if (dmin == FLT_MAX)
+				continue;
+			float score = dmin;
+			if (l >= 0)
+			{
+				nearest[i] = dtMin(nearest[i], dmin);
+				score = nearest[i];
+			}
+
+			if (score > farthest)
+			{
+				farthest = score;
+				next = polyRefs[i];
+			}
+		}
+		source = next;
+	}
+
+	dtFree(slotPolys);
+	dtFree(dist);
+	dtFree(heap);
+	dtFree(heapPos);
+	dtFree(polyRefs);
+	dtFree(nearest);
+	dtFree(parts);
+
+	return DT_SUCCESS;
+}
+
+dtStatus dtLandmarkTable::refresh()
+{
+	if (!m_nav || !m_landmarkCount)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	return build(m_nav, m_landmarkCount);
+}
+
+/// @par
+///
+/// The bound is measured in the graph the searches run on, a path leaves 'from' through one of its
+/// portals, goes from portal middle to portal middle, and enters 'to' through one of its portals.
+/// With [lo, hi] the range of the landmark distances of each point, the triangle inequality
+/// gives max(lo(to) - hi(from), lo(from) - hi(to)) <= d(from, to) for each landmark.
+float dtLandmarkTable::getLowerBound(dtPolyRef from, const float* fromPos, dtPolyRef to, const float* toPos) const
+{
+	dtLandmarkGoal goal;
+	initGoal(to, toPos, &goal);
+	return getLowerBound(from, fromPos, goal);
+}
+
+void dtLandmarkTable::initGoal(dtPolyRef ref, const float* pos, dtLandmarkGoal* goal) const
+{
+	goal->ref = 0;
+	goal->costScale = 1.0f;
+	if (!m_distances)
+		return;
+
+	dtAssert((int)m_nav->decodePolyIdTile(ref) < m_maxTiles);
+	if (m_linkOffsets[m_nav->decodePolyIdTile(ref)] < 0)
+		return;
+
+	goal->ref = ref;
+	getPointDistanceRange(m_nav, m_linkOffsets, m_distances, m_positions, m_landmarkCount, ref, pos, goal->lo, goal->hi);
+}
+
+float dtLandmarkTable::getLowerBound(dtPolyRef from, const float* fromPos, const dtLandmarkGoal& goal) const
+{
+	if (!goal.ref || from == goal.ref || !m_distances)
+		return 0.0f;
+
+	dtAssert((int)m_nav->decodePolyIdTile(from) < m_maxTiles);
+	if (m_linkOffsets[m_nav->decodePolyIdTile(from)] < 0)
+		return 0.0f;
+
+	float lo[DT_MAX_LANDMARKS], hi[DT_MAX_LANDMARKS];
+	getPointDistanceRange(m_nav, m_linkOffsets, m_distances, m_positions, m_landmarkCount, from, fromPos, lo, hi);
+
+	float bound = 0.0f;
+	for (int i = 0; i < m_landmarkCount; ++i)
+	{
+		// Unreachable from the landmark, nothing is known.
+		if (lo[i] == FLT_MAX || goal.lo[i] == FLT_MAX)
+			continue;
+		bound = dtMax(bound, dtMax(goal.lo[i] - hi[i], lo[i] - goal.hi[i]));
+	}
+	return bound * goal.costScale;
+}
@@ -193,7 +193,8 @@ dtNavMesh::dtNavMesh() :
 	m_tileLutMask(0),
 	m_posLookup(0),
 	m_nextFree(0),
-	m_tiles(0)
+	m_tiles(0),
+	m_tileGeneration(0)
 {
 #ifndef DT_POLYREF64
 	m_saltBits = 0;
@@ -833,9 +834,36 @@ int dtNavMesh::queryPolygonsInTile(const dtMeshTile* tile, const float* qmin, co
 		bmax[1] = (unsigned short)(qfac * maxy + 1) | 1;
 		bmax[2] = (unsigned short)(qfac * maxz + 1) | 1;
 		
-		// Traverse tree
 		dtPolyRef base = getPolyRefBase(tile);
 		int n = 0;
+
+		if (tile->wideBvTree)
+		{
+			// Traverse the wide tree. The children are pushed backwards to return the polygons in the order of the binary tree.
+			int stack[DT_WIDE_BV_STACK_SIZE];
+			int nstack = 0;
+			stack[nstack++] = 0;
+			while (nstack > 0)
+			{
+				const int i = stack[--nstack];
+				if (i < 0)
+				{
+					if (n < maxPolys)
+						polys[n++] = base | (dtPolyRef)~i;
+					continue;
+				}
+				const dtWideBVNode* wideNode = &tile->wideBvTree[i];
+				const unsigned int mask = dtOverlapQuantBounds8(bmin, bmax, wideNode->bmin[0], wideNode->bmax[0]);
+				for (int j = DT_WIDE_BV_WIDTH-1; j >= 0; --j)
+				{
+					if ((mask & (1u << j)) && wideNode->child[j])
+						stack[nstack++] = wideNode->child[j];
+				}
+			}
+			return n;
+		}
+		
+		// Traverse tree
 		while (node < end)
 		{
 			const bool overlap = dtOverlapQuantBounds(bmin, bmax, node->bmin, node->bmax);
@@ -984,6 +1012,11 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 	const int detailTrisSize = dtAlign4(sizeof(unsigned char)*4*header->detailTriCount);
 	const int bvtreeSize = dtAlign4(sizeof(dtBVNode)*header->bvNodeCount);
 	const int offMeshLinksSize = dtAlign4(sizeof(dtOffMeshConnection)*header->offMeshConCount);
+	const int faceClearancesSize = dtAlign4(sizeof(dtFaceClearance)*header->faceClearanceCount);
+	const int faceBvTreeSize = dtAlign4(sizeof(dtBVNode)*header->faceBvNodeCount);
+	const int faceAbstractionsSize = dtAlign4(sizeof(dtFaceAbstraction)*header->faceAbstractionCount);
+	const int polyTriangulationsSize = dtAlign4(sizeof(dtPolyTriangulation)*header->polyTriangulationCount);
+	const int wideBvTreeSize = dtAlign4(sizeof(dtWideBVNode)*header->wideBvNodeCount);
 	
 	unsigned char* d = data + headerSize;
 	tile->verts = dtGetThenAdvanceBufferPointer<float>(d, vertsSize);
@@ -994,11 +1027,36 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 	tile->detailTris = dtGetThenAdvanceBufferPointer<unsigned char>(d, detailTrisSize);
 	tile->bvTree = dtGetThenAdvanceBufferPointer<dtBVNode>(d, bvtreeSize);
 	tile->offMeshCons = dtGetThenAdvanceBufferPointer<dtOffMeshConnection>(d, offMeshLinksSize);
+	tile->faceClearances = dtGetThenAdvanceBufferPointer<dtFaceClearance>(d, faceClearancesSize);
+	tile->faceBvTree = dtGetThenAdvanceBufferPointer<dtBVNode>(d, faceBvTreeSize);
+	tile->faceAbstractions = dtGetThenAdvanceBufferPointer<dtFaceAbstraction>(d, faceAbstractionsSize);
+	tile->polyTriangulations = dtGetThenAdvanceBufferPointer<dtPolyTriangulation>(d, polyTriangulationsSize);
+	tile->wideBvTree = dtGetThenAdvanceBufferPointer<dtWideBVNode>(d, wideBvTreeSize);
 
 	// If there are no items in the bvtree, reset the tree pointer.
 	if (!bvtreeSize)
 		tile->bvTree = 0;
 
+	// If there are no face clearances, reset the clearance pointer.
+	if (!faceClearancesSize)
+		tile->faceClearances = 0;
+
+	// If there is no face tree, reset the face tree pointer.
+	if (!faceBvTreeSize)
+		tile->faceBvTree = 0;
+
+	// If there is no face abstraction, reset the abstraction pointer.
+	if (!faceAbstractionsSize)
+		tile->faceAbstractions = 0;
+
+	// If the polygons use the fan, reset the triangulation pointer.
+	if (!polyTriangulationsSize)
+		tile->polyTriangulations = 0;
+
+	// If there is no wide tree, reset the wide tree pointer.
+	if (!wideBvTreeSize)
+		tile->wideBvTree = 0;
+
 	// Build links freelist
 	tile->linksFreeList = 0;
 	tile->links[header->maxLinkCount-1].next = DT_NULL_LINK;
@@ -1050,6 +1108,8 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 	
 	if (result)
 		*result = getTileRef(tile);
+
+	m_tileGeneration++;
 	
 	return DT_SUCCESS;
 }
@@ -1315,6 +1375,11 @@ dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSiz
 	tile->detailTris = 0;
 	tile->bvTree = 0;
 	tile->offMeshCons = 0;
+	tile->faceClearances = 0;
+	tile->faceBvTree = 0;
+	tile->faceAbstractions = 0;
+	tile->polyTriangulations = 0;
+	tile->wideBvTree = 0;
 
 	// Update salt, salt should never be zero.
 #ifdef DT_POLYREF64
@@ -1329,6 +1394,8 @@ dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSiz
 	tile->next = m_nextFree;
 	m_nextFree = tile;
 
+	m_tileGeneration++;
+
 	return DT_SUCCESS;
 }
 
@@ -240,6 +240,740 @@ static int createBVTree(dtNavMeshCreateParams* params, dtBVNode* nodes, int /*nn
 	return curNode;
 }
 
+inline int bvNodeSize(const dtBVNode& node)
+{
+	return node.i >= 0 ? 1 : -node.i;
+}
+
+inline int bvNodeExtent(const dtBVNode& node)
+{
+	return (node.bmax[0] - node.bmin[0]) + (node.bmax[1] - node.bmin[1]) + (node.bmax[2] - node.bmin[2]);
+}
+
+// Collapses the binary subtree at ibin into one wide node and its descendants.
+static int collapseBVTree(const dtBVNode* nodes, const int ibin, dtWideBVNode* wideNodes, int& curNode)
+{
+	const int icur = curNode++;
+	dtWideBVNode& node = wideNodes[icur];
+
+	// Open the largest inner node until the wide node is full. The children stay in
+	// the order of the binary tree, so that the queries return the polygons in the same order.
+	int children[DT_WIDE_BV_WIDTH];
+	int nchildren = 0;
+	children[nchildren++] = ibin;
+	while (nchildren < DT_WIDE_BV_WIDTH)
+	{
+		int best = -1;
+		for (int j = 0; j < nchildren; ++j)
+		{
+			if (nodes[children[j]].i >= 0)
+				continue;
+			if (best == -1 || bvNodeExtent(nodes[children[j]]) > bvNodeExtent(nodes[children[best]]))
+				best = j;
+		}
+		if (best == -1)
+			break;
+		const int left = children[best] + 1;
+		const int right = left + bvNodeSize(nodes[left]);
+		for (int j = nchildren; j > best+1; --j)
+			children[j] = children[j-1];
+		children[best] = left;
+		children[best+1] = right;
+		nchildren++;
+	}
+
+	for (int j = 0; j < DT_WIDE_BV_WIDTH; ++j)
+	{
+		if (j >= nchildren)
+		{
+			// Unused, the empty box never overlaps.
+			for (int k = 0; k < 3; ++k)
+			{
+				node.bmin[k][j] = 0xffff;
+				node.bmax[k][j] = 0;
+			}
+			node.child[j] = 0;
+			continue;
+		}
+		const dtBVNode& child = nodes[children[j]];
+		for (int k = 0; k < 3; ++k)
+		{
+			node.bmin[k][j] = child.bmin[k];
+			node.bmax[k][j] = child.bmax[k];
+		}
+		if (child.i >= 0)
+			node.child[j] = ~child.i;
+		else
+			node.child[j] = collapseBVTree(nodes, children[j], wideNodes, curNode);
+	}
+
+	return icur;
+}
+
+static int createWideBVTree(const dtBVNode* nodes, dtWideBVNode* wideNodes)
+{
+	int curNode = 0;
+	collapseBVTree(nodes, 0, wideNodes, curNode);
+	return curNode;
+}
+
+// Half-edge of a polygon triangle, used when building the face clearances.
+// The triangles of a polygon are given by its dtPolyTriangulation, the fan (v0, v[i+1], v[i+2])
+// by default. The local edge k goes from the local vertex k to k+1.
+// This matches the primitives in DetourNavMeshQuery_Nonpoint.h.
+struct FanEdge
+{
+	int poly;
+	int face;
+	int edge;
+};
+
+enum FanEdgeType
+{
+	FAN_EDGE_WALL,		// Edge is on the mesh border.
+	FAN_EDGE_INNER,		// Edge is shared with an other triangle in the tile.
+	FAN_EDGE_PORTAL,	// Edge is on the tile border, the neighbour is unknown at build time.
+};
+
+static int countPolyVerts(const unsigned short* p, const int nvp)
+{
+	int nv = 0;
+	while (nv < nvp && p[nv] != MESH_NULL_IDX)
+		nv++;
+	return nv;
+}
+
+// Builds the edge tables of a polygon triangulation from its triangles.
+// The triangles hold polygon vertex indices, they are sorted so that the fan
+// triangulation gets the face and inner edge indices of the fan formulas.
+static void setPolyTriangles(const int nv, unsigned char (*tris)[3], const int ntris, dtPolyTriangulation* out)
+{
+	memset(out, 0, sizeof(dtPolyTriangulation));
+
+	// Keep the vertices of each triangle in polygon order, which keeps the winding of the polygon.
+	for (int i = 0; i < ntris; ++i)
+	{
+		unsigned char* t = tris[i];
+		for (int a = 0; a < 2; ++a)
+			for (int b = a+1; b < 3; ++b)
+				if (t[b] < t[a]) dtSwap(t[a], t[b]);
+	}
+	for (int i = 1; i < ntris; ++i)
+	{
+		for (int j = i; j > 0 && memcmp(tris[j], tris[j-1], 3) < 0; --j)
+		{
+			unsigned char tmp[3];
+			memcpy(tmp, tris[j], 3);
+			memcpy(tris[j], tris[j-1], 3);
+			memcpy(tris[j-1], tmp, 3);
+		}
+	}
+
+	// The diagonals sorted by their vertices, the fan gets (0,2), (0,3), (0,4).
+	int ndiags = 0;
+	unsigned char diags[DT_VERTS_PER_POLYGON-3][2];
+	for (int i = 0; i < ntris; ++i)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			const unsigned char va = tris[i][k];
+			const unsigned char vb = tris[i][(k+1) % 3];
+			if ((va+1) % nv == vb || (vb+1) % nv == va)
+				continue;
+			const unsigned char lo = dtMin(va, vb), hi = dtMax(va, vb);
+			int d = 0;
+			while (d < ndiags && (diags[d][0] != lo || diags[d][1] != hi))
+				d++;
+			if (d < ndiags)
+				continue;
+			while (d > 0 && (diags[d-1][0] > lo || (diags[d-1][0] == lo && diags[d-1][1] > hi)))
+			{
+				diags[d][0] = diags[d-1][0];
+				diags[d][1] = diags[d-1][1];
+				d--;
+			}
+			diags[d][0] = lo;
+			diags[d][1] = hi;
+			ndiags++;
+		}
+	}
+
+	// The even inner edge goes from the higher vertex to the lower one, as in the fan.
+	for (int d = 0; d < ndiags; ++d)
+	{
+		out->diagVerts[d][0] = diags[d][1];
+		out->diagVerts[d][1] = diags[d][0];
+	}
+
+	for (int i = 0; i < ntris; ++i)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			const unsigned char va = tris[i][k];
+			const unsigned char vb = tris[i][(k+1) % 3];
+			int edge = 0;
+			if ((va+1) % nv == vb)
+			{
+				edge = va;
+			}
+			else
+			{
+				int d = 0;
+				while (d < ndiags && !(out->diagVerts[d][0] == va && out->diagVerts[d][1] == vb) &&
+					   !(out->diagVerts[d][0] == vb && out->diagVerts[d][1] == va))
+					d++;
+				edge = DT_VERTS_PER_POLYGON + d*2 + (out->diagVerts[d][0] == va ? 0 : 1);
+			}
+			out->faceEdges[i][k] = (unsigned char)edge;
+			out->edgeFaces[edge] = (unsigned char)((i << 2) | k);
+		}
+	}
+}
+
+static void triangulatePolyFan(const int nv, dtPolyTriangulation* out)
+{
+	unsigned char tris[DT_FACES_PER_POLYGON][3];
+	for (int j = 0; j < nv-2; ++j)
+	{
+		tris[j][0] = 0;
+		tris[j][1] = (unsigned char)(j+1);
+		tris[j][2] = (unsigned char)(j+2);
+	}
+	setPolyTriangles(nv, tris, dtMax(nv-2, 0), out);
+}
+
+// Twice the signed area of the triangle in the xz-plane.
+static int triArea2D(const unsigned short* a, const unsigned short* b, const unsigned short* c)
+{
+	return ((int)b[0] - (int)a[0])*((int)c[2] - (int)a[2]) - ((int)c[0] - (int)a[0])*((int)b[2] - (int)a[2]);
+}
+
+// True if 'd' is strictly inside the circumcircle of the triangle (a, b, c) in the xz-plane.
+static bool inCircumcircle(const unsigned short* a, const unsigned short* b, const unsigned short* c, const unsigned short* d)
+{
+	const double adx = (double)a[0] - d[0], adz = (double)a[2] - d[2];
+	const double bdx = (double)b[0] - d[0], bdz = (double)b[2] - d[2];
+	const double cdx = (double)c[0] - d[0], cdz = (double)c[2] - d[2];
+	const double det = (adx*adx + adz*adz) * (bdx*cdz - cdx*bdz)
+					 - (bdx*bdx + bdz*bdz) * (adx*cdz - cdx*adz)
+					 + (cdx*cdx + cdz*cdz) * (adx*bdz - bdx*adz);
+	return triArea2D(a, b, c) > 0 ? det > 0 : det < 0;
+}
+
+// Delaunay triangulation of a convex polygon, the fan is flipped until no diagonal is illegal.
+static void triangulatePolyDelaunay(const dtNavMeshCreateParams* params, const int poly, const int nv,
+									dtPolyTriangulation* out)
+{
+	const unsigned short* p = &params->polys[poly*2*params->nvp];
+	unsigned char tris[DT_FACES_PER_POLYGON][3];
+	const int ntris = dtMax(nv-2, 0);
+	for (int j = 0; j < ntris; ++j)
+	{
+		tris[j][0] = 0;
+		tris[j][1] = (unsigned char)(j+1);
+		tris[j][2] = (unsigned char)(j+2);
+	}
+
+	// A polygon has at most 3 diagonals, the flips end quickly. Bound them anyway.
+	static const int MAX_FLIPS = 16;
+	for (int iter = 0; iter < MAX_FLIPS; ++iter)
+	{
+		bool flipped = false;
+		for (int i = 0; i < ntris && !flipped; ++i)
+		{
+			for (int j = i+1; j < ntris && !flipped; ++j)
+			{
+				// Find the shared diagonal (sa, sb) and the opposite vertices 'oi' and 'oj'.
+				int shared = 0;
+				unsigned char s[2] = { 0, 0 };
+				unsigned char oi = 0, oj = 0;
+				for (int a = 0; a < 3; ++a)
+				{
+					bool found = false;
+					for (int b = 0; b < 3; ++b)
+						found |= tris[i][a] == tris[j][b];
+					if (found && shared < 2)
+						s[shared++] = tris[i][a];
+					else
+						oi = tris[i][a];
+				}
+				if (shared != 2)
+					continue;
+				for (int b = 0; b < 3; ++b)
+				{
+					if (tris[j][b] != s[0] && tris[j][b] != s[1])
+						oj = tris[j][b];
+				}
+
+				const unsigned short* va = &params->verts[p[s[0]]*3];
+				const unsigned short* vb = &params->verts[p[s[1]]*3];
+				const unsigned short* vi = &params->verts[p[oi]*3];
+				const unsigned short* vj = &params->verts[p[oj]*3];
+				if (!inCircumcircle(vi, va, vb, vj))
+					continue;
+				// Do not create degenerate triangles from collinear vertices.
+				if (triArea2D(vi, vj, va) == 0 || triArea2D(vi, vj, vb) == 0)
+					continue;
+
+				tris[i][0] = oi; tris[i][1] = oj; tris[i][2] = s[0];
+				tris[j][0] = oi; tris[j][1] = oj; tris[j][2] = s[1];
+				flipped = true;
+			}
+		}
+		if (!flipped)
+			break;
+	}
+
+	setPolyTriangles(nv, tris, ntris, out);
+}
+
+// Vertex index of the start of an edge of the triangulation, inside the polygon.
+static int triEdgeOrigin(const dtPolyTriangulation* tri, const int edge)
+{
+	if (edge < DT_VERTS_PER_POLYGON)
+		return edge;
+	const int d = (edge - DT_VERTS_PER_POLYGON) / 2;
+	return (edge & 1) == 0 ? tri->diagVerts[d][0] : tri->diagVerts[d][1];
+}
+
+static void getFanVertex(const dtNavMeshCreateParams* params, const dtPolyTriangulation* tris,
+						 const int poly, const int face, const int vert, float* pos)
+{
+	const unsigned short* p = &params->polys[poly*2*params->nvp];
+	const unsigned short* iv = &params->verts[p[triEdgeOrigin(&tris[poly], tris[poly].faceEdges[face][vert])]*3];
+	pos[0] = params->bmin[0] + iv[0]*params->cs;
+	pos[1] = params->bmin[1] + iv[1]*params->ch;
+	pos[2] = params->bmin[2] + iv[2]*params->cs;
+}
+
+static int createFaceBVTree(dtNavMeshCreateParams* params, const dtPolyTriangulation* tris,
+							dtBVNode* nodes, const int faceCount)
+{
+	// Build tree
+	const float quantFactor = 1 / params->cs;
+	BVItem* items = (BVItem*)dtAlloc(sizeof(BVItem)*faceCount, DT_ALLOC_TEMP);
+	if (!items)
+		return 0;
+
+	int n = 0;
+	for (int i = 0; i < params->polyCount; ++i)
+	{
+		const unsigned short* p = &params->polys[i*params->nvp*2];
+		const int nv = countPolyVerts(p, params->nvp);
+
+		// The fan triangles only follow the polygon in xz, use the height range
+		// of the detail mesh if available so that the faces cover the surface.
+		unsigned short ymin = 0xffff, ymax = 0;
+		if (params->detailMeshes)
+		{
+			const int vb = (int)params->detailMeshes[i*4+0];
+			const int ndv = (int)params->detailMeshes[i*4+1];
+			float dmin = params->detailVerts[vb*3+1];
+			float dmax = dmin;
+			for (int j = 1; j < ndv; ++j)
+			{
+				dmin = dtMin(dmin, params->detailVerts[(vb+j)*3+1]);
+				dmax = dtMax(dmax, params->detailVerts[(vb+j)*3+1]);
+			}
+			ymin = (unsigned short)dtClamp((int)((dmin - params->bmin[1])*quantFactor), 0, 0xffff);
+			ymax = (unsigned short)dtClamp((int)((dmax - params->bmin[1])*quantFactor), 0, 0xffff);
+		}
+		else
+		{
+			for (int j = 0; j < nv; ++j)
+			{
+				const unsigned short y = params->verts[p[j]*3+1];
+				if (y < ymin) ymin = y;
+				if (y > ymax) ymax = y;
+			}
+			// Remap y
+			ymin = (unsigned short)dtMathFloorf((float)ymin * params->ch / params->cs);
+			ymax = (unsigned short)dtMathCeilf((float)ymax * params->ch / params->cs);
+		}
+
+		for (int j = 0; j < nv-2; ++j)
+		{
+			BVItem& it = items[n++];
+			it.i = i*DT_FACES_PER_POLYGON + j;
+
+			const unsigned char* fe = tris[i].faceEdges[j];
+			const unsigned short* v0 = &params->verts[p[triEdgeOrigin(&tris[i], fe[0])]*3];
+			const unsigned short* v1 = &params->verts[p[triEdgeOrigin(&tris[i], fe[1])]*3];
+			const unsigned short* v2 = &params->verts[p[triEdgeOrigin(&tris[i], fe[2])]*3];
+			it.bmin[0] = dtMin(v0[0], dtMin(v1[0], v2[0]));
+			it.bmin[2] = dtMin(v0[2], dtMin(v1[2], v2[2]));
+			it.bmax[0] = dtMax(v0[0], dtMax(v1[0], v2[0]));
+			it.bmax[2] = dtMax(v0[2], dtMax(v1[2], v2[2]));
+			it.bmin[1] = ymin;
+			it.bmax[1] = ymax;
+		}
+	}
+	dtAssert(n == faceCount);
+
+	int curNode = 0;
+	subdivide(items, n, 0, n, curNode, nodes);
+
+	dtFree(items);
+
+	return curNode;
+}
+
+static int crossFanEdge(const dtNavMeshCreateParams* params, const dtPolyTriangulation* tris,
+						const FanEdge& e, FanEdge& opposite)
+{
+	const int nvp = params->nvp;
+	const unsigned short* p = &params->polys[e.poly*2*nvp];
+	const int nv = countPolyVerts(p, nvp);
+
+	// Find the polygon edge, or cross the diagonal to the neighbour triangle in the polygon.
+	const dtPolyTriangulation* tri = &tris[e.poly];
+	const int pe = tri->faceEdges[e.face][e.edge];
+	if (pe >= DT_VERTS_PER_POLYGON)
+	{
+		const unsigned char twin = tri->edgeFaces[pe ^ 1];
+		opposite.poly = e.poly;
+		opposite.face = twin >> 2;
+		opposite.edge = twin & 3;
+		return FAN_EDGE_INNER;
+	}
+
+	const unsigned short nei = p[nvp+pe];
+	if (nei & 0x8000)
+		return (nei & 0xf) == 0xf ? FAN_EDGE_WALL : FAN_EDGE_PORTAL;
+
+	// Find the matching edge in the neighbour polygon.
+	const unsigned short va = p[pe];
+	const unsigned short vb = p[(pe+1) % nv];
+	const unsigned short* q = &params->polys[nei*2*nvp];
+	const int nq = countPolyVerts(q, nvp);
+	for (int k = 0; k < nq; ++k)
+	{
+		if (q[k] != vb || q[(k+1) % nq] != va)
+			continue;
+		opposite.poly = nei;
+		opposite.face = tris[nei].edgeFaces[k] >> 2;
+		opposite.edge = tris[nei].edgeFaces[k] & 3;
+		return FAN_EDGE_INNER;
+	}
+
+	return FAN_EDGE_WALL;
+}
+
+static float distancePtSegSqr(const float* pt, const float* p, const float* q)
+{
+	float pq[3], d[3];
+	dtVsub(pq, q, p);
+	dtVsub(d, pt, p);
+	const float len = dtVlenSqr(pq);
+	float t = dtVdot(pq, d);
+	if (len > 0) t /= len;
+	if (t < 0) t = 0;
+	else if (t > 1) t = 1;
+	dtVmad(d, p, pq, t);
+	return dtVdistSqr(pt, d);
+}
+
+// Finds the nearest constrained edge to the pivot 'c' by walking across 'start' through the
+// triangles which are closer than the current width. Returns the squared width.
+static float searchFanWidth(const dtNavMeshCreateParams* params, const dtPolyTriangulation* tris,
+							const float* c, const FanEdge& start, float widthSqr, bool& partial)
+{
+	static const int MAX_STACK = 64;
+	FanEdge stack[MAX_STACK];
+	FanEdge visited[MAX_STACK];
+	int nstack = 0;
+	int nvisited = 0;
+	float portalSqr = FLT_MAX;
+
+	stack[nstack++] = start;
+	visited[nvisited++] = start;
+
+	while (nstack > 0)
+	{
+		const FanEdge e = stack[--nstack];
+
+		float va[3], vb[3];
+		getFanVertex(params, tris, e.poly, e.face, e.edge, va);
+		getFanVertex(params, tris, e.poly, e.face, (e.edge+1) % 3, vb);
+		const float distSqr = distancePtSegSqr(c, va, vb);
+		if (distSqr >= widthSqr)
+			continue;
+
+		FanEdge next;
+		const int type = crossFanEdge(params, tris, e, next);
+		if (type == FAN_EDGE_WALL)
+		{
+			widthSqr = distSqr;
+			continue;
+		}
+		if (type == FAN_EDGE_PORTAL)
+		{
+			portalSqr = dtMin(portalSqr, distSqr);
+			continue;
+		}
+
+		bool seen = false;
+		for (int i = 0; i < nvisited && !seen; ++i)
+			seen = visited[i].poly == next.poly && visited[i].face == next.face;
+		if (seen)
+			continue;
+		if (nvisited >= MAX_STACK || nstack+2 > MAX_STACK)
+		{
+			// Too complex, let the runtime check verify the result.
+			portalSqr = dtMin(portalSqr, distSqr);
+			continue;
+		}
+		visited[nvisited++] = next;
+
+		FanEdge& e0 = stack[nstack++];
+		e0 = next;
+		e0.edge = (next.edge+1) % 3;
+		FanEdge& e1 = stack[nstack++];
+		e1 = next;
+		e1.edge = (next.edge+2) % 3;
+	}
+
+	// Anything past a tile border may narrow the corridor further.
+	if (portalSqr < widthSqr)
+		partial = true;
+
+	return widthSqr;
+}
+
+static void calcFaceClearance(const dtNavMeshCreateParams* params, const dtPolyTriangulation* tris,
+							  const int poly, const int face, dtFaceClearance* clearance)
+{
+	float tri[9];
+	for (int k = 0; k < 3; ++k)
+		getFanVertex(params, tris, poly, face, k, &tri[k*3]);
+
+	clearance->flags = 0;
+	for (int k = 0; k < 3; ++k)
+	{
+		// Corridor between the two edges sharing the pivot vertex 'c'.
+		const float* c = &tri[k*3];
+		const float* a = &tri[((k+1) % 3)*3];
+		const float* b = &tri[((k+2) % 3)*3];
+
+		float ab[3], ac[3], ba[3], bc[3];
+		dtVsub(ab, b, a);
+		dtVsub(ac, c, a);
+		dtVsub(ba, a, b);
+		dtVsub(bc, c, b);
+
+		// Right or obtuse angle at the far edge, the vertex limits the corridor.
+		if (dtVdot(ab, ac) <= 0)
+		{
+			clearance->width[k] = dtVlen(ac);
+			continue;
+		}
+		if (dtVdot(ba, bc) <= 0)
+		{
+			clearance->width[k] = dtVlen(bc);
+			continue;
+		}
+
+		FanEdge adj;
+		adj.poly = poly;
+		adj.face = face;
+		adj.edge = (k+1) % 3;
+		bool partial = false;
+		const float widthSqr = searchFanWidth(params, tris, c, adj, dtMin(dtVlenSqr(ac), dtVlenSqr(bc)), partial);
+
+		clearance->width[k] = dtMathSqrtf(widthSqr);
+		if (partial)
+			clearance->flags |= (unsigned char)(DT_FACE_CLEARANCE_PARTIAL << k);
+	}
+}
+
+static const int FAN_NEI_WALL = -1;
+static const int FAN_NEI_PORTAL = -2;
+
+// Classifies the polygon fan triangles of the tile into decision nodes, corridor chains and dead-end trees.
+// Dead ends are found by repeatedly pruning the faces with at most one remaining neighbour, the faces
+// touching the tile border are never pruned since their neighbours are unknown at build time.
+static bool createFaceAbstraction(const dtNavMeshCreateParams* params, const dtPolyTriangulation* tris,
+								  dtFaceAbstraction* abstractions)
+{
+	const int nvp = params->nvp;
+	const int maxFaces = params->polyCount*DT_FACES_PER_POLYGON;
+
+	int* neis = (int*)dtAlloc(sizeof(int)*maxFaces*3, DT_ALLOC_TEMP);
+	int* degree = (int*)dtAlloc(sizeof(int)*maxFaces, DT_ALLOC_TEMP);
+	int* stack = (int*)dtAlloc(sizeof(int)*maxFaces, DT_ALLOC_TEMP);
+	if (!neis || !degree || !stack)
+	{
+		dtFree(neis);
+		dtFree(degree);
+		dtFree(stack);
+		return false;
+	}
+
+	// Face adjacency inside the tile.
+	int nstack = 0;
+	for (int i = 0; i < params->polyCount; ++i)
+	{
+		const int nv = countPolyVerts(&params->polys[i*nvp*2], nvp);
+		for (int j = 0; j < DT_FACES_PER_POLYGON; ++j)
+		{
+			const int f = i*DT_FACES_PER_POLYGON + j;
+			dtFaceAbstraction& fa = abstractions[f];
+			fa.corridorWidth = 0;
+			fa.region = 0;
+			fa.type = DT_FACE_DECISION;
+			fa.pad = 0;
+			degree[f] = 0;
+			for (int k = 0; k < 3; ++k)
+				neis[f*3+k] = FAN_NEI_WALL;
+			if (j >= nv-2)
+				continue;
+
+			for (int k = 0; k < 3; ++k)
+			{
+				FanEdge e, opposite;
+				e.poly = i;
+				e.face = j;
+				e.edge = k;
+				const int type = crossFanEdge(params, tris, e, opposite);
+				if (type == FAN_EDGE_INNER)
+				{
+					neis[f*3+k] = opposite.poly*DT_FACES_PER_POLYGON + opposite.face;
+					degree[f]++;
+				}
+				else if (type == FAN_EDGE_PORTAL)
+				{
+					neis[f*3+k] = FAN_NEI_PORTAL;
+					// Keeps the face out of the dead ends.
+					degree[f] += 3;
+				}
+			}
+			if (degree[f] <= 1)
+			{
+				fa.type = DT_FACE_DEAD_END;
+				stack[nstack++] = f;
+			}
+		}
+	}
+
+	// Prune the dead-end trees, leaves first.
+	while (nstack > 0)
+	{
+		const int f = stack[--nstack];
+		for (int k = 0; k < 3; ++k)
+		{
+			const int nei = neis[f*3+k];
+			if (nei < 0 || abstractions[nei].type == DT_FACE_DEAD_END)
+				continue;
+			if (--degree[nei] <= 1)
+			{
+				abstractions[nei].type = DT_FACE_DEAD_END;
+				stack[nstack++] = nei;
+			}
+		}
+	}
+
+	// Label each dead-end tree, the searches only enter the tree containing the goal.
+	int nregions = 0;
+	for (int f = 0; f < maxFaces; ++f)
+	{
+		if (abstractions[f].type != DT_FACE_DEAD_END || abstractions[f].region)
+			continue;
+		if (nregions >= 0xffff)
+		{
+			// Out of region ids, keep the remaining trees in the search.
+			abstractions[f].type = DT_FACE_DECISION;
+			continue;
+		}
+		const unsigned short region = (unsigned short)++nregions;
+		abstractions[f].region = region;
+		nstack = 0;
+		stack[nstack++] = f;
+		while (nstack > 0)
+		{
+			const int cur = stack[--nstack];
+			for (int k = 0; k < 3; ++k)
+			{
+				const int nei = neis[cur*3+k];
+				if (nei < 0 || abstractions[nei].type != DT_FACE_DEAD_END || abstractions[nei].region)
+					continue;
+				abstractions[nei].region = region;
+				stack[nstack++] = nei;
+			}
+		}
+	}
+
+	// The faces with exactly two remaining neighbours inside the tile form the corridors.
+	for (int i = 0; i < params->polyCount; ++i)
+	{
+		const int nv = countPolyVerts(&params->polys[i*nvp*2], nvp);
+		for (int j = 0; j < nv-2; ++j)
+		{
+			const int f = i*DT_FACES_PER_POLYGON + j;
+			if (abstractions[f].type == DT_FACE_DEAD_END)
+				continue;
+
+			int edges[3];
+			int nedges = 0;
+			bool portal = false;
+			for (int k = 0; k < 3; ++k)
+			{
+				const int nei = neis[f*3+k];
+				if (nei == FAN_NEI_PORTAL)
+					portal = true;
+				else if (nei >= 0 && abstractions[nei].type != DT_FACE_DEAD_END)
+					edges[nedges++] = k;
+			}
+			if (portal || nedges != 2)
+				continue;
+
+			// Same pivot as astar::isWalkableByRadius(), the vertex shared by the two edges.
+			const int pivot = (3 - edges[0] - edges[1] + 2) % 3;
+			dtFaceClearance clearance;
+			calcFaceClearance(params, tris, i, j, &clearance);
+			abstractions[f].type = DT_FACE_CORRIDOR;
+			if ((clearance.flags & (DT_FACE_CLEARANCE_PARTIAL << pivot)) == 0)
+				abstractions[f].corridorWidth = clearance.width[pivot];
+		}
+	}
+
+	// The narrowest face of each corridor chain limits the whole chain.
+	// The degrees are no longer needed, reuse them as the visited flags.
+	for (int f = 0; f < maxFaces; ++f)
+		degree[f] = 0;
+	for (int f = 0; f < maxFaces; ++f)
+	{
+		if (abstractions[f].type != DT_FACE_CORRIDOR || degree[f])
+			continue;
+
+		float width = FLT_MAX;
+		int nchain = 0;
+		nstack = 0;
+		stack[nstack++] = f;
+		degree[f] = 1;
+		while (nchain < nstack)
+		{
+			const int cur = stack[nchain++];
+			width = dtMin(width, abstractions[cur].corridorWidth);
+			for (int k = 0; k < 3; ++k)
+			{
+				const int nei = neis[cur*3+k];
+				if (nei < 0 || abstractions[nei].type != DT_FACE_CORRIDOR || degree[nei])
+					continue;
+				degree[nei] = 1;
+				stack[nstack++] = nei;
+			}
+		}
+		for (int k = 0; k < nchain; ++k)
+			abstractions[stack[k]].corridorWidth = width;
+	}
+
+	dtFree(neis);
+	dtFree(degree);
+	dtFree(stack);
+
+	return true;
+}
+
 static unsigned char classifyOffMeshPoint(const float* pt, const float* bmin, const float* bmax)
 {
 	static const unsigned char XP = 1<<0;
@@ -433,10 +1167,28 @@ bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData,
 	const int detailTrisSize = dtAlign4(sizeof(unsigned char)*4*detailTriCount);
 	const int bvTreeSize = params->buildBvTree ? dtAlign4(sizeof(dtBVNode)*params->polyCount*2) : 0;
 	const int offMeshConsSize = dtAlign4(sizeof(dtOffMeshConnection)*storedOffMeshConCount);
+	const int faceClearanceCount = params->buildFaceClearance ? params->polyCount*DT_FACES_PER_POLYGON : 0;
+	const int faceClearancesSize = dtAlign4(sizeof(dtFaceClearance)*faceClearanceCount);
+	int faceCount = 0;
+	if (params->buildFaceBvTree)
+	{
+		for (int i = 0; i < params->polyCount; ++i)
+			faceCount += countPolyVerts(&params->polys[i*nvp*2], nvp) - 2;
+	}
+	const int faceBvNodeCount = faceCount*2;
+	const int faceBvTreeSize = dtAlign4(sizeof(dtBVNode)*faceBvNodeCount);
+	const int faceAbstractionCount = params->buildFaceAbstraction ? params->polyCount*DT_FACES_PER_POLYGON : 0;
+	const int faceAbstractionsSize = dtAlign4(sizeof(dtFaceAbstraction)*faceAbstractionCount);
+	const int polyTriangulationCount = params->buildPolyTriangulation ? params->polyCount : 0;
+	const int polyTriangulationsSize = dtAlign4(sizeof(dtPolyTriangulation)*polyTriangulationCount);
+	// A tree of n leaves has at most n-1 wide nodes with two or more children.
+	const int wideBvNodeCount = (params->buildBvTree && params->buildWideBvTree) ? params->polyCount : 0;
+	const int wideBvTreeSize = dtAlign4(sizeof(dtWideBVNode)*wideBvNodeCount);
 	
 	const int dataSize = headerSize + vertsSize + polysSize + linksSize +
 						 detailMeshesSize + detailVertsSize + detailTrisSize +
-						 bvTreeSize + offMeshConsSize;
+						 bvTreeSize + offMeshConsSize + faceClearancesSize + faceBvTreeSize +
+						 faceAbstractionsSize + polyTriangulationsSize + wideBvTreeSize;
 						 
 	unsigned char* data = (unsigned char*)dtAlloc(sizeof(unsigned char)*dataSize, DT_ALLOC_PERM);
 	if (!data)
@@ -457,6 +1209,11 @@ bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData,
 	unsigned char* navDTris = dtGetThenAdvanceBufferPointer<unsigned char>(d, detailTrisSize);
 	dtBVNode* navBvtree = dtGetThenAdvanceBufferPointer<dtBVNode>(d, bvTreeSize);
 	dtOffMeshConnection* offMeshCons = dtGetThenAdvanceBufferPointer<dtOffMeshConnection>(d, offMeshConsSize);
+	dtFaceClearance* faceClearances = dtGetThenAdvanceBufferPointer<dtFaceClearance>(d, faceClearancesSize);
+	dtBVNode* faceBvTree = dtGetThenAdvanceBufferPointer<dtBVNode>(d, faceBvTreeSize);
+	dtFaceAbstraction* faceAbstractions = dtGetThenAdvanceBufferPointer<dtFaceAbstraction>(d, faceAbstractionsSize);
+	dtPolyTriangulation* polyTriangulations = dtGetThenAdvanceBufferPointer<dtPolyTriangulation>(d, polyTriangulationsSize);
+	dtWideBVNode* wideBvTree = dtGetThenAdvanceBufferPointer<dtWideBVNode>(d, wideBvTreeSize);
 	
 	
 	// Store header
@@ -481,6 +1238,11 @@ bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData,
 	header->walkableClimb = params->walkableClimb;
 	header->offMeshConCount = storedOffMeshConCount;
 	header->bvNodeCount = params->buildBvTree ? params->polyCount*2 : 0;
+	header->faceClearanceCount = faceClearanceCount;
+	header->faceBvNodeCount = faceBvNodeCount;
+	header->faceAbstractionCount = faceAbstractionCount;
+	header->polyTriangulationCount = polyTriangulationCount;
+	header->wideBvNodeCount = wideBvNodeCount;
 	
 	const int offMeshVertsBase = params->vertCount;
 	const int offMeshPolyBase = params->polyCount;
@@ -625,6 +1387,8 @@ bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData,
 	if (params->buildBvTree)
 	{
 		createBVTree(params, navBvtree, 2*params->polyCount);
+		if (wideBvNodeCount > 0)
+			createWideBVTree(navBvtree, wideBvTree);
 	}
 	
 	// Store Off-Mesh connections.
@@ -648,7 +1412,65 @@ bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData,
 			n++;
 		}
 	}
-		
+
+	// Store the polygon triangulations, the face data below is built from the same triangles.
+	// Without stored triangulations the faces are the fan, kept only while building.
+	dtPolyTriangulation* tris = polyTriangulationCount ? polyTriangulations : 0;
+	const bool buildFaceData = params->buildFaceClearance || params->buildFaceBvTree || params->buildFaceAbstraction;
+	if (!tris && buildFaceData && params->polyCount > 0)
+	{
+		tris = (dtPolyTriangulation*)dtAlloc(sizeof(dtPolyTriangulation)*params->polyCount, DT_ALLOC_TEMP);
+		if (!tris)
+		{
+			dtFree(data);
+			dtFree(offMeshConClass);
+			return false;
+		}
+	}
+	if (tris)
+	{
+		for (int i = 0; i < params->polyCount; ++i)
+		{
+			const int nv = navPolys[i].vertCount;
+			if (params->buildPolyTriangulation)
+				triangulatePolyDelaunay(params, i, nv, &tris[i]);
+			else
+				triangulatePolyFan(nv, &tris[i]);
+		}
+	}
+
+	// Store face clearances.
+	if (params->buildFaceClearance)
+	{
+		for (int i = 0; i < params->polyCount; ++i)
+		{
+			const int nv = navPolys[i].vertCount;
+			for (int j = 0; j < nv-2; ++j)
+				calcFaceClearance(params, tris, i, j, &faceClearances[i*DT_FACES_PER_POLYGON+j]);
+		}
+	}
+
+	// Store and create face BVtree.
+	if (params->buildFaceBvTree && faceCount > 0)
+	{
+		createFaceBVTree(params, tris, faceBvTree, faceCount);
+	}
+
+	// Store the abstract face graph.
+	if (params->buildFaceAbstraction && params->polyCount > 0)
+	{
+		if (!createFaceAbstraction(params, tris, faceAbstractions))
+		{
+			if (!polyTriangulationCount)
+				dtFree(tris);
+			dtFree(data);
+			dtFree(offMeshConClass);
+			return false;
+		}
+	}
+
+	if (!polyTriangulationCount)
+		dtFree(tris);
 	dtFree(offMeshConClass);
 	
 	*outData = data;
@@ -687,6 +1509,11 @@ bool dtNavMeshHeaderSwapEndian(unsigned char* data, const int /*dataSize*/)
 	dtSwapEndian(&header->bvNodeCount);
 	dtSwapEndian(&header->offMeshConCount);
 	dtSwapEndian(&header->offMeshBase);
+	dtSwapEndian(&header->faceClearanceCount);
+	dtSwapEndian(&header->faceBvNodeCount);
+	dtSwapEndian(&header->faceAbstractionCount);
+	dtSwapEndian(&header->polyTriangulationCount);
+	dtSwapEndian(&header->wideBvNodeCount);
 	dtSwapEndian(&header->walkableHeight);
 	dtSwapEndian(&header->walkableRadius);
 	dtSwapEndian(&header->walkableClimb);
@@ -728,6 +1555,11 @@ bool dtNavMeshDataSwapEndian(unsigned char* data, const int /*dataSize*/)
 	const int detailTrisSize = dtAlign4(sizeof(unsigned char)*4*header->detailTriCount);
 	const int bvtreeSize = dtAlign4(sizeof(dtBVNode)*header->bvNodeCount);
 	const int offMeshLinksSize = dtAlign4(sizeof(dtOffMeshConnection)*header->offMeshConCount);
+	const int faceClearancesSize = dtAlign4(sizeof(dtFaceClearance)*header->faceClearanceCount);
+	const int faceBvTreeSize = dtAlign4(sizeof(dtBVNode)*header->faceBvNodeCount);
+	const int faceAbstractionsSize = dtAlign4(sizeof(dtFaceAbstraction)*header->faceAbstractionCount);
+	const int polyTriangulationsSize = dtAlign4(sizeof(dtPolyTriangulation)*header->polyTriangulationCount);
+	const int wideBvTreeSize = dtAlign4(sizeof(dtWideBVNode)*header->wideBvNodeCount);
 	
 	unsigned char* d = data + headerSize;
 	float* verts = dtGetThenAdvanceBufferPointer<float>(d, vertsSize);
@@ -740,6 +1572,11 @@ bool dtNavMeshDataSwapEndian(unsigned char* data, const int /*dataSize*/)
 	//unsigned char* detailTris = dtGetThenAdvanceBufferPointer<unsigned char>(d, detailTrisSize);
 	dtBVNode* bvTree = dtGetThenAdvanceBufferPointer<dtBVNode>(d, bvtreeSize);
 	dtOffMeshConnection* offMeshCons = dtGetThenAdvanceBufferPointer<dtOffMeshConnection>(d, offMeshLinksSize);
+	dtFaceClearance* faceClearances = dtGetThenAdvanceBufferPointer<dtFaceClearance>(d, faceClearancesSize);
+	dtBVNode* faceBvTree = dtGetThenAdvanceBufferPointer<dtBVNode>(d, faceBvTreeSize);
+	dtFaceAbstraction* faceAbstractions = dtGetThenAdvanceBufferPointer<dtFaceAbstraction>(d, faceAbstractionsSize);
+	d += polyTriangulationsSize; // Ignore polygon triangulations; single bytes can't be endian-swapped.
+	dtWideBVNode* wideBvTree = dtGetThenAdvanceBufferPointer<dtWideBVNode>(d, wideBvTreeSize);
 	
 	// Vertices
 	for (int i = 0; i < header->vertCount*3; ++i)
@@ -797,6 +1634,51 @@ bool dtNavMeshDataSwapEndian(unsigned char* data, const int /*dataSize*/)
 		dtSwapEndian(&con->rad);
 		dtSwapEndian(&con->poly);
 	}
+
+	// Face clearances.
+	for (int i = 0; i < header->faceClearanceCount; ++i)
+	{
+		dtFaceClearance* clearance = &faceClearances[i];
+		for (int j = 0; j < 3; ++j)
+			dtSwapEndian(&clearance->width[j]);
+	}
+
+	// Face BV-tree
+	for (int i = 0; i < header->faceBvNodeCount; ++i)
+	{
+		dtBVNode* node = &faceBvTree[i];
+		for (int j = 0; j < 3; ++j)
+		{
+			dtSwapEndian(&node->bmin[j]);
+			dtSwapEndian(&node->bmax[j]);
+		}
+		dtSwapEndian(&node->i);
+	}
+
+	// Face abstractions.
+	for (int i = 0; i < header->faceAbstractionCount; ++i)
+	{
+		dtFaceAbstraction* abstraction = &faceAbstractions[i];
+		dtSwapEndian(&abstraction->corridorWidth);
+		dtSwapEndian(&abstraction->region);
+	}
+
+	// Polygon triangulations are single bytes, no need to swap.
+
+	// Wide BV-tree
+	for (int i = 0; i < header->wideBvNodeCount; ++i)
+	{
+		dtWideBVNode* node = &wideBvTree[i];
+		for (int j = 0; j < DT_WIDE_BV_WIDTH; ++j)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				dtSwapEndian(&node->bmin[k][j]);
+				dtSwapEndian(&node->bmax[k][j]);
+			}
+			dtSwapEndian(&node->child[j]);
+		}
+	}
 	
 	return true;
 }
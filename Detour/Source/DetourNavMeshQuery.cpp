@@ -18,9 +18,13 @@
 
 #include <float.h>
 #include <string.h>
+#include <stdlib.h>
 #include "DetourNavMeshQuery.h"
 #include "DetourNavMesh.h"
 #include "DetourNode.h"
+#include "DetourLandmarks.h"
+#include "DetourTilePortalGraph.h"
+#include "DetourNavMeshQueryTemplates.h"
 #include "DetourCommon.h"
 #include "DetourMath.h"
 #include "DetourAlloc.h"
@@ -83,25 +87,8 @@ float dtQueryFilter::getCost(const float* pa, const float* pb,
 {
 	return dtVdist(pa, pb) * m_areaCost[curPoly->getArea()];
 }
-#else
-inline bool dtQueryFilter::passFilter(const dtPolyRef /*ref*/,
-									  const dtMeshTile* /*tile*/,
-									  const dtPoly* poly) const
-{
-	return (poly->flags & m_includeFlags) != 0 && (poly->flags & m_excludeFlags) == 0;
-}
-
-inline float dtQueryFilter::getCost(const float* pa, const float* pb,
-									const dtPolyRef /*prevRef*/, const dtMeshTile* /*prevTile*/, const dtPoly* /*prevPoly*/,
-									const dtPolyRef /*curRef*/, const dtMeshTile* /*curTile*/, const dtPoly* curPoly,
-									const dtPolyRef /*nextRef*/, const dtMeshTile* /*nextTile*/, const dtPoly* /*nextPoly*/) const
-{
-	return dtVdist(pa, pb) * m_areaCost[curPoly->getArea()];
-}
 #endif	
 	
-static const float H_SCALE = 0.999f; // Search heuristic scale.
-
 
 dtNavMeshQuery* dtAllocNavMeshQuery()
 {
@@ -139,7 +126,10 @@ dtNavMeshQuery::dtNavMeshQuery() :
 	m_nav(0),
 	m_tinyNodePool(0),
 	m_nodePool(0),
-	m_openList(0)
+	m_openList(0),
+	m_backOpenList(0),
+	m_trace(0),
+	m_landmarks(0)
 {
 	memset(&m_query, 0, sizeof(dtQueryData));
 }
@@ -152,9 +142,12 @@ dtNavMeshQuery::~dtNavMeshQuery()
 		m_nodePool->~dtNodePool();
 	if (m_openList)
 		m_openList->~dtNodeQueue();
+	if (m_backOpenList)
+		m_backOpenList->~dtNodeQueue();
 	dtFree(m_tinyNodePool);
 	dtFree(m_nodePool);
 	dtFree(m_openList);
+	dtFree(m_backOpenList);
 }
 
 /// @par 
@@ -165,7 +158,7 @@ dtNavMeshQuery::~dtNavMeshQuery()
 /// This function can be used multiple times.
 dtStatus dtNavMeshQuery::init(const dtNavMesh* nav, const int maxNodes)
 {
-	if (maxNodes > DT_NULL_IDX || maxNodes > (1 << DT_NODE_PARENT_BITS) - 1)
+	if (maxNodes > DT_MAX_NODES)
 		return DT_FAILURE | DT_INVALID_PARAM;
 
 	m_nav = nav;
@@ -198,7 +191,7 @@ dtStatus dtNavMeshQuery::init(const dtNavMesh* nav, const int maxNodes)
 		m_tinyNodePool->clear();
 	}
 	
-	if (!m_openList || m_openList->getCapacity() < maxNodes)
+	if (!m_openList || m_openList->getCapacity() < maxNodes || m_openList->getNodePool() != m_nodePool)
 	{
 		if (m_openList)
 		{
@@ -206,7 +199,7 @@ dtStatus dtNavMeshQuery::init(const dtNavMesh* nav, const int maxNodes)
 			dtFree(m_openList);
 			m_openList = 0;
 		}
-		m_openList = new (dtAlloc(sizeof(dtNodeQueue), DT_ALLOC_PERM)) dtNodeQueue(maxNodes);
+		m_openList = new (dtAlloc(sizeof(dtNodeQueue), DT_ALLOC_PERM)) dtNodeQueue(maxNodes, m_nodePool);
 		if (!m_openList)
 			return DT_FAILURE | DT_OUT_OF_MEMORY;
 	}
@@ -214,6 +207,23 @@ dtStatus dtNavMeshQuery::init(const dtNavMesh* nav, const int maxNodes)
 	{
 		m_openList->clear();
 	}
+
+	if (!m_backOpenList || m_backOpenList->getCapacity() < maxNodes || m_backOpenList->getNodePool() != m_nodePool)
+	{
+		if (m_backOpenList)
+		{
+			m_backOpenList->~dtNodeQueue();
+			dtFree(m_backOpenList);
+			m_backOpenList = 0;
+		}
+		m_backOpenList = new (dtAlloc(sizeof(dtNodeQueue), DT_ALLOC_PERM)) dtNodeQueue(maxNodes, m_nodePool);
+		if (!m_backOpenList)
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+	else
+	{
+		m_backOpenList->clear();
+	}
 	
 	return DT_SUCCESS;
 }
@@ -725,6 +735,335 @@ dtStatus dtNavMeshQuery::findNearestPoly(const float* center, const float* halfE
 	return DT_SUCCESS;
 }
 
+// Max number of points of findNearestPolys() searched together.
+static const int MAX_NEAREST_GROUP = 64;
+// Max depth of the BV tree nodes narrowing the points of a group, the deeper nodes test all the points of the last one.
+static const int MAX_NEAREST_DEPTH = 24;
+
+struct dtNearestPolyKey
+{
+	int x, y;		// The tile of the minimum of the search box.
+	int point;
+};
+
+static int compareNearestPolyKey(const void* va, const void* vb)
+{
+	const dtNearestPolyKey* a = (const dtNearestPolyKey*)va;
+	const dtNearestPolyKey* b = (const dtNearestPolyKey*)vb;
+	if (a->y != b->y)
+		return a->y < b->y ? -1 : 1;
+	if (a->x != b->x)
+		return a->x < b->x ? -1 : 1;
+	return a->point < b->point ? -1 : (a->point > b->point ? 1 : 0);
+}
+
+// Search state of a point of findNearestPolys().
+struct dtNearestPolyPoint
+{
+	const float* center;
+	float bmin[3], bmax[3];
+	unsigned short qmin[3], qmax[3];	// The search box quantized in the current tile.
+	int maxx, maxy;						// The tile of the maximum of the search box.
+	float nearestDistanceSqr;
+	float nearestPoint[3];
+	dtPolyRef nearestRef;
+	bool overPoly;
+};
+
+// Same as dtFindNearestPolyQuery::process() for one polygon.
+static void updateNearestPoly(const dtNavMeshQuery* query, const dtMeshTile* tile, const dtPolyRef ref, dtNearestPolyPoint& p)
+{
+	float closestPtPoly[3];
+	float diff[3];
+	bool posOverPoly = false;
+	float d;
+	query->closestPointOnPoly(ref, p.center, closestPtPoly, &posOverPoly);
+
+	dtVsub(diff, p.center, closestPtPoly);
+	if (posOverPoly)
+	{
+		d = dtAbs(diff[1]) - tile->header->walkableClimb;
+		d = d > 0 ? d*d : 0;
+	}
+	else
+	{
+		d = dtVlenSqr(diff);
+	}
+
+	if (d < p.nearestDistanceSqr)
+	{
+		dtVcopy(p.nearestPoint, closestPtPoly);
+		p.nearestDistanceSqr = d;
+		p.nearestRef = ref;
+		p.overPoly = posOverPoly;
+	}
+}
+
+// Lower bound of the distance updateNearestPoly() gives to a polygon in the box.
+static float getNearestPolyBound(const float* pos, const float* bmin, const float* bmax, const float walkableClimb)
+{
+	float d[3];
+	for (int i = 0; i < 3; ++i)
+		d[i] = dtMax(dtMax(bmin[i] - pos[i], pos[i] - bmax[i]), 0.0f);
+	if (d[0] == 0.0f && d[2] == 0.0f)
+	{
+		// The point may be over the polygon.
+		const float dy = dtMax(d[1] - walkableClimb, 0.0f);
+		return dy*dy;
+	}
+	return dtVlenSqr(d);
+}
+
+// Finds the nearest polygons of the tile for the points of a group, visiting the polygons
+// in the order of queryPolygonsInTile() so that the ties resolve like findNearestPoly().
+static void findNearestPolysInTile(const dtNavMeshQuery* query, const dtNavMesh* nav, const dtMeshTile* tile,
+								   const dtQueryFilter* filter, dtNearestPolyPoint* points,
+								   const unsigned char* active, const int nactive)
+{
+	const dtPolyRef base = nav->getPolyRefBase(tile);
+
+	if (tile->bvTree)
+	{
+		const float* tbmin = tile->header->bmin;
+		const float* tbmax = tile->header->bmax;
+		const float qfac = tile->header->bvQuantFactor;
+		for (int i = 0; i < nactive; ++i)
+		{
+			dtNearestPolyPoint& p = points[active[i]];
+			for (int j = 0; j < 3; ++j)
+			{
+				const float minv = dtClamp(p.bmin[j], tbmin[j], tbmax[j]) - tbmin[j];
+				const float maxv = dtClamp(p.bmax[j], tbmin[j], tbmax[j]) - tbmin[j];
+				p.qmin[j] = (unsigned short)(qfac * minv) & 0xfffe;
+				p.qmax[j] = (unsigned short)(qfac * maxv + 1) | 1;
+			}
+		}
+
+		// The points overlapping the nodes on the way down, the subtree of level i ends at ends[i].
+		unsigned char lists[(MAX_NEAREST_DEPTH+1)*MAX_NEAREST_GROUP];
+		int counts[MAX_NEAREST_DEPTH+1];
+		int ends[MAX_NEAREST_DEPTH+1];
+		memcpy(lists, active, sizeof(unsigned char)*nactive);
+		counts[0] = nactive;
+		ends[0] = tile->header->bvNodeCount;
+		int depth = 0;
+
+		int ni = 0;
+		while (ni < tile->header->bvNodeCount)
+		{
+			while (ni >= ends[depth])
+				depth--;
+
+			const dtBVNode* node = &tile->bvTree[ni];
+			const unsigned char* list = &lists[depth*MAX_NEAREST_GROUP];
+			const int n = counts[depth];
+
+			if (node->i >= 0)
+			{
+				// Leaf, the filter is checked once for all the points.
+				const dtPolyRef ref = base | (dtPolyRef)node->i;
+				int pass = -1;
+				float nbmin[3], nbmax[3];
+				for (int i = 0; i < n; ++i)
+				{
+					dtNearestPolyPoint& p = points[list[i]];
+					if (!dtOverlapQuantBounds(p.qmin, p.qmax, node->bmin, node->bmax))
+						continue;
+					if (pass < 0)
+					{
+						pass = filter->passFilter(ref, tile, &tile->polys[node->i]) ? 1 : 0;
+						if (!pass)
+							break;
+						// The node box grown by one quantization step, it contains the nearest points of the polygon.
+						for (int j = 0; j < 3; ++j)
+						{
+							nbmin[j] = tbmin[j] + ((float)node->bmin[j] - 1.0f) / qfac;
+							nbmax[j] = tbmin[j] + ((float)node->bmax[j] + 1.0f) / qfac;
+						}
+					}
+					// Skip the polygons that cannot beat the nearest one, see updateNearestPoly().
+					if (p.nearestRef && getNearestPolyBound(p.center, nbmin, nbmax, tile->header->walkableClimb) > p.nearestDistanceSqr)
+						continue;
+					updateNearestPoly(query, tile, ref, p);
+				}
+				ni++;
+				continue;
+			}
+
+			const int escapeIndex = -node->i;
+			if (depth < MAX_NEAREST_DEPTH)
+			{
+				unsigned char* sub = &lists[(depth+1)*MAX_NEAREST_GROUP];
+				int nsub = 0;
+				for (int i = 0; i < n; ++i)
+				{
+					const dtNearestPolyPoint& p = points[list[i]];
+					if (dtOverlapQuantBounds(p.qmin, p.qmax, node->bmin, node->bmax))
+						sub[nsub++] = list[i];
+				}
+				if (nsub == 0)
+				{
+					ni += escapeIndex;
+					continue;
+				}
+				depth++;
+				counts[depth] = nsub;
+				ends[depth] = ni + escapeIndex;
+				ni++;
+			}
+			else
+			{
+				bool overlap = false;
+				for (int i = 0; i < n && !overlap; ++i)
+				{
+					const dtNearestPolyPoint& p = points[list[i]];
+					overlap = dtOverlapQuantBounds(p.qmin, p.qmax, node->bmin, node->bmax);
+				}
+				ni += overlap ? 1 : escapeIndex;
+			}
+		}
+	}
+	else
+	{
+		float bmin[3], bmax[3];
+		for (int i = 0; i < tile->header->polyCount; ++i)
+		{
+			const dtPoly* poly = &tile->polys[i];
+			// Do not return off-mesh connection polygons.
+			if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+				continue;
+			const dtPolyRef ref = base | (dtPolyRef)i;
+			if (!filter->passFilter(ref, tile, poly))
+				continue;
+			const float* v = &tile->verts[poly->verts[0]*3];
+			dtVcopy(bmin, v);
+			dtVcopy(bmax, v);
+			for (int j = 1; j < poly->vertCount; ++j)
+			{
+				v = &tile->verts[poly->verts[j]*3];
+				dtVmin(bmin, v);
+				dtVmax(bmax, v);
+			}
+			for (int j = 0; j < nactive; ++j)
+			{
+				dtNearestPolyPoint& p = points[active[j]];
+				if (dtOverlapBounds(p.bmin, p.bmax, bmin, bmax))
+					updateNearestPoly(query, tile, ref, p);
+			}
+		}
+	}
+}
+
+/// @par
+///
+/// The results are the same as calling #findNearestPoly for each point. The points are sorted by the tile
+/// of their search box, and the points of a tile are searched together: the tiles are looked up once per
+/// group and the BV tree nodes are tested only against the points that overlap their parent node,
+/// so the cost grows with the number of groups and the polygons they overlap rather than with the points.
+///
+/// The sort takes a temporary buffer of the size of the batch.
+dtStatus dtNavMeshQuery::findNearestPolys(const float* centers, const int count, const float* halfExtents,
+										  const dtQueryFilter* filter,
+										  dtPolyRef* nearestRefs, float* nearestX, float* nearestY, float* nearestZ,
+										  unsigned char* isOverPoly) const
+{
+	dtAssert(m_nav);
+
+	if (!centers || count < 0 || !halfExtents || !dtVisfinite(halfExtents) ||
+		!filter || !nearestRefs)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+	for (int i = 0; i < count; ++i)
+	{
+		if (!dtVisfinite(&centers[i*3]))
+			return DT_FAILURE | DT_INVALID_PARAM;
+	}
+	if (count == 0)
+		return DT_SUCCESS;
+
+	dtNearestPolyKey* keys = (dtNearestPolyKey*)dtAlloc(sizeof(dtNearestPolyKey)*count, DT_ALLOC_TEMP);
+	if (!keys)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+
+	for (int i = 0; i < count; ++i)
+	{
+		float bmin[3];
+		dtVsub(bmin, &centers[i*3], halfExtents);
+		m_nav->calcTileLoc(bmin, &keys[i].x, &keys[i].y);
+		keys[i].point = i;
+	}
+	qsort(keys, count, sizeof(dtNearestPolyKey), compareNearestPolyKey);
+
+	static const int MAX_NEIS = 32;
+	const dtMeshTile* neis[MAX_NEIS];
+	dtNearestPolyPoint points[MAX_NEAREST_GROUP];
+	unsigned char active[MAX_NEAREST_GROUP];
+
+	for (int first = 0; first < count; )
+	{
+		// The points sharing the tile of their box minimum.
+		int npoints = 0;
+		int maxx = keys[first].x, maxy = keys[first].y;
+		while (first + npoints < count && npoints < MAX_NEAREST_GROUP &&
+			   keys[first + npoints].x == keys[first].x && keys[first + npoints].y == keys[first].y)
+		{
+			dtNearestPolyPoint& p = points[npoints];
+			p.center = &centers[keys[first + npoints].point*3];
+			dtVsub(p.bmin, p.center, halfExtents);
+			dtVadd(p.bmax, p.center, halfExtents);
+			m_nav->calcTileLoc(p.bmax, &p.maxx, &p.maxy);
+			p.nearestDistanceSqr = FLT_MAX;
+			p.nearestRef = 0;
+			p.overPoly = false;
+			maxx = dtMax(maxx, p.maxx);
+			maxy = dtMax(maxy, p.maxy);
+			npoints++;
+		}
+
+		// Same tile order as queryPolygons().
+		for (int y = keys[first].y; y <= maxy; ++y)
+		{
+			for (int x = keys[first].x; x <= maxx; ++x)
+			{
+				int nactive = 0;
+				for (int i = 0; i < npoints; ++i)
+				{
+					if (x <= points[i].maxx && y <= points[i].maxy)
+						active[nactive++] = (unsigned char)i;
+				}
+				if (!nactive)
+					continue;
+				const int nneis = m_nav->getTilesAt(x, y, neis, MAX_NEIS);
+				for (int j = 0; j < nneis; ++j)
+					findNearestPolysInTile(this, m_nav, neis[j], filter, points, active, nactive);
+			}
+		}
+
+		for (int i = 0; i < npoints; ++i)
+		{
+			const dtNearestPolyPoint& p = points[i];
+			const int k = keys[first + i].point;
+			const float* pos = p.nearestRef ? p.nearestPoint : p.center;
+			nearestRefs[k] = p.nearestRef;
+			if (nearestX)
+				nearestX[k] = pos[0];
+			if (nearestY)
+				nearestY[k] = pos[1];
+			if (nearestZ)
+				nearestZ[k] = pos[2];
+			if (isOverPoly)
+				isOverPoly[k] = (p.nearestRef && p.overPoly) ? 1 : 0;
+		}
+
+		first += npoints;
+	}
+
+	dtFree(keys);
+
+	return DT_SUCCESS;
+}
+
 void dtNavMeshQuery::queryPolygonsInTile(const dtMeshTile* tile, const float* qmin, const float* qmax,
 										 const dtQueryFilter* filter, dtPolyQuery* query) const
 {
@@ -759,39 +1098,80 @@ void dtNavMeshQuery::queryPolygonsInTile(const dtMeshTile* tile, const float* qm
 		bmax[1] = (unsigned short)(qfac * maxy + 1) | 1;
 		bmax[2] = (unsigned short)(qfac * maxz + 1) | 1;
 
-		// Traverse tree
 		const dtPolyRef base = m_nav->getPolyRefBase(tile);
-		while (node < end)
+		if (tile->wideBvTree)
 		{
-			const bool overlap = dtOverlapQuantBounds(bmin, bmax, node->bmin, node->bmax);
-			const bool isLeafNode = node->i >= 0;
-
-			if (isLeafNode && overlap)
+			// Traverse the wide tree. The children are pushed backwards to return the polygons in the order of the binary tree.
+			int stack[DT_WIDE_BV_STACK_SIZE];
+			int nstack = 0;
+			stack[nstack++] = 0;
+			while (nstack > 0)
 			{
-				dtPolyRef ref = base | (dtPolyRef)node->i;
-				if (filter->passFilter(ref, tile, &tile->polys[node->i]))
+				const int i = stack[--nstack];
+				if (i < 0)
 				{
-					polyRefs[n] = ref;
-					polys[n] = &tile->polys[node->i];
-
-					if (n == batchSize - 1)
+					const dtPolyRef ref = base | (dtPolyRef)~i;
+					if (filter->passFilter(ref, tile, &tile->polys[~i]))
 					{
-						query->process(tile, polys, polyRefs, batchSize);
-						n = 0;
+						polyRefs[n] = ref;
+						polys[n] = &tile->polys[~i];
+
+						if (n == batchSize - 1)
+						{
+							query->process(tile, polys, polyRefs, batchSize);
+							n = 0;
+						}
+						else
+						{
+							n++;
+						}
 					}
-					else
+					continue;
+				}
+				const dtWideBVNode* wideNode = &tile->wideBvTree[i];
+				const unsigned int mask = dtOverlapQuantBounds8(bmin, bmax, wideNode->bmin[0], wideNode->bmax[0]);
+				for (int j = DT_WIDE_BV_WIDTH-1; j >= 0; --j)
+				{
+					if ((mask & (1u << j)) && wideNode->child[j])
+						stack[nstack++] = wideNode->child[j];
+				}
+			}
+		}
+		else
+		{
+			// Traverse tree
+			while (node < end)
+			{
+				const bool overlap = dtOverlapQuantBounds(bmin, bmax, node->bmin, node->bmax);
+				const bool isLeafNode = node->i >= 0;
+
+				if (isLeafNode && overlap)
+				{
+					dtPolyRef ref = base | (dtPolyRef)node->i;
+					if (filter->passFilter(ref, tile, &tile->polys[node->i]))
 					{
-						n++;
+						polyRefs[n] = ref;
+						polys[n] = &tile->polys[node->i];
+
+						if (n == batchSize - 1)
+						{
+							query->process(tile, polys, polyRefs, batchSize);
+							n = 0;
+						}
+						else
+						{
+							n++;
+						}
 					}
 				}
-			}
 
-			if (overlap || isLeafNode)
-				node++;
-			else
-			{
-				const int escapeIndex = -node->i;
-				node += escapeIndex;
+				if (overlap || isLeafNode)
+					node++;
+				else
+				{
+					const int escapeIndex = -node->i;
+					node += escapeIndex;
+				}
 			}
 		}
 	}
@@ -962,195 +1342,24 @@ dtStatus dtNavMeshQuery::queryPolygons(const float* center, const float* halfExt
 dtStatus dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
 								  const float* startPos, const float* endPos,
 								  const dtQueryFilter* filter,
-								  dtPolyRef* path, int* pathCount, const int maxPath) const
+								  dtPolyRef* path, int* pathCount, const int maxPath,
+								  const unsigned int options) const
 {
-	dtAssert(m_nav);
-	dtAssert(m_nodePool);
-	dtAssert(m_openList);
-
-	if (!pathCount)
-		return DT_FAILURE | DT_INVALID_PARAM;
-
-	*pathCount = 0;
-	
-	// Validate input
-	if (!m_nav->isValidPolyRef(startRef) || !m_nav->isValidPolyRef(endRef) ||
-		!startPos || !dtVisfinite(startPos) ||
-		!endPos || !dtVisfinite(endPos) ||
-		!filter || !path || maxPath <= 0)
-	{
-		return DT_FAILURE | DT_INVALID_PARAM;
-	}
+	return findPathWithFilter(startRef, endRef, startPos, endPos, filter, path, pathCount, maxPath, options);
+}
 
-	if (startRef == endRef)
-	{
-		path[0] = startRef;
-		*pathCount = 1;
-		return DT_SUCCESS;
-	}
-	
-	m_nodePool->clear();
-	m_openList->clear();
-	
-	dtNode* startNode = m_nodePool->getNode(startRef);
-	dtVcopy(startNode->pos, startPos);
-	startNode->pidx = 0;
-	startNode->cost = 0;
-	startNode->total = dtVdist(startPos, endPos) * H_SCALE;
-	startNode->id = startRef;
-	startNode->flags = DT_NODE_OPEN;
-	m_openList->push(startNode);
-	
-	dtNode* lastBestNode = startNode;
-	float lastBestNodeCost = startNode->total;
-	
-	bool outOfNodes = false;
-	
-	while (!m_openList->empty())
+// True when the search in the other direction has closed a node in the polygon of 'node'.
+bool dtNavMeshQuery::isPolyClosedByOtherSearch(const dtNode* node) const
+{
+	const bool backward = node->state >= DT_NODE_BACKWARD_STATE;
+	dtNode* others[DT_MAX_STATES_PER_NODE];
+	const int n = m_nodePool->findNodes(node->id, others, DT_MAX_STATES_PER_NODE);
+	for (int i = 0; i < n; ++i)
 	{
-		// Remove node from open list and put it in closed list.
-		dtNode* bestNode = m_openList->pop();
-		bestNode->flags &= ~DT_NODE_OPEN;
-		bestNode->flags |= DT_NODE_CLOSED;
-		
-		// Reached the goal, stop searching.
-		if (bestNode->id == endRef)
-		{
-			lastBestNode = bestNode;
-			break;
-		}
-		
-		// Get current poly and tile.
-		// The API input has been cheked already, skip checking internal data.
-		const dtPolyRef bestRef = bestNode->id;
-		const dtMeshTile* bestTile = 0;
-		const dtPoly* bestPoly = 0;
-		m_nav->getTileAndPolyByRefUnsafe(bestRef, &bestTile, &bestPoly);
-		
-		// Get parent poly and tile.
-		dtPolyRef parentRef = 0;
-		const dtMeshTile* parentTile = 0;
-		const dtPoly* parentPoly = 0;
-		if (bestNode->pidx)
-			parentRef = m_nodePool->getNodeAtIdx(bestNode->pidx)->id;
-		if (parentRef)
-			m_nav->getTileAndPolyByRefUnsafe(parentRef, &parentTile, &parentPoly);
-		
-		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
-		{
-			dtPolyRef neighbourRef = bestTile->links[i].ref;
-			
-			// Skip invalid ids and do not expand back to where we came from.
-			if (!neighbourRef || neighbourRef == parentRef)
-				continue;
-			
-			// Get neighbour poly and tile.
-			// The API input has been cheked already, skip checking internal data.
-			const dtMeshTile* neighbourTile = 0;
-			const dtPoly* neighbourPoly = 0;
-			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);			
-			
-			if (!filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
-				continue;
-
-			// deal explicitly with crossing tile boundaries
-			unsigned char crossSide = 0;
-			if (bestTile->links[i].side != 0xff)
-				crossSide = bestTile->links[i].side >> 1;
-
-			// get the node
-			dtNode* neighbourNode = m_nodePool->getNode(neighbourRef, crossSide);
-			if (!neighbourNode)
-			{
-				outOfNodes = true;
-				continue;
-			}
-			
-			// If the node is visited the first time, calculate node position.
-			if (neighbourNode->flags == 0)
-			{
-				getEdgeMidPoint(bestRef, bestPoly, bestTile,
-								neighbourRef, neighbourPoly, neighbourTile,
-								neighbourNode->pos);
-			}
-
-			// Calculate cost and heuristic.
-			float cost = 0;
-			float heuristic = 0;
-			
-			// Special case for last node.
-			if (neighbourRef == endRef)
-			{
-				// Cost
-				const float curCost = filter->getCost(bestNode->pos, neighbourNode->pos,
-													  parentRef, parentTile, parentPoly,
-													  bestRef, bestTile, bestPoly,
-													  neighbourRef, neighbourTile, neighbourPoly);
-				const float endCost = filter->getCost(neighbourNode->pos, endPos,
-													  bestRef, bestTile, bestPoly,
-													  neighbourRef, neighbourTile, neighbourPoly,
-													  0, 0, 0);
-				
-				cost = bestNode->cost + curCost + endCost;
-				heuristic = 0;
-			}
-			else
-			{
-				// Cost
-				const float curCost = filter->getCost(bestNode->pos, neighbourNode->pos,
-													  parentRef, parentTile, parentPoly,
-													  bestRef, bestTile, bestPoly,
-													  neighbourRef, neighbourTile, neighbourPoly);
-				cost = bestNode->cost + curCost;
-				heuristic = dtVdist(neighbourNode->pos, endPos)*H_SCALE;
-			}
-
-			const float total = cost + heuristic;
-			
-			// The node is already in open list and the new result is worse, skip.
-			if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
-				continue;
-			// The node is already visited and process, and the new result is worse, skip.
-			if ((neighbourNode->flags & DT_NODE_CLOSED) && total >= neighbourNode->total)
-				continue;
-			
-			// Add or update the node.
-			neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
-			neighbourNode->id = neighbourRef;
-			neighbourNode->flags = (neighbourNode->flags & ~DT_NODE_CLOSED);
-			neighbourNode->cost = cost;
-			neighbourNode->total = total;
-			
-			if (neighbourNode->flags & DT_NODE_OPEN)
-			{
-				// Already in open, update node location.
-				m_openList->modify(neighbourNode);
-			}
-			else
-			{
-				// Put the node in open list.
-				neighbourNode->flags |= DT_NODE_OPEN;
-				m_openList->push(neighbourNode);
-			}
-			
-			// Update nearest node to target so far.
-			if (heuristic < lastBestNodeCost)
-			{
-				lastBestNodeCost = heuristic;
-				lastBestNode = neighbourNode;
-			}
-		}
+		if ((others[i]->state >= DT_NODE_BACKWARD_STATE) != backward && (others[i]->flags & DT_NODE_CLOSED))
+			return true;
 	}
-
-	dtStatus status = getPathToNode(lastBestNode, path, pathCount, maxPath);
-
-	if (lastBestNode->id != endRef)
-		status |= DT_PARTIAL_RESULT;
-
-	if (outOfNodes)
-		status |= DT_OUT_OF_NODES;
-	
-	return status;
+	return false;
 }
 
 dtStatus dtNavMeshQuery::getPathToNode(dtNode* endNode, dtPolyRef* path, int* pathCount, int maxPath) const
@@ -1193,295 +1402,316 @@ dtStatus dtNavMeshQuery::getPathToNode(dtNode* endNode, dtPolyRef* path, int* pa
 	return DT_SUCCESS;
 }
 
+// Node states of the hierarchical path search.
+static const unsigned char HIERARCHY_START_STATE = 0;	// Polygons of the start tile, searched from the start point.
+static const unsigned char HIERARCHY_PORTAL_STATE = 1;	// Portals, the id is the tile index and the portal index.
+static const unsigned char HIERARCHY_END_STATE = 2;		// Polygons of the end tile, searched from the end point.
+static const unsigned char HIERARCHY_GOAL_STATE = 3;	// The end point.
+
+// Maximum number of portals of a hierarchical path.
+static const int MAX_HIERARCHY_PORTALS = 256;
+
+static float getCostInPoly(const dtNavMesh* nav, const dtQueryFilter* filter, dtPolyRef ref, const float* pa, const float* pb)
+{
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	nav->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
+	return filter->getCost(pa, pb, 0, 0, 0, ref, tile, poly, 0, 0, 0);
+}
+
+static dtStatus relaxHierarchyNode(dtNodePool* nodePool, dtNodeQueue* openList, const dtNode* parent,
+								   dtPolyRef id, const unsigned char state, const float* pos, const float cost,
+								   const float* endPos)
+{
+	dtNode* node = nodePool->getNode(id, state);
+	if (!node)
+		return DT_OUT_OF_NODES;
+	if ((node->flags & (DT_NODE_OPEN | DT_NODE_CLOSED)) && cost >= node->cost)
+		return 0;
+
+	dtVcopy(node->pos, pos);
+	node->pidx = nodePool->getNodeIdx(parent);
+	node->cost = cost;
+	node->total = cost + dtVdist(pos, endPos) * DT_HEURISTIC_SCALE;
+	node->flags = (node->flags & ~DT_NODE_CLOSED);
+	if (node->flags & DT_NODE_OPEN)
+	{
+		openList->modify(node);
+	}
+	else
+	{
+		node->flags |= DT_NODE_OPEN;
+		openList->push(node);
+	}
+	return 0;
+}
 
 /// @par
 ///
-/// @warning Calling any non-slice methods before calling finalizeSlicedFindPath() 
-/// or finalizeSlicedFindPathPartial() may result in corrupted data!
+/// The route is first searched in the tile portal graph: from the start point to the portals of
+/// its tile, from portal to portal, and from the portals of the end tile to the end point.
+/// It is then refined with #findPath from portal to portal, the searches stay short however long the path is.
 ///
-/// The @p filter pointer is stored and used for the duration of the sliced
-/// path query.
+/// The portal costs of the graph do not use the filter, the filter applies to the start and end tiles
+/// and to the refinement. If a refinement search fails, the path up to it is returned with #DT_PARTIAL_RESULT.
+/// The path is close to the one of #findPath but not always the shortest.
 ///
-dtStatus dtNavMeshQuery::initSlicedFindPath(dtPolyRef startRef, dtPolyRef endRef,
-											const float* startPos, const float* endPos,
-											const dtQueryFilter* filter, const unsigned int options)
+/// Falls back to #findPath if the graph is not up to date (see dtTilePortalGraph::isValid), if both
+/// polygons are in the same tile, or if no route is found in the graph.
+dtStatus dtNavMeshQuery::findPathHierarchical(const dtTilePortalGraph* graph,
+											  dtPolyRef startRef, dtPolyRef endRef,
+											  const float* startPos, const float* endPos,
+											  const dtQueryFilter* filter,
+											  dtPolyRef* path, int* pathCount, const int maxPath) const
 {
 	dtAssert(m_nav);
 	dtAssert(m_nodePool);
 	dtAssert(m_openList);
 
-	// Init path state.
-	memset(&m_query, 0, sizeof(dtQueryData));
-	m_query.status = DT_FAILURE;
-	m_query.startRef = startRef;
-	m_query.endRef = endRef;
-	if (startPos)
-		dtVcopy(m_query.startPos, startPos);
-	if (endPos)
-		dtVcopy(m_query.endPos, endPos);
-	m_query.filter = filter;
-	m_query.options = options;
-	m_query.raycastLimitSqr = FLT_MAX;
-	
+	if (!pathCount)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	*pathCount = 0;
+
 	// Validate input
 	if (!m_nav->isValidPolyRef(startRef) || !m_nav->isValidPolyRef(endRef) ||
 		!startPos || !dtVisfinite(startPos) ||
-		!endPos || !dtVisfinite(endPos) || !filter)
+		!endPos || !dtVisfinite(endPos) ||
+		!filter || !path || maxPath <= 0)
 	{
 		return DT_FAILURE | DT_INVALID_PARAM;
 	}
 
-	// trade quality with performance?
-	if (options & DT_FINDPATH_ANY_ANGLE)
-	{
-		// limiting to several times the character radius yields nice results. It is not sensitive 
-		// so it is enough to compute it from the first tile.
-		const dtMeshTile* tile = m_nav->getTileByRef(startRef);
-		float agentRadius = tile->header->walkableRadius;
-		m_query.raycastLimitSqr = dtSqr(agentRadius * DT_RAY_CAST_LIMIT_PROPORTIONS);
-	}
+	const int startTile = (int)m_nav->decodePolyIdTile(startRef);
+	const int endTile = (int)m_nav->decodePolyIdTile(endRef);
+	if (!graph || !graph->isValid(m_nav) || startTile == endTile)
+		return findPath(startRef, endRef, startPos, endPos, filter, path, pathCount, maxPath);
 
-	if (startRef == endRef)
-	{
-		m_query.status = DT_SUCCESS;
-		return DT_SUCCESS;
-	}
-	
 	m_nodePool->clear();
-	m_openList->clear();
-	
-	dtNode* startNode = m_nodePool->getNode(startRef);
-	dtVcopy(startNode->pos, startPos);
-	startNode->pidx = 0;
-	startNode->cost = 0;
-	startNode->total = dtVdist(startPos, endPos) * H_SCALE;
-	startNode->id = startRef;
-	startNode->flags = DT_NODE_OPEN;
-	m_openList->push(startNode);
-	
-	m_query.status = DT_IN_PROGRESS;
-	m_query.lastBestNode = startNode;
-	m_query.lastBestNodeCost = startNode->total;
-	
-	return m_query.status;
-}
-	
-dtStatus dtNavMeshQuery::updateSlicedFindPath(const int maxIter, int* doneIters)
-{
-	if (!dtStatusInProgress(m_query.status))
-		return m_query.status;
+	dtStatus searchStatus = dtSearchTilePolys(m_nav, filter, m_nodePool, m_openList, startRef, startPos, HIERARCHY_START_STATE);
+	searchStatus |= dtSearchTilePolys(m_nav, filter, m_nodePool, m_openList, endRef, endPos, HIERARCHY_END_STATE);
 
-	// Make sure the request is still valid.
-	if (!m_nav->isValidPolyRef(m_query.startRef) || !m_nav->isValidPolyRef(m_query.endRef))
+	m_openList->clear();
+	int portalCount = 0;
+	const dtTilePortal* portals = graph->getPortals(startTile, &portalCount);
+	for (int i = 0; i < portalCount; ++i)
 	{
-		m_query.status = DT_FAILURE;
-		return DT_FAILURE;
+		const dtNode* node = m_nodePool->findNode(portals[i].poly, HIERARCHY_START_STATE);
+		if (!node)
+			continue;
+		const float cost = node->cost + getCostInPoly(m_nav, filter, portals[i].poly, node->pos, portals[i].pos);
+		const dtPolyRef id = ((dtPolyRef)startTile << DT_TILE_PORTAL_BITS) | (dtPolyRef)i;
+		searchStatus |= relaxHierarchyNode(m_nodePool, m_openList, 0, id, HIERARCHY_PORTAL_STATE, portals[i].pos, cost, endPos);
 	}
 
-	dtRaycastHit rayHit;
-	rayHit.maxPath = 0;
-		
-	int iter = 0;
-	while (iter < maxIter && !m_openList->empty())
+	dtNode* goalNode = 0;
+	while (!m_openList->empty())
 	{
-		iter++;
-		
-		// Remove node from open list and put it in closed list.
 		dtNode* bestNode = m_openList->pop();
 		bestNode->flags &= ~DT_NODE_OPEN;
 		bestNode->flags |= DT_NODE_CLOSED;
-		
-		// Reached the goal, stop searching.
-		if (bestNode->id == m_query.endRef)
-		{
-			m_query.lastBestNode = bestNode;
-			const dtStatus details = m_query.status & DT_STATUS_DETAIL_MASK;
-			m_query.status = DT_SUCCESS | details;
-			if (doneIters)
-				*doneIters = iter;
-			return m_query.status;
-		}
-		
-		// Get current poly and tile.
-		// The API input has been cheked already, skip checking internal data.
-		const dtPolyRef bestRef = bestNode->id;
-		const dtMeshTile* bestTile = 0;
-		const dtPoly* bestPoly = 0;
-		if (dtStatusFailed(m_nav->getTileAndPolyByRef(bestRef, &bestTile, &bestPoly)))
-		{
-			// The polygon has disappeared during the sliced query, fail.
-			m_query.status = DT_FAILURE;
-			if (doneIters)
-				*doneIters = iter;
-			return m_query.status;
-		}
-		
-		// Get parent and grand parent poly and tile.
-		dtPolyRef parentRef = 0, grandpaRef = 0;
-		const dtMeshTile* parentTile = 0;
-		const dtPoly* parentPoly = 0;
-		dtNode* parentNode = 0;
-		if (bestNode->pidx)
+
+		if (bestNode->state == HIERARCHY_GOAL_STATE)
 		{
-			parentNode = m_nodePool->getNodeAtIdx(bestNode->pidx);
-			parentRef = parentNode->id;
-			if (parentNode->pidx)
-				grandpaRef = m_nodePool->getNodeAtIdx(parentNode->pidx)->id;
+			goalNode = bestNode;
+			break;
 		}
-		if (parentRef)
+
+		const int tileIndex = (int)(bestNode->id >> DT_TILE_PORTAL_BITS);
+		const int index = (int)(bestNode->id & (DT_MAX_TILE_PORTALS - 1));
+		portals = graph->getPortals(tileIndex, &portalCount);
+		const float* costs = graph->getCosts(tileIndex);
+		const dtTilePortal& portal = portals[index];
+
+		// To the end point.
+		if (tileIndex == endTile)
 		{
-			bool invalidParent = dtStatusFailed(m_nav->getTileAndPolyByRef(parentRef, &parentTile, &parentPoly));
-			if (invalidParent || (grandpaRef && !m_nav->isValidPolyRef(grandpaRef)) )
+			const dtNode* endNode = m_nodePool->findNode(portal.poly, HIERARCHY_END_STATE);
+			if (endNode)
 			{
-				// The polygon has disappeared during the sliced query, fail.
-				m_query.status = DT_FAILURE;
-				if (doneIters)
-					*doneIters = iter;
-				return m_query.status;
+				const float cost = bestNode->cost + endNode->cost +
+					getCostInPoly(m_nav, filter, portal.poly, portal.pos, endNode->pos);
+				searchStatus |= relaxHierarchyNode(m_nodePool, m_openList, bestNode, endRef, HIERARCHY_GOAL_STATE, endPos, cost, endPos);
 			}
 		}
 
-		// decide whether to test raycast to previous nodes
-		bool tryLOS = false;
-		if (m_query.options & DT_FINDPATH_ANY_ANGLE)
+		// Across the tile.
+		for (int j = 0; j < portalCount; ++j)
 		{
-			if ((parentRef != 0) && (dtVdistSqr(parentNode->pos, bestNode->pos) < m_query.raycastLimitSqr))
-				tryLOS = true;
+			const float cost = costs[index*portalCount + j];
+			if (j == index || cost == FLT_MAX)
+				continue;
+			const dtPolyRef id = ((dtPolyRef)tileIndex << DT_TILE_PORTAL_BITS) | (dtPolyRef)j;
+			searchStatus |= relaxHierarchyNode(m_nodePool, m_openList, bestNode, id, HIERARCHY_PORTAL_STATE,
+											   portals[j].pos, bestNode->cost + cost, endPos);
 		}
-		
-		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
+
+		// Into the neighbour tile.
+		if (portal.twin >= 0)
 		{
-			dtPolyRef neighbourRef = bestTile->links[i].ref;
-			
-			// Skip invalid ids and do not expand back to where we came from.
-			if (!neighbourRef || neighbourRef == parentRef)
-				continue;
-			
-			// Get neighbour poly and tile.
-			// The API input has been cheked already, skip checking internal data.
-			const dtMeshTile* neighbourTile = 0;
-			const dtPoly* neighbourPoly = 0;
-			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);			
-			
-			if (!m_query.filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
-				continue;
-			
-			// get the neighbor node
-			dtNode* neighbourNode = m_nodePool->getNode(neighbourRef, 0);
-			if (!neighbourNode)
-			{
-				m_query.status |= DT_OUT_OF_NODES;
-				continue;
-			}
-			
-			// do not expand to nodes that were already visited from the same parent
-			if (neighbourNode->pidx != 0 && neighbourNode->pidx == bestNode->pidx)
-				continue;
+			const int neighbourTile = (int)m_nav->decodePolyIdTile(portal.neighbour);
+			const dtPolyRef id = ((dtPolyRef)neighbourTile << DT_TILE_PORTAL_BITS) | (dtPolyRef)portal.twin;
+			searchStatus |= relaxHierarchyNode(m_nodePool, m_openList, bestNode, id, HIERARCHY_PORTAL_STATE,
+											   portal.pos, bestNode->cost, endPos);
+		}
+	}
 
-			// If the node is visited the first time, calculate node position.
-			if (neighbourNode->flags == 0)
-			{
-				getEdgeMidPoint(bestRef, bestPoly, bestTile,
-								neighbourRef, neighbourPoly, neighbourTile,
-								neighbourNode->pos);
-			}
-			
-			// Calculate cost and heuristic.
-			float cost = 0;
-			float heuristic = 0;
-			
-			// raycast parent
-			bool foundShortCut = false;
-			rayHit.pathCost = rayHit.t = 0;
-			if (tryLOS)
-			{
-				raycast(parentRef, parentNode->pos, neighbourNode->pos, m_query.filter, DT_RAYCAST_USE_COSTS, &rayHit, grandpaRef);
-				foundShortCut = rayHit.t >= 1.0f;
-			}
+	if (!goalNode)
+		return findPath(startRef, endRef, startPos, endPos, filter, path, pathCount, maxPath);
 
-			// update move cost
-			if (foundShortCut)
-			{
-				// shortcut found using raycast. Using shorter cost instead
-				cost = parentNode->cost + rayHit.pathCost;
-			}
-			else
-			{
-				// No shortcut found.
-				const float curCost = m_query.filter->getCost(bestNode->pos, neighbourNode->pos,
-															  parentRef, parentTile, parentPoly,
-															bestRef, bestTile, bestPoly,
-															neighbourRef, neighbourTile, neighbourPoly);
-				cost = bestNode->cost + curCost;
-			}
+	// The refinement reuses the node pool, keep the portals of the route.
+	dtPolyRef route[MAX_HIERARCHY_PORTALS];
+	int routeCount = 0;
+	for (const dtNode* node = m_nodePool->getNodeAtIdx(goalNode->pidx); node; node = m_nodePool->getNodeAtIdx(node->pidx))
+	{
+		if (routeCount == MAX_HIERARCHY_PORTALS)
+			return findPath(startRef, endRef, startPos, endPos, filter, path, pathCount, maxPath);
+		route[routeCount++] = node->id;
+	}
 
-			// Special case for last node.
-			if (neighbourRef == m_query.endRef)
-			{
-				const float endCost = m_query.filter->getCost(neighbourNode->pos, m_query.endPos,
-															  bestRef, bestTile, bestPoly,
-															  neighbourRef, neighbourTile, neighbourPoly,
-															  0, 0, 0);
-				
-				cost = cost + endCost;
-				heuristic = 0;
-			}
-			else
-			{
-				heuristic = dtVdist(neighbourNode->pos, m_query.endPos)*H_SCALE;
-			}
-			
-			const float total = cost + heuristic;
-			
-			// The node is already in open list and the new result is worse, skip.
-			if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
-				continue;
-			// The node is already visited and process, and the new result is worse, skip.
-			if ((neighbourNode->flags & DT_NODE_CLOSED) && total >= neighbourNode->total)
-				continue;
-			
-			// Add or update the node.
-			neighbourNode->pidx = foundShortCut ? bestNode->pidx : m_nodePool->getNodeIdx(bestNode);
-			neighbourNode->id = neighbourRef;
-			neighbourNode->flags = (neighbourNode->flags & ~(DT_NODE_CLOSED | DT_NODE_PARENT_DETACHED));
-			neighbourNode->cost = cost;
-			neighbourNode->total = total;
-			if (foundShortCut)
-				neighbourNode->flags = (neighbourNode->flags | DT_NODE_PARENT_DETACHED);
-			
-			if (neighbourNode->flags & DT_NODE_OPEN)
+	dtStatus status = DT_SUCCESS | (searchStatus & DT_OUT_OF_NODES);
+	int n = 0;
+	path[n++] = startRef;
+	dtPolyRef curRef = startRef;
+	float curPos[3];
+	dtVcopy(curPos, startPos);
+	const dtTilePortal* prevPortal = 0;
+
+	for (int i = routeCount - 1; i >= -1; --i)
+	{
+		// The end point comes last.
+		dtPolyRef targetRef = endRef;
+		const float* targetPos = endPos;
+		const dtTilePortal* portal = 0;
+		if (i >= 0)
+		{
+			const int tileIndex = (int)(route[i] >> DT_TILE_PORTAL_BITS);
+			portal = &graph->getPortals(tileIndex, &portalCount)[route[i] & (DT_MAX_TILE_PORTALS - 1)];
+			targetRef = portal->poly;
+			targetPos = portal->pos;
+		}
+
+		const bool crossing = prevPortal && portal && prevPortal->neighbour == portal->poly && prevPortal->twin >= 0 &&
+			portal->neighbour == prevPortal->poly;
+		if (crossing)
+		{
+			if (n >= maxPath)
 			{
-				// Already in open, update node location.
-				m_openList->modify(neighbourNode);
+				status |= DT_BUFFER_TOO_SMALL;
+				break;
 			}
-			else
+			path[n++] = targetRef;
+		}
+		else if (curRef != targetRef)
+		{
+			// The segment starts with the current polygon, the last one of the path.
+			int count = 0;
+			const dtStatus segmentStatus = findPath(curRef, targetRef, curPos, targetPos, filter,
+													path + n - 1, &count, maxPath - (n - 1));
+			if (dtStatusFailed(segmentStatus))
 			{
-				// Put the node in open list.
-				neighbourNode->flags |= DT_NODE_OPEN;
-				m_openList->push(neighbourNode);
+				status |= DT_PARTIAL_RESULT;
+				break;
 			}
-			
-			// Update nearest node to target so far.
-			if (heuristic < m_query.lastBestNodeCost)
+			n += count - 1;
+			if (dtStatusDetail(segmentStatus, DT_BUFFER_TOO_SMALL | DT_PARTIAL_RESULT))
 			{
-				m_query.lastBestNodeCost = heuristic;
-				m_query.lastBestNode = neighbourNode;
+				status |= segmentStatus & (DT_BUFFER_TOO_SMALL | DT_PARTIAL_RESULT);
+				break;
 			}
 		}
+
+		curRef = targetRef;
+		dtVcopy(curPos, targetPos);
+		prevPortal = portal;
 	}
+
+	*pathCount = n;
+	return status;
+}
+
+
+/// @par
+///
+/// @warning Calling any non-slice methods before calling finalizeSlicedFindPath() 
+/// or finalizeSlicedFindPathPartial() may result in corrupted data!
+///
+/// The @p filter pointer is stored and used for the duration of the sliced
+/// path query.
+///
+dtStatus dtNavMeshQuery::initSlicedFindPath(dtPolyRef startRef, dtPolyRef endRef,
+											const float* startPos, const float* endPos,
+											const dtQueryFilter* filter, const unsigned int options)
+{
+	dtAssert(m_nav);
+	dtAssert(m_nodePool);
+	dtAssert(m_openList);
+
+	// Init path state.
+	memset(&m_query, 0, sizeof(dtQueryData));
+	m_query.status = DT_FAILURE;
+	m_query.startRef = startRef;
+	m_query.endRef = endRef;
+	if (startPos)
+		dtVcopy(m_query.startPos, startPos);
+	if (endPos)
+		dtVcopy(m_query.endPos, endPos);
+	m_query.filter = filter;
+	m_query.options = options;
+	m_query.raycastLimitSqr = FLT_MAX;
 	
-	// Exhausted all nodes, but could not find path.
-	if (m_openList->empty())
+	// Validate input
+	if (!m_nav->isValidPolyRef(startRef) || !m_nav->isValidPolyRef(endRef) ||
+		!startPos || !dtVisfinite(startPos) ||
+		!endPos || !dtVisfinite(endPos) || !filter)
 	{
-		const dtStatus details = m_query.status & DT_STATUS_DETAIL_MASK;
-		m_query.status = DT_SUCCESS | details;
+		return DT_FAILURE | DT_INVALID_PARAM;
 	}
 
-	if (doneIters)
-		*doneIters = iter;
+	// trade quality with performance?
+	if (options & DT_FINDPATH_ANY_ANGLE)
+	{
+		// limiting to several times the character radius yields nice results. It is not sensitive 
+		// so it is enough to compute it from the first tile.
+		const dtMeshTile* tile = m_nav->getTileByRef(startRef);
+		float agentRadius = tile->header->walkableRadius;
+		m_query.raycastLimitSqr = dtSqr(agentRadius * DT_RAY_CAST_LIMIT_PROPORTIONS);
+	}
 
+	if (startRef == endRef)
+	{
+		m_query.status = DT_SUCCESS;
+		return DT_SUCCESS;
+	}
+	
+	m_nodePool->clear();
+	m_openList->clear();
+	// The any-angle shortcuts are shorter than the portal steps the landmark table measures.
+	if (options & DT_FINDPATH_ANY_ANGLE)
+		m_query.landmarkGoal.ref = 0;
+	else
+		initLandmarkGoal(endRef, endPos, filter, &m_query.landmarkGoal);
+	
+	dtNode* startNode = m_nodePool->getNode(startRef);
+	dtVcopy(startNode->pos, startPos);
+	startNode->pidx = 0;
+	startNode->cost = 0;
+	startNode->total = dtVdist(startPos, endPos) * DT_HEURISTIC_SCALE;
+	startNode->id = startRef;
+	startNode->flags = DT_NODE_OPEN;
+	m_openList->push(startNode);
+	
+	m_query.status = DT_IN_PROGRESS;
+	m_query.lastBestNode = startNode;
+	m_query.lastBestNodeCost = startNode->total;
+	
 	return m_query.status;
 }
+	
+dtStatus dtNavMeshQuery::updateSlicedFindPath(const int maxIter, int* doneIters)
+{
+	return updateSlicedFindPathWithFilter(m_query.filter, maxIter, doneIters);
+}
 
 dtStatus dtNavMeshQuery::finalizeSlicedFindPath(dtPolyRef* path, int* pathCount, const int maxPath)
 {
@@ -2328,6 +2558,38 @@ dtStatus dtNavMeshQuery::getPortalPoints(dtPolyRef from, const dtPoly* fromPoly,
 	return DT_SUCCESS;
 }
 
+void dtNavMeshQuery::initLandmarkGoal(dtPolyRef endRef, const float* endPos, const dtQueryFilter* filter,
+									  dtLandmarkGoal* goal) const
+{
+	goal->ref = 0;
+	if (!m_landmarks || !m_landmarks->isValid(m_nav))
+		return;
+
+	// The table measures distances, a path costs at least its length times the cheapest area.
+	float minAreaCost = FLT_MAX;
+	for (int i = 0; i < DT_MAX_AREAS; ++i)
+		minAreaCost = dtMin(minAreaCost, filter->getAreaCost(i));
+	if (!(minAreaCost > 0.0f))
+		return;
+
+	m_landmarks->initGoal(endRef, endPos, goal);
+	goal->costScale = minAreaCost;
+}
+
+/// @par
+///
+/// The straight-line heuristic still decides which node is nearest to the end for the partial paths.
+/// The landmark bound is scaled by the smallest area cost of the filter, it stays a lower bound
+/// as long as the filter costs a move at least its length times the area cost.
+float dtNavMeshQuery::estimateCostToEnd(dtPolyRef ref, const float* pos, const dtLandmarkGoal& goal,
+										const float heuristic) const
+{
+	// The table may have been invalidated by a tile change during a sliced query.
+	if (heuristic <= 0.0f || !goal.ref || !m_landmarks || !m_landmarks->isValid(m_nav))
+		return heuristic;
+	return dtMax(heuristic, m_landmarks->getLowerBound(ref, pos, goal) * DT_HEURISTIC_SCALE);
+}
+
 // Returns edge mid point between two polygons.
 dtStatus dtNavMeshQuery::getEdgeMidPoint(dtPolyRef from, dtPolyRef to, float* mid) const
 {
@@ -2414,6 +2676,215 @@ dtStatus dtNavMeshQuery::raycast(dtPolyRef startRef, const float* startPos, cons
 }
 
 
+// State of a ray between the polygons of raycast().
+struct dtRaycastRay
+{
+	dtPolyRef curRef;
+	dtPolyRef prevRef;
+	const dtMeshTile* prevTile, *tile, *nextTile;
+	const dtPoly* prevPoly, *poly, *nextPoly;
+	float curPos[3];		// Where the ray entered the current polygon, for the costs.
+	int n;					// Number of visited polygons.
+	dtStatus status;
+};
+
+// Max rays advanced together by raycasts(), the rays in the same polygon are found in the packet.
+static const int MAX_RAYCAST_PACKET = 64;
+
+static void initRaycastRay(const dtNavMesh* nav, dtPolyRef startRef, const float* startPos, dtPolyRef prevRef, dtRaycastRay& ray)
+{
+	// The API input has been checked already, skip checking internal data.
+	ray.curRef = startRef;
+	ray.prevRef = prevRef;
+	ray.tile = 0;
+	ray.poly = 0;
+	nav->getTileAndPolyByRefUnsafe(startRef, &ray.tile, &ray.poly);
+	ray.nextTile = ray.prevTile = ray.tile;
+	ray.nextPoly = ray.prevPoly = ray.poly;
+	if (prevRef)
+		nav->getTileAndPolyByRefUnsafe(prevRef, &ray.prevTile, &ray.prevPoly);
+	dtVcopy(ray.curPos, startPos);
+	ray.n = 0;
+	ray.status = DT_SUCCESS;
+}
+
+static int getRaycastPolyVerts(const dtMeshTile* tile, const dtPoly* poly, float* verts)
+{
+	// Collect vertices.
+	int nv = 0;
+	for (int i = 0; i < (int)poly->vertCount; ++i)
+	{
+		dtVcopy(&verts[nv*3], &tile->verts[poly->verts[i]*3]);
+		nv++;
+	}
+	return nv;
+}
+
+// Moves the ray past its current polygon, which it leaves at tmax through the edge segMax (see dtIntersectSegmentPoly2D).
+// Returns true if the ray goes on in the next polygon, false when the hit is complete.
+static bool advanceRaycastRay(const dtNavMesh* nav, const float* startPos, const float* endPos,
+							  const dtQueryFilter* filter, const unsigned int options,
+							  const float* verts, const int nv, const float tmax, const int segMax,
+							  dtRaycastRay& ray, dtRaycastHit* hit)
+{
+	const dtMeshTile* tile = ray.tile;
+	const dtPoly* poly = ray.poly;
+
+	hit->hitEdgeIndex = segMax;
+
+	// Keep track of furthest t so far.
+	if (tmax > hit->t)
+		hit->t = tmax;
+	
+	// Store visited polygons.
+	if (ray.n < hit->maxPath)
+		hit->path[ray.n++] = ray.curRef;
+	else
+		ray.status |= DT_BUFFER_TOO_SMALL;
+
+	// Ray end is completely inside the polygon.
+	if (segMax == -1)
+	{
+		hit->t = FLT_MAX;
+		hit->pathCount = ray.n;
+		
+		// add the cost
+		if (options & DT_RAYCAST_USE_COSTS)
+			hit->pathCost += filter->getCost(ray.curPos, endPos, ray.prevRef, ray.prevTile, ray.prevPoly, ray.curRef, tile, poly, ray.curRef, tile, poly);
+		return false;
+	}
+
+	// Follow neighbours.
+	dtPolyRef nextRef = 0;
+	
+	for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+	{
+		const dtLink* link = &tile->links[i];
+		
+		// Find link which contains this edge.
+		if ((int)link->edge != segMax)
+			continue;
+		
+		// Get pointer to the next polygon.
+		ray.nextTile = 0;
+		ray.nextPoly = 0;
+		nav->getTileAndPolyByRefUnsafe(link->ref, &ray.nextTile, &ray.nextPoly);
+		
+		// Skip off-mesh connections.
+		if (ray.nextPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+			continue;
+		
+		// Skip links based on filter.
+		if (!filter->passFilter(link->ref, ray.nextTile, ray.nextPoly))
+			continue;
+		
+		// If the link is internal, just return the ref.
+		if (link->side == 0xff)
+		{
+			nextRef = link->ref;
+			break;
+		}
+		
+		// If the link is at tile boundary,
+		
+		// Check if the link spans the whole edge, and accept.
+		if (link->bmin == 0 && link->bmax == 255)
+		{
+			nextRef = link->ref;
+			break;
+		}
+		
+		// Check for partial edge links.
+		const int v0 = poly->verts[link->edge];
+		const int v1 = poly->verts[(link->edge+1) % poly->vertCount];
+		const float* left = &tile->verts[v0*3];
+		const float* right = &tile->verts[v1*3];
+		
+		// Check that the intersection lies inside the link portal.
+		if (link->side == 0 || link->side == 4)
+		{
+			// Calculate link size.
+			const float s = 1.0f/255.0f;
+			float lmin = left[2] + (right[2] - left[2])*(link->bmin*s);
+			float lmax = left[2] + (right[2] - left[2])*(link->bmax*s);
+			if (lmin > lmax) dtSwap(lmin, lmax);
+			
+			// Find Z intersection.
+			float z = startPos[2] + (endPos[2]-startPos[2])*tmax;
+			if (z >= lmin && z <= lmax)
+			{
+				nextRef = link->ref;
+				break;
+			}
+		}
+		else if (link->side == 2 || link->side == 6)
+		{
+			// Calculate link size.
+			const float s = 1.0f/255.0f;
+			float lmin = left[0] + (right[0] - left[0])*(link->bmin*s);
+			float lmax = left[0] + (right[0] - left[0])*(link->bmax*s);
+			if (lmin > lmax) dtSwap(lmin, lmax);
+			
+			// Find X intersection.
+			float x = startPos[0] + (endPos[0]-startPos[0])*tmax;
+			if (x >= lmin && x <= lmax)
+			{
+				nextRef = link->ref;
+				break;
+			}
+		}
+	}
+	
+	// add the cost
+	if (options & DT_RAYCAST_USE_COSTS)
+	{
+		// compute the intersection point at the furthest end of the polygon
+		// and correct the height (since the raycast moves in 2d)
+		float dir[3], lastPos[3];
+		dtVsub(dir, endPos, startPos);
+		dtVcopy(lastPos, ray.curPos);
+		dtVmad(ray.curPos, startPos, dir, hit->t);
+		const float* e1 = &verts[segMax*3];
+		const float* e2 = &verts[((segMax+1)%nv)*3];
+		float eDir[3], diff[3];
+		dtVsub(eDir, e2, e1);
+		dtVsub(diff, ray.curPos, e1);
+		float s = dtSqr(eDir[0]) > dtSqr(eDir[2]) ? diff[0] / eDir[0] : diff[2] / eDir[2];
+		ray.curPos[1] = e1[1] + eDir[1] * s;
+
+		hit->pathCost += filter->getCost(lastPos, ray.curPos, ray.prevRef, ray.prevTile, ray.prevPoly, ray.curRef, tile, poly, nextRef, ray.nextTile, ray.nextPoly);
+	}
+
+	if (!nextRef)
+	{
+		// No neighbour, we hit a wall.
+		
+		// Calculate hit normal.
+		const int a = segMax;
+		const int b = segMax+1 < nv ? segMax+1 : 0;
+		const float* va = &verts[a*3];
+		const float* vb = &verts[b*3];
+		const float dx = vb[0] - va[0];
+		const float dz = vb[2] - va[2];
+		hit->hitNormal[0] = dz;
+		hit->hitNormal[1] = 0;
+		hit->hitNormal[2] = -dx;
+		dtVnormalize(hit->hitNormal);
+		
+		hit->pathCount = ray.n;
+		return false;
+	}
+
+	// No hit, advance to neighbour polygon.
+	ray.prevRef = ray.curRef;
+	ray.curRef = nextRef;
+	ray.prevTile = tile;
+	ray.tile = ray.nextTile;
+	ray.prevPoly = poly;
+	ray.poly = ray.nextPoly;
+	return true;
+}
+
 /// @par
 ///
 /// This method is meant to be used for quick, short distance checks.
@@ -2475,205 +2946,156 @@ dtStatus dtNavMeshQuery::raycast(dtPolyRef startRef, const float* startPos, cons
 		return DT_FAILURE | DT_INVALID_PARAM;
 	}
 	
-	float dir[3], curPos[3], lastPos[3];
-	float verts[DT_VERTS_PER_POLYGON*3+3];	
-	int n = 0;
-
-	dtVcopy(curPos, startPos);
-	dtVsub(dir, endPos, startPos);
+	dtRaycastRay ray;
+	initRaycastRay(m_nav, startRef, startPos, prevRef, ray);
 	dtVset(hit->hitNormal, 0, 0, 0);
 
-	dtStatus status = DT_SUCCESS;
-
-	const dtMeshTile* prevTile, *tile, *nextTile;
-	const dtPoly* prevPoly, *poly, *nextPoly;
-	dtPolyRef curRef;
-
-	// The API input has been checked already, skip checking internal data.
-	curRef = startRef;
-	tile = 0;
-	poly = 0;
-	m_nav->getTileAndPolyByRefUnsafe(curRef, &tile, &poly);
-	nextTile = prevTile = tile;
-	nextPoly = prevPoly = poly;
-	if (prevRef)
-		m_nav->getTileAndPolyByRefUnsafe(prevRef, &prevTile, &prevPoly);
+	float verts[DT_VERTS_PER_POLYGON*3+3];
 
-	while (curRef)
+	while (ray.curRef)
 	{
 		// Cast ray against current polygon.
-		
-		// Collect vertices.
-		int nv = 0;
-		for (int i = 0; i < (int)poly->vertCount; ++i)
-		{
-			dtVcopy(&verts[nv*3], &tile->verts[poly->verts[i]*3]);
-			nv++;
-		}
+		const int nv = getRaycastPolyVerts(ray.tile, ray.poly, verts);
 		
 		float tmin, tmax;
 		int segMin, segMax;
 		if (!dtIntersectSegmentPoly2D(startPos, endPos, verts, nv, tmin, tmax, segMin, segMax))
 		{
 			// Could not hit the polygon, keep the old t and report hit.
-			hit->pathCount = n;
-			return status;
+			hit->pathCount = ray.n;
+			return ray.status;
 		}
 
-		hit->hitEdgeIndex = segMax;
+		if (!advanceRaycastRay(m_nav, startPos, endPos, filter, options, verts, nv, tmax, segMax, ray, hit))
+			return ray.status;
+	}
+	
+	hit->pathCount = ray.n;
+	
+	return ray.status;
+}
 
-		// Keep track of furthest t so far.
-		if (tmax > hit->t)
-			hit->t = tmax;
-		
-		// Store visited polygons.
-		if (n < hit->maxPath)
-			hit->path[n++] = curRef;
-		else
-			status |= DT_BUFFER_TOO_SMALL;
+/// @par
+///
+/// The rays are advanced in packets of consecutive rays, one polygon at a time. At each step the
+/// rays of the packet in the same polygon are intersected with it together, four at a time.
+/// (See: #dtIntersectSegmentsPoly2D4) The rays sharing polygons should be next to each other,
+/// for example the rays from the same start point.
+/// The hits are the same as the ones of #raycast for each ray.
+///
+/// The @p path and @p maxPath of each hit must be set by the caller, as with #raycast.
+///
+dtStatus dtNavMeshQuery::raycasts(const dtPolyRef* startRefs, const float* startPos, const float* endPos, const int count,
+								  const dtQueryFilter* filter, const unsigned int options,
+								  dtRaycastHit* hits, const dtPolyRef* prevRefs) const
+{
+	dtAssert(m_nav);
+
+	if (!hits || count < 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
 
-		// Ray end is completely inside the polygon.
-		if (segMax == -1)
+	for (int i = 0; i < count; ++i)
+	{
+		hits[i].t = 0;
+		hits[i].pathCount = 0;
+		hits[i].pathCost = 0;
+	}
+
+	// Validate input
+	if (!startRefs || !startPos || !endPos || !filter)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	for (int i = 0; i < count; ++i)
+	{
+		if (!m_nav->isValidPolyRef(startRefs[i]) ||
+			!dtVisfinite(&startPos[i*3]) || !dtVisfinite(&endPos[i*3]) ||
+			(prevRefs && prevRefs[i] && !m_nav->isValidPolyRef(prevRefs[i])))
 		{
-			hit->t = FLT_MAX;
-			hit->pathCount = n;
-			
-			// add the cost
-			if (options & DT_RAYCAST_USE_COSTS)
-				hit->pathCost += filter->getCost(curPos, endPos, prevRef, prevTile, prevPoly, curRef, tile, poly, curRef, tile, poly);
-			return status;
+			return DT_FAILURE | DT_INVALID_PARAM;
 		}
+	}
 
-		// Follow neighbours.
-		dtPolyRef nextRef = 0;
-		
-		for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+	dtStatus status = DT_SUCCESS;
+	float verts[DT_VERTS_PER_POLYGON*3+3];
+	dtRaycastRay rays[MAX_RAYCAST_PACKET];
+	int active[MAX_RAYCAST_PACKET];
+	int next[MAX_RAYCAST_PACKET];
+
+	for (int first = 0; first < count; first += MAX_RAYCAST_PACKET)
+	{
+		// The rays of a packet travel together, one polygon per step.
+		int nactive = dtMin(count - first, MAX_RAYCAST_PACKET);
+		for (int i = 0; i < nactive; ++i)
 		{
-			const dtLink* link = &tile->links[i];
-			
-			// Find link which contains this edge.
-			if ((int)link->edge != segMax)
-				continue;
-			
-			// Get pointer to the next polygon.
-			nextTile = 0;
-			nextPoly = 0;
-			m_nav->getTileAndPolyByRefUnsafe(link->ref, &nextTile, &nextPoly);
-			
-			// Skip off-mesh connections.
-			if (nextPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
-				continue;
-			
-			// Skip links based on filter.
-			if (!filter->passFilter(link->ref, nextTile, nextPoly))
-				continue;
-			
-			// If the link is internal, just return the ref.
-			if (link->side == 0xff)
-			{
-				nextRef = link->ref;
-				break;
-			}
-			
-			// If the link is at tile boundary,
-			
-			// Check if the link spans the whole edge, and accept.
-			if (link->bmin == 0 && link->bmax == 255)
-			{
-				nextRef = link->ref;
-				break;
-			}
-			
-			// Check for partial edge links.
-			const int v0 = poly->verts[link->edge];
-			const int v1 = poly->verts[(link->edge+1) % poly->vertCount];
-			const float* left = &tile->verts[v0*3];
-			const float* right = &tile->verts[v1*3];
-			
-			// Check that the intersection lies inside the link portal.
-			if (link->side == 0 || link->side == 4)
+			const int r = first + i;
+			initRaycastRay(m_nav, startRefs[r], &startPos[r*3], prevRefs ? prevRefs[r] : 0, rays[i]);
+			dtVset(hits[r].hitNormal, 0, 0, 0);
+			active[i] = i;
+		}
+
+		while (nactive > 0)
+		{
+			int nnext = 0;
+			for (int begin = 0; begin < nactive; )
 			{
-				// Calculate link size.
-				const float s = 1.0f/255.0f;
-				float lmin = left[2] + (right[2] - left[2])*(link->bmin*s);
-				float lmax = left[2] + (right[2] - left[2])*(link->bmax*s);
-				if (lmin > lmax) dtSwap(lmin, lmax);
-				
-				// Find Z intersection.
-				float z = startPos[2] + (endPos[2]-startPos[2])*tmax;
-				if (z >= lmin && z <= lmax)
+				// Move the rays in the polygon of the first ray next to it.
+				const dtPolyRef ref = rays[active[begin]].curRef;
+				int end = begin + 1;
+				for (int j = end; j < nactive; ++j)
 				{
-					nextRef = link->ref;
-					break;
+					if (rays[active[j]].curRef == ref)
+						dtSwap(active[end++], active[j]);
 				}
-			}
-			else if (link->side == 2 || link->side == 6)
-			{
-				// Calculate link size.
-				const float s = 1.0f/255.0f;
-				float lmin = left[0] + (right[0] - left[0])*(link->bmin*s);
-				float lmax = left[0] + (right[0] - left[0])*(link->bmax*s);
-				if (lmin > lmax) dtSwap(lmin, lmax);
-				
-				// Find X intersection.
-				float x = startPos[0] + (endPos[0]-startPos[0])*tmax;
-				if (x >= lmin && x <= lmax)
+
+				const dtRaycastRay& head = rays[active[begin]];
+				const int nv = getRaycastPolyVerts(head.tile, head.poly, verts);
+
+				for (int i = begin; i < end; i += 4)
 				{
-					nextRef = link->ref;
-					break;
+					const int nrays = dtMin(4, end - i);
+					float p0x[4], p0z[4], p1x[4], p1z[4];
+					for (int k = 0; k < 4; ++k)
+					{
+						const int r = first + active[i + dtMin(k, nrays-1)];
+						p0x[k] = startPos[r*3+0];
+						p0z[k] = startPos[r*3+2];
+						p1x[k] = endPos[r*3+0];
+						p1z[k] = endPos[r*3+2];
+					}
+
+					float tmin[4], tmax[4];
+					int segMin[4], segMax[4];
+					const unsigned int mask = dtIntersectSegmentsPoly2D4(p0x, p0z, p1x, p1z, verts, nv, tmin, tmax, segMin, segMax);
+
+					for (int k = 0; k < nrays; ++k)
+					{
+						const int r = first + active[i + k];
+						dtRaycastRay& ray = rays[active[i + k]];
+						dtRaycastHit* hit = &hits[r];
+						if (!(mask & (1u << k)))
+						{
+							// Could not hit the polygon, keep the old t and report hit.
+							hit->pathCount = ray.n;
+							status |= ray.status;
+						}
+						else if (advanceRaycastRay(m_nav, &startPos[r*3], &endPos[r*3], filter, options, verts, nv, tmax[k], segMax[k], ray, hit))
+						{
+							next[nnext++] = active[i + k];
+						}
+						else
+						{
+							status |= ray.status;
+						}
+					}
 				}
-			}
-		}
-		
-		// add the cost
-		if (options & DT_RAYCAST_USE_COSTS)
-		{
-			// compute the intersection point at the furthest end of the polygon
-			// and correct the height (since the raycast moves in 2d)
-			dtVcopy(lastPos, curPos);
-			dtVmad(curPos, startPos, dir, hit->t);
-			float* e1 = &verts[segMax*3];
-			float* e2 = &verts[((segMax+1)%nv)*3];
-			float eDir[3], diff[3];
-			dtVsub(eDir, e2, e1);
-			dtVsub(diff, curPos, e1);
-			float s = dtSqr(eDir[0]) > dtSqr(eDir[2]) ? diff[0] / eDir[0] : diff[2] / eDir[2];
-			curPos[1] = e1[1] + eDir[1] * s;
 
-			hit->pathCost += filter->getCost(lastPos, curPos, prevRef, prevTile, prevPoly, curRef, tile, poly, nextRef, nextTile, nextPoly);
-		}
+				begin = end;
+			}
 
-		if (!nextRef)
-		{
-			// No neighbour, we hit a wall.
-			
-			// Calculate hit normal.
-			const int a = segMax;
-			const int b = segMax+1 < nv ? segMax+1 : 0;
-			const float* va = &verts[a*3];
-			const float* vb = &verts[b*3];
-			const float dx = vb[0] - va[0];
-			const float dz = vb[2] - va[2];
-			hit->hitNormal[0] = dz;
-			hit->hitNormal[1] = 0;
-			hit->hitNormal[2] = -dx;
-			dtVnormalize(hit->hitNormal);
-			
-			hit->pathCount = n;
-			return status;
+			memcpy(active, next, sizeof(int)*nnext);
+			nactive = nnext;
 		}
-
-		// No hit, advance to neighbour polygon.
-		prevRef = curRef;
-		curRef = nextRef;
-		prevTile = tile;
-		tile = nextTile;
-		prevPoly = poly;
-		poly = nextPoly;
 	}
-	
-	hit->pathCount = n;
-	
+
 	return status;
 }
 
@@ -1,52 +1,224 @@
 ﻿#include "DetourNavMeshQuery_Nonpoint.h"
 #include "DetourNavMeshQuery.h"
+#include "DetourNavMeshQueryTemplates.h"
 #include "DetourNode.h"
+#include "DetourAlloc.h"
 
-#include <list>
-#include <unordered_set>
-#include <unordered_map>
+#include <string.h>
+#include <stdio.h>
+#include <float.h>
 
-static const float H_SCALE = 0.999f; // Search heuristic scale.
+// 在候选polygon的fan三角形中找离center最近的face，距离的计算方式与findNearestPoly相同
+class dtFindNearestFaceQuery : public dtPolyQuery
+{
+	const dtNavMeshQuery* m_query;
+	const float* m_center;
+	float m_nearestDistanceSqr;
+	dtPolyRef m_nearestRef;
+	dtPrimIndex m_nearestIdx;
+	float m_nearestPoint[3];
+
+public:
+	dtFindNearestFaceQuery(const dtNavMeshQuery* query, const float* center)
+		: m_query(query), m_center(center), m_nearestDistanceSqr(FLT_MAX), m_nearestRef(0), m_nearestIdx(DT_INVALID_PRIM_INDEX), m_nearestPoint()
+	{
+	}
+
+	dtPolyRef nearestRef() const { return m_nearestRef; }
+	dtPrimIndex nearestIdx() const { return m_nearestIdx; }
+	const float* nearestPoint() const { return m_nearestPoint; }
+
+	// 没有face BV树的tile，测试polygon BV树返回的polygon的所有face
+	void process(const dtMeshTile* tile, dtPoly** polys, dtPolyRef* refs, int count)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			for (int j = 0; j < polys[i]->vertCount - 2; ++j)
+				processFace(tile, polys[i], refs[i], j);
+		}
+	}
+
+	void processFace(const dtMeshTile* tile, const dtPoly* poly, const dtPolyRef ref, const int face)
+	{
+		int verts[3];
+		queriers::faceVertexIndices(tile, poly, face, verts);
+		float tri[9];
+		dtVcopy(&tri[0], &tile->verts[poly->verts[verts[0]]*3]);
+		dtVcopy(&tri[3], &tile->verts[poly->verts[verts[1]]*3]);
+		dtVcopy(&tri[6], &tile->verts[poly->verts[verts[2]]*3]);
+
+		float closest[3];
+		float diff[3];
+		float d;
+		if (dtPointInPolygon(m_center, tri, 3))
+		{
+			// 使用detail mesh的高度
+			dtVcopy(closest, m_center);
+			float h;
+			if (dtStatusSucceed(m_query->getPolyHeight(ref, m_center, &h)) ||
+				dtClosestHeightPointTriangle(m_center, &tri[0], &tri[3], &tri[6], h))
+			{
+				closest[1] = h;
+			}
+
+			// If a point is directly over a face and closer than
+			// climb height, favor that instead of straight line nearest point.
+			dtVsub(diff, m_center, closest);
+			d = dtAbs(diff[1]) - tile->header->walkableClimb;
+			d = d > 0 ? d*d : 0;
+		}
+		else
+		{
+			float dmin = FLT_MAX;
+			int imin = 0;
+			float tmin = 0;
+			for (int k = 0; k < 3; ++k)
+			{
+				float t;
+				const float dk = dtDistancePtSegSqr2D(m_center, &tri[k*3], &tri[((k+1)%3)*3], t);
+				if (dk < dmin)
+				{
+					dmin = dk;
+					imin = k;
+					tmin = t;
+				}
+			}
+			dtVlerp(closest, &tri[imin*3], &tri[((imin+1)%3)*3], tmin);
+
+			dtVsub(diff, m_center, closest);
+			d = dtVlenSqr(diff);
+		}
 
-dtPolyPrimitive dtPolyPrimitive::INVALID(nullptr, 0, -1);
+		if (d < m_nearestDistanceSqr)
+		{
+			dtVcopy(m_nearestPoint, closest);
+
+			m_nearestDistanceSqr = d;
+			m_nearestRef = ref;
+			m_nearestIdx = (dtPrimIndex)face;
+		}
+	}
+};
+
+// 遍历tile的face BV树，与queryPolygonsInTile相同的量化方式
+static void queryFacesInTile(const dtNavMesh* nav, const dtMeshTile* tile, const float* qmin, const float* qmax,
+	const dtQueryFilter* filter, dtFindNearestFaceQuery* query)
+{
+	dtAssert(tile->faceBvTree);
+
+	const dtBVNode* node = &tile->faceBvTree[0];
+	const dtBVNode* end = &tile->faceBvTree[tile->header->faceBvNodeCount];
+	const float* tbmin = tile->header->bmin;
+	const float* tbmax = tile->header->bmax;
+	const float qfac = tile->header->bvQuantFactor;
+
+	// Calculate quantized box
+	unsigned short bmin[3], bmax[3];
+	// dtClamp query box to world box.
+	float minx = dtClamp(qmin[0], tbmin[0], tbmax[0]) - tbmin[0];
+	float miny = dtClamp(qmin[1], tbmin[1], tbmax[1]) - tbmin[1];
+	float minz = dtClamp(qmin[2], tbmin[2], tbmax[2]) - tbmin[2];
+	float maxx = dtClamp(qmax[0], tbmin[0], tbmax[0]) - tbmin[0];
+	float maxy = dtClamp(qmax[1], tbmin[1], tbmax[1]) - tbmin[1];
+	float maxz = dtClamp(qmax[2], tbmin[2], tbmax[2]) - tbmin[2];
+	// Quantize
+	bmin[0] = (unsigned short)(qfac * minx) & 0xfffe;
+	bmin[1] = (unsigned short)(qfac * miny) & 0xfffe;
+	bmin[2] = (unsigned short)(qfac * minz) & 0xfffe;
+	bmax[0] = (unsigned short)(qfac * maxx + 1) | 1;
+	bmax[1] = (unsigned short)(qfac * maxy + 1) | 1;
+	bmax[2] = (unsigned short)(qfac * maxz + 1) | 1;
+
+	// Traverse tree
+	const dtPolyRef base = nav->getPolyRefBase(tile);
+	int lastPoly = -1;
+	bool lastPass = false;
+	while (node < end)
+	{
+		const bool overlap = dtOverlapQuantBounds(bmin, bmax, node->bmin, node->bmax);
+		const bool isLeafNode = node->i >= 0;
+
+		if (isLeafNode && overlap)
+		{
+			const int ip = node->i / DT_FACES_PER_POLYGON;
+			const dtPolyRef ref = base | (dtPolyRef)ip;
+			// 同一个polygon的face通常相邻，只过滤一次
+			if (ip != lastPoly)
+			{
+				lastPoly = ip;
+				lastPass = filter->passFilter(ref, tile, &tile->polys[ip]);
+			}
+			if (lastPass)
+				query->processFace(tile, &tile->polys[ip], ref, node->i % DT_FACES_PER_POLYGON);
+		}
+
+		if (overlap || isLeafNode)
+			node++;
+		else
+		{
+			const int escapeIndex = -node->i;
+			node += escapeIndex;
+		}
+	}
+}
 
+/// @par
+///
+/// Tiles built with dtNavMeshCreateParams::buildFaceBvTree are searched face by face,
+/// other tiles test the faces of the polygons found in the polygon BV tree.
 dtStatus dtNavMeshQuery::findNearestFace(const float* center, const float* halfExtents,
 	const dtQueryFilter* filter,
 	dtPolyFace* nearestFace, float* nearestPt) const
 {
-	dtPolyRef nearestPoly = 0;
-	float nearestPos[3];
-	if (dtStatusSucceed(findNearestPoly(center, halfExtents, filter, &nearestPoly, nearestPos)))
+	dtAssert(m_nav);
+
+	if (!nearestFace)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	if (!center || !dtVisfinite(center) ||
+		!halfExtents || !dtVisfinite(halfExtents) ||
+		!filter)
 	{
-		// 遍历polygon内部face找到包含nearestPt点的face
-		iterations::fromPolyToInternalFaces iterFaces(m_nav, nearestPoly);
-		do
-		{
-			auto face = iterFaces.next();
-			if (!face.isValid())
-				break;
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	float bmin[3], bmax[3];
+	dtVsub(bmin, center, halfExtents);
+	dtVadd(bmax, center, halfExtents);
+
+	// Find tiles the query touches.
+	int minx, miny, maxx, maxy;
+	m_nav->calcTileLoc(bmin, &minx, &miny);
+	m_nav->calcTileLoc(bmax, &maxx, &maxy);
 
-			dtPolyVertex verts[3];
-			iterations::fromFaceToVertices iterFaceVerts(face);
-			auto num_verts = iterFaceVerts.allVertices(verts, 3);
-			dtAssert(num_verts == 3);
-			float v0[3], v1[3], v2[3];
-			queriers::vertexPosition(verts[0], v0);
-			queriers::vertexPosition(verts[1], v1);
-			queriers::vertexPosition(verts[2], v2);
-
-			float s0 = dtTriArea2D(nearestPos, v0, v1);
-			float s1 = dtTriArea2D(nearestPos, v1, v2);
-			float s2 = dtTriArea2D(nearestPos, v2, v0);
-			if ((s0 * s1) >= 0 && (s0 * s2) >= 0)
+	static const int MAX_NEIS = 32;
+	const dtMeshTile* neis[MAX_NEIS];
+
+	dtFindNearestFaceQuery query(this, center);
+
+	for (int y = miny; y <= maxy; ++y)
+	{
+		for (int x = minx; x <= maxx; ++x)
+		{
+			const int nneis = m_nav->getTilesAt(x, y, neis, MAX_NEIS);
+			for (int j = 0; j < nneis; ++j)
 			{
-				*nearestFace = face;
-				if (nearestPt) dtVcopy(nearestPt, nearestPos);
-				return DT_SUCCESS;
+				if (neis[j]->faceBvTree)
+					queryFacesInTile(m_nav, neis[j], bmin, bmax, filter, &query);
+				else
+					queryPolygonsInTile(neis[j], bmin, bmax, filter, &query);
 			}
-		} while (true);
+		}
 	}
-	return DT_FAILURE;
+
+	if (!query.nearestRef())
+		return DT_FAILURE;
+
+	*nearestFace = dtPolyFace(m_nav, query.nearestRef(), query.nearestIdx());
+	if (nearestPt)
+		dtVcopy(nearestPt, query.nearestPoint());
+
+	return DT_SUCCESS;
 }
 
 dtStatus dtNavMeshQuery::findPathByRadius(const dtPolyFace& startRef, const dtPolyFace& endRef,
@@ -54,265 +226,1103 @@ dtStatus dtNavMeshQuery::findPathByRadius(const dtPolyFace& startRef, const dtPo
 	const dtQueryFilter* filter,
 	dtPolyFace* path, int* pathCount, const int maxPath,
 	dtPolyEdge* portalEdges, int* portalEdgeCount, const int maxPortalEdge,
-	const float radius
-#if DT_DEBUG_ASTAR
-	,
-	int maxIters,
-	astar::dtAstarNodeDebug* visitNodes, int& nVisitNodes, const int maxVisitNode
-#endif
-	) const
+	const float radius, const unsigned int options) const
 {
-	if (dtAbs(radius) < 0.01f)
+	return findPathByRadiusWithFilter(startRef, endRef, startPos, endPos, filter,
+		path, pathCount, maxPath, portalEdges, portalEdgeCount, maxPortalEdge, radius, options);
+}
+
+// 抽象图：走廊face离开的那条边，只看没有被剪掉的邻居，不能回到fromFace
+dtResolvedPolyFace astar::corridorNextFace(const dtResolvedPolyFace& face, const dtPolyFace& fromFace, dtResolvedPolyEdge* exitEdge)
+{
+	for (int k = 0; k < 3; ++k)
 	{
-		return DT_FAILURE;
+		dtResolvedPolyEdge edge = queriers::faceLocalEdge(face, k);
+		dtResolvedPolyFace nei = queriers::edgeRightFace(edge);
+		if (!nei.isValid() || nei == fromFace)
+			continue;
+		const dtFaceAbstraction* abstraction = queriers::faceAbstraction(nei);
+		if (abstraction && abstraction->type == DT_FACE_DEAD_END)
+			continue;
+		*exitEdge = edge;
+		return nei;
+	}
+	return dtResolvedPolyFace();
+}
+
+// face是否挨着tile内的某个死胡同区域
+bool astar::touchesDeadEnd(const dtResolvedPolyFace& face, const dtMeshTile* tile, const unsigned short region)
+{
+	for (int k = 0; k < 3; ++k)
+	{
+		dtResolvedPolyFace nei = queriers::edgeRightFace(queriers::faceLocalEdge(face, k));
+		if (!nei.isValid() || nei.tile != tile)
+			continue;
+		const dtFaceAbstraction* abstraction = queriers::faceAbstraction(nei);
+		if (abstraction && abstraction->type == DT_FACE_DEAD_END && abstraction->region == region)
+			return true;
+	}
+	return false;
+}
+
+// 同一face上更宽的类别已经以不高于total的代价到达过，新的节点不会带来更好的路径
+static bool isDominatedByWiderClass(dtNodePool* nodePool, const dtPolyFace& face,
+	const int cls, const int radiusCount, const float total)
+{
+	for (int k = cls + 1; k < radiusCount; ++k)
+	{
+		const dtNode* node = nodePool->findNode(face.polyId, (unsigned char)k, face.innerIdx);
+		if (node && (node->flags & (DT_NODE_OPEN | DT_NODE_CLOSED)) && node->total <= total)
+			return true;
 	}
-	
+	return false;
+}
+
+/// @par
+///
+/// Each node keeps the widest radius class its path fits, as the node state: a path that
+/// fits radii[k] fits every narrower radius too, so a node of class k is shared by the
+/// classes 0..k. A move the widest class does not fit only drops the node to the widest
+/// class that still fits, no expansion is repeated for the narrower ones.
+/// A node is pruned when the same face has already been reached by a wider class at a
+/// lower cost. The path of class k is the first goal node of class k or wider removed
+/// from the open list, which gives the same costs as a findPathByRadius() per radius.
+///
+/// The corridor chains of the face abstraction are not collapsed since their baked width
+/// only holds for one radius, the dead-end trees are still pruned.
+dtStatus dtNavMeshQuery::findPathByRadii(const dtPolyFace& startRef, const dtPolyFace& endRef,
+	const float* startPos, const float* endPos,
+	const dtQueryFilter* filter, const float* radii, const int radiusCount,
+	dtPolyFace* paths, int* pathCounts, const int maxPath,
+	dtPolyEdge* portalEdges, int* portalEdgeCounts, const int maxPortalEdge,
+	dtStatus* pathStatuses) const
+{
 	dtAssert(m_nav);
 	dtAssert(m_nodePool);
 	dtAssert(m_openList);
 
-	if (!pathCount || !portalEdgeCount)
+	if (!pathCounts || !portalEdgeCounts || !radii || radiusCount <= 0 || radiusCount > DT_MAX_STATES_PER_NODE)
 		return DT_FAILURE | DT_INVALID_PARAM;
 
-	*pathCount = 0;
-
-#if DT_DEBUG_ASTAR
-	int iterTimes = 0;
-	nVisitNodes = 0;
-#endif
+	for (int i = 0; i < radiusCount; ++i)
+	{
+		pathCounts[i] = 0;
+		portalEdgeCounts[i] = 0;
+		if (pathStatuses)
+			pathStatuses[i] = DT_FAILURE;
+	}
 
 	// Validate input
 	if (!startRef.isValid() || !endRef.isValid() ||
 		startRef.navmesh != m_nav || endRef.navmesh != m_nav ||
 		!startPos || !dtVisfinite(startPos) ||
 		!endPos || !dtVisfinite(endPos) ||
-		!filter || !path || maxPath <= 0 || !portalEdges || maxPortalEdge <= 0)
+		!filter || !paths || maxPath <= 0 || !portalEdges || maxPortalEdge <= 0)
 	{
 		return DT_FAILURE | DT_INVALID_PARAM;
 	}
 
+	// Same lower limit as findPathByRadius(), the classes must be sorted from the narrowest.
+	for (int i = 0; i < radiusCount; ++i)
+	{
+		if (!dtMathIsfinite(radii[i]) || radii[i] < 0.01f || (i > 0 && radii[i] < radii[i-1]))
+			return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
 	if (startRef == endRef)
 	{
-		path[0] = startRef;
-		*pathCount = 1;
+		for (int i = 0; i < radiusCount; ++i)
+		{
+			paths[i*maxPath] = startRef;
+			pathCounts[i] = 1;
+			if (pathStatuses)
+				pathStatuses[i] = DT_SUCCESS;
+		}
 		return DT_SUCCESS;
 	}
 
-#if DT_DEBUG_ASTAR
-	LOG_INFO("### findPathByRadius, startFace:%s", startRef.toString().c_str());
-#endif
-
 	m_nodePool->clear();
 	m_openList->clear();
 
-	dtNode* startNode = m_nodePool->getNode(startRef.polyId, 0, startRef.innerIdx);
+	const int widest = radiusCount - 1;
+	dtNode* startNode = m_nodePool->getNode(startRef.polyId, (unsigned char)widest, startRef.innerIdx);
 	dtVcopy(startNode->pos, startPos);
 	startNode->pidx = 0;
 	startNode->cost = 0;
-	startNode->total = dtVdist(startPos, endPos) * H_SCALE;
+	startNode->total = dtVdist(startPos, endPos) * DT_HEURISTIC_SCALE;
 	startNode->id = startRef.polyId;
 	startNode->primIdx = startRef.innerIdx;
-	startNode->entryEdge.reset();
+	m_nodePool->setEntryEdge(startNode, DT_NODE_NULL_EDGE);
 	startNode->flags = DT_NODE_OPEN;
 	m_openList->push(startNode);
 
-	dtNode* lastBestNode = startNode;
-	float lastBestNodeCost = startNode->total;
+	if (m_trace)
+		m_trace->record(debug::DT_TRACE_SEARCH_BEGIN, startRef.polyId, startRef.innerIdx, 0, startPos[0], startPos[1], startPos[2]);
+
+	dtNode* lastBestNodes[DT_MAX_STATES_PER_NODE];
+	float lastBestNodeCosts[DT_MAX_STATES_PER_NODE];
+	dtNode* endNodes[DT_MAX_STATES_PER_NODE];
+	for (int i = 0; i < radiusCount; ++i)
+	{
+		lastBestNodes[i] = startNode;
+		lastBestNodeCosts[i] = startNode->total;
+		endNodes[i] = 0;
+	}
+	const dtResolvedPolyFace resolvedEndRef(endRef);
 
-	bool outOfNodes = false;
+	// The classes are resolved from the narrowest, 'resolved' is the number of classes with a path.
+	int resolved = 0;
+	dtStatus status = 0;
 
-	while (!m_openList->empty())
+	while (!m_openList->empty() && resolved < radiusCount)
 	{
 		// Remove node from open list and put it in closed list.
 		dtNode* bestNode = m_openList->pop();
 		bestNode->flags &= ~DT_NODE_OPEN;
 		bestNode->flags |= DT_NODE_CLOSED;
 
-		dtPolyFace bestFace(m_nav, bestNode->id, bestNode->primIdx);
-		auto entryEdge = bestNode->entryEdge;
+		const dtPolyFace bestFace(m_nav, bestNode->id, bestNode->primIdx);
 
-#if DT_DEBUG_ASTAR
-		++iterTimes;
-		if (iterTimes > maxIters)
+		// Reached the goal, the node serves every class up to its own.
+		if (bestFace == endRef)
 		{
+			for (; resolved <= (int)bestNode->state; ++resolved)
+				endNodes[resolved] = bestNode;
+			continue;
+		}
+
+		// A wider class reached the face no later, it expands the same moves.
+		if (isDominatedByWiderClass(m_nodePool, bestFace, bestNode->state, radiusCount, bestNode->total))
+			continue;
+
+		status |= expandFaceNodeByRadii(bestNode, startRef, resolvedEndRef, endPos, filter, radii, radiusCount,
+			lastBestNodes, lastBestNodeCosts);
+	}
+
+	for (int i = 0; i < radiusCount; ++i)
+	{
+		dtNode* endNode = endNodes[i] ? endNodes[i] : lastBestNodes[i];
+		dtStatus pathStatus = getPathToNode(endNode, &paths[i*maxPath], &pathCounts[i], maxPath,
+			&portalEdges[i*maxPortalEdge], &portalEdgeCounts[i], maxPortalEdge);
+		pathStatus |= status;
+		if (!endNodes[i])
+			pathStatus |= DT_PARTIAL_RESULT;
+		if (pathStatuses)
+			pathStatuses[i] = pathStatus;
+		status |= pathStatus & DT_STATUS_DETAIL_MASK;
+
+		if (m_trace)
+			m_trace->record(debug::DT_TRACE_SEARCH_END, endNode->id, endNode->primIdx,
+				(unsigned short)(pathStatus & DT_STATUS_DETAIL_MASK), endNode->cost, radii[i], 0);
+	}
+
+	return DT_SUCCESS | (status & DT_STATUS_DETAIL_MASK);
+}
+
+dtStatus dtNavMeshQuery::expandFaceNodeByRadii(dtNode* bestNode,
+	const dtPolyFace& startRef, const dtResolvedPolyFace& endRef, const float* endPos,
+	const dtQueryFilter* filter, const float* radii, const int radiusCount,
+	dtNode** lastBestNodes, float* lastBestNodeCosts) const
+{
+	dtStatus status = 0;
+
+	// The face refs have been validated already, skip checking internal data.
+	const dtMeshTile* bestTile = 0;
+	const dtPoly* bestPoly = 0;
+	m_nav->getTileAndPolyByRefUnsafe(bestNode->id, &bestTile, &bestPoly);
+	dtResolvedPolyFace bestFace(m_nav, bestNode->id, bestNode->primIdx, bestTile, bestPoly);
+	const int bestClass = bestNode->state;
+
+	if (m_trace)
+		m_trace->record(debug::DT_TRACE_FACE_EXPANDED, bestFace.polyId, bestFace.innerIdx,
+			m_nodePool->getEntryEdge(bestNode), bestNode->cost, bestNode->total, radii[bestClass]);
+
+	// Get parent face, the entry edge belongs to the parent face.
+	dtResolvedPolyFace parentFace;
+	dtResolvedPolyEdge entryEdge;
+	if (bestNode->pidx)
+	{
+		auto parentNode = m_nodePool->getNodeAtIdx(bestNode->pidx);
+		const dtMeshTile* parentTile = 0;
+		const dtPoly* parentPoly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(parentNode->id, &parentTile, &parentPoly);
+		parentFace = dtResolvedPolyFace(m_nav, parentNode->id, parentNode->primIdx, parentTile, parentPoly);
+		entryEdge = parentFace.sibling(m_nodePool->getEntryEdge(bestNode));
+	}
+
+	// The dead-end tree containing the goal, if any.
+	const dtFaceAbstraction* bestAbstraction = queriers::faceAbstraction(bestFace);
+	const dtFaceAbstraction* endAbstraction = queriers::faceAbstraction(endRef);
+	const unsigned short endRegion = (endAbstraction && endAbstraction->type == DT_FACE_DEAD_END) ? endAbstraction->region : 0;
+	const bool bestDeadEnd = bestAbstraction && bestAbstraction->type == DT_FACE_DEAD_END;
+
+	iterations::fromFaceToInnerEdges iterInnerEdges(bestFace);
+
+	do
+	{
+		auto innerEdge = iterInnerEdges.next();
+		if (!innerEdge.isValid())
 			break;
+
+		auto neighbourFace = queriers::edgeRightFace(innerEdge);
+
+		// Skip invalid ids and do not expand back to where we came from.
+		if (!neighbourFace.isValid()
+			|| neighbourFace == bestFace
+			|| neighbourFace == parentFace)
+		{
+			continue;
 		}
 
-		if (visitNodes && nVisitNodes < maxVisitNode)
+		if (!filter->passFilter(neighbourFace.polyId, neighbourFace.tile, neighbourFace.poly))
+			continue;
+
+		const dtFaceAbstraction* neighbourAbstraction = queriers::faceAbstraction(neighbourFace);
+		if (neighbourAbstraction && neighbourAbstraction->type == DT_FACE_DEAD_END && !bestDeadEnd &&
+			(neighbourFace.tile != endRef.tile || neighbourAbstraction->region != endRegion))
 		{
-			auto& visit = visitNodes[nVisitNodes];
-			visit.face = bestFace;
-			dtVcopy(visit.entry_pos, bestNode->pos);
+			continue;
+		}
 
-			++nVisitNodes;
+		// 从当前类别往窄的方向找第一个能通过的半径
+		int cls = bestClass;
+		if (bestFace != startRef)
+		{
+			while (cls >= 0 && !astar::isWalkableByRadius(radii[cls], entryEdge, bestFace, innerEdge))
+			{
+				if (m_trace)
+					m_trace->record(debug::DT_TRACE_RADIUS_REJECTED, bestFace.polyId, bestFace.innerIdx,
+						(unsigned short)innerEdge.innerIdx, radii[cls], 0, 0);
+				cls--;
+			}
 		}
-#endif
+		if (cls < 0)
+			continue;
 
-		// Reached the goal, stop searching.
-		if (bestFace == endRef)
+		// Get neighbor node
+		dtNode* neighbourNode = m_nodePool->getNode(neighbourFace.polyId, (unsigned char)cls, neighbourFace.innerIdx);
+		if (!neighbourNode)
 		{
-			lastBestNode = bestNode;
-			break;
+			status |= DT_OUT_OF_NODES;
+			continue;
+		}
+
+		// If the node is visited the first time, calculate node position.
+		if (neighbourNode->flags == 0)
+		{
+			if (!geom::closestPointToEdge(bestNode->pos, innerEdge, neighbourNode->pos))
+			{
+				break;
+			}
+		}
+
+		// Calculate cost and heuristic.
+		float cost = 0;
+		float heuristic = 0;
+
+		const float curCost = filter->getCost(bestNode->pos, neighbourNode->pos,
+			parentFace.polyId, parentFace.tile, parentFace.poly,
+			bestFace.polyId, bestFace.tile, bestFace.poly,
+			neighbourFace.polyId, neighbourFace.tile, neighbourFace.poly);
+
+		// Special case for last node.
+		if (neighbourFace == endRef)
+		{
+			const float endCost = filter->getCost(neighbourNode->pos, endPos,
+				bestFace.polyId, bestFace.tile, bestFace.poly,
+				neighbourFace.polyId, neighbourFace.tile, neighbourFace.poly,
+				0, 0, 0);
+			cost = bestNode->cost + curCost + endCost;
+			heuristic = 0;
+		}
+		else
+		{
+			cost = bestNode->cost + curCost;
+			heuristic = dtVdist(neighbourNode->pos, endPos) * DT_HEURISTIC_SCALE;
+		}
+
+		const float total = cost + heuristic;
+
+		// The node is already in open list and the new result is worse, skip.
+		if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
+			continue;
+		// The node is already visited and process, and the new result is worse, skip.
+		if ((neighbourNode->flags & DT_NODE_CLOSED) && total >= neighbourNode->total)
+			continue;
+		// A wider class is already there at a lower cost.
+		if (isDominatedByWiderClass(m_nodePool, neighbourFace, cls, radiusCount, total))
+			continue;
+
+		// Add or update the node.
+		neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
+		neighbourNode->id = neighbourFace.polyId;
+		neighbourNode->primIdx = neighbourFace.innerIdx;
+		neighbourNode->flags = (neighbourNode->flags & ~DT_NODE_CLOSED);
+		m_nodePool->setEntryEdge(neighbourNode, (unsigned char)innerEdge.innerIdx);
+		neighbourNode->cost = cost;
+		neighbourNode->total = total;
+
+		if (neighbourNode->flags & DT_NODE_OPEN)
+		{
+			// Already in open, update node location.
+			m_openList->modify(neighbourNode);
+		}
+		else
+		{
+			// Put the node in open list.
+			neighbourNode->flags |= DT_NODE_OPEN;
+			m_openList->push(neighbourNode);
+		}
+
+		// Update nearest node to target so far, for every class the node serves.
+		for (int k = 0; k <= cls; ++k)
+		{
+			if (heuristic < lastBestNodeCosts[k])
+			{
+				lastBestNodeCosts[k] = heuristic;
+				lastBestNodes[k] = neighbourNode;
+			}
+		}
+	} while(true);
+
+	return status;
+}
+
+/// @par
+///
+/// Same as the sliced polygon query, the node pool and open list are shared:
+/// calling any non-slice methods before finalizeSlicedFindPathByRadius()
+/// or finalizeSlicedFindPathByRadiusPartial() may result in corrupted data!
+///
+/// The @p filter pointer is stored and used for the duration of the sliced
+/// path query.
+dtStatus dtNavMeshQuery::initSlicedFindPathByRadius(const dtPolyFace& startRef, const dtPolyFace& endRef,
+	const float* startPos, const float* endPos,
+	const dtQueryFilter* filter, const float radius)
+{
+	dtAssert(m_nav);
+	dtAssert(m_nodePool);
+	dtAssert(m_openList);
+
+	// Init path state.
+	memset(&m_query, 0, sizeof(dtQueryData));
+	m_query.status = DT_FAILURE;
+	m_query.startRef = startRef.polyId;
+	m_query.endRef = endRef.polyId;
+	m_query.startPrim = startRef.innerIdx;
+	m_query.endPrim = endRef.innerIdx;
+	if (startPos)
+		dtVcopy(m_query.startPos, startPos);
+	if (endPos)
+		dtVcopy(m_query.endPos, endPos);
+	m_query.filter = filter;
+	m_query.radius = radius;
+
+	// Validate input
+	if (dtAbs(radius) < 0.01f ||
+		!startRef.isValid() || !endRef.isValid() ||
+		startRef.navmesh != m_nav || endRef.navmesh != m_nav ||
+		!m_nav->isValidPolyRef(startRef.polyId) || !m_nav->isValidPolyRef(endRef.polyId) ||
+		!startPos || !dtVisfinite(startPos) ||
+		!endPos || !dtVisfinite(endPos) || !filter)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	if (startRef == endRef)
+	{
+		m_query.status = DT_SUCCESS;
+		return DT_SUCCESS;
+	}
+
+	m_nodePool->clear();
+	m_openList->clear();
+
+	dtNode* startNode = m_nodePool->getNode(startRef.polyId, 0, startRef.innerIdx);
+	dtVcopy(startNode->pos, startPos);
+	startNode->pidx = 0;
+	startNode->cost = 0;
+	startNode->total = dtVdist(startPos, endPos) * DT_HEURISTIC_SCALE;
+	startNode->id = startRef.polyId;
+	startNode->primIdx = startRef.innerIdx;
+	m_nodePool->setEntryEdge(startNode, DT_NODE_NULL_EDGE);
+	startNode->flags = DT_NODE_OPEN;
+	m_openList->push(startNode);
+
+	if (m_trace)
+		m_trace->record(debug::DT_TRACE_SEARCH_BEGIN, startRef.polyId, startRef.innerIdx, 0, startPos[0], startPos[1], startPos[2]);
+
+	m_query.status = DT_IN_PROGRESS;
+	m_query.lastBestNode = startNode;
+	m_query.lastBestNodeCost = startNode->total;
+
+	return m_query.status;
+}
+
+dtStatus dtNavMeshQuery::updateSlicedFindPathByRadius(const int maxIter, int* doneIters)
+{
+	return updateSlicedFindPathByRadiusWithFilter(m_query.filter, maxIter, doneIters);
+}
+
+dtStatus dtNavMeshQuery::finalizeSlicedFindPathByRadius(dtPolyFace* path, int* pathCount, const int maxPath,
+	dtPolyEdge* portalEdges, int* portalEdgeCount, const int maxPortalEdge)
+{
+	if (!pathCount || !portalEdgeCount)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	*pathCount = 0;
+	*portalEdgeCount = 0;
+
+	if (!path || maxPath <= 0 || !portalEdges || maxPortalEdge <= 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	if (dtStatusFailed(m_query.status))
+	{
+		// Reset query.
+		memset(&m_query, 0, sizeof(dtQueryData));
+		return DT_FAILURE;
+	}
+
+	if (m_query.startRef == m_query.endRef && m_query.startPrim == m_query.endPrim)
+	{
+		// Special case: the search starts and ends at same face.
+		path[0] = dtPolyFace(m_nav, m_query.startRef, m_query.startPrim);
+		*pathCount = 1;
+	}
+	else
+	{
+		dtAssert(m_query.lastBestNode);
+
+		if (m_query.lastBestNode->id != m_query.endRef || m_query.lastBestNode->primIdx != m_query.endPrim)
+			m_query.status |= DT_PARTIAL_RESULT;
+
+		m_query.status |= getPathToNode(m_query.lastBestNode, path, pathCount, maxPath,
+			portalEdges, portalEdgeCount, maxPortalEdge) & DT_STATUS_DETAIL_MASK;
+
+		if (m_trace)
+			m_trace->record(debug::DT_TRACE_SEARCH_END, m_query.lastBestNode->id, m_query.lastBestNode->primIdx,
+				(unsigned short)(m_query.status & DT_STATUS_DETAIL_MASK), m_query.lastBestNode->cost, 0, 0);
+	}
+
+	const dtStatus details = m_query.status & DT_STATUS_DETAIL_MASK;
+
+	// Reset query.
+	memset(&m_query, 0, sizeof(dtQueryData));
+
+	return DT_SUCCESS | details;
+}
+
+dtStatus dtNavMeshQuery::finalizeSlicedFindPathByRadiusPartial(const dtPolyFace* existing, const int existingSize,
+	dtPolyFace* path, int* pathCount, const int maxPath,
+	dtPolyEdge* portalEdges, int* portalEdgeCount, const int maxPortalEdge)
+{
+	if (!pathCount || !portalEdgeCount)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	*pathCount = 0;
+	*portalEdgeCount = 0;
+
+	if (!existing || existingSize <= 0 || !path || maxPath <= 0 || !portalEdges || maxPortalEdge <= 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	if (dtStatusFailed(m_query.status))
+	{
+		// Reset query.
+		memset(&m_query, 0, sizeof(dtQueryData));
+		return DT_FAILURE;
+	}
+
+	if (m_query.startRef == m_query.endRef && m_query.startPrim == m_query.endPrim)
+	{
+		// Special case: the search starts and ends at same face.
+		path[0] = dtPolyFace(m_nav, m_query.startRef, m_query.startPrim);
+		*pathCount = 1;
+	}
+	else
+	{
+		// Find furthest existing node that was visited.
+		dtNode* node = 0;
+		for (int i = existingSize-1; i >= 0; --i)
+		{
+			node = m_nodePool->findNode(existing[i].polyId, 0, existing[i].innerIdx);
+			if (node)
+				break;
+		}
+
+		if (!node)
+		{
+			m_query.status |= DT_PARTIAL_RESULT;
+			dtAssert(m_query.lastBestNode);
+			node = m_query.lastBestNode;
 		}
 
-#if DT_DEBUG_ASTAR
-		LOG_INFO("findPathByRadius, bestFace:%ld[%d]", bestFace.polyId, bestFace.innerIdx);
-#endif
+		m_query.status |= getPathToNode(node, path, pathCount, maxPath,
+			portalEdges, portalEdgeCount, maxPortalEdge) & DT_STATUS_DETAIL_MASK;
+
+		if (m_trace)
+			m_trace->record(debug::DT_TRACE_SEARCH_END, node->id, node->primIdx,
+				(unsigned short)(m_query.status & DT_STATUS_DETAIL_MASK), node->cost, 0, 0);
+	}
+
+	const dtStatus details = m_query.status & DT_STATUS_DETAIL_MASK;
+
+	// Reset query.
+	memset(&m_query, 0, sizeof(dtQueryData));
+
+	return DT_SUCCESS | details;
+}
+
+/// @par
+///
+/// Same hit parameter as raycast(): FLT_MAX if the disc reaches the end position,
+/// otherwise the center of the disc touches a wall at:
+///
+/// @code
+/// hitPoint = startPos + (endPos - startPos) * t
+/// @endcode
+///
+/// If the hit parameter is zero, the disc already overlaps a wall at the start position.
+///
+/// The walls within @p radius of the ray are found with a search over the node pool,
+/// the query is meant for short distance checks. If the node pool runs out the result
+/// is flagged with #DT_OUT_OF_NODES and walls further away may be missed.
+///
+/// Like raycast(), the check is done in 2D and the y-value of the end position is ignored.
+dtStatus dtNavMeshQuery::raycastByRadius(const dtPolyFace& startRef, const float* startPos, const float* endPos,
+	const dtQueryFilter* filter, const float radius,
+	float* t, float* hitNormal, dtPolyFace* path, int* pathCount, const int maxPath) const
+{
+	dtAssert(m_nav);
+	dtAssert(m_nodePool);
+	dtAssert(m_openList);
+
+	if (!t)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	*t = 0;
+	if (pathCount)
+		*pathCount = 0;
+
+	// Validate input
+	if (!startRef.isValid() || startRef.navmesh != m_nav ||
+		!m_nav->isValidPolyRef(startRef.polyId) ||
+		!startPos || !dtVisfinite(startPos) ||
+		!endPos || !dtVisfinite(endPos) ||
+		!filter || !(radius > 0.0f) ||
+		(path && maxPath <= 0))
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	if (hitNormal)
+		dtVset(hitNormal, 0, 0, 0);
+
+	dtStatus status = DT_SUCCESS;
+
+	// 搜索射线半径范围内的face，找到圆第一次碰到的墙
+	m_nodePool->clear();
+	m_openList->clear();
+
+	dtNode* startNode = m_nodePool->getNode(startRef.polyId, 0, startRef.innerIdx);
+	dtVcopy(startNode->pos, startPos);
+	startNode->flags = DT_NODE_OPEN;
+	m_openList->push(startNode);
+
+	const float radiusSqr = radius * radius;
+	float hitT = FLT_MAX;
+	float hitA[3], hitB[3];
+
+	while (!m_openList->empty())
+	{
+		dtNode* bestNode = m_openList->pop();
+		bestNode->flags &= ~DT_NODE_OPEN;
+		bestNode->flags |= DT_NODE_CLOSED;
 
+		// The face refs have been validated already, skip checking internal data.
 		const dtMeshTile* bestTile = 0;
 		const dtPoly* bestPoly = 0;
-		bestFace.getTileAndPoly(&bestTile, &bestPoly);
+		m_nav->getTileAndPolyByRefUnsafe(bestNode->id, &bestTile, &bestPoly);
+		dtResolvedPolyFace bestFace(m_nav, bestNode->id, bestNode->primIdx, bestTile, bestPoly);
 
-		// Get parent poly and tile.
-		dtPolyFace parentFace;
-		if (bestNode->pidx)
+		for (int k = 0; k < 3; ++k)
 		{
-			auto parentNode = m_nodePool->getNodeAtIdx(bestNode->pidx);
-			parentFace = dtPolyFace(m_nav, parentNode->id, parentNode->primIdx);
+			dtResolvedPolyEdge edge = queriers::faceLocalEdge(bestFace, k);
+			float a[3], b[3];
+			if (!queriers::edgeOriginAndDestinationPosition(edge, a, b))
+				continue;
+
+			dtResolvedPolyFace neighbourFace = queriers::edgeRightFace(edge);
+			if (!neighbourFace.isValid() ||
+				!filter->passFilter(neighbourFace.polyId, neighbourFace.tile, neighbourFace.poly))
+			{
+				// Wall, keep the first contact along the ray.
+				float edgeT;
+				if (geom::sweptCircleHitSegment2D(startPos, endPos, radius, a, b, &edgeT) && edgeT < hitT)
+				{
+					hitT = edgeT;
+					dtVcopy(hitA, a);
+					dtVcopy(hitB, b);
+				}
+				continue;
+			}
+
+			// The disc can only reach the neighbour through this edge if the edge is close enough to the ray.
+			if (geom::distanceSquaredSegmentToSegment2D(startPos, endPos, a, b) >= radiusSqr)
+				continue;
+
+			dtNode* neighbourNode = m_nodePool->getNode(neighbourFace.polyId, 0, neighbourFace.innerIdx);
+			if (!neighbourNode)
+			{
+				status |= DT_OUT_OF_NODES;
+				continue;
+			}
+			if (neighbourNode->flags != 0)
+				continue;
+
+			neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
+			neighbourNode->flags = DT_NODE_OPEN;
+			m_openList->push(neighbourNode);
 		}
+	}
 
-		const dtMeshTile* parentTile = 0;
-		const dtPoly* parentPoly = 0;
-		parentFace.getTileAndPoly(&parentTile, &parentPoly);
+	// 沿射线记录圆心经过的face，直到碰到墙的位置
+	int n = 0;
+	dtResolvedPolyFace curFace(startRef);
+	while (curFace.isValid())
+	{
+		dtResolvedPolyVertex verts[3];
+		iterations::fromFaceToVertices iterFaceVerts(curFace);
+		if (iterFaceVerts.allVertices(verts, 3) != 3)
+			break;
+
+		float tri[9];
+		for (int i = 0; i < 3; ++i)
+			queriers::vertexPosition(verts[i], &tri[i*3]);
 
-		iterations::fromFaceToInnerEdges iterInnerEdges(bestFace);
+		float tmin, tmax;
+		int segMin, segMax;
+		if (!dtIntersectSegmentPoly2D(startPos, endPos, tri, 3, tmin, tmax, segMin, segMax))
+			break;
+		if (tmin > hitT)
+			break;
 
-		do 
+		if (path)
 		{
-			auto innerEdge = iterInnerEdges.next();
-			if (!innerEdge.isValid())
+			if (n >= maxPath)
+			{
+				status |= DT_BUFFER_TOO_SMALL;
 				break;
+			}
+			path[n] = curFace;
+		}
+		n++;
+
+		// Ray end is inside the face, or the disc stops inside it.
+		if (segMax == -1 || tmax >= hitT)
+			break;
+
+		dtResolvedPolyFace nextFace = queriers::edgeRightFace(queriers::faceLocalEdge(curFace, segMax));
+		if (!nextFace.isValid() ||
+			!filter->passFilter(nextFace.polyId, nextFace.tile, nextFace.poly))
+			break;
+		curFace = nextFace;
+	}
+
+	if (pathCount)
+		*pathCount = path ? n : 0;
+
+	*t = hitT;
+
+	if (hitT < FLT_MAX && hitNormal)
+	{
+		// Normal from the closest point of the wall toward the center of the disc.
+		float hitPos[3], closest[3];
+		dtVlerp(hitPos, startPos, endPos, hitT);
+		float u;
+		dtDistancePtSegSqr2D(hitPos, hitA, hitB, u);
+		dtVlerp(closest, hitA, hitB, u);
+		dtVsub(hitNormal, hitPos, closest);
+		hitNormal[1] = 0;
+		if (dtVlenSqr(hitNormal) < 1e-8f)
+		{
+			hitNormal[0] = hitB[2] - hitA[2];
+			hitNormal[2] = -(hitB[0] - hitA[0]);
+			float toStart[3];
+			dtVsub(toStart, startPos, closest);
+			if (dtVdot2D(hitNormal, toStart) < 0)
+				dtVscale(hitNormal, hitNormal, -1.0f);
+		}
+		dtVnormalize(hitNormal);
+	}
+
+	return status;
+}
+
+static void triangleCenter(const float* tri, float* center)
+{
+	dtVadd(center, &tri[0], &tri[3]);
+	dtVadd(center, center, &tri[6]);
+	dtVscale(center, center, 1.0f / 3.0f);
+}
+
+// Stores a wall segment and its normal pointing toward the center of the face owning it.
+static void addWall(const float* a, const float* b, const float* center, float* walls, int& nwalls, const int maxWalls)
+{
+	if (nwalls >= maxWalls)
+		return;
+
+	float* w = &walls[nwalls*9];
+	dtVcopy(&w[0], a);
+	dtVcopy(&w[3], b);
+	w[6] = b[2] - a[2];
+	w[7] = 0;
+	w[8] = -(b[0] - a[0]);
+	float toCenter[3];
+	dtVsub(toCenter, center, a);
+	if (dtVdot2D(&w[6], toCenter) < 0)
+		dtVscale(&w[6], &w[6], -1.0f);
+	dtVnormalize(&w[6]);
+	nwalls++;
+}
+
+// Stores the walls of a face which are inside the search circle.
+static void addFaceWalls(const dtResolvedPolyFace& face, const dtQueryFilter* filter,
+	const float* searchPos, const float searchRadSqr, float* walls, int& nwalls, const int maxWalls)
+{
+	dtResolvedPolyVertex verts[3];
+	iterations::fromFaceToVertices iterFaceVerts(face);
+	if (iterFaceVerts.allVertices(verts, 3) != 3)
+		return;
+
+	float tri[9], center[3];
+	for (int i = 0; i < 3; ++i)
+		queriers::vertexPosition(verts[i], &tri[i*3]);
+	triangleCenter(tri, center);
+
+	for (int k = 0; k < 3; ++k)
+	{
+		dtResolvedPolyEdge edge = queriers::faceLocalEdge(face, k);
+		float a[3], b[3];
+		if (!queriers::edgeOriginAndDestinationPosition(edge, a, b))
+			continue;
+
+		dtResolvedPolyFace neighbourFace = queriers::edgeRightFace(edge);
+		if (neighbourFace.isValid() &&
+			filter->passFilter(neighbourFace.polyId, neighbourFace.tile, neighbourFace.poly))
+			continue;
+
+		float tseg;
+		if (dtDistancePtSegSqr2D(searchPos, a, b, tseg) <= searchRadSqr)
+			addWall(a, b, center, walls, nwalls, maxWalls);
+	}
+}
+
+// Deepest penetration of a disc into the walls, walls are stored as segment start, segment end and normal.
+static float wallPenetration(const float* pos, const float* walls, const int nwalls, const float radius)
+{
+	float maxPenetration = 0.0f;
+	for (int i = 0; i < nwalls; ++i)
+	{
+		const float* w = &walls[i*9];
+		float tseg;
+		const float dist = dtMathSqrtf(dtDistancePtSegSqr2D(pos, &w[0], &w[3], tseg));
+		maxPenetration = dtMax(maxPenetration, radius - dist);
+	}
+	return maxPenetration;
+}
+
+dtStatus dtNavMeshQuery::moveAlongSurfaceByRadius(const dtPolyFace& startRef, const float* startPos, const float* endPos,
+	const dtQueryFilter* filter, const float radius,
+	float* resultPos, dtPolyFace* visited, int* visitedCount, const int maxVisitedSize) const
+{
+	dtAssert(m_nav);
+	dtAssert(m_tinyNodePool);
+
+	if (!visitedCount)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	*visitedCount = 0;
+
+	// Validate input
+	if (!startRef.isValid() || startRef.navmesh != m_nav ||
+		!m_nav->isValidPolyRef(startRef.polyId) ||
+		!startPos || !dtVisfinite(startPos) ||
+		!endPos || !dtVisfinite(endPos) ||
+		!filter || !(radius >= 0.0f) || !resultPos || !visited ||
+		maxVisitedSize <= 0)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	dtStatus status = DT_SUCCESS;
+
+	// 每帧每个单位都会调用，只使用固定大小的栈和m_tinyNodePool，不分配内存
+	static const int MAX_STACK = 48;
+	dtNode* stack[MAX_STACK];
+	int nstack = 0;
+
+	// Walls near the move, stored as segment start, segment end and the normal pointing into the face.
+	static const int MAX_WALLS = 32;
+	float walls[MAX_WALLS*9];
+	int nwalls = 0;
+
+	m_tinyNodePool->clear();
+
+	dtNode* startNode = m_tinyNodePool->getNode(startRef.polyId, 0, startRef.innerIdx);
+	startNode->pidx = 0;
+	startNode->cost = 0;
+	startNode->total = 0;
+	startNode->flags = DT_NODE_CLOSED;
+	stack[nstack++] = startNode;
+
+	float bestPos[3];
+	float bestDist = FLT_MAX;
+	dtNode* bestNode = 0;
+	bool endInside = false;
+	dtVcopy(bestPos, startPos);
+
+	// Search constraints, the walls within one radius of the move are needed too.
+	float searchPos[3];
+	dtVlerp(searchPos, startPos, endPos, 0.5f);
+	const float searchRad = dtVdist(startPos, endPos)*0.5f + 0.001f;
+	const float searchRadSqr = dtSqr(searchRad + radius);
+
+	while (nstack)
+	{
+		// Pop front.
+		dtNode* curNode = stack[0];
+		for (int i = 0; i < nstack-1; ++i)
+			stack[i] = stack[i+1];
+		nstack--;
+
+		// The face refs have been validated already, skip checking internal data.
+		const dtMeshTile* curTile = 0;
+		const dtPoly* curPoly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(curNode->id, &curTile, &curPoly);
+		dtResolvedPolyFace curFace(m_nav, curNode->id, curNode->primIdx, curTile, curPoly);
+
+		dtResolvedPolyVertex verts[3];
+		iterations::fromFaceToVertices iterFaceVerts(curFace);
+		if (iterFaceVerts.allVertices(verts, 3) != 3)
+			continue;
+
+		float tri[9];
+		for (int i = 0; i < 3; ++i)
+			queriers::vertexPosition(verts[i], &tri[i*3]);
+
+		// 终点在face内，继续搜索以收集终点附近的墙
+		if (!endInside && dtPointInPolygon(endPos, tri, 3))
+		{
+			bestNode = curNode;
+			dtVcopy(bestPos, endPos);
+			endInside = true;
+		}
+
+		float center[3];
+		triangleCenter(tri, center);
+
+		// The entry edge belongs to the parent face.
+		dtResolvedPolyEdge entryEdge;
+		dtPolyFace parentFace;
+		if (curNode->pidx)
+		{
+			const dtNode* parentNode = m_tinyNodePool->getNodeAtIdx(curNode->pidx);
+			const dtMeshTile* parentTile = 0;
+			const dtPoly* parentPoly = 0;
+			m_nav->getTileAndPolyByRefUnsafe(parentNode->id, &parentTile, &parentPoly);
+			parentFace = dtPolyFace(m_nav, parentNode->id, parentNode->primIdx);
+			entryEdge = dtResolvedPolyEdge(m_nav, parentNode->id, m_tinyNodePool->getEntryEdge(curNode), parentTile, parentPoly);
+		}
+
+		for (int k = 0; k < 3; ++k)
+		{
+			dtResolvedPolyEdge edge = queriers::faceLocalEdge(curFace, k);
+			float a[3], b[3];
+			if (!queriers::edgeOriginAndDestinationPosition(edge, a, b))
+				continue;
 
-			auto neighbourFace = queriers::edgeRightFace(innerEdge);
+			float tseg;
+			dtResolvedPolyFace neighbourFace = queriers::edgeRightFace(edge);
+			if (!neighbourFace.isValid() ||
+				!filter->passFilter(neighbourFace.polyId, neighbourFace.tile, neighbourFace.poly))
+			{
+				// Wall edge, calc distance.
+				if (!endInside)
+				{
+					const float distSqr = dtDistancePtSegSqr2D(endPos, a, b, tseg);
+					if (distSqr < bestDist)
+					{
+						// Update nearest distance.
+						dtVlerp(bestPos, a, b, tseg);
+						bestDist = distSqr;
+						bestNode = curNode;
+					}
+				}
 
-			// Skip invalid ids and do not expand back to where we came from.
-			if (!neighbourFace.isValid()
-				|| neighbourFace == bestFace
-				|| neighbourFace == parentFace)
-			{
+				if (dtDistancePtSegSqr2D(searchPos, a, b, tseg) <= searchRadSqr)
+					addWall(a, b, center, walls, nwalls, MAX_WALLS);
 				continue;
 			}
 
-			// Get neighbour poly and tile.
-			const dtMeshTile* neighbourTile = 0;
-			const dtPoly* neighbourPoly = 0;
-			neighbourFace.getTileAndPoly(&neighbourTile, &neighbourPoly);
+			if (neighbourFace == parentFace)
+				continue;
 
-			if (!filter->passFilter(neighbourFace.polyId, neighbourTile, neighbourPoly))
+			// If the edge is outside the search circle, skip.
+			if (dtDistancePtSegSqr2D(searchPos, a, b, tseg) > searchRadSqr)
 				continue;
 
-			// check radius
-			if (bestFace != startRef
-				&& radius > 0.0f
-				&& !astar::isWalkableByRadius(radius, entryEdge, bestFace, innerEdge))
+			// 与A*相同的半径检查，单位必须能从进入边走到这条边
+			if (curNode != startNode
+				&& !astar::isWalkableByRadius(radius, entryEdge, curFace, edge))
 			{
-#if DT_DEBUG_ASTAR
-				LOG_INFO("\t not walkable");
-#endif
+				// 单位进不去这个face，但它的墙仍可能在单位半径内
+				addFaceWalls(neighbourFace, filter, searchPos, searchRadSqr, walls, nwalls, MAX_WALLS);
 				continue;
 			}
 
-			// Get neighbor node
-			dtNode* neighbourNode = m_nodePool->getNode(neighbourFace.polyId, 0, neighbourFace.innerIdx);
+			dtNode* neighbourNode = m_tinyNodePool->getNode(neighbourFace.polyId, 0, neighbourFace.innerIdx);
 			if (!neighbourNode)
-			{
-				outOfNodes = true;
 				continue;
-			}
+			// Skip if already visited.
+			if (neighbourNode->flags & DT_NODE_CLOSED)
+				continue;
 
-			// If the node is visited the first time, calculate node position.
-			if (neighbourNode->flags == 0)
+			// Cost
+			if (nstack < MAX_STACK)
 			{
-				if (!geom::closestPointToEdge(bestNode->pos, innerEdge, neighbourNode->pos))
-				{
-					break;
-				}
+				neighbourNode->pidx = m_tinyNodePool->getNodeIdx(curNode);
+				neighbourNode->flags |= DT_NODE_CLOSED;
+				m_tinyNodePool->setEntryEdge(neighbourNode, (unsigned char)edge.innerIdx);
+				stack[nstack++] = neighbourNode;
 			}
+		}
+	}
 
-			// Calculate cost and heuristic.
-			float cost = 0;
-			float heuristic = 0;
-
-			// Special case for last node.
-			if (neighbourFace == endRef)
-			{
-				// Cost
-				const float curCost = filter->getCost(bestNode->pos, neighbourNode->pos,
-					parentFace.polyId, parentTile, parentPoly,
-					bestFace.polyId, bestTile, bestPoly,
-					neighbourFace.polyId, neighbourTile, neighbourPoly);
-				const float endCost = filter->getCost(neighbourNode->pos, endPos,
-					bestFace.polyId, bestTile, bestPoly,
-					neighbourFace.polyId, neighbourTile, neighbourPoly,
-					0, 0, 0);
-
-				cost = bestNode->cost + curCost + endCost;
-				heuristic = 0;
-			}
-			else
+	// 把圆心推离墙，保证与墙的距离不小于半径
+	float pos[3];
+	dtVcopy(pos, bestPos);
+	if (radius > 0.0f)
+	{
+		static const int MAX_PUSH_ITERS = 4;
+		const float radiusSqr = radius * radius;
+		for (int iter = 0; iter < MAX_PUSH_ITERS; ++iter)
+		{
+			bool moved = false;
+			for (int i = 0; i < nwalls; ++i)
 			{
-				// Cost
-				const float curCost = filter->getCost(bestNode->pos, neighbourNode->pos,
-					parentFace.polyId, parentTile, parentPoly,
-					bestFace.polyId, bestTile, bestPoly,
-					neighbourFace.polyId, neighbourTile, neighbourPoly);
-				cost = bestNode->cost + curCost;
-				heuristic = dtVdist(neighbourNode->pos, endPos) * H_SCALE;
-			}
+				const float* w = &walls[i*9];
+				float tseg;
+				const float distSqr = dtDistancePtSegSqr2D(pos, &w[0], &w[3], tseg);
+				if (distSqr >= radiusSqr*0.9999f)
+					continue;
 
-			const float total = cost + heuristic;
+				float closest[3], dir[3];
+				dtVlerp(closest, &w[0], &w[3], tseg);
+				dtVsub(dir, pos, closest);
+				dir[1] = 0;
+				const float dist = dtMathSqrtf(distSqr);
+				if (dist > 1e-4f)
+					dtVscale(dir, dir, 1.0f / dist);
+				else
+					dtVcopy(dir, &w[6]);
+				dtVmad(pos, pos, dir, radius - dist);
+				moved = true;
+			}
+			if (!moved)
+				break;
+		}
+	}
 
-			// The node is already in open list and the new result is worse, skip.
-			if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
+	// The pushed position has to stay on the visited faces and clear of the walls,
+	// otherwise the unit does not fit there and stays at the start position.
+	dtNode* resultNode = bestNode;
+	if (!dtVequal(pos, bestPos))
+	{
+		resultNode = 0;
+		for (int i = 0; i < m_tinyNodePool->getNodeCount() && !resultNode; ++i)
+		{
+			dtNode* node = m_tinyNodePool->getNodeAtIdx(i+1);
+			if (!(node->flags & DT_NODE_CLOSED))
 				continue;
-			// The node is already visited and process, and the new result is worse, skip.
-			if ((neighbourNode->flags & DT_NODE_CLOSED) && total >= neighbourNode->total)
+
+			dtResolvedPolyVertex verts[3];
+			iterations::fromFaceToVertices iterFaceVerts(dtPolyFace(m_nav, node->id, node->primIdx));
+			if (iterFaceVerts.allVertices(verts, 3) != 3)
 				continue;
 
-			// Add or update the node.
-			neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
-			neighbourNode->id = neighbourFace.polyId;
-			neighbourNode->primIdx = neighbourFace.innerIdx;
-			neighbourNode->entryEdge = innerEdge;
-			neighbourNode->flags = (neighbourNode->flags & ~DT_NODE_CLOSED);
-			neighbourNode->cost = cost;
-			neighbourNode->total = total;
-
-			if (neighbourNode->flags & DT_NODE_OPEN)
-			{
-				// Already in open, update node location.
-				m_openList->modify(neighbourNode);
-			}
-			else
-			{
-				// Put the node in open list.
-				neighbourNode->flags |= DT_NODE_OPEN;
-				m_openList->push(neighbourNode);
-			}
+			float tri[9];
+			for (int j = 0; j < 3; ++j)
+				queriers::vertexPosition(verts[j], &tri[j*3]);
+			if (dtPointInPolygon(pos, tri, 3))
+				resultNode = node;
+		}
+	}
+	if (radius > 0.0f && nwalls > 0)
+	{
+		// 起点本身离墙太近时，只要没有更深地进入墙的半径范围就允许移动
+		const float startPenetration = wallPenetration(startPos, walls, nwalls, radius);
+		if (!resultNode ||
+			wallPenetration(pos, walls, nwalls, radius) > dtMax(startPenetration, radius*0.001f))
+		{
+			resultNode = startNode;
+			dtVcopy(pos, startPos);
+		}
+	}
+	dtVcopy(bestPos, pos);
+
+	int n = 0;
+	if (resultNode)
+	{
+		// Reverse the path.
+		dtNode* prev = 0;
+		dtNode* node = resultNode;
+		do
+		{
+			dtNode* next = m_tinyNodePool->getNodeAtIdx(node->pidx);
+			node->pidx = m_tinyNodePool->getNodeIdx(prev);
+			prev = node;
+			node = next;
+		}
+		while (node);
 
-			// Update nearest node to target so far.
-			if (heuristic < lastBestNodeCost)
+		// Store result
+		node = prev;
+		do
+		{
+			visited[n++] = dtPolyFace(m_nav, node->id, node->primIdx);
+			if (n >= maxVisitedSize)
 			{
-				lastBestNodeCost = heuristic;
-				lastBestNode = neighbourNode;
+				status |= DT_BUFFER_TOO_SMALL;
+				break;
 			}
-		} while(true);
+			node = m_tinyNodePool->getNodeAtIdx(node->pidx);
+		}
+		while (node);
 	}
 
-	dtStatus status = getPathToNode(lastBestNode, path, pathCount, maxPath, portalEdges, portalEdgeCount, maxPortalEdge);
+	dtVcopy(resultPos, bestPos);
 
-	if (lastBestNode->id != endRef.polyId &&
-		lastBestNode->primIdx != endRef.innerIdx)
-		status |= DT_PARTIAL_RESULT;
-
-	if (outOfNodes)
-		status |= DT_OUT_OF_NODES;
+	*visitedCount = n;
 
 	return status;
 }
 
+// 走廊链的一步：从链尾face往回走到前一个face，返回穿过的边（属于前一个face）
+static dtResolvedPolyEdge corridorPrevEdge(const dtResolvedPolyFace& face, const dtPolyFace& nextFace)
+{
+	dtResolvedPolyEdge exitEdge;
+	const dtResolvedPolyFace prevFace = astar::corridorNextFace(face, nextFace, &exitEdge);
+	if (!prevFace.isValid())
+		return dtResolvedPolyEdge();
+	return queriers::edgeOppositeEdge(exitEdge);
+}
+
+/// @par
+///
+/// The nodes flagged #DT_NODE_PARENT_DETACHED were reached through a corridor chain,
+/// the chain faces are recovered by walking back from the node to its parent.
 dtStatus dtNavMeshQuery::getPathToNode(
-	dtNode* endNode, 
+	dtNode* endNode,
 	dtPolyFace* path, int* pathCount, int maxPath,
 	dtPolyEdge* portalEdges, int* portalEdgeCount, const int maxPortalEdge) const
 {
@@ -322,131 +1332,197 @@ dtStatus dtNavMeshQuery::getPathToNode(
 	do
 	{
 		length++;
-		curNode = m_nodePool->getNodeAtIdx(curNode->pidx);
+		dtNode* parentNode = m_nodePool->getNodeAtIdx(curNode->pidx);
+		if ((curNode->flags & DT_NODE_PARENT_DETACHED) && parentNode)
+		{
+			const dtPolyFace parentFace(m_nav, parentNode->id, parentNode->primIdx);
+			dtResolvedPolyFace face(dtPolyFace(m_nav, curNode->id, curNode->primIdx));
+			dtResolvedPolyEdge edge = queriers::edgeOppositeEdge(face.sibling(m_nodePool->getEntryEdge(curNode)));
+			dtResolvedPolyFace chainFace = queriers::edgeLeftFace(edge);
+			for (int n = 0; chainFace.isValid() && chainFace != parentFace && n < astar::MAX_CORRIDOR_CHAIN; ++n)
+			{
+				length++;
+				edge = corridorPrevEdge(chainFace, face);
+				face = chainFace;
+				chainFace = queriers::edgeLeftFace(edge);
+			}
+		}
+		curNode = parentNode;
 	} while (curNode);
 
-	// If the path cannot be fully stored then advance to the last node we will be able to store.
+	// Write the path from the end, the faces that do not fit are skipped.
 	curNode = endNode;
-	int writeCount;
-	for (writeCount = length; writeCount > maxPath; writeCount--)
+	int i = length - 1;
+	while (curNode)
 	{
-		dtAssert(curNode);
-
-		curNode = m_nodePool->getNodeAtIdx(curNode->pidx);
-	}
+		dtNode* parentNode = m_nodePool->getNodeAtIdx(curNode->pidx);
+		dtResolvedPolyFace face(dtPolyFace(m_nav, curNode->id, curNode->primIdx));
+		if (i < maxPath)
+			path[i] = face;
 
-	// Write path
-	for (int i = writeCount - 1; i >= 0; i--)
-	{
-		dtAssert(curNode);
+		if ((curNode->flags & DT_NODE_PARENT_DETACHED) && parentNode)
+		{
+			const dtPolyFace parentFace(m_nav, parentNode->id, parentNode->primIdx);
+			dtResolvedPolyEdge edge = queriers::edgeOppositeEdge(face.sibling(m_nodePool->getEntryEdge(curNode)));
+			dtResolvedPolyFace chainFace = queriers::edgeLeftFace(edge);
+			for (int n = 0; chainFace.isValid() && chainFace != parentFace && n < astar::MAX_CORRIDOR_CHAIN; ++n)
+			{
+				if (i < maxPath && i <= maxPortalEdge)
+					portalEdges[i-1] = edge;
+				i--;
+				if (i < maxPath)
+					path[i] = chainFace;
+				edge = corridorPrevEdge(chainFace, face);
+				face = chainFace;
+				chainFace = queriers::edgeLeftFace(edge);
+			}
+			if (i > 0 && i < maxPath && i <= maxPortalEdge)
+				portalEdges[i-1] = edge;
+		}
+		else if (parentNode && i < maxPath && i <= maxPortalEdge)
+		{
+			portalEdges[i-1] = dtPolyEdge(m_nav, parentNode->id, m_nodePool->getEntryEdge(curNode));
+		}
 
-		path[i] = dtPolyFace(m_nav, curNode->id, curNode->primIdx);
-		if (i != 0)
-			portalEdges[i-1] = curNode->entryEdge;
-		curNode = m_nodePool->getNodeAtIdx(curNode->pidx);
+		i--;
+		curNode = parentNode;
 	}
 
-	dtAssert(!curNode);
+	dtAssert(i == -1);
 
 	*pathCount = dtMin(length, maxPath);
-	*portalEdgeCount = dtMin(length-1, maxPath-1);
+	*portalEdgeCount = dtMin(dtMin(length-1, maxPath-1), maxPortalEdge);
 
-	if (length > maxPath)
+	if (length > maxPath || length-1 > maxPortalEdge)
 		return DT_SUCCESS | DT_BUFFER_TOO_SMALL;
 
 	return DT_SUCCESS;
 }
 
-struct dtPolyPrimitiveHash
+namespace geom
 {
-	std::size_t operator()(const dtPolyPrimitive& p) const {
-		return std::hash<dtPolyRef>()(p.polyId) ^ (std::hash<int>()(p.innerIdx) << 1);
+	bool sweptCircleHitSegment2D(const float* p, const float* q, const float radius, const float* a, const float* b, float* t)
+	{
+		const float radiusSqr = radius * radius;
+		float u;
+
+		// 起点已经与线段重叠
+		if (dtDistancePtSegSqr2D(p, a, b, u) < radiusSqr)
+		{
+			*t = 0.0f;
+			return true;
+		}
+
+		// 圆心到ab的距离沿pq是凸函数，最小值在端点、a和b的投影或交点处取得
+		float tc[5];
+		int nc = 0;
+		tc[nc++] = 1.0f;
+		dtDistancePtSegSqr2D(a, p, q, tc[nc++]);
+		dtDistancePtSegSqr2D(b, p, q, tc[nc++]);
+		float s, st;
+		if (dtIntersectSegSeg2D(p, q, a, b, s, st) && s >= 0.0f && s <= 1.0f && st >= 0.0f && st <= 1.0f)
+			tc[nc++] = s;
+
+		float pos[3];
+		float tmin = 0.0f;
+		float dmin = FLT_MAX;
+		for (int i = 0; i < nc; ++i)
+		{
+			dtVlerp(pos, p, q, tc[i]);
+			const float d = dtDistancePtSegSqr2D(pos, a, b, u);
+			if (d < dmin)
+			{
+				dmin = d;
+				tmin = tc[i];
+			}
+		}
+		if (dmin >= radiusSqr)
+			return false;
+
+		// 在[0, tmin]上二分查找第一次重叠的位置
+		float lo = 0.0f;
+		float hi = tmin;
+		for (int i = 0; i < 24; ++i)
+		{
+			const float mid = (lo + hi) * 0.5f;
+			dtVlerp(pos, p, q, mid);
+			if (dtDistancePtSegSqr2D(pos, a, b, u) < radiusSqr)
+				hi = mid;
+			else
+				lo = mid;
+		}
+		*t = hi;
+		return true;
 	}
-};
+}
 
 namespace astar
 {
 	bool isWalkableByRadius(float radius, const dtPolyEdge& fromEdge, const dtPolyFace& throughFace, const dtPolyEdge& toEdge)
 	{
-#if DT_DEBUG_ASTAR
-		LOG_INFO("\t isWalkableByRadius, fromEdge:%s throughFace:%s, toEdge:%s", 
-			fromEdge.toString().c_str(), 
-			throughFace.toString().c_str(),
-			toEdge.toString().c_str());
-#endif
-		// we identify the points
-		dtPolyVertex fromEdgeOrigin, fromEdgeDestination;
-		if (!queriers::edgeOriginAndDestinationVertex(fromEdge, &fromEdgeOrigin, &fromEdgeDestination))
-		{
-			return false;
-		}
+		return isWalkableByRadius(radius, dtResolvedPolyEdge(fromEdge), dtResolvedPolyFace(throughFace), dtResolvedPolyEdge(toEdge));
+	}
 
-		dtPolyVertex toEdgeOrigin, toEdgeDestination;
-		if (!queriers::edgeOriginAndDestinationVertex(toEdge, &toEdgeOrigin, &toEdgeDestination))
+	bool isWalkableByRadius(float radius, const dtResolvedPolyEdge& fromEdge, const dtResolvedPolyFace& throughFace, const dtResolvedPolyEdge& toEdge)
+	{
+		// fromEdge is the half-edge of the previous face, use its twin in throughFace
+		// so that both edges can be located inside the face.
+		dtResolvedPolyEdge entryEdge = queriers::edgeOppositeEdge(fromEdge);
+		const int entryIdx = queriers::edgeFaceIndex(entryEdge);
+		const int exitIdx = queriers::edgeFaceIndex(toEdge);
+		if (entryIdx < 0 || exitIdx < 0 || entryIdx == exitIdx)
 		{
 			return false;
 		}
 
-		dtPolyVertex vA;  // the vertex on fromEdge not on toEdge  
-		dtPolyVertex vB;  // the vertex on toEdge not on fromEdge  
-		dtPolyVertex vC;  // the common vertex of the 2 edges (pivot) 
+		// the common vertex of the 2 edges (pivot)
+		const int pivot = (3 - entryIdx - exitIdx + 2) % 3;
 
-		if (fromEdgeOrigin == toEdgeOrigin)
-		{
-			vA = fromEdgeDestination;
-			vB = toEdgeDestination;
-			vC = fromEdgeOrigin;
-		}
-		else if (fromEdgeDestination == toEdgeDestination)
-		{
-			vA = fromEdgeOrigin;
-			vB = toEdgeOrigin;
-			vC = fromEdgeDestination;
-		}
-		else if (fromEdgeOrigin == toEdgeDestination)
+		// Note: Diameter-based judgment is applied here.
+		float diameter = radius * 2;
+		float diameterSquared = diameter * diameter;
+
+		// use the clearance baked into the tile when available
+		const dtFaceClearance* clearance = queriers::faceClearance(throughFace);
+		if (clearance)
 		{
-			vA = fromEdgeDestination;
-			vB = toEdgeOrigin;
-			vC = fromEdgeOrigin;
+			if (clearance->width[pivot] < diameter)
+				return false;
+			if ((clearance->flags & (DT_FACE_CLEARANCE_PARTIAL << pivot)) == 0)
+				return true;
 		}
-		else if (fromEdgeDestination == toEdgeOrigin)
+
+		dtResolvedPolyVertex verts[3];
+		iterations::fromFaceToVertices iterFaceVerts(throughFace);
+		if (iterFaceVerts.allVertices(verts, 3) != 3)
 		{
-			vA = fromEdgeOrigin;
-			vB = toEdgeDestination;
-			vC = fromEdgeDestination;
+			return false;
 		}
 
-#if DT_DEBUG_ASTAR
-		LOG_INFO("\t isWalkableByRadius, vA:%s vB:%s, vC:%s",
-			vA.toString().c_str(),
-			vB.toString().c_str(),
-			vC.toString().c_str());
-#endif
-		// Note: Diameter-based judgment is applied here.
-		float diameter = radius * 2;
-		float diameterSquared = diameter * diameter;
+		dtResolvedPolyVertex vC = verts[pivot];				// the common vertex of the 2 edges (pivot)
+		dtResolvedPolyVertex vA = verts[(pivot + 1) % 3];	// the vertex on the first edge not on the second edge
+		dtResolvedPolyVertex vB = verts[(pivot + 2) % 3];	// the vertex on the second edge not on the first edge
+
 
 		float dot;
 		//bool result;
 		float distSquared;
 
 		float a[3], b[3], c[3];
-		queriers::vertexPosition(vA, a);
-		queriers::vertexPosition(vB, b);
-		queriers::vertexPosition(vC, c);
+		if (!queriers::vertexPosition(vA, a) || !queriers::vertexPosition(vB, b) || !queriers::vertexPosition(vC, c))
+		{
+			return false;
+		}
 
 		// if we have a right or obtuse angle on CAB
 		float ab[3], ac[3];
 		dtVsub(ab, b, a);
-		dtVsub(ab, c, a);
+		dtVsub(ac, c, a);
 		dot = dtVdot(ab, ac);
 		if (dot <= 0)
 		{
 			// we compare length of AC with radius
 			distSquared = dtVlenSqr(ac);
-#if DT_DEBUG_ASTAR
-			LOG_INFO("\t isWalkableByRadius, CAB is obutse, distSquared:%.2f, diameterSquared:%.2f", distSquared, diameterSquared);
-#endif
 			return distSquared >= diameterSquared;
 		}
 
@@ -459,37 +1535,13 @@ namespace astar
 		{
 			// we compare length of BC with radius
 			distSquared = dtVlenSqr(bc);
-#if DT_DEBUG_ASTAR
-			LOG_INFO("\t isWalkableByRadius, CBA is obutse, distSquared:%.2f, diameterSquared:%.2f", distSquared, diameterSquared);
-#endif
 			return distSquared >= diameterSquared;
 		}
 
 		// we identify the adjacent edge (facing pivot vertex) 
-		dtPolyEdge faceEdge = queriers::faceEdge(throughFace);
-		if (!faceEdge) return false;
-		dtPolyEdge oppositeEdge = queriers::edgeOppositeEdge(faceEdge);
-		dtPolyEdge nextLeftEdge = queriers::edgeNextLeftEdge(faceEdge);
-		if (!nextLeftEdge) return false;
-		dtPolyEdge nextLeftEdge_Opp = queriers::edgeOppositeEdge(nextLeftEdge);
-
-		dtPolyEdge adjEdge;
-		if (faceEdge != fromEdge && oppositeEdge != fromEdge && faceEdge != toEdge && oppositeEdge != toEdge)
-		{
-			adjEdge = faceEdge;
-		}
-		else if (nextLeftEdge != fromEdge && nextLeftEdge_Opp != fromEdge && nextLeftEdge != toEdge && nextLeftEdge_Opp != toEdge)
-		{
-			adjEdge = nextLeftEdge;
-		}
-		else
-		{
-			adjEdge = queriers::edgePrevLeftEdge(faceEdge);
-		}
+		dtResolvedPolyEdge adjEdge = queriers::faceLocalEdge(throughFace, (pivot + 1) % 3);
+		if (!adjEdge) return false;
 
-#if DT_DEBUG_ASTAR
-		LOG_INFO("\t isWalkableByRadius, adjEdge:%s, isBoundary:%d", adjEdge.toString().c_str(), queriers::edgeIsBoundary(adjEdge)); 
-#endif
 
 		// if the adjacent edge is constrained, we check the distance of orthognaly projected
 		if (queriers::edgeIsBoundary(adjEdge))
@@ -500,9 +1552,6 @@ namespace astar
 				float v[3];
 				dtVsub(v, proj, c);
 				distSquared = dtVlenSqr(v);
-#if DT_DEBUG_ASTAR
-				LOG_INFO("\t isWalkableByRadius, isBoundary:1, distSquared:%.2f diameterSquared:%.2f", distSquared, diameterSquared);
-#endif
 				return distSquared >= diameterSquared;
 			}
 			else
@@ -522,117 +1571,80 @@ namespace astar
 			}
 			else
 			{
-				std::list<dtPolyFace> faceToCheck;
-				std::list<dtPolyEdge> faceFromEdge;
+				// Fixed size stacks, the check runs per expanded face and per moved unit and must not allocate.
+				// The faces that do not fit are not searched: a search that large is in an open area and
+				// the walls it could not reach are treated as out of range.
+				static const int MAX_STACK = 32;
+				dtResolvedPolyFace faceToCheck[MAX_STACK];
+				dtResolvedPolyEdge faceFromEdge[MAX_STACK];
+				dtPolyFace faceDone[MAX_STACK];
+				int nstack = 0;
+				int ndone = 0;
 
-				std::unordered_set<dtPolyFace, dtPolyPrimitiveHash> faceDone;
-
-				faceFromEdge.push_back(adjEdge);
 				auto leftFace = queriers::edgeLeftFace(adjEdge);
-				if (leftFace == throughFace)
-				{
-					auto rightFace = queriers::edgeRightFace(adjEdge);
-					faceToCheck.push_back(rightFace);
-					faceDone.insert(rightFace);
-				}
-				else
-				{
-					faceToCheck.push_back(leftFace);
-					faceDone.insert(leftFace);
-				}
+				const dtResolvedPolyFace firstFace = leftFace == throughFace ? queriers::edgeRightFace(adjEdge) : leftFace;
+				faceToCheck[nstack] = firstFace;
+				faceFromEdge[nstack++] = adjEdge;
+				faceDone[ndone++] = firstFace;
 
-				while (faceToCheck.size() > 0)
+				while (nstack > 0)
 				{
-					auto currFace = faceToCheck.front();
-					faceToCheck.pop_front();
-
-					auto fromEdge = faceFromEdge.front();
-					faceFromEdge.pop_front();
+					nstack--;
+					const dtResolvedPolyFace currFace = faceToCheck[nstack];
+					const dtResolvedPolyEdge fromEdge = faceFromEdge[nstack];
 
 					auto faceEdge = queriers::faceEdge(currFace);
 					auto faceEdge_Next = queriers::edgeNextLeftEdge(faceEdge);
 					auto fromEdge_Opp = queriers::edgeOppositeEdge(fromEdge);
 
-					dtPolyEdge currEdgeA, currEdgeB;
+					dtResolvedPolyEdge currEdges[2];
 					if (faceEdge == fromEdge || faceEdge == fromEdge_Opp)
 					{
 						// we identify the 2 edges to evaluate
-						currEdgeA = queriers::edgeNextLeftEdge(faceEdge);
-						currEdgeB = queriers::edgeNextLeftEdge(faceEdge_Next);
+						currEdges[0] = queriers::edgeNextLeftEdge(faceEdge);
+						currEdges[1] = queriers::edgeNextLeftEdge(faceEdge_Next);
 					}
 					else if (faceEdge_Next == fromEdge || faceEdge_Next == fromEdge_Opp)
 					{
-						// we identify the faces related to the 2 edges
-						currEdgeA = faceEdge;
-						currEdgeB = queriers::edgeNextLeftEdge(faceEdge_Next);
-					}
-					else
-					{
-						currEdgeA = faceEdge;
-						currEdgeB = faceEdge_Next;
-					}
-
-					dtPolyFace nextFaceA;
-					auto currEdgeA_LeftFace = queriers::edgeLeftFace(currEdgeA);
-					if (currEdgeA_LeftFace == currFace)
-					{
-						nextFaceA = queriers::edgeRightFace(currEdgeA);
+						currEdges[0] = faceEdge;
+						currEdges[1] = queriers::edgeNextLeftEdge(faceEdge_Next);
 					}
 					else
 					{
-						nextFaceA = currEdgeA_LeftFace;
+						currEdges[0] = faceEdge;
+						currEdges[1] = faceEdge_Next;
 					}
 
-					dtPolyFace nextFaceB;
-					auto currEdgeB_LeftFace = queriers::edgeLeftFace(currEdgeB);
-					if (currEdgeB_LeftFace == currFace)
-					{
-						nextFaceB = queriers::edgeRightFace(currEdgeB);
-					}
-					else
+					for (int k = 0; k < 2; ++k)
 					{
-						nextFaceB = currEdgeB_LeftFace;
-					}
-					// we check if the next face is not already in pipe
-					// and if the edge A is close to pivot vertex
-					bool nextFaceA_not_done = faceDone.count(nextFaceA) == 0;
-					if (nextFaceA_not_done && geom::distanceSquaredVertexToEdge(vC, currEdgeA) < diameterSquared)
-					{
-						// if the edge is constrained
-						if (queriers::edgeIsBoundary(currEdgeA))
-						{
-							// so it is not walkable
+						const dtResolvedPolyEdge& currEdge = currEdges[k];
+
+						// we identify the face on the other side of the edge
+						dtResolvedPolyFace nextFace = queriers::edgeLeftFace(currEdge);
+						if (nextFace == currFace)
+							nextFace = queriers::edgeRightFace(currEdge);
+
+						// we check if the next face is not already in pipe
+						// and if the edge is close to pivot vertex
+						bool nextFaceDone = false;
+						for (int i = 0; i < ndone && !nextFaceDone; ++i)
+							nextFaceDone = faceDone[i] == nextFace;
+						if (nextFaceDone || geom::distanceSquaredVertexToEdge(vC, currEdge) >= diameterSquared)
+							continue;
+
+						// if the edge is constrained, so it is not walkable
+						if (queriers::edgeIsBoundary(currEdge))
 							return false;
-						}
-						else
-						{
-							// if the edge is not constrained, we continue the search
-							faceToCheck.push_back(nextFaceA);
-							faceFromEdge.push_back(currEdgeA);
-							faceDone.insert(nextFaceA);
-						}
-					} 
 
-					// and if the edge B is close to pivot vertex    // we check if the next face is not already in pipe  
-					bool nextFaceB_not_done = faceDone.count(nextFaceB) == 0;
-					if (nextFaceB_not_done && geom::distanceSquaredVertexToEdge(vC, currEdgeB) < diameterSquared)
-					{
-						// if the edge is constrained
-						if (queriers::edgeIsBoundary(currEdgeB))
-						{
-							// so it is not walkable
-							return false;
-						}
-						else
-						{
-							// if the edge is not constrained, we continue the search
-							faceToCheck.push_back(nextFaceB);
-							faceFromEdge.push_back(currEdgeB);
-							faceDone.insert(nextFaceB);
-						}
+						// if the edge is not constrained, we continue the search
+						if (nstack >= MAX_STACK || ndone >= MAX_STACK)
+							continue;
+						faceToCheck[nstack] = nextFace;
+						faceFromEdge[nstack++] = currEdge;
+						faceDone[ndone++] = nextFace;
 					}
-				}  
-				
+				}
+
 				// if we didn't previously meet a constrained edge  
 				return true;
 			}
@@ -644,6 +1656,60 @@ namespace astar
 
 namespace funnel
 {
+	dtRadiusPathScratch::dtRadiusPathScratch()
+		: m_points(0), m_pointSides(0), m_radii(0), m_startAngles(0), m_endAngles(0), m_dirs(0), m_maxPoints(0), m_trace(0)
+	{
+	}
+
+	dtRadiusPathScratch::~dtRadiusPathScratch()
+	{
+		purge();
+	}
+
+	void dtRadiusPathScratch::purge()
+	{
+		dtFree(m_points);
+		dtFree(m_pointSides);
+		dtFree(m_radii);
+		dtFree(m_startAngles);
+		dtFree(m_endAngles);
+		dtFree(m_dirs);
+		m_points = 0;
+		m_pointSides = 0;
+		m_radii = 0;
+		m_startAngles = 0;
+		m_endAngles = 0;
+		m_dirs = 0;
+		m_maxPoints = 0;
+	}
+
+	bool dtRadiusPathScratch::init(const int maxPoints)
+	{
+		if (maxPoints <= 0)
+			return false;
+
+		// 已经足够大时直接复用
+		if (maxPoints <= m_maxPoints)
+			return true;
+
+		purge();
+
+		m_points = (float*)dtAlloc(sizeof(float)*3*maxPoints, DT_ALLOC_PERM);
+		m_pointSides = (int*)dtAlloc(sizeof(int)*maxPoints, DT_ALLOC_PERM);
+		m_radii = (float*)dtAlloc(sizeof(float)*maxPoints, DT_ALLOC_PERM);
+		m_startAngles = (float*)dtAlloc(sizeof(float)*maxPoints, DT_ALLOC_PERM);
+		m_endAngles = (float*)dtAlloc(sizeof(float)*maxPoints, DT_ALLOC_PERM);
+		m_dirs = (unsigned char*)dtAlloc(sizeof(unsigned char)*maxPoints, DT_ALLOC_PERM);
+		if (!m_points || !m_pointSides || !m_radii || !m_startAngles || !m_endAngles || !m_dirs)
+		{
+			purge();
+			return false;
+		}
+
+		m_maxPoints = maxPoints;
+		return true;
+	}
+
 	// Funnel Algorithm: https://blog.csdn.net/fengkeyleaf/article/details/118832924?utm_source=app&app_version=5.3.1
 	// 算法步骤：
 	//		1.每次处理一条导航线，直到处理完所有的导航线:
@@ -691,33 +1757,30 @@ namespace funnel
 		const dtPolyEdge* portalEdges, const int portalEdgeCount,
 		float* straightPath, unsigned char* straightPathFlags, dtPolyFace* straightPathRefs, 
 		int* straightPathCount, const int maxStraightPath, 
-		const float radius
-#if DT_DEBUG_ASTAR
-		,
-		dtFunnelDebug* portalDebugs, int* portalDebugCount, const int maxPortalDebug,
-		dtFunnelStep* funnelSteps, int* funnelStepCount, const int maxFunnelStep
-#endif
-		)
+		const float radius, dtRadiusPathScratch* scratch)
 	{
+		dtIgnoreUnused(radius);
+
 		if (!straightPathCount)
 			return DT_FAILURE | DT_INVALID_PARAM;
 
 		*straightPathCount = 0;
 
-#if DT_DEBUG_ASTAR
-		*portalDebugCount = 0;
-		*funnelStepCount = 0;
-#endif
-
 		if (!startPos || !dtVisfinite(startPos) ||
 			!endPos || !dtVisfinite(endPos) ||
 			!path || pathSize <= 0 || !path[0] ||
 			!portalEdges || portalEdgeCount <= 0 ||
-			maxStraightPath <= 0)
+			maxStraightPath <= 0 || !scratch)
 		{
 			return DT_FAILURE | DT_INVALID_PARAM;
 		}
 
+		// 第一条edge的两个顶点，之后每条edge一个新顶点，以及终点的左右两侧
+		if (portalEdgeCount + 3 > scratch->getMaxPoints())
+		{
+			return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+		}
+
 		dtStatus stat = 0;
 
 		// Add start point.
@@ -744,28 +1807,28 @@ namespace funnel
 			auto rightPolyFace = path[0];
 
 			// 预先处理所有edge，并确定左右顶点
-			std::unordered_map<dtPolyVertex, int, dtPolyPrimitiveHash> vertexSideCache;
-			std::vector<float> points;
-			std::vector<int> pointSides;
-			points.resize(portalEdgeCount * 2 * 3);
-			pointSides.resize(portalEdgeCount * 2);
+			float* points = scratch->getPoints();
+			int* pointSides = scratch->getPointSides();
+			debug::dtTraceBuffer* trace = scratch->getTraceBuffer();
 			int pointCount = 0;
 
 			static const int POINT_SIDE_LEFT =   1;
 			static const int POINT_SIDE_RIGHT = -1;
 
-			dtPolyVertex fromVertex;
-			dtPolyVertex fromFromVertex;
+			// 相邻的两条edge共享一个顶点，只需要记住上一条edge两个顶点所在的一侧
+			dtResolvedPolyVertex fromVertex;
+			dtResolvedPolyVertex fromFromVertex;
+			int fromVertexSide = 0, fromFromVertexSide = 0;
 			float fromVertexPos[3], fromFromVertexPos[3];
-			dtPolyVertex currVertex;
+			dtResolvedPolyVertex currVertex;
 			for (int i = 0; i < portalEdgeCount; ++i)
 			{
 				// we identify the current vertex and his origin vertex
-				auto currEdge = &portalEdges[i];
+				dtResolvedPolyEdge currEdge(portalEdges[i]);
 
 				int direction = 0;
-				dtPolyVertex origin, destination;
-				if (!queriers::edgeOriginAndDestinationVertex(*currEdge, &origin, &destination))
+				dtResolvedPolyVertex origin, destination;
+				if (!queriers::edgeOriginAndDestinationVertex(currEdge, &origin, &destination))
 				{
 					return DT_FAILURE;
 				}
@@ -777,28 +1840,21 @@ namespace funnel
 				if (i == 0)
 				{
 					auto side = geom::relativeSide(startPos, originPos, destinationPos);
-					if (side == geom::REL_SIDE_LEFT)
-					{
-						vertexSideCache[destination] = POINT_SIDE_LEFT;
-						vertexSideCache[origin] = POINT_SIDE_RIGHT;
-					}
-					else
-					{
-						vertexSideCache[destination] = POINT_SIDE_RIGHT;
-						vertexSideCache[origin] = POINT_SIDE_LEFT;
-					}
+					const int originSide = (side == geom::REL_SIDE_LEFT) ? POINT_SIDE_RIGHT : POINT_SIDE_LEFT;
 
 					direction = -side;
 					fromVertex = origin;
 					fromFromVertex = destination;
+					fromVertexSide = originSide;
+					fromFromVertexSide = -originSide;
 					dtVcopy(fromVertexPos, originPos);
 					dtVcopy(fromFromVertexPos, destinationPos);
 					// 
 					dtVcopy(&points[pointCount*3], originPos);
-					pointSides[pointCount] = vertexSideCache[origin];
+					pointSides[pointCount] = fromVertexSide;
 					++pointCount;
 					dtVcopy(&points[pointCount * 3], destinationPos);
-					pointSides[pointCount] = vertexSideCache[destination];
+					pointSides[pointCount] = fromFromVertexSide;
 					++pointCount;
 				}
 				else
@@ -815,56 +1871,36 @@ namespace funnel
 					{
 						currVertex = destination;
 						fromVertex = fromFromVertex;
+						fromVertexSide = fromFromVertexSide;
 						dtVcopy(fromVertexPos, fromFromVertexPos);
 					}
 					else if (dtVequal(destinationPos, fromFromVertexPos))
 					{
 						currVertex = origin;
 						fromVertex = fromFromVertex;
+						fromVertexSide = fromFromVertexSide;
 						dtVcopy(fromVertexPos, fromFromVertexPos);
 					}
 					else
 					{
 						dtAssert(false && "IMPOSSIBLE TO IDENTIFY THE VERTEX !!!");
-						//return DT_FAILURE;
+						return DT_FAILURE;
 					}
 
-					auto find_iter = vertexSideCache.find(fromVertex);
-					dtAssert(find_iter != vertexSideCache.end() && "straightPathByRadius, find fromVertex failed!!!");
-					direction = -(*find_iter).second;
+					direction = -fromVertexSide;
 
 					fromFromVertex = fromVertex;
 					fromVertex = currVertex;
 					dtVcopy(fromFromVertexPos, fromVertexPos);
 					queriers::vertexPosition(currVertex, fromVertexPos);
 
-					vertexSideCache[fromVertex] = direction;
-					vertexSideCache[fromFromVertex] = -direction;
+					fromVertexSide = direction;
+					fromFromVertexSide = -direction;
 					// 
 					dtVcopy(&points[pointCount * 3], fromVertexPos);
 					pointSides[pointCount] = direction;
 					++pointCount;
 				}
-
-#if DT_DEBUG_ASTAR
-				if (*portalDebugCount < maxPortalDebug)
-				{
-					auto portalDebug = &portalDebugs[*portalDebugCount];
-					portalDebug->portalEdge = *currEdge;
-					if (direction == geom::REL_SIDE_RIGHT)
-					{
-						portalDebug->portalRight = fromVertex;
-						portalDebug->portalLeft = fromFromVertex;
-					}
-					else
-					{
-						portalDebug->portalRight = fromFromVertex;
-						portalDebug->portalLeft = fromVertex;
-					}
-
-					(*portalDebugCount)++;
-				}
-#endif			
 			}
 
 			// add end point
@@ -886,20 +1922,9 @@ namespace funnel
 				int side = pointSides[i];
 				const float* point = &points[i*3];
 
-			#if DT_DEBUG_ASTAR
-				auto step = &funnelSteps[*funnelStepCount];
-				dtVcopy(step->apexPos, portalApex);
-				dtVcopy(step->leftPos, portalLeft);
-				dtVcopy(step->rightPos, portalRight);
-				dtVcopy(step->currPos, point);
-				step->currSide = side;
-				++(*funnelStepCount);
-
-				if (*funnelStepCount >= maxFunnelStep)
-				{
-					return DT_FAILURE;
-				}
-			#endif
+				if (trace)
+					trace->record(debug::DT_TRACE_FUNNEL_STEP, 0, DT_INVALID_PRIM_INDEX, (unsigned short)i,
+						point[0], point[1], point[2], (unsigned char)(side == POINT_SIDE_RIGHT));
 
 				// Right vertex.
 				if (side == POINT_SIDE_RIGHT &&
@@ -908,7 +1933,7 @@ namespace funnel
 					if (dtVequal(portalApex, portalRight) || dtTriArea2D(portalApex, portalLeft, point) <= 0.0f)
 					{
 						dtVcopy(portalRight, point);
-						rightPolyFace = (i + 1 < pathSize) ? path[i + 1] : dtPolyFace::INVALID;
+						rightPolyFace = (i + 1 < pathSize) ? path[i + 1] : dtPolyFace();
 						rightIndex = i;
 					}
 					else
@@ -949,7 +1974,7 @@ namespace funnel
 					if (dtVequal(portalApex, portalLeft) || dtTriArea2D(portalApex, portalRight, point) >= 0.0f)
 					{
 						dtVcopy(portalLeft, point);
-						leftPolyFace = (i + 1 < pathSize) ? path[i + 1] : dtPolyFace::INVALID;
+						leftPolyFace = (i + 1 < pathSize) ? path[i + 1] : dtPolyFace();
 						leftIndex = i;
 					}
 					else
@@ -986,7 +2011,7 @@ namespace funnel
 		}	
 
 		// Ignore status return value as we're just about to return anyway.
-		appendVertex(endPos, DT_STRAIGHTPATH_END, dtPolyFace::INVALID,
+		appendVertex(endPos, DT_STRAIGHTPATH_END, dtPolyFace(),
 			straightPath, straightPathFlags, straightPathRefs,
 			straightPathCount, maxStraightPath);
 
@@ -996,54 +2021,56 @@ namespace funnel
 	static const float PI = 3.14159265f;
 
 	// Radius modifier
-	void dtRadiusModifier::applyModify(
+	dtStatus dtRadiusModifier::applyModify(
 		const float* straightPath, const int straightPathCount,
-		float* modifiedStraightPath, int* modifiedStraightPathCount, const int maxModifiedStraightPath
-#if DT_DEBUG_ASTAR
-		,
-		dtRadiusModifierDebug* modifierDebug, int* modifierDebugCount, const int maxModifierDebug
-#endif
-		)
+		float* modifiedStraightPath, int* modifiedStraightPathCount, const int maxModifiedStraightPath,
+		dtRadiusPathScratch* scratch)
 	{
-		if (!straightPath || !modifiedStraightPath)
+		if (!modifiedStraightPathCount)
+			return DT_FAILURE | DT_INVALID_PARAM;
+
+		*modifiedStraightPathCount = 0;
+
+		if (!straightPath || straightPathCount < 0 || !modifiedStraightPath || maxModifiedStraightPath <= 0 || !scratch)
 		{
-			return;
+			return DT_FAILURE | DT_INVALID_PARAM;
 		}
 
 		if (straightPathCount < 3)
 		{
 			int count = dtMin(straightPathCount, maxModifiedStraightPath);
-			memcpy(modifiedStraightPathCount, straightPath, sizeof(float)*3*count);
+			memcpy(modifiedStraightPath, straightPath, sizeof(float)*3*count);
 			*modifiedStraightPathCount = count;
-			return;
+			return DT_SUCCESS | ((count < straightPathCount) ? DT_BUFFER_TOO_SMALL : 0);
+		}
+
+		if (straightPathCount > scratch->getMaxPoints())
+		{
+			return DT_FAILURE | DT_BUFFER_TOO_SMALL;
 		}
 
-		/** \todo Do something about these allocations */
-		std::vector<float> radi, a1, a2;
-		std::vector<bool> dir;
-		radi.resize(straightPathCount);
-		a1.resize(straightPathCount);
-		a2.resize(straightPathCount);
-		dir.resize(straightPathCount);
+		float* radi = scratch->getRadii();
+		float* a1 = scratch->getStartAngles();
+		float* a2 = scratch->getEndAngles();
+		unsigned char* dir = scratch->getDirs();
+		memset(a1, 0, sizeof(float)*straightPathCount);
+		memset(a2, 0, sizeof(float)*straightPathCount);
+		memset(dir, 0, sizeof(unsigned char)*straightPathCount);
 
-		for (int i = 0; i < radi.size(); i++)
+		for (int i = 0; i < straightPathCount; i++)
 		{
 			radi[i] = _radius;
 		}
 
 		radi[0] = 0;
-		radi[radi.size() - 1] = 0;
-
-	#if DT_DEBUG_ASTAR
-		*modifierDebugCount = 0;
-	#endif
+		radi[straightPathCount - 1] = 0;
 
 		int count = 0;
 		for (int i = 0; i < straightPathCount - 1; i++)
 		{
 			count++;
 			if (count > 2 * straightPathCount) {
-				// LOG_WARNING("Could not resolve radiuses, the path is too complex. Try reducing the base radius");
+				// Could not resolve radiuses, the path is too complex. Try reducing the base radius.
 				break;
 			}
 			
@@ -1063,17 +2090,6 @@ namespace funnel
 			}
 
 			//DrawCircle (vs[i], radi[i], Color.yellow);
-		#if DT_DEBUG_ASTAR
-			if (*modifierDebugCount < maxModifierDebug)
-			{
-				auto debug = &modifierDebug[*modifierDebugCount];
-				dtVcopy(debug->pos, &straightPath[i*3]);
-				debug->radius = radi[i];
-
-				++(*modifierDebugCount);
-			}
-		#endif
-
 			if ((tt & TangentType::Inner) != 0) 
 			{
 				//Angle to tangent
@@ -1098,13 +2114,13 @@ namespace funnel
 				{
 					a2[i] = sigma - a;
 					a1[i + 1] = sigma - a + PI;
-					dir[i] = true;
+					dir[i] = 1;
 				}
 				else 
 				{
 					a2[i] = sigma + a;
 					a1[i + 1] = sigma + a + PI;
-					dir[i] = false;
+					dir[i] = 0;
 				}
 			}
 			else 
@@ -1145,13 +2161,13 @@ namespace funnel
 				{
 					a2[i] = sigma - a;
 					a1[i + 1] = sigma - a;
-					dir[i] = true;
+					dir[i] = 1;
 				}
 				else 
 				{
 					a2[i] = sigma + a;
 					a1[i + 1] = sigma + a;
-					dir[i] = false;
+					dir[i] = 0;
 				}
 			}
 		}
@@ -1192,24 +2208,139 @@ namespace funnel
 				if (start < end) start += (float)PI * 2;
 				for (float t = start; t > end; t -= step)
 				{
-					float offset[3];
-					offset[0] = dtMathCosf(t);
-					offset[1] = 0.0f;
-					offset[2] = dtMathSinf(t);
+					if (newPathCount < maxModifiedStraightPath)
+					{
+						float offset[3];
+						offset[0] = dtMathCosf(t);
+						offset[1] = 0.0f;
+						offset[2] = dtMathSinf(t);
 
-					dtVmad(&modifiedStraightPath[newPathCount * 3], &straightPath[i * 3], offset, rad);
-					++newPathCount;
+						dtVmad(&modifiedStraightPath[newPathCount * 3], &straightPath[i * 3], offset, rad);
+						++newPathCount;
+					}
 				}
 			}
 		}
 
+		// 圆弧上的点会先占满输出，终点放不下时说明结果被截断了
+		dtStatus status = DT_SUCCESS;
 		if (newPathCount < maxModifiedStraightPath)
 		{
 			dtVcopy(&modifiedStraightPath[newPathCount * 3], &straightPath[(straightPathCount - 1) * 3]);
 			++newPathCount;
 		}
+		else
+		{
+			status |= DT_BUFFER_TOO_SMALL;
+		}
 
 		*modifiedStraightPathCount = newPathCount;
+		return status;
+	}
+
+}
+
+namespace debug
+{
+	dtTraceBuffer::dtTraceBuffer()
+		: m_events(0), m_mask(0), m_next(0)
+	{
+	}
+
+	dtTraceBuffer::~dtTraceBuffer()
+	{
+		dtFree(m_events);
+	}
+
+	bool dtTraceBuffer::init(const int capacity)
+	{
+		if (capacity <= 0)
+			return false;
+
+		const unsigned int size = dtNextPow2((unsigned int)capacity);
+		if (!m_events || size != m_mask + 1)
+		{
+			dtFree(m_events);
+			m_events = (dtTraceEvent*)dtAlloc(sizeof(dtTraceEvent)*size, DT_ALLOC_PERM);
+			if (!m_events)
+			{
+				m_mask = 0;
+				m_next = 0;
+				return false;
+			}
+			m_mask = size - 1;
+		}
+		memset(m_events, 0, sizeof(dtTraceEvent)*size);
+		m_next = 0;
+		return true;
+	}
+
+	int dtTraceBuffer::copyEvents(dtTraceEvent* events, const int maxEvents) const
+	{
+		if (!events || maxEvents <= 0)
+			return 0;
+		const int count = dtMin(getEventCount(), maxEvents);
+		for (int i = 0; i < count; ++i)
+			events[i] = *getEvent(i);
+		return count;
+	}
+
+	const char* traceEventName(const unsigned char type)
+	{
+		switch (type)
+		{
+		case DT_TRACE_SEARCH_BEGIN: return "search_begin";
+		case DT_TRACE_FACE_EXPANDED: return "face_expanded";
+		case DT_TRACE_RADIUS_REJECTED: return "radius_rejected";
+		case DT_TRACE_SEARCH_END: return "search_end";
+		case DT_TRACE_FUNNEL_STEP: return "funnel_step";
+		default: return "unknown";
+		}
 	}
 
+	int formatTraceEvent(const dtTraceEvent& ev, char* buf, const int bufSize)
+	{
+		if (!buf || bufSize <= 0)
+			return 0;
+
+		int n = 0;
+		switch (ev.type)
+		{
+		case DT_TRACE_SEARCH_BEGIN:
+			n = snprintf(buf, bufSize, "%u %s face:%llu[%d] pos:(%.3f, %.3f, %.3f)",
+				ev.seq, traceEventName(ev.type), (unsigned long long)ev.ref, (int)ev.prim,
+				ev.data[0], ev.data[1], ev.data[2]);
+			break;
+		case DT_TRACE_FACE_EXPANDED:
+			n = snprintf(buf, bufSize, "%u %s face:%llu[%d] entry:%d cost:%.3f total:%.3f",
+				ev.seq, traceEventName(ev.type), (unsigned long long)ev.ref, (int)ev.prim,
+				(int)ev.arg, ev.data[0], ev.data[1]);
+			break;
+		case DT_TRACE_RADIUS_REJECTED:
+			n = snprintf(buf, bufSize, "%u %s face:%llu[%d] exit:%d radius:%.3f",
+				ev.seq, traceEventName(ev.type), (unsigned long long)ev.ref, (int)ev.prim,
+				(int)ev.arg, ev.data[0]);
+			break;
+		case DT_TRACE_SEARCH_END:
+			n = snprintf(buf, bufSize, "%u %s face:%llu[%d] detail:0x%x cost:%.3f",
+				ev.seq, traceEventName(ev.type), (unsigned long long)ev.ref, (int)ev.prim,
+				(unsigned int)ev.arg, ev.data[0]);
+			break;
+		case DT_TRACE_FUNNEL_STEP:
+			n = snprintf(buf, bufSize, "%u %s point:%d side:%s pos:(%.3f, %.3f, %.3f)",
+				ev.seq, traceEventName(ev.type), (int)ev.arg, ev.side ? "right" : "left",
+				ev.data[0], ev.data[1], ev.data[2]);
+			break;
+		default:
+			n = snprintf(buf, bufSize, "%u %s type:%d", ev.seq, traceEventName(ev.type), (int)ev.type);
+			break;
+		}
+
+		if (n < 0)
+		{
+			buf[0] = 0;
+			return 0;
+		}
+		return dtMin(n, bufSize - 1);
+	}
 }
@@ -47,11 +47,21 @@ inline unsigned int dtHashRef(dtPolyRef a)
 }
 #endif
 
+inline unsigned int dtNodePrim(dtPrimIndex primIdx)
+{
+	dtAssert(primIdx == DT_INVALID_PRIM_INDEX || primIdx < DT_NODE_NULL_PRIM);
+	return primIdx == DT_INVALID_PRIM_INDEX ? DT_NODE_NULL_PRIM : (unsigned int)primIdx;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////
 dtNodePool::dtNodePool(int maxNodes, int hashSize) :
 	m_nodes(0),
+	m_entryEdges(0),
+	m_heapIndices(0),
 	m_first(0),
 	m_next(0),
+	m_bucketGens(0),
+	m_generation(1),
 	m_maxNodes(maxNodes),
 	m_hashSize(hashSize),
 	m_nodeCount(0)
@@ -59,41 +69,59 @@ dtNodePool::dtNodePool(int maxNodes, int hashSize) :
 	dtAssert(dtNextPow2(m_hashSize) == (unsigned int)m_hashSize);
 	// pidx is special as 0 means "none" and 1 is the first node. For that reason
 	// we have 1 fewer nodes available than the number of values it can contain.
-	dtAssert(m_maxNodes > 0 && m_maxNodes <= DT_NULL_IDX && m_maxNodes <= (1 << DT_NODE_PARENT_BITS) - 1);
+	dtAssert(m_maxNodes > 0 && m_maxNodes <= DT_MAX_NODES);
 
 	m_nodes = (dtNode*)dtAlloc(sizeof(dtNode)*m_maxNodes, DT_ALLOC_PERM);
+	m_entryEdges = (unsigned char*)dtAlloc(sizeof(unsigned char)*m_maxNodes, DT_ALLOC_PERM);
+	m_heapIndices = (dtNodeIndex*)dtAlloc(sizeof(dtNodeIndex)*m_maxNodes, DT_ALLOC_PERM);
 	m_next = (dtNodeIndex*)dtAlloc(sizeof(dtNodeIndex)*m_maxNodes, DT_ALLOC_PERM);
 	m_first = (dtNodeIndex*)dtAlloc(sizeof(dtNodeIndex)*hashSize, DT_ALLOC_PERM);
+	m_bucketGens = (unsigned int*)dtAlloc(sizeof(unsigned int)*hashSize, DT_ALLOC_PERM);
 
 	dtAssert(m_nodes);
+	dtAssert(m_entryEdges);
+	dtAssert(m_heapIndices);
 	dtAssert(m_next);
 	dtAssert(m_first);
+	dtAssert(m_bucketGens);
 
 	memset(m_first, 0xff, sizeof(dtNodeIndex)*m_hashSize);
 	memset(m_next, 0xff, sizeof(dtNodeIndex)*m_maxNodes);
+	memset(m_bucketGens, 0, sizeof(unsigned int)*m_hashSize);
 }
 
 dtNodePool::~dtNodePool()
 {
 	dtFree(m_nodes);
+	dtFree(m_entryEdges);
+	dtFree(m_heapIndices);
 	dtFree(m_next);
 	dtFree(m_first);
+	dtFree(m_bucketGens);
 }
 
+// The buckets are not touched, the ones written before the new generation read as empty.
+// Only when the generation wraps around the stamps are reset.
 void dtNodePool::clear()
 {
-	memset(m_first, 0xff, sizeof(dtNodeIndex)*m_hashSize);
+	m_generation++;
+	if (m_generation == 0)
+	{
+		memset(m_bucketGens, 0, sizeof(unsigned int)*m_hashSize);
+		m_generation = 1;
+	}
 	m_nodeCount = 0;
 }
 
 unsigned int dtNodePool::findNodes(dtPolyRef id, dtNode** nodes, const int maxNodes, dtPrimIndex primIdx/*=DT_INVALID_PRIM_INDEX*/)
 {
+	const unsigned int prim = dtNodePrim(primIdx);
 	int n = 0;
 	unsigned int bucket = dtHashRef(id) & (m_hashSize-1);
-	dtNodeIndex i = m_first[bucket];
+	dtNodeIndex i = getFirst(bucket);
 	while (i != DT_NULL_IDX)
 	{
-		if (m_nodes[i].id == id && m_nodes[i].primIdx == primIdx)
+		if (m_nodes[i].id == id && m_nodes[i].primIdx == prim)
 		{
 			if (n >= maxNodes)
 				return n;
@@ -107,11 +135,12 @@ unsigned int dtNodePool::findNodes(dtPolyRef id, dtNode** nodes, const int maxNo
 
 dtNode* dtNodePool::findNode(dtPolyRef id, unsigned char state, dtPrimIndex primIdx/*=DT_INVALID_PRIM_INDEX*/)
 {
+	const unsigned int prim = dtNodePrim(primIdx);
 	unsigned int bucket = dtHashRef(id) & (m_hashSize-1);
-	dtNodeIndex i = m_first[bucket];
+	dtNodeIndex i = getFirst(bucket);
 	while (i != DT_NULL_IDX)
 	{
-		if (m_nodes[i].id == id && m_nodes[i].state == state && m_nodes[i].primIdx == primIdx)
+		if (m_nodes[i].id == id && m_nodes[i].state == state && m_nodes[i].primIdx == prim)
 			return &m_nodes[i];
 		i = m_next[i];
 	}
@@ -120,12 +149,13 @@ dtNode* dtNodePool::findNode(dtPolyRef id, unsigned char state, dtPrimIndex prim
 
 dtNode* dtNodePool::getNode(dtPolyRef id, unsigned char state, dtPrimIndex primIdx/*=DT_INVALID_PRIM_INDEX*/)
 {
+	const unsigned int prim = dtNodePrim(primIdx);
 	unsigned int bucket = dtHashRef(id) & (m_hashSize-1);
-	dtNodeIndex i = m_first[bucket];
+	dtNodeIndex i = getFirst(bucket);
 	dtNode* node = 0;
 	while (i != DT_NULL_IDX)
 	{
-		if (m_nodes[i].id == id && m_nodes[i].state == state && m_nodes[i].primIdx == primIdx)
+		if (m_nodes[i].id == id && m_nodes[i].state == state && m_nodes[i].primIdx == prim)
 			return &m_nodes[i];
 		i = m_next[i];
 	}
@@ -144,10 +174,12 @@ dtNode* dtNodePool::getNode(dtPolyRef id, unsigned char state, dtPrimIndex primI
 	node->id = id;
 	node->state = state;
 	node->flags = 0;
-	node->primIdx = primIdx;
+	node->primIdx = prim;
+	m_entryEdges[i] = DT_NODE_NULL_EDGE;
 	
-	m_next[i] = m_first[bucket];
+	m_next[i] = getFirst(bucket);
 	m_first[bucket] = i;
+	m_bucketGens[bucket] = m_generation;
 	
 	return node;
 }
@@ -155,11 +187,25 @@ dtNode* dtNodePool::getNode(dtPolyRef id, unsigned char state, dtPrimIndex primI
 
 //////////////////////////////////////////////////////////////////////////////////////////
 dtNodeQueue::dtNodeQueue(int n) :
+	m_nodePool(0),
+	m_heap(0),
+	m_capacity(n),
+	m_size(0)
+{
+	dtAssert(m_capacity > 0);
+	
+	m_heap = (dtNode**)dtAlloc(sizeof(dtNode*)*(m_capacity+1), DT_ALLOC_PERM);
+	dtAssert(m_heap);
+}
+
+dtNodeQueue::dtNodeQueue(int n, dtNodePool* nodePool) :
+	m_nodePool(nodePool),
 	m_heap(0),
 	m_capacity(n),
 	m_size(0)
 {
 	dtAssert(m_capacity > 0);
+	dtAssert(m_nodePool);
 	
 	m_heap = (dtNode**)dtAlloc(sizeof(dtNode*)*(m_capacity+1), DT_ALLOC_PERM);
 	dtAssert(m_heap);
@@ -172,30 +218,39 @@ dtNodeQueue::~dtNodeQueue()
 
 void dtNodeQueue::bubbleUp(int i, dtNode* node)
 {
-	int parent = (i-1)/2;
+	int parent = (i-1)/DT_NODE_QUEUE_ARITY;
 	// note: (index > 0) means there is a parent
 	while ((i > 0) && (m_heap[parent]->total > node->total))
 	{
 		m_heap[i] = m_heap[parent];
+		if (m_nodePool)
+			m_nodePool->setHeapIndex(m_heap[i], (dtNodeIndex)i);
 		i = parent;
-		parent = (i-1)/2;
+		parent = (i-1)/DT_NODE_QUEUE_ARITY;
 	}
 	m_heap[i] = node;
+	if (m_nodePool)
+		m_nodePool->setHeapIndex(node, (dtNodeIndex)i);
 }
 
 void dtNodeQueue::trickleDown(int i, dtNode* node)
 {
-	int child = (i*2)+1;
+	int child = (i*DT_NODE_QUEUE_ARITY)+1;
 	while (child < m_size)
 	{
-		if (((child+1) < m_size) && 
-			(m_heap[child]->total > m_heap[child+1]->total))
+		// Smallest of the children.
+		const int end = dtMin(child+DT_NODE_QUEUE_ARITY, m_size);
+		int best = child;
+		for (int j = child+1; j < end; ++j)
 		{
-			child++;
+			if (m_heap[best]->total > m_heap[j]->total)
+				best = j;
 		}
-		m_heap[i] = m_heap[child];
-		i = child;
-		child = (i*2)+1;
+		m_heap[i] = m_heap[best];
+		if (m_nodePool)
+			m_nodePool->setHeapIndex(m_heap[i], (dtNodeIndex)i);
+		i = best;
+		child = (i*DT_NODE_QUEUE_ARITY)+1;
 	}
 	bubbleUp(i, node);
 }
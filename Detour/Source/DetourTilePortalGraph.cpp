@@ -0,0 +1,438 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include <float.h>
+#include <string.h>
+#include <new>
+#include "DetourTilePortalGraph.h"
+#include "DetourNode.h"
+#include "DetourCommon.h"
+#include "DetourAlloc.h"
+#include "DetourAssert.h"
+
+// Update marks of the tiles.
+static const unsigned char TILE_REBUILD = 0x01;
+static const unsigned char TILE_RELINK = 0x02;
+
+// The middle of the portal of the link, like dtNavMeshQuery::getEdgeMidPoint.
+static void getLinkPortalMid(const dtNavMesh* nav, const dtMeshTile* tile, const dtPoly* poly,
+							 dtPolyRef ref, const dtLink& link, float* mid)
+{
+	if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+	{
+		dtVcopy(mid, &tile->verts[poly->verts[link.edge]*3]);
+		return;
+	}
+
+	const dtMeshTile* toTile = 0;
+	const dtPoly* toPoly = 0;
+	nav->getTileAndPolyByRefUnsafe(link.ref, &toTile, &toPoly);
+	if (toPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+	{
+		for (unsigned int i = toPoly->firstLink; i != DT_NULL_LINK; i = toTile->links[i].next)
+		{
+			if (toTile->links[i].ref == ref)
+			{
+				dtVcopy(mid, &toTile->verts[toPoly->verts[toTile->links[i].edge]*3]);
+				return;
+			}
+		}
+		dtVcopy(mid, &tile->verts[poly->verts[0]*3]);
+		return;
+	}
+
+	const float* v0 = &tile->verts[poly->verts[link.edge]*3];
+	const float* v1 = &tile->verts[poly->verts[(link.edge+1) % (int)poly->vertCount]*3];
+	float tmin = 0.0f, tmax = 1.0f;
+	if (link.side != 0xff && (link.bmin != 0 || link.bmax != 255))
+	{
+		const float s = 1.0f/255.0f;
+		tmin = link.bmin*s;
+		tmax = link.bmax*s;
+	}
+	dtVlerp(mid, v0, v1, (tmin + tmax)*0.5f);
+}
+
+/// @par
+///
+/// The search is a Dijkstra search: the nodes are stepped like in dtNavMeshQuery::findPath, without heuristic.
+/// The nodes that did not fit the pool are skipped and #DT_OUT_OF_NODES is returned.
+dtStatus dtSearchTilePolys(const dtNavMesh* nav, const dtQueryFilter* filter,
+						   dtNodePool* nodePool, dtNodeQueue* openList,
+						   dtPolyRef startRef, const float* startPos, const unsigned char state)
+{
+	dtAssert(nav && filter && nodePool && openList);
+
+	openList->clear();
+	dtNode* startNode = nodePool->getNode(startRef, state);
+	if (!startNode)
+		return DT_FAILURE | DT_OUT_OF_NODES;
+	dtVcopy(startNode->pos, startPos);
+	startNode->pidx = 0;
+	startNode->cost = 0;
+	startNode->total = 0;
+	startNode->flags = DT_NODE_OPEN;
+	openList->push(startNode);
+
+	const unsigned int tileIndex = nav->decodePolyIdTile(startRef);
+	dtStatus status = DT_SUCCESS;
+
+	while (!openList->empty())
+	{
+		dtNode* bestNode = openList->pop();
+		bestNode->flags &= ~DT_NODE_OPEN;
+		bestNode->flags |= DT_NODE_CLOSED;
+
+		const dtPolyRef bestRef = bestNode->id;
+		const dtMeshTile* bestTile = 0;
+		const dtPoly* bestPoly = 0;
+		nav->getTileAndPolyByRefUnsafe(bestRef, &bestTile, &bestPoly);
+
+		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
+		{
+			const dtLink& link = bestTile->links[i];
+			const dtPolyRef neighbourRef = link.ref;
+			// Stay in the tile.
+			if (!neighbourRef || nav->decodePolyIdTile(neighbourRef) != tileIndex)
+				continue;
+
+			const dtMeshTile* neighbourTile = 0;
+			const dtPoly* neighbourPoly = 0;
+			nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);
+			if (!filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
+				continue;
+
+			dtNode* neighbourNode = nodePool->getNode(neighbourRef, state);
+			if (!neighbourNode)
+			{
+				status |= DT_OUT_OF_NODES;
+				continue;
+			}
+
+			if (neighbourNode->flags == 0)
+				getLinkPortalMid(nav, bestTile, bestPoly, bestRef, link, neighbourNode->pos);
+
+			const float cost = bestNode->cost + filter->getCost(bestNode->pos, neighbourNode->pos,
+				0, 0, 0, bestRef, bestTile, bestPoly, neighbourRef, neighbourTile, neighbourPoly);
+
+			if ((neighbourNode->flags & (DT_NODE_OPEN | DT_NODE_CLOSED)) && cost >= neighbourNode->cost)
+				continue;
+
+			neighbourNode->pidx = nodePool->getNodeIdx(bestNode);
+			neighbourNode->flags = (neighbourNode->flags & ~DT_NODE_CLOSED);
+			neighbourNode->cost = cost;
+			neighbourNode->total = cost;
+
+			if (neighbourNode->flags & DT_NODE_OPEN)
+			{
+				openList->modify(neighbourNode);
+			}
+			else
+			{
+				neighbourNode->flags |= DT_NODE_OPEN;
+				openList->push(neighbourNode);
+			}
+		}
+	}
+
+	return status;
+}
+
+dtTilePortalGraph::dtTilePortalGraph() :
+	m_nav(0),
+	m_tileGeneration(0),
+	m_maxTiles(0),
+	m_tiles(0),
+	m_marks(0),
+	m_updatedTileCount(0),
+	m_nodePool(0),
+	m_openList(0)
+{
+}
+
+dtTilePortalGraph::~dtTilePortalGraph()
+{
+	clear();
+}
+
+void dtTilePortalGraph::clear()
+{
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		dtFree(m_tiles[i].portals);
+		dtFree(m_tiles[i].costs);
+	}
+	dtFree(m_tiles);
+	dtFree(m_marks);
+	if (m_nodePool)
+		m_nodePool->~dtNodePool();
+	if (m_openList)
+		m_openList->~dtNodeQueue();
+	dtFree(m_nodePool);
+	dtFree(m_openList);
+
+	m_nav = 0;
+	m_tileGeneration = 0;
+	m_maxTiles = 0;
+	m_tiles = 0;
+	m_marks = 0;
+	m_updatedTileCount = 0;
+	m_nodePool = 0;
+	m_openList = 0;
+}
+
+/// @par
+///
+/// The intra-tile searches need a node per polygon of the largest tile, a tile that does not fit
+/// keeps the portals that were reached and the update returns #DT_OUT_OF_NODES.
+dtStatus dtTilePortalGraph::init(const dtNavMesh* nav, const int maxNodes)
+{
+	clear();
+
+	if (!nav || maxNodes <= 0 || maxNodes > DT_MAX_NODES)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	m_nav = nav;
+	m_maxTiles = nav->getMaxTiles();
+
+	m_tiles = (TileGraph*)dtAlloc(sizeof(TileGraph)*m_maxTiles, DT_ALLOC_PERM);
+	m_marks = (unsigned char*)dtAlloc(sizeof(unsigned char)*m_maxTiles, DT_ALLOC_PERM);
+	m_nodePool = new (dtAlloc(sizeof(dtNodePool), DT_ALLOC_PERM)) dtNodePool(maxNodes, dtNextPow2(maxNodes/4));
+	m_openList = new (dtAlloc(sizeof(dtNodeQueue), DT_ALLOC_PERM)) dtNodeQueue(maxNodes, m_nodePool);
+	if (!m_tiles || !m_marks || !m_nodePool || !m_openList)
+	{
+		// clear() walks the tiles.
+		if (m_tiles)
+			memset(m_tiles, 0, sizeof(TileGraph)*m_maxTiles);
+		else
+			m_maxTiles = 0;
+		clear();
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+	memset(m_tiles, 0, sizeof(TileGraph)*m_maxTiles);
+	memset(m_marks, 0, sizeof(unsigned char)*m_maxTiles);
+
+	// Every tile is new.
+	m_tileGeneration = nav->getTileGeneration() - 1;
+	return update();
+}
+
+void dtTilePortalGraph::markTileAndNeighbours(const int x, const int y, unsigned char flag)
+{
+	static const int MAX_NEIS = 32;
+	const dtMeshTile* neis[MAX_NEIS];
+	for (int dy = -1; dy <= 1; ++dy)
+	{
+		for (int dx = -1; dx <= 1; ++dx)
+		{
+			const int n = m_nav->getTilesAt(x+dx, y+dy, neis, MAX_NEIS);
+			for (int i = 0; i < n; ++i)
+				m_marks[m_nav->decodePolyIdTile(m_nav->getTileRef(neis[i]))] |= flag;
+		}
+	}
+}
+
+/// @par
+///
+/// A tile added or removed changes the links of its neighbours, so their portals are rebuilt too.
+/// The rest of the graph is kept. The changes are found by comparing the tile references,
+/// the update is cheap when nothing changed.
+dtStatus dtTilePortalGraph::update()
+{
+	if (!m_tiles)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	if (m_nav->getTileGeneration() == m_tileGeneration)
+	{
+		m_updatedTileCount = 0;
+		return DT_SUCCESS;
+	}
+
+	memset(m_marks, 0, sizeof(unsigned char)*m_maxTiles);
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const dtMeshTile* tile = m_nav->getTile(i);
+		const dtTileRef ref = (tile && tile->header) ? m_nav->getTileRef(tile) : 0;
+		if (ref == m_tiles[i].ref)
+			continue;
+		// The neighbours of the removed tile lost their links to it.
+		m_marks[i] |= TILE_REBUILD;
+		if (m_tiles[i].ref)
+			markTileAndNeighbours(m_tiles[i].x, m_tiles[i].y, TILE_REBUILD);
+		if (ref)
+			markTileAndNeighbours(tile->header->x, tile->header->y, TILE_REBUILD);
+	}
+
+	dtStatus status = DT_SUCCESS;
+	m_updatedTileCount = 0;
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		if (!(m_marks[i] & TILE_REBUILD))
+			continue;
+		status |= buildTile(i);
+		m_updatedTileCount++;
+	}
+
+	// The twins pointing to the rebuilt tiles moved, relink the neighbours too.
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		if (!(m_marks[i] & TILE_REBUILD))
+			continue;
+		m_marks[i] |= TILE_RELINK;
+		if (m_tiles[i].ref)
+			markTileAndNeighbours(m_tiles[i].x, m_tiles[i].y, TILE_RELINK);
+	}
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		if (m_marks[i] & TILE_RELINK)
+			linkTwins(i);
+	}
+
+	if (dtStatusFailed(status))
+		return status;
+
+	m_tileGeneration = m_nav->getTileGeneration();
+	return status;
+}
+
+dtStatus dtTilePortalGraph::buildTile(const int tileIndex)
+{
+	TileGraph& graph = m_tiles[tileIndex];
+	dtFree(graph.portals);
+	dtFree(graph.costs);
+	graph.ref = 0;
+	graph.portalCount = 0;
+	graph.portals = 0;
+	graph.costs = 0;
+
+	const dtMeshTile* tile = m_nav->getTile(tileIndex);
+	if (!tile || !tile->header)
+		return DT_SUCCESS;
+
+	graph.ref = m_nav->getTileRef(tile);
+	graph.x = tile->header->x;
+	graph.y = tile->header->y;
+
+	dtStatus status = DT_SUCCESS;
+	const dtPolyRef base = m_nav->getPolyRefBase(tile);
+
+	int portalCount = 0;
+	for (int i = 0; i < tile->header->polyCount; ++i)
+	{
+		const dtPoly* poly = &tile->polys[i];
+		for (unsigned int j = poly->firstLink; j != DT_NULL_LINK; j = tile->links[j].next)
+		{
+			if (tile->links[j].ref && m_nav->decodePolyIdTile(tile->links[j].ref) != (unsigned int)tileIndex)
+				portalCount++;
+		}
+	}
+	if (portalCount > DT_MAX_TILE_PORTALS)
+	{
+		portalCount = DT_MAX_TILE_PORTALS;
+		status |= DT_BUFFER_TOO_SMALL;
+	}
+	if (!portalCount)
+		return status;
+
+	graph.portals = (dtTilePortal*)dtAlloc(sizeof(dtTilePortal)*portalCount, DT_ALLOC_PERM);
+	graph.costs = (float*)dtAlloc(sizeof(float)*portalCount*portalCount, DT_ALLOC_PERM);
+	if (!graph.portals || !graph.costs)
+	{
+		dtFree(graph.portals);
+		dtFree(graph.costs);
+		graph.portals = 0;
+		graph.costs = 0;
+		graph.ref = 0;
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+
+	int n = 0;
+	for (int i = 0; i < tile->header->polyCount && n < portalCount; ++i)
+	{
+		const dtPoly* poly = &tile->polys[i];
+		const dtPolyRef ref = base | (dtPolyRef)i;
+		for (unsigned int j = poly->firstLink; j != DT_NULL_LINK && n < portalCount; j = tile->links[j].next)
+		{
+			const dtLink& link = tile->links[j];
+			if (!link.ref || m_nav->decodePolyIdTile(link.ref) == (unsigned int)tileIndex)
+				continue;
+			dtTilePortal& portal = graph.portals[n++];
+			portal.poly = ref;
+			portal.neighbour = link.ref;
+			portal.twin = -1;
+			getLinkPortalMid(m_nav, tile, poly, ref, link, portal.pos);
+		}
+	}
+	graph.portalCount = n;
+
+	// One search per portal, the cost to another portal is the cost to its polygon,
+	// then from the node position to the middle of the portal.
+	for (int i = 0; i < n; ++i)
+	{
+		m_nodePool->clear();
+		status |= dtSearchTilePolys(m_nav, &m_filter, m_nodePool, m_openList,
+									graph.portals[i].poly, graph.portals[i].pos, 0);
+		for (int j = 0; j < n; ++j)
+		{
+			const dtTilePortal& to = graph.portals[j];
+			const dtNode* node = m_nodePool->findNode(to.poly, 0);
+			float cost = FLT_MAX;
+			if (node)
+			{
+				const dtMeshTile* toTile = 0;
+				const dtPoly* toPoly = 0;
+				m_nav->getTileAndPolyByRefUnsafe(to.poly, &toTile, &toPoly);
+				cost = node->cost + m_filter.getCost(node->pos, to.pos, 0, 0, 0, to.poly, toTile, toPoly, 0, 0, 0);
+			}
+			graph.costs[i*n + j] = i == j ? 0.0f : cost;
+		}
+	}
+	// The search failures are per portal, the tile is kept.
+	return status & ~DT_FAILURE;
+}
+
+void dtTilePortalGraph::linkTwins(const int tileIndex)
+{
+	TileGraph& graph = m_tiles[tileIndex];
+	for (int i = 0; i < graph.portalCount; ++i)
+	{
+		dtTilePortal& portal = graph.portals[i];
+		portal.twin = -1;
+		const TileGraph& other = m_tiles[m_nav->decodePolyIdTile(portal.neighbour)];
+		for (int j = 0; j < other.portalCount; ++j)
+		{
+			if (other.portals[j].poly == portal.neighbour && other.portals[j].neighbour == portal.poly)
+			{
+				portal.twin = j;
+				break;
+			}
+		}
+	}
+}
+
+const dtTilePortal* dtTilePortalGraph::getPortals(const int tileIndex, int* portalCount) const
+{
+	dtAssert(tileIndex >= 0 && tileIndex < m_maxTiles);
+	*portalCount = m_tiles[tileIndex].portalCount;
+	return m_tiles[tileIndex].portals;
+}
+
+const float* dtTilePortalGraph::getCosts(const int tileIndex) const
+{
+	dtAssert(tileIndex >= 0 && tileIndex < m_maxTiles);
+	return m_tiles[tileIndex].costs;
+}
@@ -23,6 +23,7 @@
 #include "DetourObstacleAvoidance.h"
 #include "DetourLocalBoundary.h"
 #include "DetourPathCorridor.h"
+#include "DetourFaceCorridor.h"
 #include "DetourProximityGrid.h"
 #include "DetourPathQueue.h"
 
@@ -127,6 +128,14 @@ struct dtCrowdAgent
 	/// The path corridor the agent is using.
 	dtPathCorridor corridor;
 
+	/// True if the agent is larger than the radius path threshold and follows #faceCorridor.
+	/// #corridor is then kept on the polygon containing the agent.
+	/// @see dtCrowd::setRadiusPathThreshold()
+	bool radiusPath;
+
+	/// The face corridor the agent is using when #radiusPath is set.
+	dtFaceCorridor faceCorridor;
+
 	/// The local boundary data for the agent.
 	dtLocalBoundary boundary;
 	
@@ -165,6 +174,7 @@ struct dtCrowdAgent
 	
 	unsigned char targetState;			///< State of the movement request.
 	dtPolyRef targetRef;				///< Target polyref of the movement request.
+	dtPolyFace targetFace;				///< Target face of the movement request. (Only used if #radiusPath is set.)
 	float targetPos[3];					///< Target position of the movement request (or velocity in case of DT_CROWDAGENT_TARGET_VELOCITY).
 	dtPathQueueRef targetPathqRef;		///< Path finder ref.
 	bool targetReplan;					///< Flag indicating that the current path is being replanned.
@@ -215,6 +225,7 @@ class dtCrowd
 	dtProximityGrid* m_grid;
 	
 	dtPolyRef* m_pathResult;
+	dtPolyFace* m_facePathResult;
 	int m_maxPathResult;
 	
 	float m_agentPlacementHalfExtents[3];
@@ -225,6 +236,9 @@ class dtCrowd
 
 	int m_velocitySampleCount;
 
+	float m_radiusPathThreshold;
+	funnel::dtRadiusPathScratch m_radiusScratch;
+
 	dtNavMeshQuery* m_navquery;
 
 	void updateTopologyOptimization(dtCrowdAgent** agents, const int nagents, const float dt);
@@ -235,6 +249,11 @@ class dtCrowd
 
 	bool requestMoveTargetReplan(const int idx, dtPolyRef ref, const float* pos);
 
+	inline bool needsRadiusPath(const float radius) const { return m_radiusPathThreshold > 0.0f && radius > m_radiusPathThreshold; }
+	void resetFaceCorridor(dtCrowdAgent* ag);
+	void updateFaceMoveRequest(dtCrowdAgent* ag);
+	void applyFacePathResult(dtCrowdAgent* ag);
+
 	void purge();
 	
 public:
@@ -317,6 +336,15 @@ public:
 	///  @param[out]	debug	A debug object to load with debug information. [Opt]
 	void update(const float dt, dtCrowdAgentDebugInfo* debug);
 	
+	/// Sets the radius above which agents plan and move through a #dtFaceCorridor.
+	/// Applies to the agents added or updated afterwards.
+	///  @param[in]		radius	The radius threshold. Zero disables radius pathfinding. [Limit: >= 0]
+	inline void setRadiusPathThreshold(const float radius) { m_radiusPathThreshold = radius; }
+
+	/// Gets the radius above which agents plan and move through a #dtFaceCorridor.
+	/// @return The radius threshold, zero if radius pathfinding is disabled.
+	inline float getRadiusPathThreshold() const { return m_radiusPathThreshold; }
+
 	/// Gets the filter used by the crowd.
 	/// @return The filter used by the crowd.
 	inline const dtQueryFilter* getFilter(const int i) const { return (i >= 0 && i < DT_CROWD_MAX_QUERY_FILTER_TYPE) ? &m_filters[i] : 0; }
@@ -0,0 +1,144 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef DETOURFACECORRIDOR_H
+#define DETOURFACECORRIDOR_H
+
+#include "DetourNavMeshQuery.h"
+
+/// Represents a dynamic face corridor used to plan the movement of large agents.
+/// Same usage as #dtPathCorridor, the path is made of faces found by
+/// #dtNavMeshQuery::findPathByRadius() and every query takes the radius of the agent.
+/// @ingroup crowd, detour
+class dtFaceCorridor
+{
+	float m_pos[3];
+	float m_target[3];
+
+	dtPolyFace* m_path;
+	dtPolyEdge* m_portals;		///< m_portals[i] is the edge of m_path[i] leading to m_path[i+1].
+	int m_npath;
+	int m_maxPath;
+
+public:
+	dtFaceCorridor();
+	~dtFaceCorridor();
+
+	/// Allocates the corridor's path buffers.
+	///  @param[in]		maxPath		The maximum path size the corridor can handle.
+	/// @return True if the initialization succeeded.
+	bool init(const int maxPath);
+
+	/// Resets the path corridor to the specified position.
+	///  @param[in]		ref		The face containing the position.
+	///  @param[in]		pos		The new position in the corridor. [(x, y, z)]
+	void reset(const dtPolyFace& ref, const float* pos);
+
+	/// Finds the corners in the corridor from the position toward the target.
+	/// The corners go around the path vertices at the distance of @p radius.
+	///  @param[out]	cornerVerts		The corner vertices. [(x, y, z) * cornerCount] [Size: <= maxCorners]
+	///  @param[out]	cornerFlags		The flag for each corner. [(flag) * cornerCount] [Size: <= maxCorners]
+	///  @param[in]		maxCorners		The maximum number of corners the buffers can hold.
+	///  @param[in]		radius			The radius of the agent.
+	///  @param[in]		scratch			The temporary storage of the funnel, sized for the corridor path.
+	/// @return The number of corners returned in the corner buffers. [0 <= value <= @p maxCorners]
+	int findCorners(float* cornerVerts, unsigned char* cornerFlags, const int maxCorners,
+					const float radius, funnel::dtRadiusPathScratch* scratch);
+
+	/// Attempts to optimize the path if the agent fits on the way to the specified point.
+	///  @param[in]		next					The point to search toward. [(x, y, z])
+	///  @param[in]		pathOptimizationRange	The maximum range to search. [Limit: > 0]
+	///  @param[in]		radius					The radius of the agent.
+	///  @param[in]		navquery				The query object used to build the corridor.
+	///  @param[in]		filter					The filter to apply to the operation.
+	void optimizePathVisibility(const float* next, const float pathOptimizationRange, const float radius,
+								dtNavMeshQuery* navquery, const dtQueryFilter* filter);
+
+	/// Attempts to optimize the path using a local area search. (Partial replanning.)
+	///  @param[in]		radius		The radius of the agent.
+	///  @param[in]		navquery	The query object used to build the corridor.
+	///  @param[in]		filter		The filter to apply to the operation.
+	bool optimizePathTopology(const float radius, dtNavMeshQuery* navquery, const dtQueryFilter* filter);
+
+	/// Checks the current corridor path to see if its faces remain valid.
+	///  @param[in]		maxLookAhead	The number of faces from the beginning of the corridor to search.
+	///  @param[in]		navquery		The query object used to build the corridor.
+	///  @param[in]		filter			The filter to apply to the operation.
+	bool isValid(const int maxLookAhead, dtNavMeshQuery* navquery, const dtQueryFilter* filter);
+
+	/// Moves the position from the current location to the desired location, adjusting the corridor
+	/// as needed to reflect the change. The agent keeps @p radius away from the walls.
+	///  @param[in]		npos		The desired new position. [(x, y, z)]
+	///  @param[in]		radius		The radius of the agent.
+	///  @param[in]		navquery	The query object used to build the corridor.
+	///  @param[in]		filter		The filter to apply to the operation.
+	/// @return Returns true if move succeeded.
+	bool movePosition(const float* npos, const float radius, dtNavMeshQuery* navquery, const dtQueryFilter* filter);
+
+	/// Loads a new path and target into the corridor.
+	/// The portals between the faces are looked up and the target is clamped into the last face.
+	///  @param[in]		target		The target location. [(x, y, z)]
+	///  @param[in]		path		The face corridor. [(face) * @p npath]
+	///  @param[in]		npath		The number of faces in the path.
+	void setCorridor(const float* target, const dtPolyFace* path, const int npath);
+
+	/// Gets the current position within the corridor. (In the first face.)
+	/// @return The current position within the corridor.
+	inline const float* getPos() const { return m_pos; }
+
+	/// Gets the current target within the corridor. (In the last face.)
+	/// @return The current target within the corridor.
+	inline const float* getTarget() const { return m_target; }
+
+	/// The first face in the corridor, the face containing the position.
+	/// @return The first face in the corridor. (Or an invalid face if there is no path.)
+	inline dtPolyFace getFirstFace() const { return m_npath ? m_path[0] : dtPolyFace(); }
+
+	/// The last face in the corridor, the face containing the target.
+	/// @return The last face in the corridor. (Or an invalid face if there is no path.)
+	inline dtPolyFace getLastFace() const { return m_npath ? m_path[m_npath-1] : dtPolyFace(); }
+
+	/// The corridor's path.
+	/// @return The corridor's path. [(face) * #getPathCount()]
+	inline const dtPolyFace* getPath() const { return m_path; }
+
+	/// The portals between the faces of the path.
+	/// @return The corridor's portals. [(edge) * (#getPathCount() - 1)]
+	inline const dtPolyEdge* getPortals() const { return m_portals; }
+
+	/// The number of faces in the current corridor path.
+	/// @return The number of faces in the current corridor path.
+	inline int getPathCount() const { return m_npath; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtFaceCorridor(const dtFaceCorridor&);
+	dtFaceCorridor& operator=(const dtFaceCorridor&);
+};
+
+/// Same as dtMergeCorridorStartMoved(), the portals of the merged faces are looked up again.
+/// The path is truncated before the first faces that are not adjacent.
+int dtMergeFaceCorridorStartMoved(dtPolyFace* path, dtPolyEdge* portals, const int npath, const int maxPath,
+								  const dtPolyFace* visited, const int nvisited);
+
+/// Same as dtMergeCorridorStartShortcut(), the portals of the merged faces are looked up again.
+/// The path is truncated before the first faces that are not adjacent.
+int dtMergeFaceCorridorStartShortcut(dtPolyFace* path, dtPolyEdge* portals, const int npath, const int maxPath,
+									 const dtPolyFace* visited, const int nvisited);
+
+#endif // DETOURFACECORRIDOR_H
@@ -34,8 +34,13 @@ class dtPathQueue
 		/// Path find start and end location.
 		float startPos[3], endPos[3];
 		dtPolyRef startRef, endRef;
+		/// Start and end faces of a radius request.
+		dtPolyFace startFace, endFace;
+		/// Radius of the unit, zero for a polygon path request.
+		float radius;
 		/// Result.
 		dtPolyRef* path;
+		dtPolyFace* facePath;
 		int npath;
 		/// State.
 		dtStatus status;
@@ -47,6 +52,7 @@ class dtPathQueue
 	PathQuery m_queue[MAX_QUEUE];
 	dtPathQueueRef m_nextHandle;
 	int m_maxPathSize;
+	dtPolyEdge* m_portalEdges;	///< Shared by the radius requests, only the faces are kept.
 	int m_queueHead;
 	dtNavMeshQuery* m_navquery;
 	
@@ -67,6 +73,14 @@ public:
 	dtStatus getRequestStatus(dtPathQueueRef ref) const;
 	
 	dtStatus getPathResult(dtPathQueueRef ref, dtPolyRef* path, int* pathSize, const int maxPath);
+
+	/// Queues a face path request for a unit of the given radius, see dtNavMeshQuery::findPathByRadius().
+	dtPathQueueRef requestByRadius(const dtPolyFace& startRef, const dtPolyFace& endRef,
+								   const float* startPos, const float* endPos,
+								   const dtQueryFilter* filter, const float radius);
+
+	/// Gets the faces of a completed radius request, the request is freed like getPathResult().
+	dtStatus getFacePathResult(dtPathQueueRef ref, dtPolyFace* path, int* pathSize, const int maxPath);
 	
 	inline const dtNavMeshQuery* getNavQuery() const { return m_navquery; }
 
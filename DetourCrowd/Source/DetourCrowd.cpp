@@ -337,9 +337,11 @@ dtCrowd::dtCrowd() :
 	m_obstacleQuery(0),
 	m_grid(0),
 	m_pathResult(0),
+	m_facePathResult(0),
 	m_maxPathResult(0),
 	m_maxAgentRadius(0),
 	m_velocitySampleCount(0),
+	m_radiusPathThreshold(0),
 	m_navquery(0)
 {
 }
@@ -365,6 +367,9 @@ void dtCrowd::purge()
 	
 	dtFree(m_pathResult);
 	m_pathResult = 0;
+
+	dtFree(m_facePathResult);
+	m_facePathResult = 0;
 	
 	dtFreeProximityGrid(m_grid);
 	m_grid = 0;
@@ -423,6 +428,16 @@ bool dtCrowd::init(const int maxAgents, const float maxAgentRadius, dtNavMesh* n
 	m_pathResult = (dtPolyRef*)dtAlloc(sizeof(dtPolyRef)*m_maxPathResult, DT_ALLOC_PERM);
 	if (!m_pathResult)
 		return false;
+
+	m_facePathResult = (dtPolyFace*)dtAlloc(sizeof(dtPolyFace)*m_maxPathResult, DT_ALLOC_PERM);
+	if (!m_facePathResult)
+		return false;
+	for (int i = 0; i < m_maxPathResult; ++i)
+		new(&m_facePathResult[i]) dtPolyFace();
+
+	// The radius funnel needs the portals of a whole corridor plus three points.
+	if (!m_radiusScratch.init(m_maxPathResult + 3))
+		return false;
 	
 	if (!m_pathq.init(m_maxPathResult, MAX_PATHQUEUE_NODES, nav))
 		return false;
@@ -445,6 +460,8 @@ bool dtCrowd::init(const int maxAgents, const float maxAgentRadius, dtNavMesh* n
 		m_agents[i].active = false;
 		if (!m_agents[i].corridor.init(m_maxPathResult))
 			return false;
+		if (!m_agents[i].faceCorridor.init(m_maxPathResult))
+			return false;
 	}
 
 	for (int i = 0; i < m_maxAgents; ++i)
@@ -504,6 +521,36 @@ void dtCrowd::updateAgentParameters(const int idx, const dtCrowdAgentParams* par
 	if (idx < 0 || idx >= m_maxAgents)
 		return;
 	memcpy(&m_agents[idx].params, params, sizeof(dtCrowdAgentParams));
+
+	// The radius crossed the radius path threshold, switch corridors and replan from the current position.
+	dtCrowdAgent* ag = &m_agents[idx];
+	if (!ag->active || ag->radiusPath == needsRadiusPath(ag->params.radius))
+		return;
+
+	ag->radiusPath = !ag->radiusPath;
+	ag->corridor.reset(ag->corridor.getFirstPoly(), ag->npos);
+	if (ag->radiusPath)
+		resetFaceCorridor(ag);
+	ag->ncorners = 0;
+
+	if (ag->targetState != DT_CROWDAGENT_TARGET_NONE &&
+		ag->targetState != DT_CROWDAGENT_TARGET_VELOCITY &&
+		ag->targetState != DT_CROWDAGENT_TARGET_FAILED)
+	{
+		requestMoveTargetReplan(idx, ag->targetRef, ag->targetPos);
+	}
+}
+
+void dtCrowd::resetFaceCorridor(dtCrowdAgent* ag)
+{
+	dtPolyFace face;
+	float nearest[3];
+	if (ag->corridor.getFirstPoly() == 0 ||
+		dtStatusFailed(m_navquery->findNearestFace(ag->npos, m_agentPlacementHalfExtents, &m_filters[ag->params.queryFilterType], &face, nearest)))
+	{
+		face.reset();
+	}
+	ag->faceCorridor.reset(face, ag->npos);
 }
 
 /// @par
@@ -551,6 +598,10 @@ int dtCrowd::addAgent(const float* pos, const dtCrowdAgentParams* params)
 	dtVset(ag->nvel, 0,0,0);
 	dtVset(ag->vel, 0,0,0);
 	dtVcopy(ag->npos, nearest);
+
+	ag->radiusPath = needsRadiusPath(ag->params.radius);
+	if (ag->radiusPath)
+		resetFaceCorridor(ag);
 	
 	ag->desiredSpeed = 0;
 
@@ -692,7 +743,11 @@ void dtCrowd::updateMoveRequest(const float /*dt*/)
 		if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
 			continue;
 
-		if (ag->targetState == DT_CROWDAGENT_TARGET_REQUESTING)
+		if (ag->targetState == DT_CROWDAGENT_TARGET_REQUESTING && ag->radiusPath)
+		{
+			updateFaceMoveRequest(ag);
+		}
+		else if (ag->targetState == DT_CROWDAGENT_TARGET_REQUESTING)
 		{
 			const dtPolyRef* path = ag->corridor.getPath();
 			const int npath = ag->corridor.getPathCount();
@@ -772,8 +827,17 @@ void dtCrowd::updateMoveRequest(const float /*dt*/)
 	for (int i = 0; i < nqueue; ++i)
 	{
 		dtCrowdAgent* ag = queue[i];
-		ag->targetPathqRef = m_pathq.request(ag->corridor.getLastPoly(), ag->targetRef,
-											 ag->corridor.getTarget(), ag->targetPos, &m_filters[ag->params.queryFilterType]);
+		if (ag->radiusPath)
+		{
+			ag->targetPathqRef = m_pathq.requestByRadius(ag->faceCorridor.getLastFace(), ag->targetFace,
+														 ag->faceCorridor.getTarget(), ag->targetPos,
+														 &m_filters[ag->params.queryFilterType], ag->params.radius);
+		}
+		else
+		{
+			ag->targetPathqRef = m_pathq.request(ag->corridor.getLastPoly(), ag->targetRef,
+												 ag->corridor.getTarget(), ag->targetPos, &m_filters[ag->params.queryFilterType]);
+		}
 		if (ag->targetPathqRef != DT_PATHQ_INVALID)
 			ag->targetState = DT_CROWDAGENT_TARGET_WAITING_FOR_PATH;
 	}
@@ -807,6 +871,10 @@ void dtCrowd::updateMoveRequest(const float /*dt*/)
 					ag->targetState = DT_CROWDAGENT_TARGET_FAILED;
 				ag->targetReplanTime = 0.0;
 			}
+			else if (dtStatusSucceed(status) && ag->radiusPath)
+			{
+				applyFacePathResult(ag);
+			}
 			else if (dtStatusSucceed(status))
 			{
 				const dtPolyRef* path = ag->corridor.getPath();
@@ -905,6 +973,142 @@ void dtCrowd::updateMoveRequest(const float /*dt*/)
 }
 
 
+void dtCrowd::updateFaceMoveRequest(dtCrowdAgent* ag)
+{
+	const dtQueryFilter* filter = &m_filters[ag->params.queryFilterType];
+	const dtPolyFace* path = ag->faceCorridor.getPath();
+	const int npath = ag->faceCorridor.getPathCount();
+	dtAssert(npath);
+
+	// The face search needs the face of the target.
+	float nearest[3];
+	ag->targetFace.reset();
+	m_navquery->findNearestFace(ag->targetPos, m_agentPlacementHalfExtents, filter, &ag->targetFace, nearest);
+	if (!ag->targetFace.isValid())
+	{
+		ag->targetState = DT_CROWDAGENT_TARGET_FAILED;
+		return;
+	}
+
+	static const int MAX_RES = 32;
+	float reqPos[3];
+	dtPolyFace reqPath[MAX_RES];	// The path to the request location
+	dtPolyEdge reqPortals[MAX_RES];
+	int reqPathCount = 0;
+	int reqPortalCount = 0;
+
+	// Quick search towards the goal.
+	static const int MAX_ITER = 20;
+	m_navquery->initSlicedFindPathByRadius(path[0], ag->targetFace, ag->npos, ag->targetPos, filter, ag->params.radius);
+	m_navquery->updateSlicedFindPathByRadius(MAX_ITER, 0);
+	dtStatus status = 0;
+	if (ag->targetReplan)
+	{
+		// Try to use existing steady path during replan if possible.
+		status = m_navquery->finalizeSlicedFindPathByRadiusPartial(path, npath, reqPath, &reqPathCount, MAX_RES,
+																   reqPortals, &reqPortalCount, MAX_RES);
+	}
+	else
+	{
+		// Try to move towards target when goal changes.
+		status = m_navquery->finalizeSlicedFindPathByRadius(reqPath, &reqPathCount, MAX_RES,
+															 reqPortals, &reqPortalCount, MAX_RES);
+	}
+
+	if (!dtStatusFailed(status) && reqPathCount > 0)
+	{
+		// The corridor constrains a partial target inside the last face.
+		dtVcopy(reqPos, ag->targetPos);
+	}
+	else
+	{
+		// Could not find path, start the request from current location.
+		dtVcopy(reqPos, ag->npos);
+		reqPath[0] = path[0];
+		reqPathCount = 1;
+	}
+
+	ag->faceCorridor.setCorridor(reqPos, reqPath, reqPathCount);
+	ag->boundary.reset();
+	ag->partial = false;
+
+	if (ag->faceCorridor.getLastFace() == ag->targetFace)
+	{
+		ag->targetState = DT_CROWDAGENT_TARGET_VALID;
+		ag->targetReplanTime = 0.0;
+	}
+	else
+	{
+		// The path is longer or potentially unreachable, full plan.
+		ag->targetState = DT_CROWDAGENT_TARGET_WAITING_FOR_QUEUE;
+	}
+}
+
+void dtCrowd::applyFacePathResult(dtCrowdAgent* ag)
+{
+	const dtPolyFace* path = ag->faceCorridor.getPath();
+	const int npath = ag->faceCorridor.getPathCount();
+	dtAssert(npath);
+
+	dtPolyFace* res = m_facePathResult;
+	bool valid = true;
+	int nres = 0;
+	dtStatus status = m_pathq.getFacePathResult(ag->targetPathqRef, res, &nres, m_maxPathResult);
+	if (dtStatusFailed(status) || !nres)
+		valid = false;
+
+	if (dtStatusDetail(status, DT_PARTIAL_RESULT))
+		ag->partial = true;
+	else
+		ag->partial = false;
+
+	// Same merge as the polygon path, the request was issued at the end of the corridor.
+	if (valid && path[npath-1] != res[0])
+		valid = false;
+
+	if (valid && npath > 1)
+	{
+		// Make space for the old path.
+		if ((npath-1)+nres > m_maxPathResult)
+			nres = m_maxPathResult - (npath-1);
+
+		for (int j = nres-1; j >= 0; --j)
+			res[j+npath-1] = res[j];
+		// Copy old path in the beginning.
+		for (int j = 0; j < npath-1; ++j)
+			res[j] = path[j];
+		nres += npath-1;
+
+		// Remove trackbacks
+		for (int j = 0; j < nres; ++j)
+		{
+			if (j-1 >= 0 && j+1 < nres && res[j-1] == res[j+1])
+			{
+				for (int k = j+1; k < nres; ++k)
+					res[k-2] = res[k];
+				nres -= 2;
+				j -= 2;
+			}
+		}
+	}
+
+	if (valid)
+	{
+		// Set current corridor, a partial target is constrained inside the last face.
+		ag->faceCorridor.setCorridor(ag->targetPos, res, nres);
+		// Force to update boundary.
+		ag->boundary.reset();
+		ag->targetState = DT_CROWDAGENT_TARGET_VALID;
+	}
+	else
+	{
+		// Something went wrong.
+		ag->targetState = DT_CROWDAGENT_TARGET_FAILED;
+	}
+
+	ag->targetReplanTime = 0.0;
+}
+
 void dtCrowd::updateTopologyOptimization(dtCrowdAgent** agents, const int nagents, const float dt)
 {
 	if (!nagents)
@@ -932,7 +1136,10 @@ void dtCrowd::updateTopologyOptimization(dtCrowdAgent** agents, const int nagent
 	for (int i = 0; i < nqueue; ++i)
 	{
 		dtCrowdAgent* ag = queue[i];
-		ag->corridor.optimizePathTopology(m_navquery, &m_filters[ag->params.queryFilterType]);
+		if (ag->radiusPath)
+			ag->faceCorridor.optimizePathTopology(ag->params.radius, m_navquery, &m_filters[ag->params.queryFilterType]);
+		else
+			ag->corridor.optimizePathTopology(m_navquery, &m_filters[ag->params.queryFilterType]);
 		ag->topologyOptTime = 0;
 	}
 
@@ -985,6 +1192,8 @@ void dtCrowd::checkPathValidity(dtCrowdAgent** agents, const int nagents, const
 //			ag->corridor.trimInvalidPath(agentRef, agentPos, m_navquery, &m_filter);
 			ag->boundary.reset();
 			dtVcopy(ag->npos, agentPos);
+			if (ag->radiusPath)
+				resetFaceCorridor(ag);
 
 			replan = true;
 		}
@@ -1010,13 +1219,18 @@ void dtCrowd::checkPathValidity(dtCrowdAgent** agents, const int nagents, const
 			{
 				// Failed to reposition target, fail moverequest.
 				ag->corridor.reset(agentRef, agentPos);
+				if (ag->radiusPath)
+					ag->faceCorridor.reset(ag->faceCorridor.getFirstFace(), agentPos);
 				ag->partial = false;
 				ag->targetState = DT_CROWDAGENT_TARGET_NONE;
 			}
 		}
 
 		// If nearby corridor is not valid, replan.
-		if (!ag->corridor.isValid(CHECK_LOOKAHEAD, m_navquery, &m_filters[ag->params.queryFilterType]))
+		const bool corridorValid = ag->radiusPath ?
+			ag->faceCorridor.isValid(CHECK_LOOKAHEAD, m_navquery, &m_filters[ag->params.queryFilterType]) :
+			ag->corridor.isValid(CHECK_LOOKAHEAD, m_navquery, &m_filters[ag->params.queryFilterType]);
+		if (!corridorValid)
 		{
 			// Fix current path.
 //			ag->corridor.trimInvalidPath(agentRef, agentPos, m_navquery, &m_filter);
@@ -1027,9 +1241,11 @@ void dtCrowd::checkPathValidity(dtCrowdAgent** agents, const int nagents, const
 		// If the end of the path is near and it is not the requested location, replan.
 		if (ag->targetState == DT_CROWDAGENT_TARGET_VALID)
 		{
+			const int pathCount = ag->radiusPath ? ag->faceCorridor.getPathCount() : ag->corridor.getPathCount();
+			const dtPolyRef lastRef = ag->radiusPath ? ag->faceCorridor.getLastFace().polyId : ag->corridor.getLastPoly();
 			if (ag->targetReplanTime > TARGET_REPLAN_DELAY &&
-				ag->corridor.getPathCount() < CHECK_LOOKAHEAD &&
-				ag->corridor.getLastPoly() != ag->targetRef)
+				pathCount < CHECK_LOOKAHEAD &&
+				lastRef != ag->targetRef)
 				replan = true;
 		}
 
@@ -1107,20 +1323,35 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 			continue;
 		
 		// Find corners for steering
-		ag->ncorners = ag->corridor.findCorners(ag->cornerVerts, ag->cornerFlags, ag->cornerPolys,
-												DT_CROWDAGENT_MAX_CORNERS, m_navquery, &m_filters[ag->params.queryFilterType]);
+		if (ag->radiusPath)
+		{
+			// The corners go around the path vertices, they do not enter polygons.
+			ag->ncorners = ag->faceCorridor.findCorners(ag->cornerVerts, ag->cornerFlags, DT_CROWDAGENT_MAX_CORNERS,
+														ag->params.radius, &m_radiusScratch);
+			for (int j = 0; j < ag->ncorners; ++j)
+				ag->cornerPolys[j] = 0;
+		}
+		else
+		{
+			ag->ncorners = ag->corridor.findCorners(ag->cornerVerts, ag->cornerFlags, ag->cornerPolys,
+													DT_CROWDAGENT_MAX_CORNERS, m_navquery, &m_filters[ag->params.queryFilterType]);
+		}
 		
 		// Check to see if the corner after the next corner is directly visible,
 		// and short cut to there.
 		if ((ag->params.updateFlags & DT_CROWD_OPTIMIZE_VIS) && ag->ncorners > 0)
 		{
 			const float* target = &ag->cornerVerts[dtMin(1,ag->ncorners-1)*3];
-			ag->corridor.optimizePathVisibility(target, ag->params.pathOptimizationRange, m_navquery, &m_filters[ag->params.queryFilterType]);
+			if (ag->radiusPath)
+				ag->faceCorridor.optimizePathVisibility(target, ag->params.pathOptimizationRange, ag->params.radius,
+														m_navquery, &m_filters[ag->params.queryFilterType]);
+			else
+				ag->corridor.optimizePathVisibility(target, ag->params.pathOptimizationRange, m_navquery, &m_filters[ag->params.queryFilterType]);
 			
 			// Copy data for debug purposes.
 			if (debugIdx == i)
 			{
-				dtVcopy(debug->optStart, ag->corridor.getPos());
+				dtVcopy(debug->optStart, ag->radiusPath ? ag->faceCorridor.getPos() : ag->corridor.getPos());
 				dtVcopy(debug->optEnd, target);
 			}
 		}
@@ -1394,15 +1625,28 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
 			continue;
 		
-		// Move along navmesh.
-		ag->corridor.movePosition(ag->npos, m_navquery, &m_filters[ag->params.queryFilterType]);
-		// Get valid constrained position back.
-		dtVcopy(ag->npos, ag->corridor.getPos());
+		if (ag->radiusPath)
+		{
+			// Move along the faces, keeping the agent radius away from the walls.
+			ag->faceCorridor.movePosition(ag->npos, ag->params.radius, m_navquery, &m_filters[ag->params.queryFilterType]);
+			dtVcopy(ag->npos, ag->faceCorridor.getPos());
+			// The polygon corridor only tracks the polygon containing the agent.
+			ag->corridor.reset(ag->faceCorridor.getFirstFace().polyId, ag->npos);
+		}
+		else
+		{
+			// Move along navmesh.
+			ag->corridor.movePosition(ag->npos, m_navquery, &m_filters[ag->params.queryFilterType]);
+			// Get valid constrained position back.
+			dtVcopy(ag->npos, ag->corridor.getPos());
+		}
 
 		// If not using path, truncate the corridor to just one poly.
 		if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
 		{
 			ag->corridor.reset(ag->corridor.getFirstPoly(), ag->npos);
+			if (ag->radiusPath)
+				ag->faceCorridor.reset(ag->faceCorridor.getFirstFace(), ag->npos);
 			ag->partial = false;
 		}
 
@@ -0,0 +1,458 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include <string.h>
+#include <float.h>
+#include <new>
+#include "DetourFaceCorridor.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourCommon.h"
+#include "DetourAssert.h"
+#include "DetourAlloc.h"
+
+
+// Finds the edge of @p from shared with @p to.
+static bool findPortal(const dtPolyFace& from, const dtPolyFace& to, dtPolyEdge* portal)
+{
+	if (!from.isValid() || !to.isValid())
+		return false;
+
+	dtResolvedPolyFace fromFace(from);
+	if (!fromFace.isValid())
+		return false;
+
+	for (int k = 0; k < 3; ++k)
+	{
+		dtResolvedPolyEdge edge = queriers::faceLocalEdge(fromFace, k);
+		if (edge.isValid() && queriers::edgeRightFace(edge) == to)
+		{
+			*portal = edge;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Looks up the portals [first, last) of the path, returns the path size truncated before the first gap.
+static int linkFaces(const dtPolyFace* path, dtPolyEdge* portals, const int npath, const int first, const int last)
+{
+	const int end = dtMin(last, npath-1);
+	for (int i = first; i < end; ++i)
+	{
+		if (!findPortal(path[i], path[i+1], &portals[i]))
+			return i+1;
+	}
+	return npath;
+}
+
+// Moves count faces and their portals from src to dst, the ranges may overlap.
+static void moveFaces(dtPolyFace* path, dtPolyEdge* portals, const int dst, const int src, const int count)
+{
+	if (dst < src)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			path[dst+i] = path[src+i];
+			portals[dst+i] = portals[src+i];
+		}
+	}
+	else if (dst > src)
+	{
+		for (int i = count-1; i >= 0; --i)
+		{
+			path[dst+i] = path[src+i];
+			portals[dst+i] = portals[src+i];
+		}
+	}
+}
+
+static void closestPointOnFace(const dtPolyFace& face, const float* pos, float* closest)
+{
+	dtVcopy(closest, pos);
+
+	dtResolvedPolyVertex verts[3];
+	iterations::fromFaceToVertices iterFaceVerts(face);
+	if (iterFaceVerts.allVertices(verts, 3) != 3)
+		return;
+
+	float tri[9];
+	for (int i = 0; i < 3; ++i)
+		queriers::vertexPosition(verts[i], &tri[i*3]);
+
+	if (dtPointInPolygon(pos, tri, 3))
+		return;
+
+	float dmin = FLT_MAX;
+	for (int k = 0; k < 3; ++k)
+	{
+		float t;
+		const float d = dtDistancePtSegSqr2D(pos, &tri[k*3], &tri[((k+1)%3)*3], t);
+		if (d < dmin)
+		{
+			dmin = d;
+			dtVlerp(closest, &tri[k*3], &tri[((k+1)%3)*3], t);
+		}
+	}
+}
+
+int dtMergeFaceCorridorStartMoved(dtPolyFace* path, dtPolyEdge* portals, const int npath, const int maxPath,
+								  const dtPolyFace* visited, const int nvisited)
+{
+	int furthestPath = -1;
+	int furthestVisited = -1;
+
+	// Find furthest common face.
+	for (int i = npath-1; i >= 0; --i)
+	{
+		bool found = false;
+		for (int j = nvisited-1; j >= 0; --j)
+		{
+			if (path[i] == visited[j])
+			{
+				furthestPath = i;
+				furthestVisited = j;
+				found = true;
+			}
+		}
+		if (found)
+			break;
+	}
+
+	// If no intersection found just return current path.
+	if (furthestPath == -1 || furthestVisited == -1)
+		return npath;
+
+	// Concatenate paths.
+
+	// Adjust beginning of the buffer to include the visited.
+	const int req = nvisited - furthestVisited;
+	const int orig = dtMin(furthestPath+1, npath);
+	int size = dtMax(0, npath-orig);
+	if (req+size > maxPath)
+		size = maxPath-req;
+	if (size)
+		moveFaces(path, portals, req, orig, size);
+
+	// Store visited
+	for (int i = 0; i < req; ++i)
+		path[i] = visited[(nvisited-1)-i];
+
+	// The portals after the common face did not change.
+	return linkFaces(path, portals, req+size, 0, req);
+}
+
+int dtMergeFaceCorridorStartShortcut(dtPolyFace* path, dtPolyEdge* portals, const int npath, const int maxPath,
+									 const dtPolyFace* visited, const int nvisited)
+{
+	int furthestPath = -1;
+	int furthestVisited = -1;
+
+	// Find furthest common face.
+	for (int i = npath-1; i >= 0; --i)
+	{
+		bool found = false;
+		for (int j = nvisited-1; j >= 0; --j)
+		{
+			if (path[i] == visited[j])
+			{
+				furthestPath = i;
+				furthestVisited = j;
+				found = true;
+			}
+		}
+		if (found)
+			break;
+	}
+
+	// If no intersection found just return current path.
+	if (furthestPath == -1 || furthestVisited <= 0)
+		return npath;
+
+	// Concatenate paths.
+
+	// Adjust beginning of the buffer to include the visited.
+	const int req = furthestVisited;
+	const int orig = furthestPath;
+	int size = dtMax(0, npath-orig);
+	if (req+size > maxPath)
+		size = maxPath-req;
+	if (size)
+		moveFaces(path, portals, req, orig, size);
+
+	// Store visited
+	for (int i = 0; i < req; ++i)
+		path[i] = visited[i];
+
+	return linkFaces(path, portals, req+size, 0, req);
+}
+
+/**
+@class dtFaceCorridor
+@par
+
+The face version of #dtPathCorridor for agents that do not fit everywhere a point fits.
+The corridor is loaded with a path from #dtNavMeshQuery::findPathByRadius() or its sliced
+version, and follows the same usage: #reset(), #setCorridor(), then #findCorners() and
+#movePosition() every update.
+
+The corners go around the vertices of the path at the distance of the agent radius
+(#funnel::straightPathByRadius() followed by #funnel::dtRadiusModifier) and the movement
+keeps the agent radius away from the walls (#dtNavMeshQuery::moveAlongSurfaceByRadius()).
+
+Off-mesh connections are not part of the face topology, the corners never carry
+the #DT_STRAIGHTPATH_OFFMESH_CONNECTION flag.
+*/
+
+dtFaceCorridor::dtFaceCorridor() :
+	m_path(0),
+	m_portals(0),
+	m_npath(0),
+	m_maxPath(0)
+{
+}
+
+dtFaceCorridor::~dtFaceCorridor()
+{
+	dtFree(m_path);
+	dtFree(m_portals);
+}
+
+bool dtFaceCorridor::init(const int maxPath)
+{
+	dtAssert(!m_path);
+	m_path = (dtPolyFace*)dtAlloc(sizeof(dtPolyFace)*maxPath, DT_ALLOC_PERM);
+	if (!m_path)
+		return false;
+	m_portals = (dtPolyEdge*)dtAlloc(sizeof(dtPolyEdge)*maxPath, DT_ALLOC_PERM);
+	if (!m_portals)
+		return false;
+	for (int i = 0; i < maxPath; ++i)
+	{
+		new(&m_path[i]) dtPolyFace();
+		new(&m_portals[i]) dtPolyEdge();
+	}
+	m_npath = 0;
+	m_maxPath = maxPath;
+	return true;
+}
+
+void dtFaceCorridor::reset(const dtPolyFace& ref, const float* pos)
+{
+	dtAssert(m_path);
+	dtVcopy(m_pos, pos);
+	dtVcopy(m_target, pos);
+	m_path[0] = ref;
+	m_npath = 1;
+}
+
+/**
+@par
+
+Same as #dtPathCorridor::findCorners(), the target is the last corner when it is within range.
+Returns zero corners if the funnel fails, e.g. when @p scratch is too small for the path.
+*/
+int dtFaceCorridor::findCorners(float* cornerVerts, unsigned char* cornerFlags, const int maxCorners,
+								const float radius, funnel::dtRadiusPathScratch* scratch)
+{
+	dtAssert(m_path);
+	dtAssert(m_npath);
+
+	static const float MIN_TARGET_DIST = 0.01f;
+
+	// Only the beginning of the path is needed for steering.
+	static const int MAX_STRAIGHT = 8;
+	static const int MAX_MODIFIED = 32;
+
+	float straight[MAX_STRAIGHT*3];
+	unsigned char straightFlags[MAX_STRAIGHT];
+	int nstraight = 0;
+
+	if (m_npath > 1)
+	{
+		dtStatus status = funnel::straightPathByRadius(m_pos, m_target, m_path, m_npath, m_portals, m_npath-1,
+			straight, straightFlags, 0, &nstraight, MAX_STRAIGHT, radius, scratch);
+		if (dtStatusFailed(status) || nstraight == 0)
+			return 0;
+	}
+	else
+	{
+		// Start and target in the same face.
+		dtVcopy(&straight[0], m_pos);
+		straightFlags[0] = DT_STRAIGHTPATH_START;
+		dtVcopy(&straight[3], m_target);
+		straightFlags[1] = DT_STRAIGHTPATH_END;
+		nstraight = 2;
+	}
+
+	// 拐点按单位半径绕开
+	float modified[MAX_MODIFIED*3];
+	int nmodified = 0;
+	funnel::dtRadiusModifier modifier(radius);
+	dtStatus status = modifier.applyModify(straight, nstraight, modified, &nmodified, MAX_MODIFIED, scratch);
+	if (dtStatusFailed(status))
+		return 0;
+
+	// The last point is the target only if neither path was truncated.
+	const bool reachesEnd = (straightFlags[nstraight-1] & DT_STRAIGHTPATH_END) != 0 &&
+		!dtStatusDetail(status, DT_BUFFER_TOO_SMALL);
+
+	// Skip the start point, and prune points in the beginning of the path which are too close.
+	int ncorners = 0;
+	for (int i = 1; i < nmodified && ncorners < maxCorners; ++i)
+	{
+		if (ncorners == 0 && dtVdist2DSqr(&modified[i*3], m_pos) <= dtSqr(MIN_TARGET_DIST))
+			continue;
+		dtVcopy(&cornerVerts[ncorners*3], &modified[i*3]);
+		cornerFlags[ncorners] = (reachesEnd && i == nmodified-1) ? DT_STRAIGHTPATH_END : 0;
+		ncorners++;
+	}
+
+	return ncorners;
+}
+
+/**
+@par
+
+Same as #dtPathCorridor::optimizePathVisibility(), the visibility is checked with
+#dtNavMeshQuery::raycastByRadius() so the shortcut is only taken when the agent fits.
+*/
+void dtFaceCorridor::optimizePathVisibility(const float* next, const float pathOptimizationRange, const float radius,
+											dtNavMeshQuery* navquery, const dtQueryFilter* filter)
+{
+	dtAssert(m_path);
+
+	// Clamp the ray to max distance.
+	float goal[3];
+	dtVcopy(goal, next);
+	float dist = dtVdist2D(m_pos, goal);
+
+	// If too close to the goal, do not try to optimize.
+	if (dist < 0.01f)
+		return;
+
+	// Overshoot a little. This helps to optimize open fields in tiled meshes.
+	dist = dtMin(dist+0.01f, pathOptimizationRange);
+
+	// Adjust ray length.
+	float delta[3];
+	dtVsub(delta, goal, m_pos);
+	dtVmad(goal, m_pos, delta, pathOptimizationRange/dist);
+
+	static const int MAX_RES = 32;
+	dtPolyFace res[MAX_RES];
+	float t, norm[3];
+	int nres = 0;
+	navquery->raycastByRadius(m_path[0], m_pos, goal, filter, radius, &t, norm, res, &nres, MAX_RES);
+	if (nres > 1 && t > 0.99f)
+	{
+		m_npath = dtMergeFaceCorridorStartShortcut(m_path, m_portals, m_npath, m_maxPath, res, nres);
+	}
+}
+
+/**
+@par
+
+Same as #dtPathCorridor::optimizePathTopology(), using the sliced radius path query.
+*/
+bool dtFaceCorridor::optimizePathTopology(const float radius, dtNavMeshQuery* navquery, const dtQueryFilter* filter)
+{
+	dtAssert(navquery);
+	dtAssert(filter);
+	dtAssert(m_path);
+
+	if (m_npath < 3)
+		return false;
+
+	static const int MAX_ITER = 32;
+	static const int MAX_RES = 32;
+
+	dtPolyFace res[MAX_RES];
+	dtPolyEdge portals[MAX_RES];
+	int nres = 0, nportals = 0;
+	navquery->initSlicedFindPathByRadius(m_path[0], m_path[m_npath-1], m_pos, m_target, filter, radius);
+	navquery->updateSlicedFindPathByRadius(MAX_ITER, 0);
+	dtStatus status = navquery->finalizeSlicedFindPathByRadiusPartial(m_path, m_npath,
+		res, &nres, MAX_RES, portals, &nportals, MAX_RES);
+
+	if (dtStatusSucceed(status) && nres > 0)
+	{
+		m_npath = dtMergeFaceCorridorStartShortcut(m_path, m_portals, m_npath, m_maxPath, res, nres);
+		return true;
+	}
+
+	return false;
+}
+
+/**
+@par
+
+Same behavior as #dtPathCorridor::movePosition(), the agent is moved with
+#dtNavMeshQuery::moveAlongSurfaceByRadius() and does not enter the faces it does not fit through.
+*/
+bool dtFaceCorridor::movePosition(const float* npos, const float radius, dtNavMeshQuery* navquery, const dtQueryFilter* filter)
+{
+	dtAssert(m_path);
+	dtAssert(m_npath);
+
+	// Move along navmesh and update new position.
+	float result[3];
+	static const int MAX_VISITED = 16;
+	dtPolyFace visited[MAX_VISITED];
+	int nvisited = 0;
+	dtStatus status = navquery->moveAlongSurfaceByRadius(m_path[0], m_pos, npos, filter, radius,
+														 result, visited, &nvisited, MAX_VISITED);
+	if (dtStatusSucceed(status))
+	{
+		m_npath = dtMergeFaceCorridorStartMoved(m_path, m_portals, m_npath, m_maxPath, visited, nvisited);
+
+		// Adjust the position to stay on top of the navmesh.
+		float h = m_pos[1];
+		navquery->getPolyHeight(m_path[0].polyId, result, &h);
+		result[1] = h;
+		dtVcopy(m_pos, result);
+		return true;
+	}
+	return false;
+}
+
+void dtFaceCorridor::setCorridor(const float* target, const dtPolyFace* path, const int npath)
+{
+	dtAssert(m_path);
+	dtAssert(npath > 0);
+	dtAssert(npath < m_maxPath);
+
+	for (int i = 0; i < npath; ++i)
+		m_path[i] = path[i];
+	m_npath = linkFaces(m_path, m_portals, npath, 0, npath);
+
+	// Constrain the target inside the last face.
+	closestPointOnFace(m_path[m_npath-1], target, m_target);
+}
+
+bool dtFaceCorridor::isValid(const int maxLookAhead, dtNavMeshQuery* navquery, const dtQueryFilter* filter)
+{
+	// Check that all faces still pass query filter.
+	const int n = dtMin(m_npath, maxLookAhead);
+	for (int i = 0; i < n; ++i)
+	{
+		if (!navquery->isValidPolyRef(m_path[i].polyId, filter))
+			return false;
+	}
+
+	return true;
+}
@@ -17,6 +17,7 @@
 //
 
 #include <string.h>
+#include <new>
 #include "DetourPathQueue.h"
 #include "DetourNavMesh.h"
 #include "DetourNavMeshQuery.h"
@@ -27,11 +28,15 @@
 dtPathQueue::dtPathQueue() :
 	m_nextHandle(1),
 	m_maxPathSize(0),
+	m_portalEdges(0),
 	m_queueHead(0),
 	m_navquery(0)
 {
 	for (int i = 0; i < MAX_QUEUE; ++i)
+	{
 		m_queue[i].path = 0;
+		m_queue[i].facePath = 0;
+	}
 }
 
 dtPathQueue::~dtPathQueue()
@@ -47,7 +52,11 @@ void dtPathQueue::purge()
 	{
 		dtFree(m_queue[i].path);
 		m_queue[i].path = 0;
+		dtFree(m_queue[i].facePath);
+		m_queue[i].facePath = 0;
 	}
+	dtFree(m_portalEdges);
+	m_portalEdges = 0;
 }
 
 bool dtPathQueue::init(const int maxPathSize, const int maxSearchNodeCount, dtNavMesh* nav)
@@ -67,7 +76,18 @@ bool dtPathQueue::init(const int maxPathSize, const int maxSearchNodeCount, dtNa
 		m_queue[i].path = (dtPolyRef*)dtAlloc(sizeof(dtPolyRef)*m_maxPathSize, DT_ALLOC_PERM);
 		if (!m_queue[i].path)
 			return false;
+		m_queue[i].facePath = (dtPolyFace*)dtAlloc(sizeof(dtPolyFace)*m_maxPathSize, DT_ALLOC_PERM);
+		if (!m_queue[i].facePath)
+			return false;
+		for (int j = 0; j < m_maxPathSize; ++j)
+			new(&m_queue[i].facePath[j]) dtPolyFace();
 	}
+
+	m_portalEdges = (dtPolyEdge*)dtAlloc(sizeof(dtPolyEdge)*m_maxPathSize, DT_ALLOC_PERM);
+	if (!m_portalEdges)
+		return false;
+	for (int i = 0; i < m_maxPathSize; ++i)
+		new(&m_portalEdges[i]) dtPolyEdge();
 	
 	m_queueHead = 0;
 	
@@ -108,21 +128,45 @@ void dtPathQueue::update(const int maxIters)
 			continue;
 		}
 		
-		// Handle query start.
-		if (q.status == 0)
-		{
-			q.status = m_navquery->initSlicedFindPath(q.startRef, q.endRef, q.startPos, q.endPos, q.filter);
-		}		
-		// Handle query in progress.
-		if (dtStatusInProgress(q.status))
+		if (q.radius > 0.0f)
 		{
-			int iters = 0;
-			q.status = m_navquery->updateSlicedFindPath(iterCount, &iters);
-			iterCount -= iters;
+			// Same steps with the face search.
+			if (q.status == 0)
+			{
+				q.status = m_navquery->initSlicedFindPathByRadius(q.startFace, q.endFace, q.startPos, q.endPos,
+																  q.filter, q.radius);
+			}
+			if (dtStatusInProgress(q.status))
+			{
+				int iters = 0;
+				q.status = m_navquery->updateSlicedFindPathByRadius(iterCount, &iters);
+				iterCount -= iters;
+			}
+			if (dtStatusSucceed(q.status))
+			{
+				int nportals = 0;
+				q.status = m_navquery->finalizeSlicedFindPathByRadius(q.facePath, &q.npath, m_maxPathSize,
+																	  m_portalEdges, &nportals, m_maxPathSize);
+			}
 		}
-		if (dtStatusSucceed(q.status))
+		else
 		{
-			q.status = m_navquery->finalizeSlicedFindPath(q.path, &q.npath, m_maxPathSize);
+			// Handle query start.
+			if (q.status == 0)
+			{
+				q.status = m_navquery->initSlicedFindPath(q.startRef, q.endRef, q.startPos, q.endPos, q.filter);
+			}
+			// Handle query in progress.
+			if (dtStatusInProgress(q.status))
+			{
+				int iters = 0;
+				q.status = m_navquery->updateSlicedFindPath(iterCount, &iters);
+				iterCount -= iters;
+			}
+			if (dtStatusSucceed(q.status))
+			{
+				q.status = m_navquery->finalizeSlicedFindPath(q.path, &q.npath, m_maxPathSize);
+			}
 		}
 
 		if (iterCount <= 0)
@@ -159,6 +203,9 @@ dtPathQueueRef dtPathQueue::request(dtPolyRef startRef, dtPolyRef endRef,
 	q.startRef = startRef;
 	dtVcopy(q.endPos, endPos);
 	q.endRef = endRef;
+	q.startFace.reset();
+	q.endFace.reset();
+	q.radius = 0.0f;
 	
 	q.status = 0;
 	q.npath = 0;
@@ -198,3 +245,53 @@ dtStatus dtPathQueue::getPathResult(dtPathQueueRef ref, dtPolyRef* path, int* pa
 	}
 	return DT_FAILURE;
 }
+
+dtPathQueueRef dtPathQueue::requestByRadius(const dtPolyFace& startRef, const dtPolyFace& endRef,
+											const float* startPos, const float* endPos,
+											const dtQueryFilter* filter, const float radius)
+{
+	if (!(radius > 0.0f))
+		return DT_PATHQ_INVALID;
+
+	dtPathQueueRef ref = request(startRef.polyId, endRef.polyId, startPos, endPos, filter);
+	if (ref == DT_PATHQ_INVALID)
+		return DT_PATHQ_INVALID;
+
+	for (int i = 0; i < MAX_QUEUE; ++i)
+	{
+		if (m_queue[i].ref == ref)
+		{
+			PathQuery& q = m_queue[i];
+			q.startFace = startRef;
+			q.endFace = endRef;
+			q.radius = radius;
+			break;
+		}
+	}
+
+	return ref;
+}
+
+dtStatus dtPathQueue::getFacePathResult(dtPathQueueRef ref, dtPolyFace* path, int* pathSize, const int maxPath)
+{
+	for (int i = 0; i < MAX_QUEUE; ++i)
+	{
+		if (m_queue[i].ref == ref)
+		{
+			PathQuery& q = m_queue[i];
+			if (!(q.radius > 0.0f))
+				return DT_FAILURE | DT_INVALID_PARAM;
+			dtStatus details = q.status & DT_STATUS_DETAIL_MASK;
+			// Free request for reuse.
+			q.ref = DT_PATHQ_INVALID;
+			q.status = 0;
+			// Copy path
+			int n = dtMin(q.npath, maxPath);
+			for (int j = 0; j < n; ++j)
+				path[j] = q.facePath[j];
+			*pathSize = n;
+			return details | DT_SUCCESS;
+		}
+	}
+	return DT_FAILURE;
+}
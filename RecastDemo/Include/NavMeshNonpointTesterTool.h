@@ -33,8 +33,7 @@ class NavMeshNonpointTesterTool : public SampleTool
 
 	static const int MAX_POLYS = 256;
 	static const int MAX_SMOOTH = 2048;
-	static const int MAX_VISIT_FACES = 512;
-	static const int MAX_FUNNEL_STEPS = 1500;
+	static const int MAX_TRACE_EVENTS = 4096;
 
 	dtPolyFace m_startRef;
 	dtPolyFace m_endRef;
@@ -64,17 +63,8 @@ class NavMeshNonpointTesterTool : public SampleTool
 	int			m_nStraightPath;
 	float		m_modifiedStraightPath[MAX_POLYS * 3 * 2];
 	int			m_nModifiedStraightPath;
-
-#if DT_DEBUG_ASTAR
-	astar::dtAstarNodeDebug m_visitedFaces[MAX_VISIT_FACES];
-	int			m_nVisitedFaces;
-	funnel::dtFunnelDebug m_portalDebugs[MAX_POLYS];
-	int			m_portalDebugCount;
-	funnel::dtFunnelStep m_funnelSteps[MAX_FUNNEL_STEPS];
-	int			m_funnelStepCount;
-	funnel::dtRadiusModifierDebug m_modifierDebugs[MAX_POLYS];
-	int			m_modifierDebugCount;
-#endif
+	funnel::dtRadiusPathScratch m_radiusScratch;
+	debug::dtTraceBuffer m_trace;
 
 public:
 	NavMeshNonpointTesterTool();
@@ -91,6 +81,7 @@ public:
 	virtual void handleRenderOverlay(double* proj, double* model, int* view);
 
 	void recalc();
+	void dumpTrace(const char* path);
 	void drawAgent(const float* pos, float r, float h, float c, const unsigned int col);
 
 	void clampValues();
@@ -38,12 +38,10 @@ static float frand()
 static float debugYOffset = 0.0f;
 static bool  debugDrawNeiFaces = false;
 static float debugFindPathRadius = 0.5f;
-static float debugFindPathIters = 100;
 static bool  debugDrawAstarVisitedFaces = false;
 static bool  debugDrawAstarPathFaces = true;
 static bool  debugDrawFunnelPathEdges = false;
 static bool  debugDrawFunnelDebug = true;
-static float debugDrawFunnelPortalDebugIndex = 0;
 static bool  debugDrawFunnelStraightPath = true;
 static float debugDrawFunnelStepIndex = 0;
 
@@ -151,12 +149,6 @@ NavMeshNonpointTesterTool::NavMeshNonpointTesterTool() :
 	m_nPathFaces(0),
 	m_nPathEdges(0),
 	m_nModifiedStraightPath(0)
-#if DT_DEBUG_ASTAR
-	,
-	m_nVisitedFaces(0),
-	m_funnelStepCount(0),
-	m_modifierDebugCount(0)
-#endif
 {
 	m_filter.setIncludeFlags(SAMPLE_POLYFLAGS_ALL ^ SAMPLE_POLYFLAGS_DISABLED);
 	m_filter.setExcludeFlags(0);
@@ -171,6 +163,9 @@ void NavMeshNonpointTesterTool::init(Sample* sample)
 	m_sample = sample;
 	m_navMesh = sample->getNavMesh();
 	m_navQuery = sample->getNavMeshQuery();
+	m_radiusScratch.init(MAX_POLYS + 3);
+	m_trace.init(MAX_TRACE_EVENTS);
+	m_radiusScratch.setTraceBuffer(&m_trace);
 	recalc();
 
 	if (m_navQuery)
@@ -183,8 +178,24 @@ void NavMeshNonpointTesterTool::init(Sample* sample)
 		m_filter.setAreaCost(SAMPLE_POLYAREA_GRASS, 2.0f);
 		m_filter.setAreaCost(SAMPLE_POLYAREA_JUMP, 1.5f);
 	}
+}
+
+void NavMeshNonpointTesterTool::dumpTrace(const char* path)
+{
+	FILE* fp = fopen(path, "w");
+	if (!fp)
+		return;
+
+	if (m_trace.getDroppedCount() > 0)
+		fprintf(fp, "# %u events dropped\n", m_trace.getDroppedCount());
 
-	debug::dtLogger::Init(debug::LogLevel::INFO, "myapp", "./logs");
+	char line[256];
+	for (int i = 0; i < m_trace.getEventCount(); ++i)
+	{
+		debug::formatTraceEvent(*m_trace.getEvent(i), line, sizeof(line));
+		fprintf(fp, "%s\n", line);
+	}
+	fclose(fp);
 }
 
 void NavMeshNonpointTesterTool::handleMenu()
@@ -295,14 +306,14 @@ void NavMeshNonpointTesterTool::handleMenu()
 					iterations::fromFaceToVertices iterFaceVerts(face);
 					auto num_verts = iterFaceVerts.allVertices(verts, 3);
 					dtAssert(num_verts == 3);
-					sprintf_s(buff, 1024, "face:%ld[%d] verts:[%d, %d, %d]", face.polyId, face.innerIdx, verts[0].innerIdx, verts[1].innerIdx, verts[2].innerIdx);
+					snprintf(buff, 1024, "face:%ld[%d] verts:[%d, %d, %d]", face.polyId, face.innerIdx, verts[0].innerIdx, verts[1].innerIdx, verts[2].innerIdx);
 					imguiValue(buff);
 
 					// 显示face的邻接face
 					dtPolyFace faces[3];
 					iterations::fromFaceToNeighborFace iterNeiFaces(face);
 					auto num_faces = iterNeiFaces.allFaces(faces, 3);
-					sprintf_s(
+					snprintf(
 					buff, 
 					1024, 
 					"nei faces:{%ld[%d], %ld[%d], %ld[%d]}", 
@@ -318,7 +329,6 @@ void NavMeshNonpointTesterTool::handleMenu()
 			m_startRef.isValid() && m_endRef.isValid())
 		{
 			imguiSlider("Debug Find Path Radius", &debugFindPathRadius, 0.1f, 3.0f, 0.1f);
-			imguiSlider("Debug Find Path Iters", &debugFindPathIters, 0.0f, 100.0f, 1.0f);
 
 			const float agentRadius = m_sample->getAgentRadius();
 			float radius = debugFindPathRadius; //dtMax(debugFindPathRadius - agentRadius, 0.1f);
@@ -349,18 +359,20 @@ void NavMeshNonpointTesterTool::handleMenu()
 				isModify = true;
 			}
 
+			if (m_trace.getEventCount() > 0 && imguiButton("Dump search trace"))
+			{
+				dumpTrace("search_trace.txt");
+			}
+
 			if (isAstar)
 			{
+				m_trace.clear();
+				m_navQuery->setTraceBuffer(&m_trace);
 				auto stat = m_navQuery->findPathByRadius(m_startRef, m_endRef, m_spos, m_epos, &m_filter, 
 					m_pathFaces, &m_nPathFaces, MAX_POLYS,
 					m_pathEdges, &m_nPathEdges, MAX_POLYS,
-					radius
-				#if DT_DEBUG_ASTAR
-					,
-					(int)debugFindPathIters,
-					m_visitedFaces, m_nVisitedFaces, MAX_VISIT_FACES
-				#endif	
-					);
+					radius);
+				m_navQuery->setTraceBuffer(0);
 			}
 
 			if (isFunnel)
@@ -368,71 +380,54 @@ void NavMeshNonpointTesterTool::handleMenu()
 				funnel::straightPathByRadius(m_spos, m_epos,
 					m_pathFaces, m_nPathFaces, m_pathEdges, m_nPathEdges,
 					m_straightPath, 0, 0, &m_nStraightPath, MAX_POLYS,
-					radius
-#if DT_DEBUG_ASTAR
-					,
-					m_portalDebugs, &m_portalDebugCount, MAX_POLYS,
-					m_funnelSteps, &m_funnelStepCount, MAX_FUNNEL_STEPS
-#endif
-				);
+					radius, &m_radiusScratch);
 			}
 
 			if (isModify)
 			{
 				funnel::dtRadiusModifier radiusModifier(radius, 10.0f);
 				radiusModifier.applyModify(m_straightPath, m_nStraightPath, 
-					m_modifiedStraightPath, &m_nModifiedStraightPath, MAX_POLYS*2
-				#if DT_DEBUG_ASTAR
-					,
-					m_modifierDebugs, &m_modifierDebugCount, MAX_POLYS
-				#endif
-					);
+					m_modifiedStraightPath, &m_nModifiedStraightPath, MAX_POLYS*2,
+					&m_radiusScratch);
 			}
 
-		#if DT_DEBUG_ASTAR
-			if (m_nVisitedFaces > 0)
+			// The visited faces and the funnel steps are read back from the trace buffer.
+			const debug::dtTraceEvent* lastExpanded = 0;
+			int funnelStepCount = 0;
+			for (int i = 0; i < m_trace.getEventCount(); ++i)
 			{
-				const auto& face = m_visitedFaces[m_nVisitedFaces-1].face;
-				sprintf_s(
+				const debug::dtTraceEvent* ev = m_trace.getEvent(i);
+				if (ev->type == debug::DT_TRACE_FACE_EXPANDED)
+					lastExpanded = ev;
+				else if (ev->type == debug::DT_TRACE_FUNNEL_STEP)
+					++funnelStepCount;
+			}
+
+			if (lastExpanded)
+			{
+				snprintf(
 					buff,
 					1024,
 					"last face:%ld[%d]",
-					face.polyId, face.innerIdx);
+					lastExpanded->ref, (int)lastExpanded->prim);
 				imguiValue(buff);
 			}
 
-			if (m_portalDebugCount > 0)
+			if (funnelStepCount > 0)
 			{
-				imguiSlider("funnel portal debug index", &debugDrawFunnelPortalDebugIndex, 0.0f, (float)(m_portalDebugCount - 1), 1.0f);
-
-				if (imguiButton("add portal debug index"))
-				{
-					debugDrawFunnelPortalDebugIndex = dtClamp(debugDrawFunnelPortalDebugIndex + 1.0f, 0.0f, (float)(m_portalDebugCount - 1));
-				}
-				if (imguiButton("sub portal debug index"))
-				{
-					debugDrawFunnelPortalDebugIndex = dtClamp(debugDrawFunnelPortalDebugIndex - 1.0f, 0.0f, (float)(m_portalDebugCount - 1));
-				}
-
-				imguiSeparator();
-			}
-
-			if (m_funnelStepCount > 0)
-			{
-				imguiSlider("funnel step index", &debugDrawFunnelStepIndex, 0.0f, (float)(m_funnelStepCount - 1), 1.0f);
+				imguiSlider("funnel step index", &debugDrawFunnelStepIndex, 0.0f, (float)(funnelStepCount - 1), 1.0f);
 
 				if (imguiButton("add funnel step index"))
 				{
-					debugDrawFunnelStepIndex = dtClamp(debugDrawFunnelStepIndex + 1.0f, 0.0f, (float)(m_funnelStepCount - 1));
+					debugDrawFunnelStepIndex = dtClamp(debugDrawFunnelStepIndex + 1.0f, 0.0f, (float)(funnelStepCount - 1));
 				}
 				if (imguiButton("sub funnel step index"))
 				{
-					debugDrawFunnelStepIndex = dtClamp(debugDrawFunnelStepIndex - 1.0f, 0.0f, (float)(m_funnelStepCount - 1));
+					debugDrawFunnelStepIndex = dtClamp(debugDrawFunnelStepIndex - 1.0f, 0.0f, (float)(funnelStepCount - 1));
 				}
 
 				imguiSeparator();
 			}
-		#endif
 
 			if (imguiCheck("Draw astar visited faces", debugDrawAstarVisitedFaces))
 			{
@@ -446,7 +441,7 @@ void NavMeshNonpointTesterTool::handleMenu()
 			{
 				debugDrawFunnelPathEdges = !debugDrawFunnelPathEdges;
 			}
-			if (imguiCheck("Draw funnel portal debug", debugDrawFunnelDebug))
+			if (imguiCheck("Draw funnel debug", debugDrawFunnelDebug))
 			{
 				debugDrawFunnelDebug = !debugDrawFunnelDebug;
 			}
@@ -612,72 +607,42 @@ void NavMeshNonpointTesterTool::handleRender()
 	}
 	else if (m_toolMode == TOOLMODE_PATHFIND_FIND_PATH)
 	{
-		static const unsigned int pointCol = duRGBA(255, 255, 0, 64);
 		static const unsigned int faceCols[3] = {
 			duRGBA(255, 0, 0, 64),
 			duRGBA(0, 255, 0, 64),
 			duRGBA(0, 0, 255, 64),
 		};
 
-#if DT_DEBUG_ASTAR
-		if (debugDrawAstarVisitedFaces && m_nVisitedFaces > 0)
-		{
-			for (int i = 0; i < m_nVisitedFaces; ++i)
-			{
-				duDebugDrawPolyFace(&dd, m_visitedFaces[i].face, faceCols[i % 3]);
-				duDebugDrawPoint(&dd, m_visitedFaces[i].entry_pos, pointCol, 10.0f);
-			}
-		}
-
-		if (debugDrawFunnelDebug && m_portalDebugCount > 0)
+		if (debugDrawAstarVisitedFaces || debugDrawFunnelDebug)
 		{
-			int debugIndex = (int)dtClamp(debugDrawFunnelPortalDebugIndex, 0.0f, (float)(m_portalDebugCount-1));
-			for (int i = 0; i < m_portalDebugCount; ++i)
+			int visitIndex = 0, stepIndex = 0;
+			for (int i = 0; i < m_trace.getEventCount(); ++i)
 			{
-				const auto& d = m_portalDebugs[i];
-				duDebugDrawPolyEdge(&dd, d.portalEdge, redCol, 1.0f);
-
-				if (i == debugIndex)
+				const debug::dtTraceEvent* ev = m_trace.getEvent(i);
+				if (debugDrawAstarVisitedFaces && ev->type == debug::DT_TRACE_FACE_EXPANDED)
 				{
-					float left[3], right[3];
-					queriers::vertexPosition(d.portalLeft, left);
-					queriers::vertexPosition(d.portalRight, right);
-					duDebugDrawPoint(&dd, left, greenCol, 10.0f);
-					duDebugDrawPoint(&dd, right, blueCol, 10.0f);
+					duDebugDrawPolyFace(&dd, dtPolyFace(m_navMesh, ev->ref, ev->prim), faceCols[visitIndex % 3]);
+					++visitIndex;
 				}
-			}
-		}
-
-		if (debugDrawFunnelDebug && m_funnelStepCount > 0)
-		{
-			for (int i = 0; i < m_funnelStepCount; ++i)
-			{
-				const auto& d = m_funnelSteps[i];
-
-				if (i == (int)debugDrawFunnelStepIndex)
+				else if (debugDrawFunnelDebug && ev->type == debug::DT_TRACE_FUNNEL_STEP)
 				{
-					duDebugDrawPoint(&dd, d.apexPos, redCol, 10.0f);
-					duDebugDrawLine(&dd, d.apexPos, d.leftPos, greenCol, 3.0f);
-					duDebugDrawLine(&dd, d.apexPos, d.rightPos, blueCol, 3.0f);
-
-					if (d.currSide == 1)
-						duDebugDrawPoint(&dd, d.currPos, greenCol, 10.0f);
-					else
-						duDebugDrawPoint(&dd, d.currPos, blueCol, 10.0f);
-
+					const unsigned int col = ev->side ? blueCol : greenCol;
+					const float size = stepIndex == (int)debugDrawFunnelStepIndex ? 10.0f : 4.0f;
+					duDebugDrawPoint(&dd, ev->data, col, size);
+					++stepIndex;
 				}
 			}
 		}
 
-		if (debugDrawFunnelDebug && m_modifierDebugCount > 0)
+		if (debugDrawFunnelDebug && m_nStraightPath > 2)
 		{
-			for (int i = 0; i < m_modifierDebugCount; ++i)
+			// The corner circles used by the radius modifier, the end points have no circle.
+			for (int i = 1; i < m_nStraightPath - 1; ++i)
 			{
-				auto& d = m_modifierDebugs[i];
-				duDebugDrawCircle(&dd, d.pos[0], d.pos[1], d.pos[2], d.radius, redCol, 1.0f);
+				const float* p = &m_straightPath[i*3];
+				duDebugDrawCircle(&dd, p[0], p[1], p[2], debugFindPathRadius, redCol, 1.0f);
 			}
 		}
-#endif
 
 		if (debugDrawAstarPathFaces && m_nPathFaces > 0)
 		{
@@ -706,6 +706,11 @@ bool Sample_SoloMesh::handleBuild()
 		params.cs = m_cfg.cs;
 		params.ch = m_cfg.ch;
 		params.buildBvTree = true;
+		params.buildFaceClearance = true;
+		params.buildFaceBvTree = true;
+		params.buildFaceAbstraction = true;
+		params.buildPolyTriangulation = true;
+		params.buildWideBvTree = true;
 		
 		if (!dtCreateNavMeshData(&params, &navData, &navDataSize))
 		{
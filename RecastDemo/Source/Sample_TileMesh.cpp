@@ -1156,6 +1156,11 @@ unsigned char* Sample_TileMesh::buildTileMesh(const int tx, const int ty, const
 		params.cs = m_cfg.cs;
 		params.ch = m_cfg.ch;
 		params.buildBvTree = true;
+		params.buildFaceClearance = true;
+		params.buildFaceBvTree = true;
+		params.buildFaceAbstraction = true;
+		params.buildPolyTriangulation = true;
+		params.buildWideBvTree = true;
 		
 		if (!dtCreateNavMeshData(&params, &navData, &navDataSize))
 		{
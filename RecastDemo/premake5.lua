@@ -217,6 +217,8 @@ project "Tests"
 		"../Tests/Recast/*.cpp",
 		"../Tests/Detour/*.h",
 		"../Tests/Detour/*.cpp",
+		"../Tests/DetourCrowd/*.h",
+		"../Tests/DetourCrowd/*.cpp",
 	}
 
 	-- project dependencies
@@ -242,7 +244,8 @@ project "Tests"
 		linkoptions { 
 			"`pkg-config --libs sdl2`",
 			"`pkg-config --libs gl`",
-			"`pkg-config --libs glu`" 
+			"`pkg-config --libs glu`",
+			"-pthread" -- The parallel query tests use std::thread.
 		}
 
 	-- windows library cflags and libs
@@ -266,3 +269,28 @@ project "Tests"
 			"SDL2.framework",
 			"Cocoa.framework",
 		}
+
+project "Benchmark_Radius"
+	language "C++"
+	kind "ConsoleApp"
+
+	includedirs { 
+		"../Detour/Include",
+		"../Recast/Include",
+		"../RecastDemo/Include",
+	}
+	files	{ 
+		"../Benchmarks/*.cpp",
+		"../RecastDemo/Source/ChunkyTriMesh.cpp",
+		"../RecastDemo/Source/MeshLoaderObj.cpp",
+	}
+
+	-- project dependencies
+	links { 
+		"Detour",
+		"Recast",
+	}
+
+	-- distribute executable in RecastDemo/Bin directory, next to the Meshes folder
+	targetdir "Bin"
+	debugdir "Bin"
@@ -0,0 +1,173 @@
+#include <string.h>
+
+#include "catch.hpp"
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourNode.h"
+
+TEST_CASE("dtNodePool triangle nodes")
+{
+	SECTION("Triangle nodes keep the polygon node layout")
+	{
+		REQUIRE(sizeof(dtNode) == sizeof(float) * 5 + sizeof(unsigned int) + sizeof(dtPolyRef));
+	}
+
+	SECTION("Polygon and triangle nodes of the same ref are distinct")
+	{
+		dtNodePool pool(16, 8);
+		dtNode* polyNode = pool.getNode(1);
+		dtNode* faceNode0 = pool.getNode(1, 0, 0);
+		dtNode* faceNode3 = pool.getNode(1, 0, DT_FACES_PER_POLYGON - 1);
+		REQUIRE(polyNode);
+		REQUIRE(faceNode0);
+		REQUIRE(faceNode3);
+		REQUIRE(polyNode != faceNode0);
+		REQUIRE(faceNode0 != faceNode3);
+		REQUIRE(polyNode->primIdx == DT_NODE_NULL_PRIM);
+		REQUIRE(faceNode3->primIdx == DT_FACES_PER_POLYGON - 1);
+		REQUIRE(pool.findNode(1, 0) == polyNode);
+		REQUIRE(pool.findNode(1, 0, 0) == faceNode0);
+		REQUIRE(pool.getNode(1, 0, DT_FACES_PER_POLYGON - 1) == faceNode3);
+
+		dtNode* nodes[4];
+		REQUIRE(pool.findNodes(1, nodes, 4) == 1);
+		REQUIRE(nodes[0] == polyNode);
+
+		REQUIRE(pool.getEntryEdge(faceNode0) == DT_NODE_NULL_EDGE);
+		pool.setEntryEdge(faceNode0, 7);
+		REQUIRE(pool.getEntryEdge(faceNode0) == 7);
+		REQUIRE(pool.getEntryEdge(faceNode3) == DT_NODE_NULL_EDGE);
+	}
+}
+
+TEST_CASE("dtNodeQueue")
+{
+	static const int NODE_COUNT = 500;
+	dtNodePool pool(NODE_COUNT, 128);
+	dtNodeQueue queue(NODE_COUNT, &pool);
+
+	// Pseudo random totals, every third node is lowered after all were pushed.
+	unsigned int seed = 12345;
+	for (int i = 0; i < NODE_COUNT; ++i)
+	{
+		seed = seed * 1103515245u + 12345u;
+		dtNode* node = pool.getNode((dtPolyRef)(i + 1));
+		REQUIRE(node);
+		node->total = (float)((seed >> 8) % 10000);
+		queue.push(node);
+	}
+	for (int i = 0; i < NODE_COUNT; i += 3)
+	{
+		dtNode* node = pool.findNode((dtPolyRef)(i + 1), 0);
+		node->total *= 0.25f;
+		queue.modify(node);
+		REQUIRE(pool.getHeapIndex(node) < queue.size());
+	}
+
+	REQUIRE(queue.size() == NODE_COUNT);
+	float prev = -1.0f;
+	int popped = 0;
+	while (!queue.empty())
+	{
+		const dtNode* node = queue.pop();
+		REQUIRE(node->total >= prev);
+		prev = node->total;
+		popped++;
+	}
+	REQUIRE(popped == NODE_COUNT);
+}
+
+TEST_CASE("dtNodeQueue without a node pool")
+{
+	// The nodes do not come from a pool, modify() finds them in the heap.
+	static const int NODE_COUNT = 64;
+	dtNode nodes[NODE_COUNT];
+	dtNodeQueue queue(NODE_COUNT);
+	REQUIRE(queue.getNodePool() == 0);
+
+	for (int i = 0; i < NODE_COUNT; ++i)
+	{
+		memset(&nodes[i], 0, sizeof(dtNode));
+		nodes[i].total = (float)((i * 37) % NODE_COUNT);
+		queue.push(&nodes[i]);
+	}
+	for (int i = 0; i < NODE_COUNT; i += 4)
+	{
+		nodes[i].total -= 0.5f;
+		queue.modify(&nodes[i]);
+	}
+
+	float prev = -1.0f;
+	int popped = 0;
+	while (!queue.empty())
+	{
+		const dtNode* node = queue.pop();
+		REQUIRE(node->total >= prev);
+		prev = node->total;
+		popped++;
+	}
+	REQUIRE(popped == NODE_COUNT);
+}
+
+TEST_CASE("dtNodePool clear")
+{
+	dtNodePool pool(64, 16);
+	for (int i = 0; i < 64; ++i)
+		REQUIRE(pool.getNode((dtPolyRef)(i + 1)));
+	REQUIRE(pool.getNode(1000) == 0);
+
+	// The nodes of the previous queries are gone, without touching the buckets.
+	for (int n = 0; n < 3; ++n)
+	{
+		pool.clear();
+		REQUIRE(pool.getNodeCount() == 0);
+		REQUIRE(pool.findNode(1, 0) == 0);
+		for (int i = 0; i < pool.getHashSize(); ++i)
+			REQUIRE(pool.getFirst(i) == DT_NULL_IDX);
+
+		dtNode* node = pool.getNode(5);
+		REQUIRE(node);
+		REQUIRE(node->flags == 0);
+		REQUIRE(pool.getNodeIdx(node) == 1);
+		REQUIRE(pool.findNode(5, 0) == node);
+		REQUIRE(pool.findNode(6, 0) == 0);
+
+		dtNode* nodes[4];
+		REQUIRE(pool.findNodes(5, nodes, 4) == 1);
+	}
+}
+
+TEST_CASE("dtNodePool size")
+{
+	SECTION("The query rejects pools over the index width")
+	{
+		dtNavMeshQuery* query = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusFailed(query->init(0, DT_MAX_NODES + 1)));
+		dtFreeNavMeshQuery(query);
+	}
+
+#ifdef DT_NODE_INDEX32
+	SECTION("A pool can hold more than 65535 nodes")
+	{
+		static const int NODE_COUNT = 70000;
+		dtNodePool pool(NODE_COUNT, 1 << 14);
+		dtNodeQueue queue(NODE_COUNT, &pool);
+		for (int i = 0; i < NODE_COUNT; ++i)
+		{
+			dtNode* node = pool.getNode((dtPolyRef)(i + 1));
+			REQUIRE(node);
+			node->pidx = pool.getNodeIdx(node) - 1;
+			node->total = (float)(NODE_COUNT - i);
+			queue.push(node);
+		}
+		REQUIRE(pool.getNode(NODE_COUNT + 1) == 0);
+
+		const dtNode* last = pool.findNode(NODE_COUNT, 0);
+		REQUIRE(last);
+		REQUIRE(pool.getNodeIdx(last) == NODE_COUNT);
+		REQUIRE(pool.getNodeAtIdx(last->pidx) == pool.findNode(NODE_COUNT - 1, 0));
+		REQUIRE(queue.pop() == last);
+	}
+#endif
+}
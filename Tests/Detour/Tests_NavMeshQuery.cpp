@@ -0,0 +1,795 @@
+#include <string.h>
+#include <float.h>
+#include <vector>
+
+#include "catch.hpp"
+#include "TestNavMesh.h"
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourNode.h"
+#include "DetourLandmarks.h"
+#include "DetourTilePortalGraph.h"
+#include "DetourCommon.h"
+
+// One 4x4 tile of 2x2 quads at (tx, tz), the tile edges are portals.
+static bool createGridTileData(const int tx, const int tz, unsigned char** data, int* dataSize)
+{
+	// Vertex grid of 3 x 3 cell corners.
+	unsigned short verts[3*3*3];
+	for (int z = 0; z < 3; ++z)
+	{
+		for (int x = 0; x < 3; ++x)
+		{
+			unsigned short* v = &verts[(z*3+x)*3];
+			v[0] = (unsigned short)(x*2);
+			v[1] = 0;
+			v[2] = (unsigned short)(z*2);
+		}
+	}
+
+	// Quads wound like the ones built by rcBuildPolyMesh, edges: -x, +z, +x, -z.
+	// The tile edges use the portal directions of rcPolyMesh, in the same order.
+	static const int dirs[4][2] = { {-1,0}, {0,1}, {1,0}, {0,-1} };
+	unsigned short polys[4*2*4];
+	for (int i = 0; i < 4; ++i)
+	{
+		const int x = i % 2, z = i / 2;
+		unsigned short* p = &polys[i*2*4];
+		p[0] = (unsigned short)(z*3+x);
+		p[1] = (unsigned short)((z+1)*3+x);
+		p[2] = (unsigned short)((z+1)*3+x+1);
+		p[3] = (unsigned short)(z*3+x+1);
+		for (int j = 0; j < 4; ++j)
+		{
+			const int nx = x+dirs[j][0], nz = z+dirs[j][1];
+			if (nx < 0 || nx > 1 || nz < 0 || nz > 1)
+				p[4+j] = (unsigned short)(0x8000 | j);
+			else
+				p[4+j] = (unsigned short)(nz*2+nx);
+		}
+	}
+
+	unsigned short polyFlags[4] = { 1, 1, 1, 1 };
+	unsigned char polyAreas[4] = { 0, 0, 0, 0 };
+
+	dtNavMeshCreateParams params;
+	initTestNavMeshParams(&params, verts, 3*3, polys, polyFlags, polyAreas, 4, 4);
+	params.tileX = tx;
+	params.tileY = tz;
+	params.bmin[0] = (float)(tx*4); params.bmin[1] = 0; params.bmin[2] = (float)(tz*4);
+	params.bmax[0] = (float)(tx*4+4); params.bmax[1] = 1; params.bmax[2] = (float)(tz*4+4);
+
+	return dtCreateNavMeshData(&params, data, dataSize);
+}
+
+// Grid of tiles, a '#' in the layout leaves the tile out. The first row is at z=0.
+static dtNavMesh* createTileGridNavMesh(const char** layout, const int rows)
+{
+	dtNavMeshParams params;
+	memset(&params, 0, sizeof(params));
+	params.tileWidth = 4.0f;
+	params.tileHeight = 4.0f;
+	params.maxTiles = 64;
+	params.maxPolys = 4;
+
+	dtNavMesh* navMesh = dtAllocNavMesh();
+	if (dtStatusFailed(navMesh->init(&params)))
+	{
+		dtFreeNavMesh(navMesh);
+		return 0;
+	}
+
+	for (int tz = 0; tz < rows; ++tz)
+	{
+		for (int tx = 0; layout[tz][tx]; ++tx)
+		{
+			if (layout[tz][tx] == '#')
+				continue;
+			unsigned char* data = 0;
+			int dataSize = 0;
+			if (!createGridTileData(tx, tz, &data, &dataSize) ||
+				dtStatusFailed(navMesh->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, 0)))
+			{
+				dtFree(data);
+				dtFreeNavMesh(navMesh);
+				return 0;
+			}
+		}
+	}
+	return navMesh;
+}
+
+// One tile of size x size unit quads on a bumpy height field, for the polygon trees.
+static dtNavMesh* createQuadGridNavMesh(const int size, const bool buildWideBvTree)
+{
+	const int nverts = (size+1)*(size+1);
+	std::vector<unsigned short> verts(nverts*3);
+	for (int z = 0; z <= size; ++z)
+	{
+		for (int x = 0; x <= size; ++x)
+		{
+			unsigned short* v = &verts[(z*(size+1)+x)*3];
+			v[0] = (unsigned short)x;
+			v[1] = (unsigned short)(2 + (x*7 + z*3) % 3);
+			v[2] = (unsigned short)z;
+		}
+	}
+
+	static const int dirs[4][2] = { {-1,0}, {0,1}, {1,0}, {0,-1} };
+	const int npolys = size*size;
+	std::vector<unsigned short> polys(npolys*2*4);
+	for (int i = 0; i < npolys; ++i)
+	{
+		const int x = i % size, z = i / size;
+		unsigned short* p = &polys[i*2*4];
+		p[0] = (unsigned short)(z*(size+1)+x);
+		p[1] = (unsigned short)((z+1)*(size+1)+x);
+		p[2] = (unsigned short)((z+1)*(size+1)+x+1);
+		p[3] = (unsigned short)(z*(size+1)+x+1);
+		for (int j = 0; j < 4; ++j)
+		{
+			const int nx = x+dirs[j][0], nz = z+dirs[j][1];
+			if (nx < 0 || nx >= size || nz < 0 || nz >= size)
+				p[4+j] = 0xffff;
+			else
+				p[4+j] = (unsigned short)(nz*size+nx);
+		}
+	}
+
+	std::vector<unsigned short> polyFlags(npolys, 1);
+	std::vector<unsigned char> polyAreas(npolys, 0);
+
+	dtNavMeshCreateParams params;
+	initTestNavMeshParams(&params, &verts[0], nverts, &polys[0], &polyFlags[0], &polyAreas[0], npolys, 4);
+	params.bmin[0] = 0; params.bmin[1] = 0; params.bmin[2] = 0;
+	params.bmax[0] = (float)size; params.bmax[1] = 6; params.bmax[2] = (float)size;
+	params.buildWideBvTree = buildWideBvTree;
+
+	return createTestNavMesh(&params);
+}
+
+static bool arePolysLinked(const dtNavMesh* navMesh, dtPolyRef from, dtPolyRef to)
+{
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	navMesh->getTileAndPolyByRefUnsafe(from, &tile, &poly);
+	for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+	{
+		if (tile->links[i].ref == to)
+			return true;
+	}
+	return false;
+}
+
+TEST_CASE("dtNavMeshQuery::findNearestPolys")
+{
+	static const char* layout[3] = { "...#....", "...#....", "........" };
+	dtNavMesh* navMesh = createTileGridNavMesh(layout, 3);
+	REQUIRE(navMesh);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(navMesh, 256)));
+	dtQueryFilter filter;
+
+	// Dense points with some off the mesh, more than one group per tile.
+	static const int POINT_COUNT = 1000;
+	float centers[POINT_COUNT*3];
+	unsigned int seed = 7;
+	for (int i = 0; i < POINT_COUNT; ++i)
+	{
+		seed = seed * 1103515245u + 12345u;
+		centers[i*3+0] = -2.0f + (float)((seed >> 8) % 3600) * 0.01f;
+		seed = seed * 1103515245u + 12345u;
+		centers[i*3+1] = -1.0f + (float)((seed >> 8) % 300) * 0.01f;
+		seed = seed * 1103515245u + 12345u;
+		centers[i*3+2] = -2.0f + (float)((seed >> 8) % 1600) * 0.01f;
+	}
+
+	dtPolyRef refs[POINT_COUNT];
+	float xs[POINT_COUNT], ys[POINT_COUNT], zs[POINT_COUNT];
+	unsigned char overPoly[POINT_COUNT];
+
+	SECTION("The batch matches findNearestPoly")
+	{
+		const float extents[2][3] = { { 0.5f, 1.0f, 0.5f }, { 3.0f, 2.0f, 3.0f } };
+		for (int e = 0; e < 2; ++e)
+		{
+			const float* halfExtents = extents[e];
+			REQUIRE(query->findNearestPolys(centers, POINT_COUNT, halfExtents, &filter, refs, xs, ys, zs, overPoly) == DT_SUCCESS);
+			int found = 0;
+			for (int i = 0; i < POINT_COUNT; ++i)
+			{
+				dtPolyRef ref = 0;
+				float pt[3] = { 0, 0, 0 };
+				bool over = false;
+				REQUIRE(dtStatusSucceed(query->findNearestPoly(&centers[i*3], halfExtents, &filter, &ref, pt, &over)));
+				REQUIRE(refs[i] == ref);
+				if (!ref)
+				{
+					REQUIRE(xs[i] == centers[i*3+0]);
+					REQUIRE(zs[i] == centers[i*3+2]);
+					continue;
+				}
+				found++;
+				REQUIRE(xs[i] == pt[0]);
+				REQUIRE(ys[i] == pt[1]);
+				REQUIRE(zs[i] == pt[2]);
+				REQUIRE((overPoly[i] != 0) == over);
+			}
+			REQUIRE(found > 0);
+			// The small boxes miss the mesh around the missing tiles.
+			if (e == 0)
+				REQUIRE(found < POINT_COUNT);
+		}
+	}
+
+	SECTION("Optional outputs and invalid input")
+	{
+		const float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+		REQUIRE(query->findNearestPolys(centers, POINT_COUNT, halfExtents, &filter, refs, 0, 0, 0) == DT_SUCCESS);
+		REQUIRE(query->findNearestPolys(centers, 0, halfExtents, &filter, refs, 0, 0, 0) == DT_SUCCESS);
+		REQUIRE(query->findNearestPolys(centers, POINT_COUNT, halfExtents, &filter, 0, 0, 0, 0) == (DT_FAILURE | DT_INVALID_PARAM));
+		centers[5] = NAN;
+		REQUIRE(query->findNearestPolys(centers, POINT_COUNT, halfExtents, &filter, refs, 0, 0, 0) == (DT_FAILURE | DT_INVALID_PARAM));
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(navMesh);
+}
+
+TEST_CASE("dtCreateNavMeshData wide BV tree")
+{
+	SECTION("Eight boxes at once match the box test")
+	{
+		unsigned int seed = 3;
+		for (int iter = 0; iter < 200; ++iter)
+		{
+			unsigned short amin[3], amax[3];
+			unsigned short bmin[3*8], bmax[3*8];
+			for (int i = 0; i < 3; ++i)
+			{
+				seed = seed * 1103515245u + 12345u;
+				amin[i] = (unsigned short)((seed >> 8) % 40);
+				amax[i] = (unsigned short)(amin[i] + (seed >> 20) % 20);
+				for (int j = 0; j < 8; ++j)
+				{
+					seed = seed * 1103515245u + 12345u;
+					bmin[i*8+j] = (unsigned short)((seed >> 8) % 40);
+					bmax[i*8+j] = (unsigned short)(bmin[i*8+j] + (seed >> 20) % 20);
+				}
+			}
+			// The empty box of the unused children, and the extremes of the unsigned range.
+			bmin[0] = bmin[8] = bmin[16] = 0xffff;
+			bmax[0] = bmax[8] = bmax[16] = 0;
+			bmax[7] = bmax[15] = bmax[23] = 0xffff;
+
+			const unsigned int mask = dtOverlapQuantBounds8(amin, amax, bmin, bmax);
+			for (int j = 0; j < 8; ++j)
+			{
+				const unsigned short nbmin[3] = { bmin[j], bmin[8+j], bmin[16+j] };
+				const unsigned short nbmax[3] = { bmax[j], bmax[8+j], bmax[16+j] };
+				REQUIRE(((mask >> j) & 1) == (dtOverlapQuantBounds(amin, amax, nbmin, nbmax) ? 1u : 0u));
+			}
+			REQUIRE((mask & 1) == 0);
+		}
+	}
+
+	static const int SIZE = 20;
+	dtNavMesh* binaryMesh = createQuadGridNavMesh(SIZE, false);
+	dtNavMesh* wideMesh = createQuadGridNavMesh(SIZE, true);
+	REQUIRE(binaryMesh);
+	REQUIRE(wideMesh);
+
+	SECTION("The wide tree holds every polygon once")
+	{
+		const dtNavMesh* constWide = wideMesh;
+		const dtNavMesh* constBinary = binaryMesh;
+		const dtMeshTile* tile = constWide->getTile(0);
+		REQUIRE(tile->wideBvTree);
+		REQUIRE(tile->header->wideBvNodeCount == SIZE*SIZE);
+		REQUIRE(!constBinary->getTile(0)->wideBvTree);
+
+		std::vector<int> seen(SIZE*SIZE, 0);
+		int stack[DT_WIDE_BV_STACK_SIZE];
+		int nstack = 0;
+		int nodeCount = 0;
+		stack[nstack++] = 0;
+		while (nstack > 0)
+		{
+			const dtWideBVNode* node = &tile->wideBvTree[stack[--nstack]];
+			nodeCount++;
+			for (int j = 0; j < DT_WIDE_BV_WIDTH; ++j)
+			{
+				if (node->child[j] > 0)
+					stack[nstack++] = node->child[j];
+				else if (node->child[j] < 0)
+					seen[~node->child[j]]++;
+			}
+		}
+		for (int i = 0; i < SIZE*SIZE; ++i)
+			REQUIRE(seen[i] == 1);
+		// Most nodes are full, far fewer than the binary tree.
+		REQUIRE(nodeCount < SIZE*SIZE/4);
+	}
+
+	SECTION("The queries match the binary tree")
+	{
+		dtNavMeshQuery* binaryQuery = dtAllocNavMeshQuery();
+		dtNavMeshQuery* wideQuery = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(binaryQuery->init(binaryMesh, 256)));
+		REQUIRE(dtStatusSucceed(wideQuery->init(wideMesh, 256)));
+		dtQueryFilter filter;
+
+		unsigned int seed = 11;
+		for (int iter = 0; iter < 300; ++iter)
+		{
+			float center[3], halfExtents[3];
+			seed = seed * 1103515245u + 12345u;
+			center[0] = -2.0f + (float)((seed >> 8) % 2400) * 0.01f;
+			seed = seed * 1103515245u + 12345u;
+			center[2] = -2.0f + (float)((seed >> 8) % 2400) * 0.01f;
+			seed = seed * 1103515245u + 12345u;
+			halfExtents[0] = 0.1f + (float)((seed >> 8) % 400) * 0.01f;
+			halfExtents[2] = 0.1f + (float)((seed >> 20) % 400) * 0.01f;
+			// Above the bottom of the tile, the unused last node of the binary tree overlaps the quantized origin.
+			center[1] = 3.5f;
+			halfExtents[1] = 0.5f + (float)(iter % 3) * 0.4f;
+
+			dtPolyRef binaryPolys[SIZE*SIZE], widePolys[SIZE*SIZE];
+			int binaryCount = 0, wideCount = 0;
+			REQUIRE(dtStatusSucceed(binaryQuery->queryPolygons(center, halfExtents, &filter, binaryPolys, &binaryCount, SIZE*SIZE)));
+			REQUIRE(dtStatusSucceed(wideQuery->queryPolygons(center, halfExtents, &filter, widePolys, &wideCount, SIZE*SIZE)));
+			REQUIRE(binaryCount == wideCount);
+			for (int i = 0; i < binaryCount; ++i)
+				REQUIRE(binaryPolys[i] == widePolys[i]);
+
+			dtPolyRef binaryRef = 0, wideRef = 0;
+			float binaryPt[3], widePt[3];
+			REQUIRE(dtStatusSucceed(binaryQuery->findNearestPoly(center, halfExtents, &filter, &binaryRef, binaryPt)));
+			REQUIRE(dtStatusSucceed(wideQuery->findNearestPoly(center, halfExtents, &filter, &wideRef, widePt)));
+			REQUIRE(binaryRef == wideRef);
+			if (binaryRef)
+				REQUIRE(dtVequal(binaryPt, widePt));
+		}
+
+		dtFreeNavMeshQuery(binaryQuery);
+		dtFreeNavMeshQuery(wideQuery);
+	}
+
+	dtFreeNavMesh(binaryMesh);
+	dtFreeNavMesh(wideMesh);
+}
+
+TEST_CASE("dtNavMeshQuery::raycasts")
+{
+	SECTION("Four segments at once match the segment test")
+	{
+		// A square with the diagonal rays, the rays along the edges and the ones missing it.
+		const float verts[4*3] = { 0,0,0, 0,0,2, 2,0,2, 2,0,0 };
+		const float segs[8][4] = {
+			{ 1, 1, 3, 1 }, { -1, -1, 3, 3 }, { 0, -1, 0, 3 }, { -1, 0.5f, -0.5f, 0.5f },
+			{ 1, 1, 1.5f, 1.5f }, { 3, 3, -1, -1 }, { 2.5f, 1, 3, 1 }, { -1, 2, 3, 2 },
+		};
+		for (int g = 0; g < 2; ++g)
+		{
+			float p0x[4], p0z[4], p1x[4], p1z[4];
+			for (int k = 0; k < 4; ++k)
+			{
+				p0x[k] = segs[g*4+k][0];
+				p0z[k] = segs[g*4+k][1];
+				p1x[k] = segs[g*4+k][2];
+				p1z[k] = segs[g*4+k][3];
+			}
+			float tmin[4], tmax[4];
+			int segMin[4], segMax[4];
+			const unsigned int mask = dtIntersectSegmentsPoly2D4(p0x, p0z, p1x, p1z, verts, 4, tmin, tmax, segMin, segMax);
+			for (int k = 0; k < 4; ++k)
+			{
+				const float p0[3] = { p0x[k], 0, p0z[k] };
+				const float p1[3] = { p1x[k], 0, p1z[k] };
+				float stmin, stmax;
+				int ssegMin, ssegMax;
+				const bool hit = dtIntersectSegmentPoly2D(p0, p1, verts, 4, stmin, stmax, ssegMin, ssegMax);
+				REQUIRE(((mask >> k) & 1) == (hit ? 1u : 0u));
+				if (!hit)
+					continue;
+				REQUIRE(tmin[k] == stmin);
+				REQUIRE(tmax[k] == stmax);
+				REQUIRE(segMin[k] == ssegMin);
+				REQUIRE(segMax[k] == ssegMax);
+			}
+		}
+	}
+
+	static const char* layout[3] = { "...#....", "...#....", "....#..." };
+	dtNavMesh* navMesh = createTileGridNavMesh(layout, 3);
+	REQUIRE(navMesh);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(navMesh, 256)));
+	dtQueryFilter filter;
+	filter.setAreaCost(0, 2.0f);
+
+	// Rays from a few points in all directions, most rays share their polygons.
+	static const int RAY_COUNT = 400;
+	static const int MAX_PATH = 16;
+	dtPolyRef startRefs[RAY_COUNT], prevRefs[RAY_COUNT];
+	float startPos[RAY_COUNT*3], endPos[RAY_COUNT*3];
+	const float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+	unsigned int seed = 5;
+	for (int i = 0; i < RAY_COUNT; ++i)
+	{
+		if (i % 20 == 0)
+		{
+			do
+			{
+				seed = seed * 1103515245u + 12345u;
+				startPos[i*3+0] = 0.1f + (float)((seed >> 8) % 3180) * 0.01f;
+				startPos[i*3+1] = 0.0f;
+				seed = seed * 1103515245u + 12345u;
+				startPos[i*3+2] = 0.1f + (float)((seed >> 8) % 1180) * 0.01f;
+				float nearest[3];
+				REQUIRE(dtStatusSucceed(query->findNearestPoly(&startPos[i*3], halfExtents, &filter, &startRefs[i], nearest)));
+			}
+			while (!startRefs[i]);
+		}
+		else
+		{
+			startRefs[i] = startRefs[i-1];
+			dtVcopy(&startPos[i*3], &startPos[(i-1)*3]);
+		}
+		const float angle = (float)i * 0.7f;
+		const float len = 1.0f + (float)(i % 7) * 1.5f;
+		endPos[i*3+0] = startPos[i*3+0] + dtMathCosf(angle) * len;
+		endPos[i*3+1] = 0.0f;
+		endPos[i*3+2] = startPos[i*3+2] + dtMathSinf(angle) * len;
+		prevRefs[i] = (i % 3 == 0) ? startRefs[i] : 0;
+	}
+
+	dtPolyRef paths[RAY_COUNT][MAX_PATH];
+	dtRaycastHit hits[RAY_COUNT];
+
+	SECTION("The batch matches raycast")
+	{
+		for (int options = 0; options <= DT_RAYCAST_USE_COSTS; options += DT_RAYCAST_USE_COSTS)
+		{
+			memset(hits, 0, sizeof(hits));
+			for (int i = 0; i < RAY_COUNT; ++i)
+			{
+				hits[i].path = paths[i];
+				hits[i].maxPath = (i % 11 == 0) ? 2 : MAX_PATH;
+			}
+			const dtStatus status = query->raycasts(startRefs, startPos, endPos, RAY_COUNT, &filter, options, hits, prevRefs);
+			REQUIRE(dtStatusSucceed(status));
+
+			int walls = 0, ends = 0;
+			dtStatus details = 0;
+			for (int i = 0; i < RAY_COUNT; ++i)
+			{
+				dtPolyRef path[MAX_PATH];
+				dtRaycastHit hit;
+				memset(&hit, 0, sizeof(hit));
+				hit.path = path;
+				hit.maxPath = hits[i].maxPath;
+				const dtStatus rayStatus = query->raycast(startRefs[i], &startPos[i*3], &endPos[i*3], &filter, options, &hit, prevRefs[i]);
+				details |= rayStatus & DT_STATUS_DETAIL_MASK;
+				REQUIRE(hits[i].t == hit.t);
+				REQUIRE(hits[i].pathCount == hit.pathCount);
+				REQUIRE(hits[i].pathCost == hit.pathCost);
+				for (int j = 0; j < hit.pathCount; ++j)
+					REQUIRE(hits[i].path[j] == hit.path[j]);
+				if (hit.t == FLT_MAX)
+				{
+					ends++;
+					continue;
+				}
+				walls++;
+				REQUIRE(hits[i].hitEdgeIndex == hit.hitEdgeIndex);
+				REQUIRE(dtVequal(hits[i].hitNormal, hit.hitNormal));
+			}
+			REQUIRE(walls > 0);
+			REQUIRE(ends > 0);
+			REQUIRE((status & DT_STATUS_DETAIL_MASK) == details);
+			REQUIRE(dtStatusDetail(status, DT_BUFFER_TOO_SMALL));
+		}
+	}
+
+	SECTION("Invalid input")
+	{
+		REQUIRE(query->raycasts(startRefs, startPos, endPos, 0, &filter, 0, hits) == DT_SUCCESS);
+		REQUIRE(query->raycasts(startRefs, startPos, endPos, RAY_COUNT, &filter, 0, 0) == (DT_FAILURE | DT_INVALID_PARAM));
+		REQUIRE(query->raycasts(startRefs, startPos, endPos, RAY_COUNT, 0, 0, hits) == (DT_FAILURE | DT_INVALID_PARAM));
+		startRefs[7] = 0;
+		REQUIRE(query->raycasts(startRefs, startPos, endPos, RAY_COUNT, &filter, 0, hits) == (DT_FAILURE | DT_INVALID_PARAM));
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(navMesh);
+}
+
+TEST_CASE("dtLandmarkTable")
+{
+	dtNavMesh* navMesh = createMazeNavMesh(false);
+	REQUIRE(navMesh);
+
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(navMesh, 2048)));
+
+	dtLandmarkTable landmarks;
+	REQUIRE(dtStatusSucceed(landmarks.build(navMesh, 4)));
+	REQUIRE(landmarks.isValid(navMesh));
+	REQUIRE(landmarks.getLandmarkCount() == 4);
+	for (int i = 0; i < landmarks.getLandmarkCount(); ++i)
+		REQUIRE(navMesh->isValidPolyRef(landmarks.getLandmark(i)));
+
+	dtQueryFilter filter;
+	const float halfExtents[3] = { 1, 1, 1 };
+	static const int MAX_PATH = 64;
+	dtPolyRef path[MAX_PATH];
+	int pathCount = 0;
+
+	SECTION("The bound is a lower bound of the path cost")
+	{
+		// Between the cell centers of the maze, the cost of the path is the total of the end node.
+		const dtMeshTile* tile = ((const dtNavMesh*)navMesh)->getTile(0);
+		const dtPolyRef base = navMesh->getPolyRefBase(tile);
+		float maxBound = 0.0f;
+		for (int i = 0; i < tile->header->polyCount; ++i)
+		{
+			for (int j = 0; j < tile->header->polyCount; ++j)
+			{
+				const dtPolyRef from = base | (dtPolyRef)i;
+				const dtPolyRef to = base | (dtPolyRef)j;
+				float fromPos[3], toPos[3];
+				dtCalcPolyCenter(fromPos, tile->polys[i].verts, tile->polys[i].vertCount, tile->verts);
+				dtCalcPolyCenter(toPos, tile->polys[j].verts, tile->polys[j].vertCount, tile->verts);
+				REQUIRE(dtStatusSucceed(query->findPath(from, to, fromPos, toPos, &filter, path, &pathCount, MAX_PATH)));
+				float cost = 0.0f;
+				if (from != to)
+				{
+					dtNode* endNode = 0;
+					REQUIRE(query->getNodePool()->findNodes(to, &endNode, 1) == 1);
+					cost = endNode->total;
+				}
+
+				const float bound = landmarks.getLowerBound(from, fromPos, to, toPos);
+				REQUIRE(bound <= cost + 1e-3f);
+				REQUIRE(bound == landmarks.getLowerBound(to, toPos, from, fromPos));
+				maxBound = dtMax(maxBound, bound - dtVdist(fromPos, toPos));
+			}
+		}
+		// The maze walls make the bound longer than the straight line somewhere.
+		REQUIRE(maxBound > 1.0f);
+	}
+
+	SECTION("The landmark heuristic finds the same path with fewer nodes")
+	{
+		// From the dead end at the top back to the start of the maze.
+		const float startPos[3] = { 3.0f, 0.0f, 13.0f };
+		const float endPos[3] = { 1.0f, 0.0f, 1.0f };
+		dtPolyRef startRef, endRef;
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(startPos, halfExtents, &filter, &startRef, 0)));
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(endPos, halfExtents, &filter, &endRef, 0)));
+
+		REQUIRE(dtStatusSucceed(query->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, MAX_PATH)));
+		const int nodes = query->getNodePool()->getNodeCount();
+
+		dtPolyRef altPath[MAX_PATH];
+		int altPathCount = 0;
+		query->setLandmarkTable(&landmarks);
+		REQUIRE(dtStatusSucceed(query->findPath(startRef, endRef, startPos, endPos, &filter, altPath, &altPathCount, MAX_PATH)));
+		const int altNodes = query->getNodePool()->getNodeCount();
+		REQUIRE(altPathCount == pathCount);
+		for (int i = 0; i < pathCount; ++i)
+			REQUIRE(altPath[i] == path[i]);
+		REQUIRE(altNodes <= nodes);
+	}
+
+	SECTION("The bound is scaled by the smallest area cost")
+	{
+		const float startPos[3] = { 3.0f, 0.0f, 13.0f };
+		const float endPos[3] = { 1.0f, 0.0f, 1.0f };
+		dtPolyRef startRef, endRef;
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(startPos, halfExtents, &filter, &startRef, 0)));
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(endPos, halfExtents, &filter, &endRef, 0)));
+
+		dtLandmarkGoal goal;
+		landmarks.initGoal(endRef, endPos, &goal);
+		REQUIRE(goal.costScale == 1.0f);
+		const float bound = landmarks.getLowerBound(startRef, startPos, goal);
+		REQUIRE(bound > 0.0f);
+		goal.costScale = 0.25f;
+		REQUIRE(landmarks.getLowerBound(startRef, startPos, goal) == Approx(bound * 0.25f));
+
+		// With the cheap area the unscaled bound would overestimate, the path and its cost are unchanged.
+		dtQueryFilter cheapFilter;
+		cheapFilter.setAreaCost(0, 0.25f);
+		REQUIRE(dtStatusSucceed(query->findPath(startRef, endRef, startPos, endPos, &cheapFilter, path, &pathCount, MAX_PATH)));
+		dtNode* endNode = 0;
+		REQUIRE(query->getNodePool()->findNodes(endRef, &endNode, 1) == 1);
+		const float cost = endNode->cost;
+
+		dtPolyRef altPath[MAX_PATH];
+		int altPathCount = 0;
+		query->setLandmarkTable(&landmarks);
+		REQUIRE(dtStatusSucceed(query->findPath(startRef, endRef, startPos, endPos, &cheapFilter, altPath, &altPathCount, MAX_PATH)));
+		REQUIRE(query->getNodePool()->findNodes(endRef, &endNode, 1) == 1);
+		REQUIRE(endNode->cost == Approx(cost));
+		REQUIRE(altPathCount == pathCount);
+		for (int i = 0; i < pathCount; ++i)
+			REQUIRE(altPath[i] == path[i]);
+
+		// The landmark bound of the nodes on the path is not above the rest of the path.
+		for (int i = 0; i < altPathCount; ++i)
+		{
+			dtNode* node = 0;
+			REQUIRE(query->getNodePool()->findNodes(altPath[i], &node, 1) == 1);
+			const float straight = dtVdist(node->pos, endPos) * DT_HEURISTIC_SCALE;
+			REQUIRE(node->total - node->cost <= dtMax(straight, cost - node->cost) + 1e-3f);
+		}
+	}
+
+	SECTION("The radius searches ignore the landmark table")
+	{
+		// The radius paths can be shorter than the landmark bound, the table would not be admissible.
+		const float startPos[3] = { 3.0f, 0.0f, 13.0f };
+		const float endPos[3] = { 1.0f, 0.0f, 1.0f };
+		dtPolyFace startFace, endFace;
+		REQUIRE(dtStatusSucceed(query->findNearestFace(startPos, halfExtents, &filter, &startFace, 0)));
+		REQUIRE(dtStatusSucceed(query->findNearestFace(endPos, halfExtents, &filter, &endFace, 0)));
+		dtPolyFace faces[MAX_PATH], altFaces[MAX_PATH];
+		dtPolyEdge portals[MAX_PATH];
+		int faceCount = 0, altFaceCount = 0, portalCount = 0;
+		query->setLandmarkTable(0);
+		REQUIRE(dtStatusSucceed(query->findPathByRadius(startFace, endFace, startPos, endPos, &filter,
+			faces, &faceCount, MAX_PATH, portals, &portalCount, MAX_PATH, 0.4f)));
+		const int faceNodes = query->getNodePool()->getNodeCount();
+		query->setLandmarkTable(&landmarks);
+		REQUIRE(dtStatusSucceed(query->findPathByRadius(startFace, endFace, startPos, endPos, &filter,
+			altFaces, &altFaceCount, MAX_PATH, portals, &portalCount, MAX_PATH, 0.4f)));
+		REQUIRE(altFaceCount == faceCount);
+		for (int i = 0; i < faceCount; ++i)
+			REQUIRE(altFaces[i] == faces[i]);
+		REQUIRE(query->getNodePool()->getNodeCount() == faceNodes);
+	}
+
+	SECTION("Adding or removing tiles invalidates the table")
+	{
+		const dtMeshTile* tile = ((const dtNavMesh*)navMesh)->getTile(0);
+		unsigned char* data = (unsigned char*)dtAlloc(tile->dataSize, DT_ALLOC_PERM);
+		const int dataSize = tile->dataSize;
+		memcpy(data, tile->data, dataSize);
+
+		REQUIRE(dtStatusSucceed(navMesh->removeTile(navMesh->getTileRef(tile), 0, 0)));
+		REQUIRE(!landmarks.isValid(navMesh));
+		REQUIRE(dtStatusSucceed(navMesh->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, 0)));
+		REQUIRE(!landmarks.isValid(navMesh));
+
+		// A stale table is ignored, the query still finds the path.
+		const float startPos[3] = { 1.0f, 0.0f, 1.0f };
+		const float endPos[3] = { 1.0f, 0.0f, 9.0f };
+		dtPolyRef startRef, endRef;
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(startPos, halfExtents, &filter, &startRef, 0)));
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(endPos, halfExtents, &filter, &endRef, 0)));
+		query->setLandmarkTable(&landmarks);
+		const dtStatus status = query->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, MAX_PATH);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+
+		REQUIRE(dtStatusSucceed(landmarks.refresh()));
+		REQUIRE(landmarks.isValid(navMesh));
+		REQUIRE(landmarks.getLandmarkCount() == 4);
+		REQUIRE(navMesh->isValidPolyRef(landmarks.getLandmark(0)));
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(navMesh);
+}
+
+TEST_CASE("dtTilePortalGraph")
+{
+	// A wall of missing tiles at x=3, open in the top row.
+	static const char* layout[3] = { "...#....", "...#....", "........" };
+	dtNavMesh* navMesh = createTileGridNavMesh(layout, 3);
+	REQUIRE(navMesh);
+
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(navMesh, 2048)));
+
+	dtTilePortalGraph graph;
+	REQUIRE(dtStatusSucceed(graph.init(navMesh, 64)));
+	REQUIRE(graph.isValid(navMesh));
+	REQUIRE(graph.getUpdatedTileCount() == 22);
+
+	// A middle tile has two portals per side, each quad reaches the others.
+	{
+		const dtMeshTile* tile = navMesh->getTileAt(1, 1, 0);
+		REQUIRE(tile);
+		const int tileIndex = (int)navMesh->decodePolyIdTile(navMesh->getPolyRefBase(tile));
+		int portalCount = 0;
+		const dtTilePortal* portals = graph.getPortals(tileIndex, &portalCount);
+		REQUIRE(portalCount == 8);
+		const float* costs = graph.getCosts(tileIndex);
+		for (int i = 0; i < portalCount; ++i)
+		{
+			REQUIRE(portals[i].twin >= 0);
+			for (int j = 0; j < portalCount; ++j)
+				REQUIRE(costs[i*portalCount + j] < FLT_MAX);
+		}
+	}
+
+	dtQueryFilter filter;
+	const float halfExtents[3] = { 1, 1, 1 };
+	const float startPos[3] = { 1.0f, 0.0f, 1.0f };
+	const float endPos[3] = { 31.0f, 0.0f, 1.0f };
+	dtPolyRef startRef, endRef;
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(startPos, halfExtents, &filter, &startRef, 0)));
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(endPos, halfExtents, &filter, &endRef, 0)));
+
+	static const int MAX_PATH = 128;
+	dtPolyRef path[MAX_PATH];
+	float straightPath[MAX_PATH * 3];
+	int pathCount = 0, straightCount = 0;
+
+	SECTION("The hierarchical path goes around the wall like findPath")
+	{
+		REQUIRE(dtStatusSucceed(query->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, MAX_PATH)));
+		REQUIRE(dtStatusSucceed(query->findStraightPath(startPos, endPos, path, pathCount,
+			straightPath, 0, 0, &straightCount, MAX_PATH)));
+		float length = 0.0f;
+		for (int i = 1; i < straightCount; ++i)
+			length += dtVdist(&straightPath[(i-1)*3], &straightPath[i*3]);
+
+		const dtStatus status = query->findPathHierarchical(&graph, startRef, endRef, startPos, endPos, &filter,
+			path, &pathCount, MAX_PATH);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(path[0] == startRef);
+		REQUIRE(path[pathCount-1] == endRef);
+		for (int i = 1; i < pathCount; ++i)
+			REQUIRE(arePolysLinked(navMesh, path[i-1], path[i]));
+
+		REQUIRE(dtStatusSucceed(query->findStraightPath(startPos, endPos, path, pathCount,
+			straightPath, 0, 0, &straightCount, MAX_PATH)));
+		float hierarchicalLength = 0.0f;
+		for (int i = 1; i < straightCount; ++i)
+			hierarchicalLength += dtVdist(&straightPath[(i-1)*3], &straightPath[i*3]);
+		REQUIRE(hierarchicalLength <= length * 1.05f);
+	}
+
+	SECTION("Removing and adding a tile updates its neighbourhood only")
+	{
+		const dtMeshTile* tile = navMesh->getTileAt(3, 2, 0);
+		REQUIRE(tile);
+		const int dataSize = tile->dataSize;
+		unsigned char* data = (unsigned char*)dtAlloc(dataSize, DT_ALLOC_PERM);
+		memcpy(data, tile->data, dataSize);
+
+		REQUIRE(dtStatusSucceed(navMesh->removeTile(navMesh->getTileRef(tile), 0, 0)));
+		REQUIRE(!graph.isValid(navMesh));
+		REQUIRE(dtStatusSucceed(graph.update()));
+		REQUIRE(graph.isValid(navMesh));
+		// The tile and its 4 remaining neighbours.
+		REQUIRE(graph.getUpdatedTileCount() == 5);
+
+		// The wall is closed.
+		dtStatus status = query->findPathHierarchical(&graph, startRef, endRef, startPos, endPos, &filter,
+			path, &pathCount, MAX_PATH);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(dtStatusDetail(status, DT_PARTIAL_RESULT));
+
+		REQUIRE(dtStatusSucceed(navMesh->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, 0)));
+		REQUIRE(dtStatusSucceed(graph.update()));
+		REQUIRE(graph.getUpdatedTileCount() == 5);
+		REQUIRE(dtStatusSucceed(graph.update()));
+		REQUIRE(graph.getUpdatedTileCount() == 0);
+
+		status = query->findPathHierarchical(&graph, startRef, endRef, startPos, endPos, &filter,
+			path, &pathCount, MAX_PATH);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(path[pathCount-1] == endRef);
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(navMesh);
+}
@@ -0,0 +1,1793 @@
+﻿#include <float.h>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+#include "TestNavMesh.h"
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourNode.h"
+#include "DetourNavMeshQueryTemplates.h"
+#include "DetourCommon.h"
+#include "DetourMath.h"
+
+// The corridor mesh with a wide detour over the top, the narrow corridor is the shortcut.
+//
+//  z=10 +-----+-----------+-----+
+//       |     |           |     |
+//   z=6 |     +-----------+     |
+//       |     |           |     |
+//   z=4 +-----+           +-----+
+//       |  A  +-----------+  B  |
+//       |     +-----------+     |
+//   z=0 +-----+           +-----+
+//     x=0   x=4         x=8   x=12
+static dtNavMesh* createTwoRouteNavMesh()
+{
+	static const unsigned short NONE = 0xffff;
+	static const unsigned short verts[] = {
+		0,0,0,  4,0,0,  4,0,1,  4,0,2,  4,0,4,  0,0,4,
+		8,0,1,  8,0,2,
+		12,0,0, 12,0,4, 8,0,4,  8,0,0,
+		0,0,10, 4,0,10, 4,0,6,  8,0,6,  8,0,10, 12,0,10,
+	};
+	static const unsigned short polys[] = {
+		// Room A
+		0, 5, 4, 3, 2, 1,		NONE, 3, NONE, 1, NONE, NONE,
+		// Corridor
+		2, 3, 7, 6, NONE, NONE,	0, NONE, 2, NONE, NONE, NONE,
+		// Room B
+		8, 11, 6, 7, 10, 9,		NONE, NONE, 1, NONE, 5, NONE,
+		// Above A
+		5, 12, 13, 14, 4, NONE,	NONE, NONE, 4, NONE, 0, NONE,
+		// Detour
+		14, 13, 16, 15, NONE, NONE,	3, NONE, 5, NONE, NONE, NONE,
+		// Above B
+		10, 15, 16, 17, 9, NONE,	NONE, 4, NONE, NONE, 2, NONE,
+	};
+	static const unsigned short polyFlags[] = { 1, 1, 1, 1, 1, 1 };
+	static const unsigned char polyAreas[] = { 0, 0, 0, 0, 0, 0 };
+
+	dtNavMeshCreateParams params;
+	initTestNavMeshParams(&params, verts, 18, polys, polyFlags, polyAreas, 6, 6);
+	params.bmin[0] = 0; params.bmin[1] = 0; params.bmin[2] = 0;
+	params.bmax[0] = 12; params.bmax[1] = 1; params.bmax[2] = 10;
+	params.buildFaceClearance = true;
+
+	return createTestNavMesh(&params);
+}
+
+// A single long hexagon, the fan from vertex 0 ends with a zero area sliver along the bottom edge.
+//
+//  z=2 1-----------2-----------3
+//      |                       |
+//  z=0 0-----------5-----------4
+//     x=0         x=6        x=12
+static dtNavMesh* createSliverNavMesh(bool buildPolyTriangulation)
+{
+	static const unsigned short NONE = 0xffff;
+	static const unsigned short verts[] = {
+		0,0,0,  0,0,2,  6,0,2,  12,0,2,  12,0,0,  6,0,0,
+	};
+	static const unsigned short polys[] = {
+		0, 1, 2, 3, 4, 5,		NONE, NONE, NONE, NONE, NONE, NONE,
+	};
+	static const unsigned short polyFlags[] = { 1 };
+	static const unsigned char polyAreas[] = { 0 };
+
+	dtNavMeshCreateParams params;
+	initTestNavMeshParams(&params, verts, 6, polys, polyFlags, polyAreas, 1, 6);
+	params.bmin[0] = 0; params.bmin[1] = 0; params.bmin[2] = 0;
+	params.bmax[0] = 12; params.bmax[1] = 1; params.bmax[2] = 2;
+	params.buildFaceClearance = true;
+	params.buildFaceBvTree = true;
+	params.buildPolyTriangulation = buildPolyTriangulation;
+
+	return createTestNavMesh(&params);
+}
+
+// A flat triangle C, B, A whose base AB borders a fan of thin triangles around the hub H, 8 units below C.
+// The boundary is far from C, every unit of radius <= 5 turning around C is free to cross the triangle.
+//
+//  z=140     X-----------Y
+//            |  \     /  |
+//  z=108     |     C     |
+//  z=103     A-----------B
+//  z=100      \    H    /     40 units around H
+//               \_____/
+//     x=60        x=100       x=140
+static dtNavMesh* createOpenFanNavMesh()
+{
+	static const int RING_COUNT = 40;
+	static const int VERT_COUNT = 6 + RING_COUNT;
+	static const int POLY_COUNT = 4 + RING_COUNT + 2;
+
+	unsigned short verts[VERT_COUNT*3] = {
+		100,0,108,  60,0,140,  140,0,140,	// C, X, Y
+		100,0,100,  60,0,103,  140,0,103,	// H, A, B
+	};
+	// The ring around H from B to A, clockwise.
+	static const float PI = 3.14159265f;
+	const float startAngle = dtMathAtan2f(3.0f, 40.0f);
+	const float step = (PI + 2.0f * startAngle) / (RING_COUNT + 1);
+	for (int i = 0; i < RING_COUNT; ++i)
+	{
+		const float a = startAngle - (i + 1) * step;
+		unsigned short* v = &verts[(6+i)*3];
+		v[0] = (unsigned short)(100.5f + 40.0f * dtMathCosf(a));
+		v[1] = 0;
+		v[2] = (unsigned short)(100.5f + 40.0f * dtMathSinf(a));
+	}
+
+	unsigned short polys[POLY_COUNT*2*3];
+	static const unsigned short tris[4][3] = {
+		{ 0, 5, 4 },	// C, B, A
+		{ 0, 4, 1 },	// C, A, X
+		{ 0, 2, 5 },	// C, Y, B
+		{ 0, 1, 2 },	// C, X, Y
+	};
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+			polys[i*2*3+j] = tris[i][j];
+	}
+	// The fan around H, the ring is A, B and the ring vertices.
+	for (int i = 0; i < RING_COUNT + 2; ++i)
+	{
+		const int a = i == 0 ? 4 : i == 1 ? 5 : 6 + i - 2;
+		const int b = i == 0 ? 5 : i == RING_COUNT + 1 ? 4 : 6 + i - 1;
+		unsigned short* p = &polys[(4+i)*2*3];
+		p[0] = 3;
+		p[1] = (unsigned short)a;
+		p[2] = (unsigned short)b;
+	}
+	// The neighbour across each edge is the polygon with the reversed edge.
+	for (int i = 0; i < POLY_COUNT; ++i)
+	{
+		unsigned short* p = &polys[i*2*3];
+		for (int j = 0; j < 3; ++j)
+		{
+			p[3+j] = 0xffff;
+			for (int k = 0; k < POLY_COUNT; ++k)
+			{
+				const unsigned short* q = &polys[k*2*3];
+				for (int l = 0; l < 3; ++l)
+				{
+					if (q[l] == p[(j+1)%3] && q[(l+1)%3] == p[j])
+						p[3+j] = (unsigned short)k;
+				}
+			}
+		}
+	}
+
+	unsigned short polyFlags[POLY_COUNT];
+	unsigned char polyAreas[POLY_COUNT];
+	for (int i = 0; i < POLY_COUNT; ++i)
+	{
+		polyFlags[i] = 1;
+		polyAreas[i] = 0;
+	}
+
+	dtNavMeshCreateParams params;
+	initTestNavMeshParams(&params, verts, VERT_COUNT, polys, polyFlags, polyAreas, POLY_COUNT, 3);
+	params.bmin[0] = 0; params.bmin[1] = 0; params.bmin[2] = 0;
+	params.bmax[0] = 150; params.bmax[1] = 1; params.bmax[2] = 150;
+
+	return createTestNavMesh(&params);
+}
+
+static int countTraceEvents(const debug::dtTraceBuffer& trace, const unsigned char type)
+{
+	int count = 0;
+	for (int i = 0; i < trace.getEventCount(); ++i)
+	{
+		if (trace.getEvent(i)->type == type)
+			count++;
+	}
+	return count;
+}
+
+TEST_CASE("dtCreateNavMeshData face clearance")
+{
+	dtNavMesh* navMesh = createCorridorNavMesh(true);
+	REQUIRE(navMesh);
+
+	const dtMeshTile* tile = navMesh->getTileAt(0, 0, 0);
+	REQUIRE(tile->faceClearances);
+	REQUIRE(tile->header->faceClearanceCount == 3 * DT_FACES_PER_POLYGON);
+
+	SECTION("Corridor width is limited by the walls")
+	{
+		// Corridor face 0 is (4,1), (8,1), (8,2). Around (8,1) the corridor
+		// is limited by the wall at z=2, the other vertices by the corridor length.
+		const dtFaceClearance& clearance = tile->faceClearances[1 * DT_FACES_PER_POLYGON + 0];
+		REQUIRE(clearance.width[1] == Approx(1.0f));
+		REQUIRE(clearance.flags == 0);
+	}
+
+	SECTION("Baked clearance agrees with the runtime search")
+	{
+		dtNavMesh* runtimeMesh = createCorridorNavMesh(false);
+		REQUIRE(runtimeMesh);
+		REQUIRE(!runtimeMesh->getTileAt(0, 0, 0)->faceClearances);
+
+		const float radii[] = { 0.2f, 0.45f, 0.55f, 1.0f, 1.6f, 2.5f };
+		const dtPolyRef base = navMesh->getPolyRefBase(tile);
+		for (int ip = 0; ip < tile->header->polyCount; ++ip)
+		{
+			const dtPoly* poly = &tile->polys[ip];
+			for (int face = 0; face < poly->vertCount - 2; ++face)
+			{
+				for (int entry = 0; entry < 3; ++entry)
+				{
+					for (int exit = 0; exit < 3; ++exit)
+					{
+						if (entry == exit)
+							continue;
+
+						dtPolyFace bakedFace(navMesh, base | (dtPolyRef)ip, (dtPrimIndex)face);
+						dtPolyEdge bakedFrom = queriers::edgeOppositeEdge(queriers::faceLocalEdge(bakedFace, entry));
+						if (!bakedFrom.isValid())
+							continue;
+						dtPolyEdge bakedTo = queriers::faceLocalEdge(bakedFace, exit);
+						REQUIRE(queriers::edgeFaceIndex(bakedTo) == exit);
+
+						dtPolyFace runtimeFace(runtimeMesh, bakedFace.polyId, bakedFace.innerIdx);
+						dtPolyEdge runtimeFrom(runtimeMesh, bakedFrom.polyId, bakedFrom.innerIdx);
+						dtPolyEdge runtimeTo(runtimeMesh, bakedTo.polyId, bakedTo.innerIdx);
+
+						for (int r = 0; r < 6; ++r)
+						{
+							REQUIRE(astar::isWalkableByRadius(radii[r], bakedFrom, bakedFace, bakedTo) ==
+									astar::isWalkableByRadius(radii[r], runtimeFrom, runtimeFace, runtimeTo));
+						}
+					}
+				}
+			}
+		}
+
+		dtFreeNavMesh(runtimeMesh);
+	}
+
+	dtFreeNavMesh(navMesh);
+}
+
+TEST_CASE("astar::isWalkableByRadius open fan")
+{
+	dtNavMesh* navMesh = createOpenFanNavMesh();
+	REQUIRE(navMesh);
+	REQUIRE(!navMesh->getTileAt(0, 0, 0)->faceClearances);
+
+	// Turning around C through the triangle C, B, A: in from C, A and out to C, B.
+	// The walls of the fan are checked around H, over more faces than the search keeps on its stacks.
+	const dtPolyFace face(navMesh, navMesh->getPolyRefBase(navMesh->getTileAt(0, 0, 0)), 0);
+	const dtPolyEdge from = queriers::edgeOppositeEdge(queriers::faceLocalEdge(face, 2));
+	const dtPolyEdge to = queriers::faceLocalEdge(face, 0);
+	REQUIRE(from.isValid());
+
+	REQUIRE(astar::isWalkableByRadius(1.0f, from, face, to));
+	REQUIRE(astar::isWalkableByRadius(5.0f, from, face, to));
+
+	// Wider than C, A.
+	REQUIRE(!astar::isWalkableByRadius(21.0f, from, face, to));
+
+	dtFreeNavMesh(navMesh);
+}
+
+TEST_CASE("dtCreateNavMeshData polygon triangulation")
+{
+	dtNavMesh* fanMesh = createSliverNavMesh(false);
+	dtNavMesh* delaunayMesh = createSliverNavMesh(true);
+	REQUIRE(fanMesh);
+	REQUIRE(delaunayMesh);
+
+	const dtNavMesh* constFan = fanMesh;
+	const dtNavMesh* constDelaunay = delaunayMesh;
+	REQUIRE(constFan->getTile(0)->polyTriangulations == 0);
+	REQUIRE(constFan->getTile(0)->header->polyTriangulationCount == 0);
+	const dtMeshTile* tile = constDelaunay->getTile(0);
+	REQUIRE(tile->polyTriangulations);
+	REQUIRE(tile->header->polyTriangulationCount == 1);
+
+	const dtPolyRef ref = delaunayMesh->getPolyRefBase(tile);
+	const dtPoly* poly = &tile->polys[0];
+	const int faceCount = poly->vertCount - 2;
+
+	SECTION("The queriers follow the stored triangles")
+	{
+		for (int f = 0; f < faceCount; ++f)
+		{
+			const dtResolvedPolyFace face(delaunayMesh, ref, (dtPrimIndex)f, tile, poly);
+			int verts[3];
+			queriers::faceVertexIndices(tile, poly, f, verts);
+			for (int k = 0; k < 3; ++k)
+			{
+				const dtResolvedPolyEdge edge = queriers::faceLocalEdge(face, k);
+				REQUIRE(queriers::edgeLeftFace(edge) == face);
+				REQUIRE(queriers::edgeFaceIndex(edge) == k);
+				REQUIRE(queriers::edgeOriginVertex(edge).innerIdx == verts[k]);
+				REQUIRE(queriers::edgeDestinationVertex(edge).innerIdx == verts[(k + 1) % 3]);
+
+				// The inner edges lead to the face on the other side of the diagonal.
+				const dtResolvedPolyFace neighbour = queriers::edgeRightFace(edge);
+				if (edge.innerIdx >= DT_VERTS_PER_POLYGON)
+				{
+					REQUIRE(neighbour.isValid());
+					REQUIRE(neighbour != face);
+					const dtResolvedPolyEdge twin = queriers::edgeOppositeEdge(edge);
+					REQUIRE(queriers::edgeOriginVertex(twin).innerIdx == verts[(k + 1) % 3]);
+					REQUIRE(queriers::edgeOppositeEdge(twin) == edge);
+				}
+				else
+				{
+					REQUIRE(!neighbour.isValid());
+				}
+			}
+		}
+	}
+
+	SECTION("The fan sliver is flipped away")
+	{
+		float fanMinArea = FLT_MAX, delaunayMinArea = FLT_MAX;
+		for (int f = 0; f < faceCount; ++f)
+		{
+			int verts[3];
+			float a[3], b[3], c[3];
+			queriers::faceVertexIndices(constFan->getTile(0), &constFan->getTile(0)->polys[0], f, verts);
+			dtVcopy(a, &constFan->getTile(0)->verts[poly->verts[verts[0]]*3]);
+			dtVcopy(b, &constFan->getTile(0)->verts[poly->verts[verts[1]]*3]);
+			dtVcopy(c, &constFan->getTile(0)->verts[poly->verts[verts[2]]*3]);
+			fanMinArea = dtMin(fanMinArea, dtAbs(dtTriArea2D(a, b, c)));
+
+			queriers::faceVertexIndices(tile, poly, f, verts);
+			dtVcopy(a, &tile->verts[poly->verts[verts[0]]*3]);
+			dtVcopy(b, &tile->verts[poly->verts[verts[1]]*3]);
+			dtVcopy(c, &tile->verts[poly->verts[verts[2]]*3]);
+			delaunayMinArea = dtMin(delaunayMinArea, dtAbs(dtTriArea2D(a, b, c)));
+		}
+		REQUIRE(fanMinArea == 0.0f);
+		REQUIRE(delaunayMinArea > 1.0f);
+
+		// The nearest face of a point on the bottom edge is a real triangle.
+		dtNavMeshQuery* query = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(query->init(delaunayMesh, 256)));
+		dtQueryFilter filter;
+		const float pos[3] = { 3.0f, 0.0f, 0.0f };
+		const float halfExtents[3] = { 1, 1, 1 };
+		dtPolyFace nearest;
+		REQUIRE(dtStatusSucceed(query->findNearestFace(pos, halfExtents, &filter, &nearest, 0)));
+		REQUIRE(nearest.isValid());
+		int verts[3];
+		queriers::faceVertexIndices(tile, poly, nearest.innerIdx, verts);
+		float a[3], b[3], c[3];
+		dtVcopy(a, &tile->verts[poly->verts[verts[0]]*3]);
+		dtVcopy(b, &tile->verts[poly->verts[verts[1]]*3]);
+		dtVcopy(c, &tile->verts[poly->verts[verts[2]]*3]);
+		REQUIRE(dtAbs(dtTriArea2D(a, b, c)) > 1.0f);
+		dtFreeNavMeshQuery(query);
+	}
+
+	SECTION("Units pass the length of the polygon with either triangulation")
+	{
+		dtNavMeshQuery* fanQuery = dtAllocNavMeshQuery();
+		dtNavMeshQuery* delaunayQuery = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(fanQuery->init(fanMesh, 256)));
+		REQUIRE(dtStatusSucceed(delaunayQuery->init(delaunayMesh, 256)));
+
+		dtQueryFilter filter;
+		const float halfExtents[3] = { 1, 1, 1 };
+		const float startPos[3] = { 0.9f, 0.0f, 1.0f };
+		const float endPos[3] = { 11.1f, 0.0f, 1.0f };
+
+		dtPolyFace startFace, endFace;
+		REQUIRE(dtStatusSucceed(delaunayQuery->findNearestFace(startPos, halfExtents, &filter, &startFace, 0)));
+		REQUIRE(dtStatusSucceed(delaunayQuery->findNearestFace(endPos, halfExtents, &filter, &endFace, 0)));
+		dtPolyFace path[8];
+		dtPolyEdge portals[8];
+		int pathCount = 0, portalCount = 0;
+		dtStatus status = delaunayQuery->findPathByRadius(startFace, endFace, startPos, endPos, &filter,
+			path, &pathCount, 8, portals, &portalCount, 8, 0.8f);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(path[pathCount - 1] == endFace);
+
+		REQUIRE(dtStatusSucceed(fanQuery->findNearestFace(startPos, halfExtents, &filter, &startFace, 0)));
+		REQUIRE(dtStatusSucceed(fanQuery->findNearestFace(endPos, halfExtents, &filter, &endFace, 0)));
+		status = fanQuery->findPathByRadius(startFace, endFace, startPos, endPos, &filter,
+			path, &pathCount, 8, portals, &portalCount, 8, 0.8f);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+
+		dtFreeNavMeshQuery(fanQuery);
+		dtFreeNavMeshQuery(delaunayQuery);
+	}
+
+	dtFreeNavMesh(fanMesh);
+	dtFreeNavMesh(delaunayMesh);
+}
+
+TEST_CASE("dtNavMeshQuery::findNearestFace")
+{
+	dtNavMesh* polyTreeMesh = createCorridorNavMesh(false);
+	dtNavMesh* faceTreeMesh = createCorridorNavMesh(false, true);
+	REQUIRE(polyTreeMesh);
+	REQUIRE(faceTreeMesh);
+
+	const dtMeshTile* tile = faceTreeMesh->getTileAt(0, 0, 0);
+	REQUIRE(polyTreeMesh->getTileAt(0, 0, 0)->faceBvTree == 0);
+	REQUIRE(tile->faceBvTree != 0);
+	// 4 + 2 + 4 fan triangles.
+	REQUIRE(tile->header->faceBvNodeCount == 2 * 10);
+
+	dtNavMeshQuery* polyTreeQuery = dtAllocNavMeshQuery();
+	dtNavMeshQuery* faceTreeQuery = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(polyTreeQuery->init(polyTreeMesh, 256)));
+	REQUIRE(dtStatusSucceed(faceTreeQuery->init(faceTreeMesh, 256)));
+
+	dtQueryFilter filter;
+	const float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+
+	SECTION("Queries land on the face containing the point")
+	{
+		for (float z = 0.1f; z < 4.0f; z += 0.3f)
+		{
+			for (float x = 0.05f; x < 12.0f; x += 0.3f)
+			{
+				const float pos[3] = { x, 0.5f, z };
+				dtPolyFace face, polyTreeFace;
+				float nearestPt[3];
+				const dtStatus status = faceTreeQuery->findNearestFace(pos, halfExtents, &filter, &face, nearestPt);
+				REQUIRE(dtStatusSucceed(polyTreeQuery->findNearestFace(pos, halfExtents, &filter, &polyTreeFace, 0)) == dtStatusSucceed(status));
+				if (dtStatusFailed(status))
+					continue;
+				REQUIRE(face.polyId == polyTreeFace.polyId);
+				REQUIRE(face.innerIdx == polyTreeFace.innerIdx);
+
+				const bool outside = x > 4.0f && x < 8.0f && (z < 1.0f || z > 2.0f);
+				if (outside)
+					continue;
+
+				float tri[9];
+				dtPolyVertex verts[3];
+				iterations::fromFaceToVertices iterVerts(face);
+				REQUIRE(iterVerts.allVertices(verts, 3) == 3);
+				for (int i = 0; i < 3; ++i)
+					queriers::vertexPosition(verts[i], &tri[i * 3]);
+				REQUIRE(dtPointInPolygon(pos, tri, 3));
+				REQUIRE(nearestPt[0] == Approx(x));
+				REQUIRE(nearestPt[1] == Approx(0.0f));
+				REQUIRE(nearestPt[2] == Approx(z));
+			}
+		}
+	}
+
+	SECTION("Points off the mesh snap to the closest face")
+	{
+		const float pos[3] = { 6.0f, 0.0f, 2.3f };
+		dtPolyFace face;
+		float nearestPt[3];
+		REQUIRE(dtStatusSucceed(faceTreeQuery->findNearestFace(pos, halfExtents, &filter, &face, nearestPt)));
+		REQUIRE(nearestPt[0] == Approx(6.0f));
+		REQUIRE(nearestPt[2] == Approx(2.0f));
+	}
+
+	SECTION("Nothing is found outside the tiles")
+	{
+		const float pos[3] = { 20.0f, 0.0f, 20.0f };
+		dtPolyFace face;
+		REQUIRE(dtStatusFailed(faceTreeQuery->findNearestFace(pos, halfExtents, &filter, &face, 0)));
+		REQUIRE(dtStatusFailed(faceTreeQuery->findNearestFace(pos, halfExtents, &filter, 0, 0)));
+	}
+
+	dtFreeNavMeshQuery(faceTreeQuery);
+	dtFreeNavMeshQuery(polyTreeQuery);
+	dtFreeNavMesh(faceTreeMesh);
+	dtFreeNavMesh(polyTreeMesh);
+}
+
+TEST_CASE("dtResolvedPolyPrimitive")
+{
+	dtNavMesh* navMesh = createCorridorNavMesh(true);
+	REQUIRE(navMesh);
+
+	const dtMeshTile* tile = navMesh->getTileAt(0, 0, 0);
+	const dtPolyRef base = navMesh->getPolyRefBase(tile);
+
+	SECTION("Invalid refs do not resolve")
+	{
+		dtResolvedPolyFace face(dtPolyFace(navMesh, base | 7, 0));
+		REQUIRE(!face.isValid());
+		REQUIRE(!face.tile);
+		REQUIRE(!face.poly);
+	}
+
+	SECTION("Resolved queriers agree with the unresolved ones")
+	{
+		for (int ip = 0; ip < tile->header->polyCount; ++ip)
+		{
+			const dtPolyRef ref = base | (dtPolyRef)ip;
+			iterations::fromPolyToInternalFaces iterFaces(navMesh, ref);
+			int faceCount = 0;
+			for (dtResolvedPolyFace face = iterFaces.next(); face.isValid(); face = iterFaces.next())
+			{
+				++faceCount;
+				REQUIRE(face.tile == tile);
+				REQUIRE(face.poly == &tile->polys[ip]);
+
+				const dtPolyFace plainFace(navMesh, ref, face.innerIdx);
+				for (int k = 0; k < 3; ++k)
+				{
+					const dtResolvedPolyEdge edge = queriers::faceLocalEdge(face, k);
+					const dtPolyEdge plainEdge = queriers::faceLocalEdge(plainFace, k);
+					REQUIRE(edge == plainEdge);
+					REQUIRE(queriers::edgeFaceIndex(edge) == k);
+					REQUIRE(queriers::edgeLeftFace(edge) == face);
+					REQUIRE(queriers::edgeOriginVertex(edge) == queriers::edgeOriginVertex(plainEdge));
+					REQUIRE(queriers::edgeDestinationVertex(edge) == queriers::edgeDestinationVertex(plainEdge));
+					REQUIRE(queriers::edgeNextLeftEdge(edge) == queriers::edgeNextLeftEdge(plainEdge));
+					REQUIRE(queriers::edgeIsBoundary(edge) == queriers::edgeIsBoundary(plainEdge));
+
+					const dtResolvedPolyEdge opposite = queriers::edgeOppositeEdge(edge);
+					REQUIRE(opposite == queriers::edgeOppositeEdge(plainEdge));
+					REQUIRE(opposite.isValid() != queriers::edgeIsBoundary(edge));
+					if (opposite.isValid())
+					{
+						REQUIRE(opposite.poly == &tile->polys[navMesh->decodePolyIdPoly(opposite.polyId)]);
+						REQUIRE(queriers::edgeOppositeEdge(opposite) == edge);
+					}
+
+					float pos[3] = { 0, 0, 0 }, plainPos[3] = { 0, 0, 0 };
+					REQUIRE(queriers::vertexPosition(queriers::edgeOriginVertex(edge), pos));
+					REQUIRE(queriers::vertexPosition(queriers::edgeOriginVertex(plainEdge), plainPos));
+					REQUIRE(dtVequal(pos, plainPos));
+				}
+			}
+			REQUIRE(faceCount == tile->polys[ip].vertCount - 2);
+		}
+	}
+
+	dtFreeNavMesh(navMesh);
+}
+
+TEST_CASE("dtNavMeshQuery::findPathByRadius")
+{
+	dtNavMesh* navMesh = createCorridorNavMesh(true);
+	REQUIRE(navMesh);
+
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(navMesh, 2048)));
+
+	dtQueryFilter filter;
+	const float halfExtents[3] = { 1, 1, 1 };
+	const float startPos[3] = { 1.0f, 0.0f, 2.0f };
+	const float endPos[3] = { 11.0f, 0.0f, 2.0f };
+
+	dtPolyFace startFace, endFace;
+	REQUIRE(dtStatusSucceed(query->findNearestFace(startPos, halfExtents, &filter, &startFace, 0)));
+	REQUIRE(dtStatusSucceed(query->findNearestFace(endPos, halfExtents, &filter, &endFace, 0)));
+
+	static const int MAX_PATH = 64;
+	dtPolyFace path[MAX_PATH];
+	dtPolyEdge portals[MAX_PATH];
+	int pathCount = 0;
+	int portalCount = 0;
+
+	SECTION("Small units pass the corridor")
+	{
+		dtStatus status = query->findPathByRadius(startFace, endFace, startPos, endPos, &filter,
+			path, &pathCount, MAX_PATH, portals, &portalCount, MAX_PATH, 0.4f);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(pathCount > 2);
+		REQUIRE(path[0] == startFace);
+		REQUIRE(path[pathCount - 1] == endFace);
+		REQUIRE(portalCount == pathCount - 1);
+	}
+
+	SECTION("The portal edges are limited to their buffer")
+	{
+		dtPolyEdge shortPortals[2];
+		dtStatus status = query->findPathByRadius(startFace, endFace, startPos, endPos, &filter,
+			path, &pathCount, MAX_PATH, shortPortals, &portalCount, 2, 0.4f);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(dtStatusDetail(status, DT_BUFFER_TOO_SMALL));
+		REQUIRE(pathCount > 3);
+		REQUIRE(portalCount == 2);
+
+		REQUIRE(dtStatusSucceed(query->findPathByRadius(startFace, endFace, startPos, endPos, &filter,
+			path, &pathCount, MAX_PATH, portals, &portalCount, MAX_PATH, 0.4f)));
+		REQUIRE(shortPortals[0] == portals[0]);
+		REQUIRE(shortPortals[1] == portals[1]);
+	}
+
+	SECTION("Large units do not fit the corridor")
+	{
+		dtStatus status = query->findPathByRadius(startFace, endFace, startPos, endPos, &filter,
+			path, &pathCount, MAX_PATH, portals, &portalCount, MAX_PATH, 0.8f);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(path[pathCount - 1].polyId == startFace.polyId);
+	}
+
+	SECTION("Sliced query matches the single call")
+	{
+		dtStatus status = query->findPathByRadius(startFace, endFace, startPos, endPos, &filter,
+			path, &pathCount, MAX_PATH, portals, &portalCount, MAX_PATH, 0.4f);
+		REQUIRE(dtStatusSucceed(status));
+
+		status = query->initSlicedFindPathByRadius(startFace, endFace, startPos, endPos, &filter, 0.4f);
+		REQUIRE(dtStatusInProgress(status));
+
+		int doneIters = 0;
+		status = query->updateSlicedFindPathByRadius(1, &doneIters);
+		REQUIRE(dtStatusInProgress(status));
+		REQUIRE(doneIters == 1);
+
+		int totalIters = doneIters;
+		while (dtStatusInProgress(status))
+		{
+			status = query->updateSlicedFindPathByRadius(1, &doneIters);
+			totalIters += doneIters;
+		}
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(totalIters > 1);
+
+		dtPolyFace slicedPath[MAX_PATH];
+		dtPolyEdge slicedPortals[MAX_PATH];
+		int slicedPathCount = 0;
+		int slicedPortalCount = 0;
+		status = query->finalizeSlicedFindPathByRadius(slicedPath, &slicedPathCount, MAX_PATH,
+			slicedPortals, &slicedPortalCount, MAX_PATH);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(slicedPathCount == pathCount);
+		REQUIRE(slicedPortalCount == portalCount);
+		for (int i = 0; i < pathCount; ++i)
+			REQUIRE(slicedPath[i] == path[i]);
+		for (int i = 0; i < portalCount; ++i)
+			REQUIRE(slicedPortals[i] == portals[i]);
+	}
+
+	SECTION("Sliced query can be finalized early")
+	{
+		dtStatus status = query->initSlicedFindPathByRadius(startFace, endFace, startPos, endPos, &filter, 0.4f);
+		REQUIRE(dtStatusInProgress(status));
+		status = query->updateSlicedFindPathByRadius(2, 0);
+		REQUIRE(dtStatusInProgress(status));
+
+		status = query->finalizeSlicedFindPathByRadiusPartial(&endFace, 1, path, &pathCount, MAX_PATH,
+			portals, &portalCount, MAX_PATH);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(pathCount >= 1);
+		REQUIRE(path[0] == startFace);
+		REQUIRE(portalCount == pathCount - 1);
+	}
+
+	SECTION("Sliced query rejects invalid input")
+	{
+		dtStatus status = query->initSlicedFindPathByRadius(startFace, dtPolyFace(), startPos, endPos, &filter, 0.4f);
+		REQUIRE(dtStatusFailed(status));
+		REQUIRE(dtStatusFailed(query->updateSlicedFindPathByRadius(8, 0)));
+		REQUIRE(dtStatusFailed(query->finalizeSlicedFindPathByRadius(path, &pathCount, MAX_PATH,
+			portals, &portalCount, MAX_PATH)));
+		REQUIRE(pathCount == 0);
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(navMesh);
+}
+
+TEST_CASE("dtCreateNavMeshData face abstraction")
+{
+	dtNavMesh* navMesh = createMazeNavMesh(true);
+	REQUIRE(navMesh);
+
+	const dtNavMesh* constMesh = navMesh;
+	const dtMeshTile* tile = constMesh->getTile(0);
+	REQUIRE(tile->header->faceAbstractionCount == tile->header->polyCount*DT_FACES_PER_POLYGON);
+	REQUIRE(tile->faceAbstractions);
+
+	int counts[3] = { 0, 0, 0 };
+	unsigned short spurRegion = 0;
+	for (int i = 0; i < tile->header->polyCount; ++i)
+	{
+		for (int j = 0; j < tile->polys[i].vertCount - 2; ++j)
+		{
+			const dtFaceAbstraction& fa = tile->faceAbstractions[i*DT_FACES_PER_POLYGON + j];
+			REQUIRE(fa.type <= DT_FACE_DEAD_END);
+			counts[fa.type]++;
+
+			// The two spur cells are the last polygons, their faces form one tree.
+			// The corner cells also have a single leaf triangle each, which are trees of their own.
+			if (i >= 13)
+			{
+				REQUIRE(fa.type == DT_FACE_DEAD_END);
+				if (!spurRegion)
+					spurRegion = fa.region;
+				REQUIRE(fa.region == spurRegion);
+			}
+			else if (fa.type == DT_FACE_DEAD_END)
+			{
+				REQUIRE(fa.region != 0);
+				REQUIRE(fa.region != spurRegion);
+			}
+			else
+			{
+				REQUIRE(fa.region == 0);
+			}
+
+			// The cells are 2 units wide.
+			if (fa.type == DT_FACE_CORRIDOR)
+				REQUIRE(fa.corridorWidth >= 2.0f - 0.001f);
+			else
+				REQUIRE(fa.corridorWidth == 0.0f);
+		}
+	}
+	REQUIRE(spurRegion != 0);
+	REQUIRE(counts[DT_FACE_DECISION] > 0);
+	REQUIRE(counts[DT_FACE_CORRIDOR] > counts[DT_FACE_DECISION]);
+
+	SECTION("Disabled by default")
+	{
+		dtNavMesh* plainMesh = createMazeNavMesh(false);
+		REQUIRE(plainMesh);
+		const dtNavMesh* constPlain = plainMesh;
+		REQUIRE(constPlain->getTile(0)->header->faceAbstractionCount == 0);
+		REQUIRE(constPlain->getTile(0)->faceAbstractions == 0);
+		dtFreeNavMesh(plainMesh);
+	}
+
+	dtFreeNavMesh(navMesh);
+}
+
+TEST_CASE("dtNavMeshQuery::findPathByRadius face abstraction")
+{
+	dtNavMesh* plainMesh = createMazeNavMesh(false);
+	dtNavMesh* abstractMesh = createMazeNavMesh(true);
+	REQUIRE(plainMesh);
+	REQUIRE(abstractMesh);
+
+	dtNavMeshQuery* plainQuery = dtAllocNavMeshQuery();
+	dtNavMeshQuery* abstractQuery = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(plainQuery->init(plainMesh, 2048)));
+	REQUIRE(dtStatusSucceed(abstractQuery->init(abstractMesh, 2048)));
+
+	debug::dtTraceBuffer plainTrace, abstractTrace;
+	REQUIRE(plainTrace.init(4096));
+	REQUIRE(abstractTrace.init(4096));
+	plainQuery->setTraceBuffer(&plainTrace);
+	abstractQuery->setTraceBuffer(&abstractTrace);
+
+	dtQueryFilter filter;
+	const float halfExtents[3] = { 1, 1, 1 };
+
+	static const int MAX_PATH = 64;
+	dtPolyFace plainPath[MAX_PATH], abstractPath[MAX_PATH];
+	dtPolyEdge plainPortals[MAX_PATH], abstractPortals[MAX_PATH];
+	int plainCount = 0, abstractCount = 0;
+	int plainPortalCount = 0, abstractPortalCount = 0;
+
+	// Up the left column, the shortest route is unique in every section.
+	float startPos[3] = { 1.0f, 0.0f, 1.0f };
+	float endPos[3] = { 1.0f, 0.0f, 9.0f };
+	float radius = 0.4f;
+
+	SECTION("Corridors are walked in one step")
+	{
+	}
+	SECTION("Goal inside the dead end")
+	{
+		endPos[0] = 3.0f; endPos[2] = 13.0f;
+	}
+	SECTION("Start inside the dead end")
+	{
+		startPos[0] = 3.0f; startPos[2] = 13.0f;
+		endPos[0] = 1.0f; endPos[2] = 1.0f;
+	}
+	SECTION("Units wider than the corridors")
+	{
+		radius = 1.2f;
+	}
+
+	dtPolyFace startFace, endFace, abstractStart, abstractEnd;
+	REQUIRE(dtStatusSucceed(plainQuery->findNearestFace(startPos, halfExtents, &filter, &startFace, 0)));
+	REQUIRE(dtStatusSucceed(plainQuery->findNearestFace(endPos, halfExtents, &filter, &endFace, 0)));
+	REQUIRE(dtStatusSucceed(abstractQuery->findNearestFace(startPos, halfExtents, &filter, &abstractStart, 0)));
+	REQUIRE(dtStatusSucceed(abstractQuery->findNearestFace(endPos, halfExtents, &filter, &abstractEnd, 0)));
+
+	const dtStatus plainStatus = plainQuery->findPathByRadius(startFace, endFace, startPos, endPos, &filter,
+		plainPath, &plainCount, MAX_PATH, plainPortals, &plainPortalCount, MAX_PATH, radius);
+	const dtStatus abstractStatus = abstractQuery->findPathByRadius(abstractStart, abstractEnd, startPos, endPos, &filter,
+		abstractPath, &abstractCount, MAX_PATH, abstractPortals, &abstractPortalCount, MAX_PATH, radius);
+	REQUIRE(dtStatusSucceed(plainStatus));
+	REQUIRE(dtStatusSucceed(abstractStatus));
+	REQUIRE(dtStatusDetail(plainStatus, DT_PARTIAL_RESULT) == dtStatusDetail(abstractStatus, DT_PARTIAL_RESULT));
+	if (radius < 1.0f)
+		REQUIRE(!dtStatusDetail(abstractStatus, DT_PARTIAL_RESULT));
+
+	// Same faces and portals, only fewer expansions.
+	REQUIRE(abstractCount == plainCount);
+	REQUIRE(abstractPortalCount == plainPortalCount);
+	for (int i = 0; i < plainCount; ++i)
+	{
+		REQUIRE(abstractPath[i].polyId == plainPath[i].polyId);
+		REQUIRE(abstractPath[i].innerIdx == plainPath[i].innerIdx);
+	}
+	for (int i = 0; i < plainPortalCount; ++i)
+	{
+		REQUIRE(abstractPortals[i].polyId == plainPortals[i].polyId);
+		REQUIRE(abstractPortals[i].innerIdx == plainPortals[i].innerIdx);
+		REQUIRE(queriers::edgeRightFace(abstractPortals[i]) == abstractPath[i+1]);
+	}
+
+	const int plainExpanded = countTraceEvents(plainTrace, debug::DT_TRACE_FACE_EXPANDED);
+	const int abstractExpanded = countTraceEvents(abstractTrace, debug::DT_TRACE_FACE_EXPANDED);
+	REQUIRE(abstractExpanded <= plainExpanded);
+	if (radius < 1.0f)
+		REQUIRE(abstractExpanded * 2 < plainExpanded);
+
+	// The refined chains also fill a short path buffer from the start.
+	if (abstractCount > 3)
+	{
+		dtPolyFace shortPath[3];
+		dtPolyEdge shortPortals[3];
+		int shortCount = 0, shortPortalCount = 0;
+		const dtStatus status = abstractQuery->findPathByRadius(abstractStart, abstractEnd, startPos, endPos, &filter,
+			shortPath, &shortCount, 3, shortPortals, &shortPortalCount, 3, radius);
+		REQUIRE(dtStatusDetail(status, DT_BUFFER_TOO_SMALL));
+		REQUIRE(shortCount == 3);
+		REQUIRE(shortPortalCount == 2);
+		for (int i = 0; i < 3; ++i)
+			REQUIRE(shortPath[i] == abstractPath[i]);
+		for (int i = 0; i < 2; ++i)
+			REQUIRE(shortPortals[i] == abstractPortals[i]);
+	}
+
+	dtFreeNavMeshQuery(plainQuery);
+	dtFreeNavMeshQuery(abstractQuery);
+	dtFreeNavMesh(plainMesh);
+	dtFreeNavMesh(abstractMesh);
+}
+
+TEST_CASE("dtNavMeshQuery bidirectional search")
+{
+	dtQueryFilter filter;
+	const float halfExtents[3] = { 1, 1, 1 };
+
+	static const int MAX_PATH = 64;
+	dtPolyFace path[MAX_PATH], biPath[MAX_PATH];
+	dtPolyEdge portals[MAX_PATH], biPortals[MAX_PATH];
+	int pathCount = 0, biPathCount = 0;
+	int portalCount = 0, biPortalCount = 0;
+
+	SECTION("Point path matches the unidirectional search")
+	{
+		dtNavMesh* navMesh = createTwoRouteNavMesh();
+		REQUIRE(navMesh);
+		dtNavMeshQuery* query = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(query->init(navMesh, 2048)));
+
+		const float startPos[3] = { 1.0f, 0.0f, 1.0f };
+		const float endPos[3] = { 11.0f, 0.0f, 9.0f };
+		dtPolyRef startRef, endRef;
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(startPos, halfExtents, &filter, &startRef, 0)));
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(endPos, halfExtents, &filter, &endRef, 0)));
+
+		dtPolyRef polys[MAX_PATH], biPolys[MAX_PATH];
+		dtStatus status = query->findPath(startRef, endRef, startPos, endPos, &filter, polys, &pathCount, MAX_PATH);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+		status = query->findPath(startRef, endRef, startPos, endPos, &filter, biPolys, &biPathCount, MAX_PATH,
+			DT_FINDPATH_BIDIRECTIONAL);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(biPathCount == pathCount);
+		for (int i = 0; i < pathCount; ++i)
+			REQUIRE(biPolys[i] == polys[i]);
+
+		// Block the corridor, both searches take the detour.
+		filter.setExcludeFlags(2);
+		REQUIRE(dtStatusSucceed(navMesh->setPolyFlags(polys[pathCount / 2], 1 | 2)));
+		status = query->findPath(startRef, endRef, startPos, endPos, &filter, polys, &pathCount, MAX_PATH);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+		status = query->findPath(startRef, endRef, startPos, endPos, &filter, biPolys, &biPathCount, MAX_PATH,
+			DT_FINDPATH_BIDIRECTIONAL);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(biPathCount == pathCount);
+		for (int i = 0; i < pathCount; ++i)
+			REQUIRE(biPolys[i] == polys[i]);
+
+		dtFreeNavMeshQuery(query);
+		dtFreeNavMesh(navMesh);
+	}
+
+	SECTION("Radius path matches the unidirectional search")
+	{
+		static const int QUERY_COUNT = 5;
+		const float queries[QUERY_COUNT][7] = {
+			// start, end, radius
+			{ 1.0f, 0.0f, 1.0f,   1.0f, 0.0f, 9.0f,   0.4f },
+			{ 1.0f, 0.0f, 1.0f,   3.0f, 0.0f, 13.0f,  0.4f },
+			{ 3.0f, 0.0f, 13.0f,  1.0f, 0.0f, 1.0f,   0.2f },
+			{ 1.0f, 0.0f, 1.0f,   3.0f, 0.0f, 5.0f,   0.3f },
+			{ 1.0f, 0.0f, 1.0f,   1.0f, 0.0f, 9.0f,   1.2f },
+		};
+
+		for (int abstraction = 0; abstraction < 2; ++abstraction)
+		{
+			dtNavMesh* navMesh = createMazeNavMesh(abstraction != 0);
+			REQUIRE(navMesh);
+			dtNavMeshQuery* query = dtAllocNavMeshQuery();
+			REQUIRE(dtStatusSucceed(query->init(navMesh, 2048)));
+
+			for (int q = 0; q < QUERY_COUNT; ++q)
+			{
+				const float* startPos = &queries[q][0];
+				const float* endPos = &queries[q][3];
+				const float radius = queries[q][6];
+				dtPolyFace startFace, endFace;
+				REQUIRE(dtStatusSucceed(query->findNearestFace(startPos, halfExtents, &filter, &startFace, 0)));
+				REQUIRE(dtStatusSucceed(query->findNearestFace(endPos, halfExtents, &filter, &endFace, 0)));
+
+				const dtStatus status = query->findPathByRadius(startFace, endFace, startPos, endPos, &filter,
+					path, &pathCount, MAX_PATH, portals, &portalCount, MAX_PATH, radius);
+				const dtStatus biStatus = query->findPathByRadius(startFace, endFace, startPos, endPos, &filter,
+					biPath, &biPathCount, MAX_PATH, biPortals, &biPortalCount, MAX_PATH, radius, DT_FINDPATH_BIDIRECTIONAL);
+				REQUIRE(dtStatusSucceed(status));
+				REQUIRE(dtStatusSucceed(biStatus));
+				REQUIRE(dtStatusDetail(biStatus, DT_PARTIAL_RESULT) == dtStatusDetail(status, DT_PARTIAL_RESULT));
+				REQUIRE(biPath[0] == startFace);
+
+				if (dtStatusDetail(status, DT_PARTIAL_RESULT))
+				{
+					REQUIRE(biPath[biPathCount - 1] == path[pathCount - 1]);
+					continue;
+				}
+
+				// The same polygons, the faces inside a polygon may differ between equal routes.
+				REQUIRE(biPath[biPathCount - 1] == endFace);
+				REQUIRE(biPortalCount == biPathCount - 1);
+				for (int i = 0; i < biPortalCount; ++i)
+				{
+					REQUIRE(queriers::edgeLeftFace(biPortals[i]) == biPath[i]);
+					REQUIRE(queriers::edgeRightFace(biPortals[i]) == biPath[i+1]);
+				}
+				int n = 0, biN = 0;
+				dtPolyRef polys[MAX_PATH], biPolys[MAX_PATH];
+				for (int i = 0; i < pathCount; ++i)
+				{
+					if (n == 0 || polys[n-1] != path[i].polyId)
+						polys[n++] = path[i].polyId;
+				}
+				for (int i = 0; i < biPathCount; ++i)
+				{
+					if (biN == 0 || biPolys[biN-1] != biPath[i].polyId)
+						biPolys[biN++] = biPath[i].polyId;
+				}
+				REQUIRE(biN == n);
+				for (int i = 0; i < n; ++i)
+					REQUIRE(biPolys[i] == polys[i]);
+			}
+
+			dtFreeNavMeshQuery(query);
+			dtFreeNavMesh(navMesh);
+		}
+	}
+}
+
+// The default filter rules with one blocked polygon, counting its calls.
+struct BlockingFilter : public dtQueryFilter
+{
+	dtPolyRef blockedRef;
+	mutable int passCount;
+	mutable int costCount;
+
+	BlockingFilter() : blockedRef(0), passCount(0), costCount(0) {}
+
+	inline bool passFilter(const dtPolyRef ref, const dtMeshTile* /*tile*/, const dtPoly* poly) const
+	{
+		++passCount;
+		return ref != blockedRef &&
+			(poly->flags & getIncludeFlags()) != 0 && (poly->flags & getExcludeFlags()) == 0;
+	}
+
+	inline float getCost(const float* pa, const float* pb,
+		const dtPolyRef /*prevRef*/, const dtMeshTile* /*prevTile*/, const dtPoly* /*prevPoly*/,
+		const dtPolyRef /*curRef*/, const dtMeshTile* /*curTile*/, const dtPoly* curPoly,
+		const dtPolyRef /*nextRef*/, const dtMeshTile* /*nextTile*/, const dtPoly* /*nextPoly*/) const
+	{
+		++costCount;
+		return dtVdist(pa, pb) * getAreaCost(curPoly->getArea());
+	}
+};
+
+TEST_CASE("dtNavMeshQuery filter templates")
+{
+	const float halfExtents[3] = { 1, 1, 1 };
+	static const int MAX_PATH = 64;
+	dtQueryFilter defaultFilter;
+	BlockingFilter filter;
+
+	SECTION("Point path with the filter type")
+	{
+		dtNavMesh* navMesh = createTwoRouteNavMesh();
+		REQUIRE(navMesh);
+		dtNavMeshQuery* query = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(query->init(navMesh, 2048)));
+
+		const float startPos[3] = { 1.0f, 0.0f, 1.0f };
+		const float endPos[3] = { 11.0f, 0.0f, 9.0f };
+		dtPolyRef startRef, endRef;
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(startPos, halfExtents, &defaultFilter, &startRef, 0)));
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(endPos, halfExtents, &defaultFilter, &endRef, 0)));
+
+		dtPolyRef polys[MAX_PATH], filterPolys[MAX_PATH];
+		int pathCount = 0, filterPathCount = 0;
+		REQUIRE(dtStatusSucceed(query->findPath(startRef, endRef, startPos, endPos, &defaultFilter,
+			polys, &pathCount, MAX_PATH)));
+
+		// The same rules give the same path, through the functions of the filter type.
+		dtStatus status = query->findPathWithFilter(startRef, endRef, startPos, endPos, &filter,
+			filterPolys, &filterPathCount, MAX_PATH);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(filter.passCount > 0);
+		REQUIRE(filter.costCount > 0);
+		REQUIRE(filterPathCount == pathCount);
+		for (int i = 0; i < pathCount; ++i)
+			REQUIRE(filterPolys[i] == polys[i]);
+
+		// Blocking the corridor takes the detour.
+		const dtPolyRef blockedRef = polys[pathCount / 2];
+		filter.blockedRef = blockedRef;
+		status = query->findPathWithFilter(startRef, endRef, startPos, endPos, &filter,
+			filterPolys, &filterPathCount, MAX_PATH);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(filterPolys[filterPathCount - 1] == endRef);
+		for (int i = 0; i < filterPathCount; ++i)
+			REQUIRE(filterPolys[i] != blockedRef);
+
+		// The bidirectional search calls the same filter functions.
+		dtPolyRef biPolys[MAX_PATH];
+		int biPathCount = 0;
+		status = query->findPathWithFilter(startRef, endRef, startPos, endPos, &filter,
+			biPolys, &biPathCount, MAX_PATH, DT_FINDPATH_BIDIRECTIONAL);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(biPolys[biPathCount - 1] == endRef);
+		for (int i = 0; i < biPathCount; ++i)
+			REQUIRE(biPolys[i] != blockedRef);
+
+		// The sliced search with the filter type.
+		REQUIRE(dtStatusInProgress(query->initSlicedFindPath(startRef, endRef, startPos, endPos, &filter)));
+		REQUIRE(query->updateSlicedFindPathWithFilter(&defaultFilter, 1, 0) == (DT_FAILURE | DT_INVALID_PARAM));
+		while (dtStatusInProgress(status = query->updateSlicedFindPathWithFilter(&filter, 4, 0)))
+			;
+		REQUIRE(dtStatusSucceed(status));
+		dtPolyRef slicedPolys[MAX_PATH];
+		int slicedPathCount = 0;
+		REQUIRE(dtStatusSucceed(query->finalizeSlicedFindPath(slicedPolys, &slicedPathCount, MAX_PATH)));
+		REQUIRE(slicedPathCount == filterPathCount);
+		for (int i = 0; i < slicedPathCount; ++i)
+			REQUIRE(slicedPolys[i] == filterPolys[i]);
+
+		dtFreeNavMeshQuery(query);
+		dtFreeNavMesh(navMesh);
+	}
+
+	SECTION("Radius path with the filter type")
+	{
+		dtNavMesh* navMesh = createMazeNavMesh(true);
+		REQUIRE(navMesh);
+		dtNavMeshQuery* query = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(query->init(navMesh, 2048)));
+
+		const float startPos[3] = { 1.0f, 0.0f, 1.0f };
+		const float endPos[3] = { 3.0f, 0.0f, 13.0f };
+		const float radius = 0.4f;
+		dtPolyFace startFace, endFace;
+		REQUIRE(dtStatusSucceed(query->findNearestFace(startPos, halfExtents, &defaultFilter, &startFace, 0)));
+		REQUIRE(dtStatusSucceed(query->findNearestFace(endPos, halfExtents, &defaultFilter, &endFace, 0)));
+
+		dtPolyFace path[MAX_PATH], filterPath[MAX_PATH];
+		dtPolyEdge portals[MAX_PATH], filterPortals[MAX_PATH];
+		int pathCount = 0, filterPathCount = 0, portalCount = 0, filterPortalCount = 0;
+		const dtStatus status = query->findPathByRadius(startFace, endFace, startPos, endPos, &defaultFilter,
+			path, &pathCount, MAX_PATH, portals, &portalCount, MAX_PATH, radius);
+		const dtStatus filterStatus = query->findPathByRadiusWithFilter(startFace, endFace, startPos, endPos, &filter,
+			filterPath, &filterPathCount, MAX_PATH, filterPortals, &filterPortalCount, MAX_PATH, radius);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(filterStatus == status);
+		REQUIRE(filter.passCount > 0);
+		REQUIRE(filter.costCount > 0);
+		REQUIRE(filterPathCount == pathCount);
+		REQUIRE(filterPortalCount == portalCount);
+		for (int i = 0; i < pathCount; ++i)
+			REQUIRE(filterPath[i] == path[i]);
+
+		// The bidirectional and the sliced searches call the same filter functions.
+		filter.blockedRef = path[pathCount / 2].polyId;
+		REQUIRE(filter.blockedRef != startFace.polyId);
+		REQUIRE(filter.blockedRef != endFace.polyId);
+		REQUIRE(dtStatusSucceed(query->findPathByRadiusWithFilter(startFace, endFace, startPos, endPos, &filter,
+			filterPath, &filterPathCount, MAX_PATH, filterPortals, &filterPortalCount, MAX_PATH, radius,
+			DT_FINDPATH_BIDIRECTIONAL)));
+		REQUIRE(filterPathCount > 0);
+		for (int i = 0; i < filterPathCount; ++i)
+			REQUIRE(filterPath[i].polyId != filter.blockedRef);
+
+		REQUIRE(dtStatusInProgress(query->initSlicedFindPathByRadius(startFace, endFace, startPos, endPos, &filter, radius)));
+		REQUIRE(query->updateSlicedFindPathByRadiusWithFilter(&defaultFilter, 1, 0) == (DT_FAILURE | DT_INVALID_PARAM));
+		dtStatus slicedStatus;
+		while (dtStatusInProgress(slicedStatus = query->updateSlicedFindPathByRadiusWithFilter(&filter, 4, 0)))
+			;
+		REQUIRE(dtStatusSucceed(slicedStatus));
+		REQUIRE(dtStatusSucceed(query->finalizeSlicedFindPathByRadius(filterPath, &filterPathCount, MAX_PATH,
+			filterPortals, &filterPortalCount, MAX_PATH)));
+		REQUIRE(filterPathCount > 0);
+		for (int i = 0; i < filterPathCount; ++i)
+			REQUIRE(filterPath[i].polyId != filter.blockedRef);
+
+		dtFreeNavMeshQuery(query);
+		dtFreeNavMesh(navMesh);
+	}
+}
+
+TEST_CASE("dtNavMeshQuery::findPathByRadii")
+{
+	dtNavMesh* navMesh = createTwoRouteNavMesh();
+	REQUIRE(navMesh);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(navMesh, 2048)));
+
+	debug::dtTraceBuffer trace;
+	REQUIRE(trace.init(4096));
+	query->setTraceBuffer(&trace);
+
+	dtQueryFilter filter;
+	const float halfExtents[3] = { 1, 1, 1 };
+	const float startPos[3] = { 2.0f, 0.0f, 2.0f };
+	const float endPos[3] = { 10.0f, 0.0f, 2.0f };
+	dtPolyFace startFace, endFace;
+	REQUIRE(dtStatusSucceed(query->findNearestFace(startPos, halfExtents, &filter, &startFace, 0)));
+	REQUIRE(dtStatusSucceed(query->findNearestFace(endPos, halfExtents, &filter, &endFace, 0)));
+
+	// Through the corridor, over the detour, and too wide for both.
+	static const int RADIUS_COUNT = 3;
+	const float radii[RADIUS_COUNT] = { 0.2f, 1.5f, 2.5f };
+	static const int MAX_PATH = 32;
+	dtPolyFace paths[RADIUS_COUNT*MAX_PATH];
+	dtPolyEdge portals[RADIUS_COUNT*MAX_PATH];
+	int pathCounts[RADIUS_COUNT];
+	int portalCounts[RADIUS_COUNT];
+	dtStatus pathStatuses[RADIUS_COUNT];
+
+	SECTION("Each radius gets the path of its own search")
+	{
+		const dtStatus status = query->findPathByRadii(startFace, endFace, startPos, endPos, &filter,
+			radii, RADIUS_COUNT, paths, pathCounts, MAX_PATH, portals, portalCounts, MAX_PATH, pathStatuses);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(dtStatusDetail(status, DT_PARTIAL_RESULT));
+		const int sharedExpanded = countTraceEvents(trace, debug::DT_TRACE_FACE_EXPANDED);
+
+		int singleExpanded = 0;
+		for (int i = 0; i < RADIUS_COUNT; ++i)
+		{
+			dtPolyFace path[MAX_PATH];
+			dtPolyEdge portalEdges[MAX_PATH];
+			int pathCount = 0, portalCount = 0;
+			trace.clear();
+			const dtStatus singleStatus = query->findPathByRadius(startFace, endFace, startPos, endPos, &filter,
+				path, &pathCount, MAX_PATH, portalEdges, &portalCount, MAX_PATH, radii[i]);
+			singleExpanded += countTraceEvents(trace, debug::DT_TRACE_FACE_EXPANDED);
+
+			REQUIRE(dtStatusSucceed(pathStatuses[i]));
+			REQUIRE(dtStatusDetail(pathStatuses[i], DT_PARTIAL_RESULT) == dtStatusDetail(singleStatus, DT_PARTIAL_RESULT));
+			REQUIRE(pathCounts[i] == pathCount);
+			REQUIRE(portalCounts[i] == portalCount);
+			for (int j = 0; j < pathCount; ++j)
+				REQUIRE(paths[i*MAX_PATH + j] == path[j]);
+			for (int j = 0; j < portalCount; ++j)
+				REQUIRE(portals[i*MAX_PATH + j] == portalEdges[j]);
+		}
+		REQUIRE(sharedExpanded < singleExpanded);
+
+		// The narrow unit takes the corridor, the wide one the detour.
+		const dtPolyRef corridorRef = navMesh->getPolyRefBase(navMesh->getTileAt(0, 0, 0)) | 1;
+		const dtPolyRef detourRef = navMesh->getPolyRefBase(navMesh->getTileAt(0, 0, 0)) | 4;
+		bool narrowInCorridor = false, wideInCorridor = false, wideInDetour = false;
+		for (int j = 0; j < pathCounts[0]; ++j)
+			narrowInCorridor |= paths[j].polyId == corridorRef;
+		for (int j = 0; j < pathCounts[1]; ++j)
+		{
+			wideInCorridor |= paths[MAX_PATH + j].polyId == corridorRef;
+			wideInDetour |= paths[MAX_PATH + j].polyId == detourRef;
+		}
+		REQUIRE(narrowInCorridor);
+		REQUIRE(!wideInCorridor);
+		REQUIRE(wideInDetour);
+		REQUIRE(!dtStatusDetail(pathStatuses[0], DT_PARTIAL_RESULT));
+		REQUIRE(!dtStatusDetail(pathStatuses[1], DT_PARTIAL_RESULT));
+		REQUIRE(dtStatusDetail(pathStatuses[2], DT_PARTIAL_RESULT));
+	}
+
+	SECTION("Equal radii share one path")
+	{
+		const float sameRadii[2] = { 0.2f, 0.2f };
+		REQUIRE(dtStatusSucceed(query->findPathByRadii(startFace, endFace, startPos, endPos, &filter,
+			sameRadii, 2, paths, pathCounts, MAX_PATH, portals, portalCounts, MAX_PATH, pathStatuses)));
+		REQUIRE(pathCounts[0] == pathCounts[1]);
+		for (int j = 0; j < pathCounts[0]; ++j)
+			REQUIRE(paths[j] == paths[MAX_PATH + j]);
+	}
+
+	SECTION("Invalid input")
+	{
+		const float unsorted[2] = { 1.5f, 0.2f };
+		REQUIRE(dtStatusFailed(query->findPathByRadii(startFace, endFace, startPos, endPos, &filter,
+			unsorted, 2, paths, pathCounts, MAX_PATH, portals, portalCounts, MAX_PATH)));
+		REQUIRE(dtStatusFailed(query->findPathByRadii(startFace, endFace, startPos, endPos, &filter,
+			radii, 0, paths, pathCounts, MAX_PATH, portals, portalCounts, MAX_PATH)));
+		const float tooMany[DT_MAX_STATES_PER_NODE + 1] = { 0.2f, 0.2f, 0.2f, 0.2f, 0.2f, 0.2f, 0.2f, 0.2f, 0.2f };
+		REQUIRE(dtStatusFailed(query->findPathByRadii(startFace, endFace, startPos, endPos, &filter,
+			tooMany, DT_MAX_STATES_PER_NODE + 1, paths, pathCounts, MAX_PATH, portals, portalCounts, MAX_PATH)));
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(navMesh);
+}
+
+TEST_CASE("dtNavMeshQuery::raycastByRadius")
+{
+	dtNavMesh* navMesh = createCorridorNavMesh(true);
+	REQUIRE(navMesh);
+
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(navMesh, 2048)));
+
+	dtQueryFilter filter;
+	const float halfExtents[3] = { 1, 1, 1 };
+	const float startPos[3] = { 1.0f, 0.0f, 1.5f };
+	const float endPos[3] = { 11.0f, 0.0f, 1.5f };
+
+	dtPolyFace startFace, endFace;
+	REQUIRE(dtStatusSucceed(query->findNearestFace(startPos, halfExtents, &filter, &startFace, 0)));
+	REQUIRE(dtStatusSucceed(query->findNearestFace(endPos, halfExtents, &filter, &endFace, 0)));
+
+	static const int MAX_PATH = 64;
+	dtPolyFace path[MAX_PATH];
+	int pathCount = 0;
+	float t = 0;
+	float hitNormal[3];
+
+	SECTION("Small units pass the corridor")
+	{
+		dtStatus status = query->raycastByRadius(startFace, startPos, endPos, &filter, 0.4f,
+			&t, hitNormal, path, &pathCount, MAX_PATH);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(t == FLT_MAX);
+		REQUIRE(pathCount > 2);
+		REQUIRE(path[0] == startFace);
+		REQUIRE(path[pathCount - 1] == endFace);
+	}
+
+	SECTION("Large units stop at the corridor entrance")
+	{
+		dtStatus status = query->raycastByRadius(startFace, startPos, endPos, &filter, 0.6f,
+			&t, hitNormal, path, &pathCount, MAX_PATH);
+		REQUIRE(dtStatusSucceed(status));
+
+		// The disc touches the entrance corners at x = 4 - sqrt(0.6^2 - 0.5^2).
+		const float hitX = 4.0f - dtMathSqrtf(0.6f * 0.6f - 0.5f * 0.5f);
+		REQUIRE(t == Approx((hitX - startPos[0]) / (endPos[0] - startPos[0])).epsilon(0.001));
+		REQUIRE(hitNormal[0] < 0.0f);
+		REQUIRE(hitNormal[1] == 0.0f);
+		REQUIRE(dtMathSqrtf(dtVlenSqr(hitNormal)) == Approx(1.0f));
+		REQUIRE(pathCount > 0);
+		REQUIRE(path[pathCount - 1].polyId == startFace.polyId);
+	}
+
+	SECTION("Walls hit straight on")
+	{
+		const float wallEnd[3] = { 1.0f, 0.0f, 10.0f };
+		dtStatus status = query->raycastByRadius(startFace, startPos, wallEnd, &filter, 0.5f,
+			&t, hitNormal, 0, 0, 0);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(t == Approx((3.5f - startPos[2]) / (wallEnd[2] - startPos[2])).epsilon(0.001));
+		REQUIRE(hitNormal[0] == Approx(0.0f).margin(0.001));
+		REQUIRE(hitNormal[2] == Approx(-1.0f));
+	}
+
+	SECTION("Start overlapping a wall")
+	{
+		const float nearWall[3] = { 1.0f, 0.0f, 0.2f };
+		dtPolyFace nearWallFace;
+		REQUIRE(dtStatusSucceed(query->findNearestFace(nearWall, halfExtents, &filter, &nearWallFace, 0)));
+		dtStatus status = query->raycastByRadius(nearWallFace, nearWall, endPos, &filter, 0.4f,
+			&t, 0, path, &pathCount, MAX_PATH);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(t == 0.0f);
+		REQUIRE(pathCount == 1);
+	}
+
+	SECTION("Path buffer too small")
+	{
+		dtStatus status = query->raycastByRadius(startFace, startPos, endPos, &filter, 0.4f,
+			&t, 0, path, &pathCount, 1);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(dtStatusDetail(status, DT_BUFFER_TOO_SMALL));
+		REQUIRE(t == FLT_MAX);
+		REQUIRE(pathCount == 1);
+	}
+
+	SECTION("Invalid input")
+	{
+		REQUIRE(dtStatusFailed(query->raycastByRadius(startFace, startPos, endPos, &filter, 0.0f,
+			&t, 0, 0, 0, 0)));
+		REQUIRE(dtStatusFailed(query->raycastByRadius(dtPolyFace(), startPos, endPos, &filter, 0.4f,
+			&t, 0, 0, 0, 0)));
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(navMesh);
+}
+
+TEST_CASE("dtNavMeshQuery::moveAlongSurfaceByRadius")
+{
+	dtNavMesh* navMesh = createCorridorNavMesh(true);
+	REQUIRE(navMesh);
+
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(navMesh, 2048)));
+
+	dtQueryFilter filter;
+	const float halfExtents[3] = { 1, 1, 1 };
+
+	static const int MAX_VISITED = 16;
+	dtPolyFace visited[MAX_VISITED];
+	int visitedCount = 0;
+	float resultPos[3];
+
+	SECTION("Free move inside a room")
+	{
+		const float startPos[3] = { 1.5f, 0.0f, 2.0f };
+		const float endPos[3] = { 2.5f, 0.0f, 2.5f };
+		dtPolyFace startFace;
+		REQUIRE(dtStatusSucceed(query->findNearestFace(startPos, halfExtents, &filter, &startFace, 0)));
+
+		dtStatus status = query->moveAlongSurfaceByRadius(startFace, startPos, endPos, &filter, 0.5f,
+			resultPos, visited, &visitedCount, MAX_VISITED);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(dtVequal(resultPos, endPos));
+		REQUIRE(visitedCount > 0);
+		REQUIRE(visited[0] == startFace);
+	}
+
+	SECTION("Keeps the radius from the walls")
+	{
+		const float startPos[3] = { 2.0f, 0.0f, 2.0f };
+		const float endPos[3] = { 2.0f, 0.0f, 3.9f };
+		dtPolyFace startFace;
+		REQUIRE(dtStatusSucceed(query->findNearestFace(startPos, halfExtents, &filter, &startFace, 0)));
+
+		dtStatus status = query->moveAlongSurfaceByRadius(startFace, startPos, endPos, &filter, 0.5f,
+			resultPos, visited, &visitedCount, MAX_VISITED);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(resultPos[0] == Approx(2.0f).margin(0.001));
+		REQUIRE(resultPos[2] == Approx(3.5f).margin(0.001));
+		REQUIRE(visitedCount > 0);
+		REQUIRE(visited[0] == startFace);
+	}
+
+	SECTION("Small units enter the corridor")
+	{
+		const float startPos[3] = { 3.5f, 0.0f, 1.5f };
+		const float endPos[3] = { 5.0f, 0.0f, 1.5f };
+		dtPolyFace startFace, endFace;
+		REQUIRE(dtStatusSucceed(query->findNearestFace(startPos, halfExtents, &filter, &startFace, 0)));
+		REQUIRE(dtStatusSucceed(query->findNearestFace(endPos, halfExtents, &filter, &endFace, 0)));
+
+		dtStatus status = query->moveAlongSurfaceByRadius(startFace, startPos, endPos, &filter, 0.4f,
+			resultPos, visited, &visitedCount, MAX_VISITED);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(dtVequal(resultPos, endPos));
+		REQUIRE(visitedCount > 1);
+		REQUIRE(visited[0] == startFace);
+		REQUIRE(visited[visitedCount - 1] == endFace);
+	}
+
+	SECTION("Large units do not fit into the corridor")
+	{
+		const float startPos[3] = { 3.2f, 0.0f, 1.5f };
+		const float endPos[3] = { 5.0f, 0.0f, 1.5f };
+		dtPolyFace startFace;
+		REQUIRE(dtStatusSucceed(query->findNearestFace(startPos, halfExtents, &filter, &startFace, 0)));
+
+		dtStatus status = query->moveAlongSurfaceByRadius(startFace, startPos, endPos, &filter, 0.6f,
+			resultPos, visited, &visitedCount, MAX_VISITED);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(resultPos[0] < 4.0f);
+		REQUIRE(visitedCount > 0);
+		REQUIRE(visited[visitedCount - 1].polyId == startFace.polyId);
+	}
+
+	SECTION("Visited buffer too small")
+	{
+		const float startPos[3] = { 3.5f, 0.0f, 1.5f };
+		const float endPos[3] = { 5.0f, 0.0f, 1.5f };
+		dtPolyFace startFace;
+		REQUIRE(dtStatusSucceed(query->findNearestFace(startPos, halfExtents, &filter, &startFace, 0)));
+
+		dtStatus status = query->moveAlongSurfaceByRadius(startFace, startPos, endPos, &filter, 0.4f,
+			resultPos, visited, &visitedCount, 1);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(dtStatusDetail(status, DT_BUFFER_TOO_SMALL));
+		REQUIRE(visitedCount == 1);
+		REQUIRE(visited[0] == startFace);
+	}
+
+	SECTION("Invalid input")
+	{
+		const float startPos[3] = { 2.0f, 0.0f, 2.0f };
+		REQUIRE(dtStatusFailed(query->moveAlongSurfaceByRadius(dtPolyFace(), startPos, startPos, &filter, 0.5f,
+			resultPos, visited, &visitedCount, MAX_VISITED)));
+		REQUIRE(visitedCount == 0);
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(navMesh);
+}
+
+TEST_CASE("funnel::straightPathByRadius")
+{
+	dtNavMesh* navMesh = createCorridorNavMesh(true);
+	REQUIRE(navMesh);
+
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(navMesh, 2048)));
+
+	dtQueryFilter filter;
+	const float halfExtents[3] = { 1, 1, 1 };
+	const float startPos[3] = { 1.0f, 0.0f, 3.5f };
+	const float endPos[3] = { 11.0f, 0.0f, 0.2f };
+
+	dtPolyFace startFace, endFace;
+	REQUIRE(dtStatusSucceed(query->findNearestFace(startPos, halfExtents, &filter, &startFace, 0)));
+	REQUIRE(dtStatusSucceed(query->findNearestFace(endPos, halfExtents, &filter, &endFace, 0)));
+
+	static const int MAX_PATH = 64;
+	dtPolyFace path[MAX_PATH];
+	dtPolyEdge portals[MAX_PATH];
+	int pathCount = 0;
+	int portalCount = 0;
+	REQUIRE(dtStatusSucceed(query->findPathByRadius(startFace, endFace, startPos, endPos, &filter,
+		path, &pathCount, MAX_PATH, portals, &portalCount, MAX_PATH, 0.4f)));
+	REQUIRE(portalCount > 1);
+
+	float straightPath[MAX_PATH * 3];
+	int straightPathCount = 0;
+
+	SECTION("Scratch must hold every portal vertex")
+	{
+		funnel::dtRadiusPathScratch scratch;
+		REQUIRE(scratch.init(portalCount + 2));
+		dtStatus status = funnel::straightPathByRadius(startPos, endPos, path, pathCount, portals, portalCount,
+			straightPath, 0, 0, &straightPathCount, MAX_PATH, 0.4f, &scratch);
+		REQUIRE(dtStatusFailed(status));
+		REQUIRE(dtStatusDetail(status, DT_BUFFER_TOO_SMALL));
+
+		REQUIRE(dtStatusFailed(funnel::straightPathByRadius(startPos, endPos, path, pathCount, portals, portalCount,
+			straightPath, 0, 0, &straightPathCount, MAX_PATH, 0.4f, 0)));
+	}
+
+	SECTION("Scratch is reused across queries")
+	{
+		funnel::dtRadiusPathScratch scratch;
+		REQUIRE(scratch.init(MAX_PATH + 3));
+		const int memUsed = scratch.getMemUsed();
+
+		for (int run = 0; run < 2; ++run)
+		{
+			dtStatus status = funnel::straightPathByRadius(startPos, endPos, path, pathCount, portals, portalCount,
+				straightPath, 0, 0, &straightPathCount, MAX_PATH, 0.4f, &scratch);
+			REQUIRE(dtStatusSucceed(status));
+
+			// The path has to turn around both corridor entrances.
+			REQUIRE(straightPathCount == 4);
+			REQUIRE(dtVequal(&straightPath[0], startPos));
+			REQUIRE(dtVequal(&straightPath[(straightPathCount - 1) * 3], endPos));
+			REQUIRE(straightPath[1 * 3 + 0] == Approx(4.0f));
+			REQUIRE(straightPath[1 * 3 + 2] == Approx(2.0f));
+			REQUIRE(straightPath[2 * 3 + 0] == Approx(8.0f));
+			REQUIRE(straightPath[2 * 3 + 2] == Approx(1.0f));
+
+			float modifiedPath[MAX_PATH * 3];
+			int modifiedPathCount = 0;
+			funnel::dtRadiusModifier modifier(0.4f, 10.0f);
+			status = modifier.applyModify(straightPath, straightPathCount, modifiedPath, &modifiedPathCount, MAX_PATH, &scratch);
+			REQUIRE(dtStatusSucceed(status));
+			REQUIRE(modifiedPathCount >= straightPathCount);
+			REQUIRE(dtVequal(&modifiedPath[0], startPos));
+			REQUIRE(dtVequal(&modifiedPath[(modifiedPathCount - 1) * 3], endPos));
+
+			status = modifier.applyModify(straightPath, straightPathCount, modifiedPath, &modifiedPathCount, 3, &scratch);
+			REQUIRE(dtStatusSucceed(status));
+			REQUIRE(dtStatusDetail(status, DT_BUFFER_TOO_SMALL));
+			REQUIRE(modifiedPathCount == 3);
+		}
+
+		REQUIRE(scratch.init(8));
+		REQUIRE(scratch.getMemUsed() == memUsed);
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(navMesh);
+}
+
+TEST_CASE("debug::dtTraceBuffer")
+{
+	SECTION("Old events are overwritten when the ring wraps")
+	{
+		debug::dtTraceBuffer trace;
+		REQUIRE(trace.getEventCount() == 0);
+		REQUIRE(trace.init(5));
+		REQUIRE(trace.getCapacity() == 8);
+
+		for (int i = 0; i < 10; ++i)
+			trace.record(debug::DT_TRACE_FACE_EXPANDED, 1, 0, (unsigned short)i, (float)i, 0, 0);
+
+		REQUIRE(trace.getEventCount() == 8);
+		REQUIRE(trace.getDroppedCount() == 2);
+		REQUIRE(trace.getEvent(0)->seq == 2);
+		REQUIRE(trace.getEvent(0)->arg == 2);
+		REQUIRE(trace.getEvent(7)->seq == 9);
+		REQUIRE(trace.getEvent(8) == 0);
+
+		debug::dtTraceEvent events[4];
+		REQUIRE(trace.copyEvents(events, 4) == 4);
+		REQUIRE(events[3].seq == 5);
+
+		trace.clear();
+		REQUIRE(trace.getEventCount() == 0);
+		REQUIRE(trace.getDroppedCount() == 0);
+	}
+
+	dtNavMesh* navMesh = createCorridorNavMesh(true);
+	REQUIRE(navMesh);
+
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(navMesh, 2048)));
+
+	dtQueryFilter filter;
+	const float halfExtents[3] = { 1, 1, 1 };
+	const float startPos[3] = { 1.0f, 0.0f, 2.0f };
+	const float endPos[3] = { 11.0f, 0.0f, 2.0f };
+
+	dtPolyFace startFace, endFace;
+	REQUIRE(dtStatusSucceed(query->findNearestFace(startPos, halfExtents, &filter, &startFace, 0)));
+	REQUIRE(dtStatusSucceed(query->findNearestFace(endPos, halfExtents, &filter, &endFace, 0)));
+
+	static const int MAX_PATH = 64;
+	dtPolyFace path[MAX_PATH];
+	dtPolyEdge portals[MAX_PATH];
+	int pathCount = 0;
+	int portalCount = 0;
+
+	debug::dtTraceBuffer trace;
+	REQUIRE(trace.init(1024));
+	query->setTraceBuffer(&trace);
+
+	SECTION("Radius search records its expanded and rejected faces")
+	{
+		dtStatus status = query->findPathByRadius(startFace, endFace, startPos, endPos, &filter,
+			path, &pathCount, MAX_PATH, portals, &portalCount, MAX_PATH, 0.8f);
+		REQUIRE(dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(trace.getEventCount() > 2);
+		REQUIRE(trace.getDroppedCount() == 0);
+
+		const debug::dtTraceEvent* first = trace.getEvent(0);
+		REQUIRE(first->type == debug::DT_TRACE_SEARCH_BEGIN);
+		REQUIRE(first->ref == startFace.polyId);
+		REQUIRE(first->prim == startFace.innerIdx);
+
+		const debug::dtTraceEvent* last = trace.getEvent(trace.getEventCount() - 1);
+		REQUIRE(last->type == debug::DT_TRACE_SEARCH_END);
+		REQUIRE((last->arg & DT_PARTIAL_RESULT) != 0);
+
+		int expanded = 0;
+		int rejected = 0;
+		for (int i = 0; i < trace.getEventCount(); ++i)
+		{
+			const debug::dtTraceEvent* ev = trace.getEvent(i);
+			if (ev->type == debug::DT_TRACE_FACE_EXPANDED)
+				++expanded;
+			else if (ev->type == debug::DT_TRACE_RADIUS_REJECTED)
+			{
+				REQUIRE(ev->data[0] == Approx(0.8f));
+				++rejected;
+			}
+		}
+		REQUIRE(expanded > 0);
+		REQUIRE(rejected > 0);
+
+		char line[128];
+		REQUIRE(debug::formatTraceEvent(*first, line, sizeof(line)) > 0);
+		REQUIRE(strstr(line, "search_begin") != 0);
+
+		// Truncated output stays null terminated.
+		char shortLine[8];
+		REQUIRE(debug::formatTraceEvent(*last, shortLine, sizeof(shortLine)) == 7);
+		REQUIRE(strlen(shortLine) == 7);
+	}
+
+	SECTION("Sliced search records to the same buffer")
+	{
+		REQUIRE(dtStatusInProgress(query->initSlicedFindPathByRadius(startFace, endFace, startPos, endPos, &filter, 0.4f)));
+		dtStatus status = DT_IN_PROGRESS;
+		while (dtStatusInProgress(status))
+			status = query->updateSlicedFindPathByRadius(4, 0);
+		REQUIRE(dtStatusSucceed(query->finalizeSlicedFindPathByRadius(path, &pathCount, MAX_PATH,
+			portals, &portalCount, MAX_PATH)));
+
+		REQUIRE(trace.getEvent(0)->type == debug::DT_TRACE_SEARCH_BEGIN);
+		REQUIRE(trace.getEvent(trace.getEventCount() - 1)->type == debug::DT_TRACE_SEARCH_END);
+		REQUIRE(trace.getEvent(trace.getEventCount() - 1)->ref == endFace.polyId);
+	}
+
+	SECTION("Funnel records a step per funnel point")
+	{
+		REQUIRE(dtStatusSucceed(query->findPathByRadius(startFace, endFace, startPos, endPos, &filter,
+			path, &pathCount, MAX_PATH, portals, &portalCount, MAX_PATH, 0.4f)));
+		trace.clear();
+
+		funnel::dtRadiusPathScratch scratch;
+		REQUIRE(scratch.init(MAX_PATH + 3));
+		scratch.setTraceBuffer(&trace);
+
+		float straightPath[MAX_PATH * 3];
+		int straightPathCount = 0;
+		REQUIRE(dtStatusSucceed(funnel::straightPathByRadius(startPos, endPos, path, pathCount, portals, portalCount,
+			straightPath, 0, 0, &straightPathCount, MAX_PATH, 0.4f, &scratch)));
+
+		REQUIRE(trace.getEventCount() >= portalCount + 2);
+		for (int i = 0; i < trace.getEventCount(); ++i)
+			REQUIRE(trace.getEvent(i)->type == debug::DT_TRACE_FUNNEL_STEP);
+		const debug::dtTraceEvent* last = trace.getEvent(trace.getEventCount() - 1);
+		REQUIRE(dtVequal(last->data, endPos));
+	}
+
+	SECTION("No events are recorded without a buffer")
+	{
+		query->setTraceBuffer(0);
+		REQUIRE(dtStatusSucceed(query->findPathByRadius(startFace, endFace, startPos, endPos, &filter,
+			path, &pathCount, MAX_PATH, portals, &portalCount, MAX_PATH, 0.4f)));
+		REQUIRE(trace.getEventCount() == 0);
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(navMesh);
+}
+
+// One result of the radius pipeline, compared field by field between the threads.
+struct RadiusPipelineResult
+{
+	dtStatus status;
+	int pathCount;
+	dtPolyFace path[64];
+	int straightPathCount;
+	float straightPath[64 * 3];
+};
+
+static void runRadiusPipeline(dtNavMeshQuery* query, funnel::dtRadiusPathScratch* scratch, const dtQueryFilter* filter,
+	const float* startPos, const float* endPos, const float radius, RadiusPipelineResult* result)
+{
+	const float halfExtents[3] = { 1, 1, 1 };
+	*result = RadiusPipelineResult();
+
+	dtPolyFace startFace, endFace;
+	query->findNearestFace(startPos, halfExtents, filter, &startFace, 0);
+	query->findNearestFace(endPos, halfExtents, filter, &endFace, 0);
+
+	dtPolyEdge portals[64];
+	int portalCount = 0;
+	result->status = query->findPathByRadius(startFace, endFace, startPos, endPos, filter,
+		result->path, &result->pathCount, 64, portals, &portalCount, 64, radius);
+	if (dtStatusFailed(result->status))
+		return;
+
+	funnel::straightPathByRadius(startPos, endPos, result->path, result->pathCount, portals, portalCount,
+		result->straightPath, 0, 0, &result->straightPathCount, 64, radius, scratch);
+}
+
+static bool sameRadiusPipelineResult(const RadiusPipelineResult& a, const RadiusPipelineResult& b)
+{
+	if (a.status != b.status || a.pathCount != b.pathCount || a.straightPathCount != b.straightPathCount)
+		return false;
+	for (int i = 0; i < a.pathCount; ++i)
+	{
+		if (a.path[i] != b.path[i])
+			return false;
+	}
+	return memcmp(a.straightPath, b.straightPath, sizeof(float) * 3 * a.straightPathCount) == 0;
+}
+
+TEST_CASE("dtNavMeshQuery radius queries from parallel threads")
+{
+	// One navmesh shared by all threads, each thread has its own query and scratch.
+	dtNavMesh* navMesh = createMazeNavMesh(true);
+	REQUIRE(navMesh);
+
+	static const int QUERY_COUNT = 4;
+	const float queries[QUERY_COUNT][7] = {
+		// start, end, radius
+		{ 1.0f, 0.0f, 1.0f,   1.0f, 0.0f, 9.0f,   0.4f },
+		{ 1.0f, 0.0f, 1.0f,   3.0f, 0.0f, 13.0f,  0.4f },
+		{ 3.0f, 0.0f, 13.0f,  1.0f, 0.0f, 1.0f,   0.2f },
+		{ 1.0f, 0.0f, 1.0f,   1.0f, 0.0f, 9.0f,   1.2f },
+	};
+
+	dtQueryFilter filter;
+
+	// Reference results from a single thread.
+	RadiusPipelineResult expected[QUERY_COUNT];
+	{
+		dtNavMeshQuery* query = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(query->init(navMesh, 2048)));
+		funnel::dtRadiusPathScratch scratch;
+		REQUIRE(scratch.init(64 + 3));
+		for (int i = 0; i < QUERY_COUNT; ++i)
+		{
+			runRadiusPipeline(query, &scratch, &filter, &queries[i][0], &queries[i][3], queries[i][6], &expected[i]);
+			REQUIRE(dtStatusSucceed(expected[i].status));
+			REQUIRE(expected[i].pathCount > 1);
+		}
+		dtFreeNavMeshQuery(query);
+	}
+
+	// Catch is not thread safe, the threads only count the mismatches.
+	static const int THREAD_COUNT = 8;
+	static const int ITERATIONS = 200;
+	std::vector<int> mismatches(THREAD_COUNT, 0);
+	std::vector<int> initFailures(THREAD_COUNT, 0);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < THREAD_COUNT; ++t)
+	{
+		threads.push_back(std::thread([&, t]()
+		{
+			dtNavMeshQuery* query = dtAllocNavMeshQuery();
+			funnel::dtRadiusPathScratch scratch;
+			if (!query || dtStatusFailed(query->init(navMesh, 2048)) || !scratch.init(64 + 3))
+			{
+				initFailures[t] = 1;
+				dtFreeNavMeshQuery(query);
+				return;
+			}
+
+			RadiusPipelineResult result;
+			for (int iter = 0; iter < ITERATIONS; ++iter)
+			{
+				const int i = (iter + t) % QUERY_COUNT;
+				runRadiusPipeline(query, &scratch, &filter, &queries[i][0], &queries[i][3], queries[i][6], &result);
+				if (!sameRadiusPipelineResult(result, expected[i]))
+					mismatches[t]++;
+			}
+
+			dtFreeNavMeshQuery(query);
+		}));
+	}
+	for (size_t t = 0; t < threads.size(); ++t)
+		threads[t].join();
+
+	for (int t = 0; t < THREAD_COUNT; ++t)
+	{
+		REQUIRE(initFailures[t] == 0);
+		REQUIRE(mismatches[t] == 0);
+	}
+
+	dtFreeNavMesh(navMesh);
+}
@@ -0,0 +1,167 @@
+#include <string.h>
+
+#include "catch.hpp"
+#include "TestNavMesh.h"
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourCommon.h"
+#include "DetourFaceCorridor.h"
+#include "DetourCrowd.h"
+
+TEST_CASE("dtFaceCorridor")
+{
+	dtNavMesh* navMesh = createCorridorNavMesh(true);
+	REQUIRE(navMesh);
+
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(navMesh, 2048)));
+
+	dtQueryFilter filter;
+	const float halfExtents[3] = { 1, 1, 1 };
+	const float startPos[3] = { 1.0f, 0.0f, 3.5f };
+	const float endPos[3] = { 11.0f, 0.0f, 0.2f };
+	dtPolyFace startFace, endFace;
+	REQUIRE(dtStatusSucceed(query->findNearestFace(startPos, halfExtents, &filter, &startFace, 0)));
+	REQUIRE(dtStatusSucceed(query->findNearestFace(endPos, halfExtents, &filter, &endFace, 0)));
+
+	SECTION("Corners and movement through the corridor")
+	{
+		static const int MAX_PATH = 64;
+		dtPolyFace path[MAX_PATH];
+		dtPolyEdge portals[MAX_PATH];
+		int pathCount = 0, portalCount = 0;
+		REQUIRE(dtStatusSucceed(query->findPathByRadius(startFace, endFace, startPos, endPos, &filter,
+			path, &pathCount, MAX_PATH, portals, &portalCount, MAX_PATH, 0.4f)));
+
+		dtFaceCorridor corridor;
+		REQUIRE(corridor.init(MAX_PATH));
+		corridor.reset(startFace, startPos);
+		corridor.setCorridor(endPos, path, pathCount);
+		REQUIRE(corridor.getPathCount() == pathCount);
+		REQUIRE(corridor.getFirstFace() == startFace);
+		REQUIRE(corridor.getLastFace() == endFace);
+		REQUIRE(dtVequal(corridor.getTarget(), endPos));
+		REQUIRE(corridor.isValid(MAX_PATH, query, &filter));
+
+		funnel::dtRadiusPathScratch scratch;
+		REQUIRE(scratch.init(MAX_PATH + 3));
+
+		static const int MAX_CORNERS = 8;
+		float cornerVerts[MAX_CORNERS*3];
+		unsigned char cornerFlags[MAX_CORNERS];
+		int ncorners = corridor.findCorners(cornerVerts, cornerFlags, MAX_CORNERS, 0.4f, &scratch);
+		REQUIRE(ncorners > 0);
+		// The first corner goes around the corridor entrance at the agent radius.
+		REQUIRE(cornerVerts[0] <= 4.0f);
+		REQUIRE(dtVdist2D(&cornerVerts[0], startPos) > 0.01f);
+		REQUIRE(!(cornerFlags[0] & DT_STRAIGHTPATH_END));
+		const float entrance[3] = { 4.0f, 0.0f, 2.0f };
+		REQUIRE(dtVdist2D(&cornerVerts[0], entrance) == Approx(0.4f).margin(0.05f));
+
+		// Walk the corridor, the first face follows the position.
+		for (int i = 0; i < 100; ++i)
+		{
+			ncorners = corridor.findCorners(cornerVerts, cornerFlags, MAX_CORNERS, 0.4f, &scratch);
+			REQUIRE(ncorners > 0);
+			float dir[3], npos[3];
+			dtVsub(dir, cornerVerts, corridor.getPos());
+			dir[1] = 0;
+			const float len = dtVlen(dir);
+			dtVmad(npos, corridor.getPos(), dir, dtMin(len, 0.25f) / len);
+			REQUIRE(corridor.movePosition(npos, 0.4f, query, &filter));
+		}
+		// The target is closer to the wall than the radius, the agent stops at the radius.
+		REQUIRE(corridor.getPos()[0] == Approx(endPos[0]).margin(0.01f));
+		REQUIRE(corridor.getPos()[2] == Approx(0.4f).margin(0.01f));
+		REQUIRE(corridor.getLastFace() == endFace);
+		REQUIRE(corridor.getPathCount() <= 2);
+	}
+
+	SECTION("Merge a moved start")
+	{
+		dtPolyFace path[4];
+		dtPolyEdge portals[4];
+		path[0] = startFace;
+		const int npath = dtMergeFaceCorridorStartMoved(path, portals, 1, 4, &startFace, 1);
+		REQUIRE(npath == 1);
+		REQUIRE(path[0] == startFace);
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(navMesh);
+}
+
+TEST_CASE("dtCrowd radius path")
+{
+	dtNavMesh* navMesh = createCorridorNavMesh(true);
+	REQUIRE(navMesh);
+
+	dtCrowd* crowd = dtAllocCrowd();
+	REQUIRE(crowd->init(4, 1.0f, navMesh));
+	// Agents larger than the threshold use the face corridor.
+	crowd->setRadiusPathThreshold(0.3f);
+
+	dtCrowdAgentParams params;
+	memset(&params, 0, sizeof(params));
+	params.height = 2.0f;
+	params.maxAcceleration = 8.0f;
+	params.maxSpeed = 3.0f;
+	params.collisionQueryRange = 4.0f;
+	params.pathOptimizationRange = 8.0f;
+	params.updateFlags = DT_CROWD_ANTICIPATE_TURNS | DT_CROWD_OPTIMIZE_VIS | DT_CROWD_OPTIMIZE_TOPO;
+
+	const float startPos[3] = { 1.0f, 0.0f, 3.5f };
+	const float endPos[3] = { 11.0f, 0.0f, 0.2f };
+	dtPolyRef targetRef;
+	float targetPos[3];
+	REQUIRE(dtStatusSucceed(crowd->getNavMeshQuery()->findNearestPoly(endPos, crowd->getQueryHalfExtents(),
+		crowd->getFilter(0), &targetRef, targetPos)));
+
+	SECTION("Small agents pass the corridor")
+	{
+		params.radius = 0.4f;
+		const int idx = crowd->addAgent(startPos, &params);
+		REQUIRE(idx >= 0);
+		REQUIRE(crowd->getAgent(idx)->radiusPath);
+		REQUIRE(crowd->requestMoveTarget(idx, targetRef, targetPos));
+
+		for (int i = 0; i < 300; ++i)
+			crowd->update(0.05f, 0);
+
+		const dtCrowdAgent* ag = crowd->getAgent(idx);
+		REQUIRE(ag->targetState == DT_CROWDAGENT_TARGET_VALID);
+		REQUIRE(ag->npos[0] > 8.0f);
+		REQUIRE(ag->corridor.getFirstPoly() == targetRef);
+	}
+
+	SECTION("Large agents stay in their room")
+	{
+		params.radius = 0.6f;
+		const int idx = crowd->addAgent(startPos, &params);
+		REQUIRE(idx >= 0);
+		REQUIRE(crowd->requestMoveTarget(idx, targetRef, targetPos));
+
+		for (int i = 0; i < 300; ++i)
+		{
+			crowd->update(0.05f, 0);
+			REQUIRE(crowd->getAgent(idx)->npos[0] < 4.0f);
+		}
+	}
+
+	SECTION("Changing the radius switches the corridor")
+	{
+		params.radius = 0.2f;
+		const int idx = crowd->addAgent(startPos, &params);
+		REQUIRE(idx >= 0);
+		REQUIRE(!crowd->getAgent(idx)->radiusPath);
+
+		params.radius = 0.4f;
+		crowd->updateAgentParameters(idx, &params);
+		REQUIRE(crowd->getAgent(idx)->radiusPath);
+		REQUIRE(crowd->getAgent(idx)->faceCorridor.getPathCount() == 1);
+	}
+
+	dtFreeCrowd(crowd);
+	dtFreeNavMesh(navMesh);
+}
@@ -0,0 +1,174 @@
+#ifndef TESTNAVMESH_H
+#define TESTNAVMESH_H
+
+#include <string.h>
+
+#include "DetourAlloc.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshBuilder.h"
+
+// Fills the creation parameters of a test tile with unit cells, the agent of the tests and the polygon BV tree.
+// The caller sets the bounds, the tile location and the optional layers.
+inline void initTestNavMeshParams(dtNavMeshCreateParams* params,
+	const unsigned short* verts, const int vertCount,
+	const unsigned short* polys, const unsigned short* polyFlags, const unsigned char* polyAreas,
+	const int polyCount, const int nvp)
+{
+	memset(params, 0, sizeof(*params));
+	params->verts = verts;
+	params->vertCount = vertCount;
+	params->polys = polys;
+	params->polyFlags = polyFlags;
+	params->polyAreas = polyAreas;
+	params->polyCount = polyCount;
+	params->nvp = nvp;
+	params->walkableHeight = 2.0f;
+	params->walkableRadius = 0.0f;
+	params->walkableClimb = 0.5f;
+	params->cs = 1.0f;
+	params->ch = 1.0f;
+	params->buildBvTree = true;
+}
+
+// Builds a single tile navigation mesh from the creation parameters.
+// Returns null on failure, the caller frees the mesh with dtFreeNavMesh.
+inline dtNavMesh* createTestNavMesh(dtNavMeshCreateParams* params)
+{
+	unsigned char* navData = 0;
+	int navDataSize = 0;
+	if (!dtCreateNavMeshData(params, &navData, &navDataSize))
+		return 0;
+
+	dtNavMesh* navMesh = dtAllocNavMesh();
+	if (dtStatusFailed(navMesh->init(navData, navDataSize, DT_TILE_FREE_DATA)))
+	{
+		dtFree(navData);
+		dtFreeNavMesh(navMesh);
+		return 0;
+	}
+	return navMesh;
+}
+
+// Two 4x4 rooms connected by a 4 units long and 1 unit wide corridor.
+//
+//  z=4 +-----+           +-----+
+//      |     |           |     |
+//  z=2 |     +-----------+     |
+//  z=1 |     +-----------+     |
+//      |     |           |     |
+//  z=0 +-----+           +-----+
+//     x=0   x=4         x=8   x=12
+//
+// The polygons are wound like the ones built by rcBuildPolyMesh.
+inline dtNavMesh* createCorridorNavMesh(bool buildFaceClearance, bool buildFaceBvTree = false)
+{
+	static const unsigned short NONE = 0xffff;
+	static const unsigned short verts[] = {
+		0,0,0,  4,0,0,  4,0,1,  4,0,2,  4,0,4,  0,0,4,
+		8,0,1,  8,0,2,
+		12,0,0, 12,0,4, 8,0,4,  8,0,0,
+	};
+	static const unsigned short polys[] = {
+		// Room A
+		0, 5, 4, 3, 2, 1,		NONE, NONE, NONE, 1, NONE, NONE,
+		// Corridor
+		2, 3, 7, 6, NONE, NONE,	0, NONE, 2, NONE, NONE, NONE,
+		// Room B
+		8, 11, 6, 7, 10, 9,		NONE, NONE, 1, NONE, NONE, NONE,
+	};
+	static const unsigned short polyFlags[] = { 1, 1, 1 };
+	static const unsigned char polyAreas[] = { 0, 0, 0 };
+
+	dtNavMeshCreateParams params;
+	initTestNavMeshParams(&params, verts, 12, polys, polyFlags, polyAreas, 3, 6);
+	params.bmin[0] = 0; params.bmin[1] = 0; params.bmin[2] = 0;
+	params.bmax[0] = 12; params.bmax[1] = 1; params.bmax[2] = 4;
+	params.buildFaceClearance = buildFaceClearance;
+	params.buildFaceBvTree = buildFaceBvTree;
+
+	return createTestNavMesh(&params);
+}
+
+// Two loops around the holes H with a dead-end spur on top, made of 2x2 cells.
+//
+//  z=14     +---+
+//           |   |          spur
+//  z=10 +---+---+---+
+//       |   |   |   |
+//       +---+---+---+
+//       |   | H |   |
+//       +---+---+---+
+//       |   |   |   |
+//       +---+---+---+
+//       |   | H |   |
+//       +---+---+---+
+//       |   |   |   |
+//   z=0 +---+---+---+
+//      x=0         x=6
+inline dtNavMesh* createMazeNavMesh(bool buildFaceAbstraction)
+{
+	static const unsigned short NONE = 0xffff;
+	static const int CELL_COUNT = 15;
+	static const int cells[CELL_COUNT][2] = {
+		{0,0}, {1,0}, {2,0},
+		{0,1}, {2,1},
+		{0,2}, {1,2}, {2,2},
+		{0,3}, {2,3},
+		{0,4}, {1,4}, {2,4},
+		{1,5}, {1,6},
+	};
+
+	// Vertex grid of 4 x 8 cell corners.
+	unsigned short verts[4*8*3];
+	for (int z = 0; z < 8; ++z)
+	{
+		for (int x = 0; x < 4; ++x)
+		{
+			unsigned short* v = &verts[(z*4+x)*3];
+			v[0] = (unsigned short)(x*2);
+			v[1] = 0;
+			v[2] = (unsigned short)(z*2);
+		}
+	}
+
+	// Quads wound like the ones built by rcBuildPolyMesh, edges: -x, +z, +x, -z.
+	static const int dirs[4][2] = { {-1,0}, {0,1}, {1,0}, {0,-1} };
+	unsigned short polys[CELL_COUNT*2*4];
+	for (int i = 0; i < CELL_COUNT; ++i)
+	{
+		const int x = cells[i][0], z = cells[i][1];
+		unsigned short* p = &polys[i*2*4];
+		p[0] = (unsigned short)(z*4+x);
+		p[1] = (unsigned short)((z+1)*4+x);
+		p[2] = (unsigned short)((z+1)*4+x+1);
+		p[3] = (unsigned short)(z*4+x+1);
+		for (int j = 0; j < 4; ++j)
+		{
+			p[4+j] = NONE;
+			for (int k = 0; k < CELL_COUNT; ++k)
+			{
+				if (cells[k][0] == x+dirs[j][0] && cells[k][1] == z+dirs[j][1])
+					p[4+j] = (unsigned short)k;
+			}
+		}
+	}
+
+	unsigned short polyFlags[CELL_COUNT];
+	unsigned char polyAreas[CELL_COUNT];
+	for (int i = 0; i < CELL_COUNT; ++i)
+	{
+		polyFlags[i] = 1;
+		polyAreas[i] = 0;
+	}
+
+	dtNavMeshCreateParams params;
+	initTestNavMeshParams(&params, verts, 4*8, polys, polyFlags, polyAreas, CELL_COUNT, 4);
+	params.bmin[0] = 0; params.bmin[1] = 0; params.bmin[2] = 0;
+	params.bmax[0] = 6; params.bmax[1] = 1; params.bmax[2] = 14;
+	params.buildFaceClearance = true;
+	params.buildFaceAbstraction = buildFaceAbstraction;
+
+	return createTestNavMesh(&params);
+}
+
+#endif // TESTNAVMESH_H